@@ -1,10 +1,13 @@
 #version 410
 
+#include "common/uniform_blocks.glsl"
+
 layout (location = 0) in vec3 vertex;
+layout (location = 1) in vec3 normal;
+layout (location = 3) in vec4 tangent;
 layout (location = 4) in vec3 binormal;
 
-uniform mat4 vertex_model_to_world;
-uniform mat4 vertex_world_to_clip;
+uniform bool has_binormals;
 
 out VS_OUT {
 	vec3 binormal;
@@ -13,7 +16,9 @@ out VS_OUT {
 
 void main()
 {
-	vs_out.binormal = binormal;
+	// Compact vertex formats only store the handedness of the binormal,
+	// in the sign of tangent.w
+	vs_out.binormal = has_binormals ? binormal : cross(normal, tangent.xyz) * sign(tangent.w);
 
 	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
 }
@@ -1,6 +1,7 @@
 #version 410
 
-uniform mat4 normal_model_to_world;// Inverse transpose
+#include "common/uniform_blocks.glsl"
+
 uniform sampler2D my_normal_map;
 uniform sampler2D my_diffuse;
 
@@ -28,6 +29,8 @@ void main()
     mat3 TBN = mat3(T,B,N);
 
     vec3 ntext= (texture(my_normal_map, TC.xy).xyz)*2 - 1;
+    // Rebuild z, which BC5-compressed normal maps do not store.
+    ntext.z = sqrt(max(1.0 - dot(ntext.xy, ntext.xy), 0.0));
     vec3 diffuse_text= (texture(my_diffuse, TC.xy).xyz);
 
     vec3 bump = (normalize(normal_model_to_world * (mat4(vec4(T,0),vec4(B,0), vec4(N,0), vec4(0,0,0,1))) * (vec4(ntext, 0)))).xyz;
@@ -0,0 +1,34 @@
+#version 410
+
+uniform sampler2D my_normal_map;
+uniform sampler2D my_diffuse;
+
+in VS_OUT {
+	vec3 N; // Normal, in world space
+	vec3 T; // Tangent, in world space
+	vec3 B; // Binormal, in world space
+	vec3 tc;
+	vec3 Lf; // Light vector
+} fs_in;
+
+out vec4 fColor;
+
+void main()
+{
+	vec3 N = normalize(fs_in.N);
+	vec3 T = normalize(fs_in.T);
+	vec3 B = normalize(fs_in.B);
+	vec3 L = normalize(fs_in.Lf);
+	mat3 TBN = mat3(T,B,N);
+
+	vec3 ntext = texture(my_normal_map, fs_in.tc.xy).xyz*2 - 1;
+	// Rebuild z, which BC5-compressed normal maps do not store.
+	ntext.z = sqrt(max(1.0 - dot(ntext.xy, ntext.xy), 0.0));
+	vec3 diffuse_text = texture(my_diffuse, fs_in.tc.xy).xyz;
+
+	// The TBN basis is already in world space.
+	vec3 bump = normalize(TBN*ntext);
+
+	fColor.xyz = diffuse_text*max(dot(L,bump),0.0);
+	fColor.w = 1.0;
+}
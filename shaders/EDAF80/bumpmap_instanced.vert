@@ -0,0 +1,37 @@
+#version 410
+
+#include "common/uniform_blocks.glsl"
+
+layout (location = 0) in vec3 Pos;// Defined in model space
+layout (location = 1) in vec3 Normal;// Defined in model space
+layout (location = 2) in vec3 textcoord;// Defined in model space
+layout (location = 3) in vec4 tan;// Defined in model space; w is the handedness of the binormal
+layout (location = 4) in vec3 binorm;// Defined in model space
+layout (location = 5) in mat4 instance_model_to_world;// Model -> World space, uses locations 5 to 8
+
+uniform bool has_binormals; // otherwise rebuilt from the normal and tangent
+
+out VS_OUT {
+	vec3 N; // Normal, in world space
+	vec3 T; // Tangent, in world space
+	vec3 B; // Binormal, in world space
+	vec3 tc;
+	vec3 Lf; // Light vector
+} fs_out;
+
+void main()
+{
+	vec3 worldPos = (instance_model_to_world*vec4(Pos,1)).xyz;
+	// Instances are scaled uniformly, so the model matrix can transform
+	// the normals; they are normalised in the fragment shader.
+	mat3 normal_model_to_world = mat3(instance_model_to_world);
+	// Compact vertex formats only store the handedness of the binormal,
+	// in the sign of tan.w
+	vec3 B = has_binormals ? binorm : cross(Normal, tan.xyz) * sign(tan.w);
+	fs_out.N = normal_model_to_world*Normal;
+	fs_out.T = normal_model_to_world*tan.xyz;
+	fs_out.B = normal_model_to_world*B;
+	fs_out.tc = textcoord;
+	fs_out.Lf = light_position - worldPos;
+	gl_Position = vertex_world_to_clip*vec4(worldPos,1);
+}
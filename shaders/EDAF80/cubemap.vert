@@ -1,10 +1,6 @@
 #version 410
 
-uniform vec3 camera_position; // Defined in world space
-
-uniform mat4 vertex_model_to_world;// Model -> World space
-uniform mat4 normal_model_to_world;// Inverse transpose
-uniform mat4 vertex_world_to_clip;// Model -> Clip space
+#include "common/uniform_blocks.glsl"
 
 
 layout (location = 0) in vec3 Pos;// Defined in model space
@@ -1,11 +1,10 @@
 #version 410
 
+#include "common/uniform_blocks.glsl"
+
 layout (location = 0) in vec3 vertex;
 layout (location = 2) in vec3 texcoord;
 
-uniform mat4 vertex_model_to_world;
-uniform mat4 vertex_world_to_clip;
-
 out VS_OUT {
 	vec2 texcoord;
 } vs_out;
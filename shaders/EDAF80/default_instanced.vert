@@ -0,0 +1,20 @@
+#version 410
+
+#include "common/uniform_blocks.glsl"
+
+layout (location = 0) in vec3 vertex;
+layout (location = 2) in vec3 texcoord;
+layout (location = 5) in mat4 instance_model_to_world; // uses locations 5 to 8
+
+
+out VS_OUT {
+	vec2 texcoord;
+} vs_out;
+
+
+void main()
+{
+	vs_out.texcoord = vec2(texcoord.x, texcoord.y);
+
+	gl_Position = vertex_world_to_clip * instance_model_to_world * vec4(vertex, 1.0);
+}
@@ -1,6 +1,6 @@
 #version 410
 
-uniform vec3 light_position;
+#include "common/uniform_blocks.glsl"
 
 in VS_OUT {
 	vec3 vertex;
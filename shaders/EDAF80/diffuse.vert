@@ -1,5 +1,7 @@
 #version 410
 
+#include "common/uniform_blocks.glsl"
+
 // Remember how we enabled vertex attributes in assignment 2 and attached some
 // data to each of them, here we retrieve that data. Attribute 0 pointed to the
 // vertices inside the OpenGL buffer object, so if we say that our input
@@ -12,10 +14,6 @@
 layout (location = 0) in vec3 vertex;
 layout (location = 1) in vec3 normal;
 
-uniform mat4 vertex_model_to_world;
-uniform mat4 normal_model_to_world;
-uniform mat4 vertex_world_to_clip;
-
 // This is the custom output of this shader. If you want to retrieve this data
 // from another shader further down the pipeline, you need to declare the exact
 // same structure as in (for input), with matching name for the structure
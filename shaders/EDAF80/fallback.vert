@@ -1,9 +1,8 @@
 #version 410
 
-layout (location = 0) in vec3 vertex;
+#include "common/uniform_blocks.glsl"
 
-uniform mat4 vertex_model_to_world;
-uniform mat4 vertex_world_to_clip;
+layout (location = 0) in vec3 vertex;
 
 void main()
 {
@@ -1,12 +1,10 @@
 #version 410
 
+#include "common/uniform_blocks.glsl"
+
 layout (location = 0) in vec3 vertex;
 layout (location = 1) in vec3 normal;
 
-uniform mat4 vertex_model_to_world;
-uniform mat4 normal_model_to_world;
-uniform mat4 vertex_world_to_clip;
-
 out VS_OUT {
 	vec3 normal;
 } vs_out;
@@ -1,11 +1,10 @@
 #version 410
 
+#include "common/uniform_blocks.glsl"
+
 layout (location = 0) in vec3 vertex;
 layout (location = 3) in vec3 tangent;
 
-uniform mat4 vertex_model_to_world;
-uniform mat4 vertex_world_to_clip;
-
 out VS_OUT {
 	vec3 tangent;
 } vs_out;
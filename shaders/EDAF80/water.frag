@@ -1,6 +1,5 @@
 #version 410
 
-uniform mat4 normal_model_to_world;// Inverse transpose
 // uniform sampler2D u_heightMap;
 
 
@@ -1,11 +1,6 @@
 #version 410
-uniform float u_time;
 
-uniform vec3 camera_position; // Defined in world space
-
-uniform mat4 vertex_model_to_world; // Model -> World space
-uniform mat4 normal_model_to_world; // Inverse transpose
-uniform mat4 vertex_world_to_clip; // Model -> Clip space
+#include "common/uniform_blocks.glsl"
 
 layout (location = 0) in vec3 pos;// Defined in model space
 
@@ -27,8 +22,8 @@ void main()
     mat2 dir = mat2(dir1, dir2);
 
 
-    float theta1 = dot(dir1, vec2(pos.x, pos.z)) * f.x +  u_time*phase.x;
-    float theta2 = dot(dir2, vec2(pos.x, pos.z)) * f.y +  u_time*phase.y;
+    float theta1 = dot(dir1, vec2(pos.x, pos.z)) * f.x +  time*phase.x;
+    float theta2 = dot(dir2, vec2(pos.x, pos.z)) * f.y +  time*phase.y;
 
     float G1 =  amplitude.x * pow((sin(theta1) * 0.5 + 0.5), sharpness.x);
     float G2 =  amplitude.y * pow((sin(theta2) * 0.5 + 0.5), sharpness.y);
@@ -44,8 +39,8 @@ void main()
     fs_out.N = vec3(-(dG1dx+dG2dx), 1, -(dG1dz+dG2dz));
 
     // vec3 pos = position;
-    // vec2 offset1 = vec2(0.8, 0.4) * u_time * 0.1;
-    // vec2 offset2 = vec2(0.6, 1.1) * u_time * 0.1;
+    // vec2 offset1 = vec2(0.8, 0.4) * time * 0.1;
+    // vec2 offset2 = vec2(0.6, 1.1) * time * 0.1;
 
    //    float hight1 = texture2D(u_heightMap, uv + offset1).r * 0.02;
     //   float hight2 = texture2D(u_heightMap, uv + offset2).r * 0.02;
@@ -1,11 +1,13 @@
 #version 410
 
+#include "common/gbuffer.glsl"
+#include "common/uniform_blocks.glsl"
+
 uniform sampler2D diffuse_texture;
 uniform sampler2D specular_texture;
 uniform sampler2D normals_texture;
 uniform sampler2D opacity_texture;
 uniform bool has_opacity_texture;
-uniform mat4 normal_model_to_world;
 
 in VS_OUT {
 	vec3 normal;
@@ -15,8 +17,11 @@ in VS_OUT {
 } fs_in;
 
 layout (location = 0) out vec4 geometry_diffuse;
-layout (location = 1) out vec4 geometry_specular;
-layout (location = 2) out vec4 geometry_normal;
+layout (location = 1) out vec2 geometry_specular;
+layout (location = 2) out vec2 geometry_normal;
+
+// Sponza's materials have no glossiness maps.
+const float glossiness = 0.5;
 
 
 void main()
@@ -28,8 +33,8 @@ void main()
 	geometry_diffuse = texture(diffuse_texture, fs_in.texcoord);
 
 	// Specular color
-	geometry_specular = texture(specular_texture, fs_in.texcoord);
+	geometry_specular = encode_specular(texture(specular_texture, fs_in.texcoord).rgb, glossiness);
 
 	// Worldspace normal
-	geometry_normal.xyz = vec3(0.0, 0.0, 0.0);
+	geometry_normal = encode_normal(normalize(fs_in.normal));
 }
@@ -1,14 +1,15 @@
 #version 410
 
-uniform mat4 vertex_model_to_world;
-uniform mat4 vertex_world_to_clip;
+#include "common/uniform_blocks.glsl"
 
 layout (location = 0) in vec3 vertex;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec3 texcoord;
-layout (location = 3) in vec3 tangent;
+layout (location = 3) in vec4 tangent;
 layout (location = 4) in vec3 binormal;
 
+uniform bool has_binormals;
+
 out VS_OUT {
 	vec3 normal;
 	vec2 texcoord;
@@ -16,12 +17,17 @@ out VS_OUT {
 	vec3 binormal;
 } vs_out;
 
+// The depth pre-pass, drawn with `fill_shadowmap.vert`, relies on both
+// computing the exact same depths.
+invariant gl_Position;
 
 void main() {
 	vs_out.normal   = normalize(normal);
 	vs_out.texcoord = texcoord.xy;
-	vs_out.tangent  = normalize(tangent);
-	vs_out.binormal = normalize(binormal);
+	vs_out.tangent  = normalize(tangent.xyz);
+	// Compact vertex formats only store the handedness of the binormal,
+	// in the sign of tangent.w.
+	vs_out.binormal = normalize(has_binormals ? binormal : cross(normal, tangent.xyz) * sign(tangent.w));
 
 	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
 }
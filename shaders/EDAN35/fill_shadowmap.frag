@@ -1,8 +1,6 @@
 #version 410
 
-out vec4 frag_color;
-
+// Depth-only: nothing to compute, the rasteriser writes the depth.
 void main()
 {
-	frag_color = vec4(1.0, 0.0, 0.0, 1.0);
 }
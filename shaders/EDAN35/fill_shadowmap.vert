@@ -1,10 +1,13 @@
 #version 410
 
-uniform mat4 vertex_model_to_world;
-uniform mat4 vertex_world_to_clip;
+#include "common/uniform_blocks.glsl"
 
 layout (location = 0) in vec3 vertex;
 
+// Depth pre-passes rely on computing the exact same depths as
+// `fill_gbuffer.vert`.
+invariant gl_Position;
+
 void main()
 {
 	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
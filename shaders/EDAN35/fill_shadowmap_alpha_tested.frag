@@ -0,0 +1,14 @@
+#version 410
+
+uniform sampler2D opacity_texture;
+
+in VS_OUT {
+	vec2 texcoord;
+} fs_in;
+
+// Depth-only, but discarding the same fragments as `fill_gbuffer.frag`
+void main()
+{
+	if (texture(opacity_texture, fs_in.texcoord).r < 1.0)
+		discard;
+}
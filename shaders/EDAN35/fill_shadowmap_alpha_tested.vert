@@ -0,0 +1,21 @@
+#version 410
+
+#include "common/uniform_blocks.glsl"
+
+layout (location = 0) in vec3 vertex;
+layout (location = 2) in vec3 texcoord;
+
+out VS_OUT {
+	vec2 texcoord;
+} vs_out;
+
+// Depth pre-passes rely on computing the exact same depths as
+// `fill_gbuffer.vert`.
+invariant gl_Position;
+
+void main()
+{
+	vs_out.texcoord = texcoord.xy;
+
+	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
+}
@@ -1,5 +1,7 @@
 #version 410
 
+#include "common/gbuffer.glsl"
+
 uniform sampler2D diffuse_texture;
 uniform sampler2D specular_texture;
 uniform sampler2D light_d_texture;
@@ -14,7 +16,7 @@ out vec4 frag_color;
 void main()
 {
 	vec3 diffuse  = texture(diffuse_texture,  fs_in.texcoord).rgb;
-	vec3 specular = texture(specular_texture, fs_in.texcoord).rgb;
+	float specular = texture(specular_texture, fs_in.texcoord).r; // see encode_specular()
 
 	vec3 light_d  = texture(light_d_texture,  fs_in.texcoord).rgb;
 	vec3 light_s  = texture(light_s_texture,  fs_in.texcoord).rgb;
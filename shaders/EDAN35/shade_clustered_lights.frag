@@ -0,0 +1,65 @@
+#version 410
+
+#include "common/gbuffer.glsl"
+#include "common/uniform_blocks.glsl"
+
+uniform sampler2D depth_texture;
+uniform sampler2D normal_texture;
+uniform sampler2D specular_texture;
+
+// Filled by bonobo::LightClusters, see src/core/light_clusters.hpp
+uniform usamplerBuffer cluster_grid;          // offset and count of each cluster
+uniform usamplerBuffer cluster_light_indices;
+uniform samplerBuffer cluster_lights;         // position and radius, then color
+uniform uvec3 cluster_grid_size;
+uniform float cluster_depth_scale;
+uniform float cluster_depth_bias;
+
+in VS_OUT {
+	vec2 texcoord;
+} fs_in;
+
+layout (location = 0) out vec4 light_diffuse_contribution;
+layout (location = 1) out vec4 light_specular_contribution;
+
+
+void main()
+{
+	float depth = texture(depth_texture, fs_in.texcoord).r;
+	if (depth == 1.0)
+		discard;
+
+	vec4 world = view_projection_inverse * vec4(vec3(fs_in.texcoord, depth) * 2.0 - 1.0, 1.0);
+	vec3 position = world.xyz / world.w;
+	vec3 N = decode_normal(texture(normal_texture, fs_in.texcoord).xy);
+	float shininess = decode_shininess(texture(specular_texture, fs_in.texcoord).g);
+	vec3 V = normalize(camera_position - position);
+
+	// Find the cluster of the fragment
+	float view_depth = -(camera_world_to_view * vec4(position, 1.0)).z;
+	uvec2 tile = min(uvec2(gl_FragCoord.xy * vec2(cluster_grid_size.xy) / viewport_size), cluster_grid_size.xy - 1u);
+	uint slice = uint(clamp(floor(log(view_depth) * cluster_depth_scale + cluster_depth_bias), 0.0, float(cluster_grid_size.z - 1u)));
+	uvec2 lights = texelFetch(cluster_grid, int((slice * cluster_grid_size.y + tile.y) * cluster_grid_size.x + tile.x)).rg;
+
+	vec3 diffuse = vec3(0.0);
+	vec3 specular = vec3(0.0);
+	for (uint i = 0u; i < lights.y; ++i) {
+		int light = int(texelFetch(cluster_light_indices, int(lights.x + i)).r);
+		vec4 position_radius = texelFetch(cluster_lights, 2 * light);
+		vec3 color = texelFetch(cluster_lights, 2 * light + 1).rgb;
+
+		vec3 L = position_radius.xyz - position;
+		float distance2 = dot(L, L);
+		L *= inversesqrt(distance2);
+
+		// Inverse square falloff, windowed to reach 0 at the radius
+		float window = clamp(1.0 - pow(distance2 / (position_radius.w * position_radius.w), 2.0), 0.0, 1.0);
+		vec3 radiance = color * window * window / max(distance2, 1.0);
+
+		diffuse += radiance * max(dot(N, L), 0.0);
+		specular += radiance * pow(max(dot(N, normalize(L + V)), 0.0), shininess);
+	}
+
+	light_diffuse_contribution  = vec4(diffuse, 1.0);
+	light_specular_contribution = vec4(specular, 1.0);
+}
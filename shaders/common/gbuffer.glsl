@@ -0,0 +1,32 @@
+// Packing of the g-buffer targets; their formats are picked in
+// src/EDAN35/assignment2.cpp, keep both in sync.
+
+// Normals are stored in two signed components, by projecting them onto an
+// octahedron whose lower half is folded over the upper one.
+vec2 encode_normal(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signs;
+}
+
+vec3 decode_normal(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+// The specular colour is reduced to its luminance, next to a glossiness
+// in [0, 1].
+vec2 encode_specular(vec3 color, float glossiness)
+{
+	return vec2(dot(color, vec3(0.2126, 0.7152, 0.0722)), glossiness);
+}
+
+float decode_shininess(float glossiness)
+{
+	return exp2(1.0 + 10.0 * glossiness);
+}
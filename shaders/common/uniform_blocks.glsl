@@ -0,0 +1,38 @@
+// Uniform blocks shared by all programs, bound by bonobo::createProgram() to
+// the binding points of bonobo::uniform_block_bindings. Their std140 layout
+// is mirrored by bonobo::frame_uniforms, bonobo::pass_uniforms and
+// bonobo::object_uniforms, in src/core/uniform_buffer.hpp: keep both in sync.
+
+// Updated once per frame
+layout (std140) uniform Frame {
+	mat4 camera_world_to_view;
+	mat4 camera_view_to_clip;
+	mat4 camera_world_to_clip;
+	mat4 view_projection_inverse; // Clip -> World space, of the camera
+	vec3 camera_position; // Defined in world space
+	float time; // In seconds
+	vec2 viewport_size; // In pixels
+	vec2 inv_res; // Inverse of the viewport size
+	float delta_time; // In seconds
+	float camera_near;
+	float camera_far;
+};
+
+// Updated once per pass, e.g. per shadow map or per light
+layout (std140) uniform Pass {
+	mat4 vertex_world_to_clip; // World -> Clip space, of the pass' view
+	mat4 shadow_view_projection; // World -> Clip space, of the light
+	vec3 light_position; // Defined in world space
+	float light_intensity;
+	vec3 light_direction; // Defined in world space
+	float light_angle_falloff;
+	vec3 light_color;
+	vec2 shadowmap_texel_size;
+	vec4 shadowmap_atlas_rect; // Slot of the light in the shadow atlas: offset in xy, size in zw, in texture coordinates
+};
+
+// Updated per draw, streamed by Node::render() through bonobo::StreamBuffer
+layout (std140) uniform Object {
+	mat4 vertex_model_to_world; // Model -> World space
+	mat4 normal_model_to_world; // Inverse transpose
+};
@@ -11,6 +11,7 @@
 #include "core/Misc.h"
 #include "core/node.hpp"
 #include "core/opengl.hpp"
+#include "core/uniform_buffer.hpp"
 #include "core/utils.h"
 #include "core/various.hpp"
 #include "core/Window.h"
@@ -25,7 +26,6 @@
 #include <chrono>
 #include <cstdlib>
 #include <unordered_map>
-#include <stack>
 #include <stdexcept>
 #include <vector>
 
@@ -147,10 +147,15 @@ edaf80::Assignment1::run()
 
     glEnable(GL_DEPTH_TEST);
 
+	bonobo::UniformBuffer frame_uniforms_buffer(bonobo::uniform_block_bindings::frame, sizeof(bonobo::frame_uniforms));
+	bonobo::UniformBuffer pass_uniforms_buffer(bonobo::uniform_block_bindings::pass, sizeof(bonobo::pass_uniforms));
+	auto pass = bonobo::pass_uniforms{};
+
 	f64 ddeltatime;
 	size_t fpsSamples = 0;
 	double nowTime, lastTime = GetTimeSeconds();
 	double fpsNextTick = lastTime + 1.0;
+	auto const startTime = lastTime;
 
 	while (!glfwWindowShouldClose(window->GetGLFW_Window())) {
 		nowTime = GetTimeSeconds();
@@ -201,31 +206,15 @@ edaf80::Assignment1::run()
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-		// Traverse the scene graph and render all the nodes
-		auto node_stack = std::stack<Node const*>();
-		auto matrix_stack = std::stack<glm::mat4>();
-		node_stack.push(&world);
-		matrix_stack.push(glm::mat4());
-		do {
-			auto const* const current_node = node_stack.top();
-			node_stack.pop();
-
-			auto const parent_matrix = matrix_stack.top();
-			matrix_stack.pop();
-
-			auto const current_node_matrix = current_node->get_transform();
-
-			//
-			// Todo: Compute the current node's world matrix
-			//
-			auto const current_node_world_matrix = parent_matrix * current_node_matrix;
-			current_node->render(mCamera.GetWorldToClipMatrix(), current_node_world_matrix);
+		auto const& camera = mCamera.GetSnapshot();
+		frame_uniforms_buffer.upload(bonobo::make_frame_uniforms(camera, window_size, static_cast<float>(nowTime - startTime), static_cast<float>(ddeltatime)));
+		pass.vertex_world_to_clip = camera.mWorldToClip;
+		pass_uniforms_buffer.upload(pass);
 
-			for (int i = static_cast<int>(current_node->get_children_nb()) - 1; i >= 0; --i) {
-				node_stack.push(current_node->get_child(static_cast<size_t>(i)));
-				matrix_stack.push(current_node_world_matrix);
-			}
-		} while (!node_stack.empty());
+		// Render all the nodes; the scene graph only recomputes the world
+		// matrices of the subtrees whose transforms changed, in one linear
+		// pass over its arrays.
+		world.render_hierarchy(camera.mWorldToClip);
 
 		Log::View::Render();
 		ImGui::Render();
@@ -238,9 +227,9 @@ edaf80::Assignment1::run()
 	shader = 0u;
 }
 
-int main()
+int main(int argc, char* argv[])
 {
-	Bonobo::Init();
+	Bonobo::Init(argc, argv);
 	try {
 		edaf80::Assignment1 assignment1;
 		assignment1.run();
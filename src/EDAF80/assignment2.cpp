@@ -11,6 +11,7 @@
 #include "core/LogView.h"
 #include "core/Misc.h"
 #include "core/node.hpp"
+#include "core/uniform_buffer.hpp"
 #include "core/utils.h"
 #include "core/Window.h"
 #include <imgui.h>
@@ -101,9 +102,8 @@ edaf80::Assignment2::run()
 	}
 
 	auto const light_position = glm::vec3(-2.0f, 4.0f, 2.0f);
-	auto const set_uniforms = [&light_position](GLuint program){
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-	};
+	// The light position is part of the `Pass` uniform block.
+	auto const set_uniforms = [](GLuint /*program*/){};
 
 	// Set the default tensions value; it can always be changed at runtime
 	// through the "Scene Controls" window.
@@ -146,10 +146,15 @@ edaf80::Assignment2::run()
 	//glCullFace(GL_BACK);
 
 
+	bonobo::UniformBuffer frame_uniforms_buffer(bonobo::uniform_block_bindings::frame, sizeof(bonobo::frame_uniforms));
+	bonobo::UniformBuffer pass_uniforms_buffer(bonobo::uniform_block_bindings::pass, sizeof(bonobo::pass_uniforms));
+	auto pass = bonobo::pass_uniforms{};
+
 	f64 ddeltatime;
 	size_t fpsSamples = 0;
 	double nowTime, lastTime = GetTimeSeconds();
 	double fpsNextTick = lastTime + 1.0;
+	auto const startTime = lastTime;
     float l_inter = 0.0f;
 	while (!glfwWindowShouldClose(window->GetGLFW_Window())) {
         nowTime = GetTimeSeconds();
@@ -210,10 +215,16 @@ edaf80::Assignment2::run()
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-        circle_rings.render(mCamera.GetWorldToClipMatrix(), circle_rings.get_transform());
+        auto const& camera = mCamera.GetSnapshot();
+        frame_uniforms_buffer.upload(bonobo::make_frame_uniforms(camera, window_size, static_cast<float>(nowTime - startTime), static_cast<float>(ddeltatime)));
+        pass.vertex_world_to_clip = camera.mWorldToClip;
+        pass.light_position = light_position;
+        pass_uniforms_buffer.upload(pass);
+
+        circle_rings.render(camera.mWorldToClip, circle_rings.get_transform());
 
 
-//        quad.render(mCamera.GetWorldToClipMatrix(), circle_rings.get_transform());
+//        quad.render(camera.mWorldToClip, circle_rings.get_transform());
 
         glm::vec3 p1 = glm::vec3(1, 2, 3);
         glm::vec3 p2 = glm::vec3(4, 2, 3);
@@ -261,9 +272,9 @@ edaf80::Assignment2::run()
 //        l_inter = l_inter + 1;
 //        interp_me = interpolation::evalLERP(cp[l_inter % 2], cp[(l_inter + 1) % 2], .5);
 //        sphere.set_translation(interp_me);
-        sphere.render(mCamera.GetWorldToClipMatrix(), sphere.get_transform());
+        sphere.render(camera.mWorldToClip, sphere.get_transform());
 
-//        tor.render(mCamera.GetWorldToClipMatrix(), circle_rings.get_transform());
+//        tor.render(camera.mWorldToClip, circle_rings.get_transform());
 
 
         bool const opened = ImGui::Begin("Scene Controls", nullptr, ImVec2(300, 100), -1.0f, 0);
@@ -291,9 +302,9 @@ edaf80::Assignment2::run()
 	diffuse_shader = 0u;
 }
 
-int main()
+int main(int argc, char* argv[])
 {
-	Bonobo::Init();
+	Bonobo::Init(argc, argv);
 	try {
 		edaf80::Assignment2 assignment2;
 		assignment2.run();
@@ -11,6 +11,7 @@
 #include "core/LogView.h"
 #include "core/Misc.h"
 #include "core/node.hpp"
+#include "core/uniform_buffer.hpp"
 #include "core/utils.h"
 #include "core/Window.h"
 #include <imgui.h>
@@ -128,19 +129,15 @@ edaf80::Assignment3::run()
 	reload_shaders();
 
 	auto light_position = glm::vec3(-2.0f, 4.0f, 2.0f);
-	auto const set_uniforms = [&light_position](GLuint program){
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-	};
+	// The light and camera positions are part of the uniform blocks.
+	auto const set_uniforms = [](GLuint /*program*/){};
 
     // ***Phong Shader
-	auto camera_position = mCamera.mWorld.GetTranslation();
 	auto ambient = glm::vec3(0.2f, 0.2f, 0.2f);
 	auto diffuse = glm::vec3(0.7f, 0.2f, 0.4f);
 	auto specular = glm::vec3(1.0f, 1.0f, 1.0f);
 	auto shininess = 1.0f;
-	auto const phong_set_uniforms = [&light_position,&camera_position,&ambient,&diffuse,&specular,&shininess](GLuint program){
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-		glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
+	auto const phong_set_uniforms = [&ambient,&diffuse,&specular,&shininess](GLuint program){
 		glUniform3fv(glGetUniformLocation(program, "ambient"), 1, glm::value_ptr(ambient));
 		glUniform3fv(glGetUniformLocation(program, "diffuse"), 1, glm::value_ptr(diffuse));
 		glUniform3fv(glGetUniformLocation(program, "specular"), 1, glm::value_ptr(specular));
@@ -154,18 +151,14 @@ edaf80::Assignment3::run()
 
 
 
-    auto const cube_set_uniforms = [&camera_position](GLuint program) {
-        glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
-    };
+    auto const cube_set_uniforms = set_uniforms;
 
     //***Cube Map Shader
     auto my_bump_map_id = bonobo::loadTexture2D("earth_bump.png", true);
 
     auto my_bump_map_id2 = bonobo::loadTexture2D("earth_diffuse.png", true);
 
-    auto const bump_set_uniforms = [&light_position,&camera_position,&ambient,&diffuse,&specular,&shininess](GLuint program) {
-        glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-        glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
+    auto const bump_set_uniforms = [&ambient,&diffuse,&specular,&shininess](GLuint program) {
         glUniform3fv(glGetUniformLocation(program, "ambient"), 1, glm::value_ptr(ambient));
         glUniform3fv(glGetUniformLocation(program, "diffuse"), 1, glm::value_ptr(diffuse));
         glUniform3fv(glGetUniformLocation(program, "specular"), 1, glm::value_ptr(specular));
@@ -214,10 +207,15 @@ edaf80::Assignment3::run()
 	//glCullFace(GL_BACK);
 
 
+	bonobo::UniformBuffer frame_uniforms_buffer(bonobo::uniform_block_bindings::frame, sizeof(bonobo::frame_uniforms));
+	bonobo::UniformBuffer pass_uniforms_buffer(bonobo::uniform_block_bindings::pass, sizeof(bonobo::pass_uniforms));
+	auto pass = bonobo::pass_uniforms{};
+
 	f64 ddeltatime;
 	size_t fpsSamples = 0;
 	double nowTime, lastTime = GetTimeMilliseconds();
 	double fpsNextTick = lastTime + 1000.0;
+	auto const startTime = lastTime;
 
 	while (!glfwWindowShouldClose(window->GetGLFW_Window())) {
 		nowTime = GetTimeMilliseconds();
@@ -277,16 +275,20 @@ edaf80::Assignment3::run()
 				break;
 		}
 
-		camera_position = mCamera.mWorld.GetTranslation();
-
 		auto const window_size = window->GetDimensions();
 		glViewport(0, 0, window_size.x, window_size.y);
 		glClearDepthf(1.0f);
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-		sphere.render(mCamera.GetWorldToClipMatrix(), sphere.get_transform());
-        sphere2.render(mCamera.GetWorldToClipMatrix(), sphere2.get_transform());
+		auto const& camera = mCamera.GetSnapshot();
+		frame_uniforms_buffer.upload(bonobo::make_frame_uniforms(camera, window_size, static_cast<float>((nowTime - startTime) / 1000.0), static_cast<float>(ddeltatime / 1000.0)));
+		pass.vertex_world_to_clip = camera.mWorldToClip;
+		pass.light_position = light_position;
+		pass_uniforms_buffer.upload(pass);
+
+		sphere.render(camera.mWorldToClip, sphere.get_transform());
+        sphere2.render(camera.mWorldToClip, sphere2.get_transform());
 
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
@@ -329,9 +331,9 @@ edaf80::Assignment3::run()
     bump_shader = 0u;
 }
 
-int main()
+int main(int argc, char* argv[])
 {
-	Bonobo::Init();
+	Bonobo::Init(argc, argv);
 	try {
 		edaf80::Assignment3 assignment3;
 		assignment3.run();
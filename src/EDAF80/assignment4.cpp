@@ -9,6 +9,7 @@
 #include "core/Log.h"
 #include "core/LogView.h"
 #include "core/Misc.h"
+#include "core/uniform_buffer.hpp"
 #include "core/utils.h"
 #include "core/Window.h"
 #include <imgui.h>
@@ -90,16 +91,10 @@ edaf80::Assignment4::run()
 
 
     auto light_position = glm::vec3(-2.0f, 4.0f, 2.0f);
-    auto const set_uniforms = [&light_position](GLuint program) {
-        glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-    };
 
-    auto camera_position = mCamera.mWorld.GetTranslation();
-    float u_time = 0.0f;
-    auto const water_set_uniforms = [&camera_position, &u_time](GLuint program) {
-        glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
-        glUniform1f(glGetUniformLocation(program, "u_time"), u_time);
-    };
+    // The camera position and the time are part of the `Frame` uniform
+    // block.
+    auto const water_set_uniforms = [](GLuint /*program*/) {};
 
 
     auto polygon_mode = polygon_mode_t::fill;
@@ -129,10 +124,15 @@ edaf80::Assignment4::run()
 	//glCullFace(GL_BACK);
 
 
+	bonobo::UniformBuffer frame_uniforms_buffer(bonobo::uniform_block_bindings::frame, sizeof(bonobo::frame_uniforms));
+	bonobo::UniformBuffer pass_uniforms_buffer(bonobo::uniform_block_bindings::pass, sizeof(bonobo::pass_uniforms));
+	auto pass = bonobo::pass_uniforms{};
+
 	f64 ddeltatime;
 	size_t fpsSamples = 0;
 	double nowTime, lastTime = GetTimeMilliseconds();
 	double fpsNextTick = lastTime + 1000.0;
+	auto const startTime = lastTime;
 
 	while (!glfwWindowShouldClose(window->GetGLFW_Window())) {
 		nowTime = GetTimeMilliseconds();
@@ -142,7 +142,6 @@ edaf80::Assignment4::run()
 			fpsSamples = 0;
 		}
 		fpsSamples++;
-        u_time += ddeltatime/1000;
 
 		auto& io = ImGui::GetIO();
 		inputHandler->SetUICapture(io.WantCaptureMouse, io.WantCaptureMouse);
@@ -150,8 +149,6 @@ edaf80::Assignment4::run()
 		inputHandler->Advance();
 		mCamera.Update(ddeltatime, *inputHandler);
 
-        camera_position = mCamera.mWorld.GetTranslation();
-
         ImGui_ImplGlfwGL3_NewFrame();
 
 		//
@@ -186,15 +183,21 @@ edaf80::Assignment4::run()
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
+		auto const& camera = mCamera.GetSnapshot();
+		frame_uniforms_buffer.upload(bonobo::make_frame_uniforms(camera, window_size, static_cast<float>((nowTime - startTime) / 1000.0), static_cast<float>(ddeltatime / 1000.0)));
+		pass.vertex_world_to_clip = camera.mWorldToClip;
+		pass.light_position = light_position;
+		pass_uniforms_buffer.upload(pass);
+
 		//
 		// Todo: Render all your geometry here.
 		//
 
 
-//        circle_rings.render(mCamera.GetWorldToClipMatrix(), circle_rings.get_transform());
+//        circle_rings.render(camera.mWorldToClip, circle_rings.get_transform());
 //
-//        quad.render(mCamera.GetWorldToClipMatrix(), quad.get_transform());
-        quad.render(mCamera.GetWorldToClipMatrix(), quad.get_transform());
+//        quad.render(camera.mWorldToClip, quad.get_transform());
+        quad.render(camera.mWorldToClip, quad.get_transform());
 
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
@@ -222,9 +225,9 @@ edaf80::Assignment4::run()
 	//
 }
 
-int main()
+int main(int argc, char* argv[])
 {
-	Bonobo::Init();
+	Bonobo::Init(argc, argv);
 	try {
 		edaf80::Assignment4 assignment4;
 		assignment4.run();
@@ -4,11 +4,16 @@
 #include "external/glad/glad.h"
 #include "core/Bonobo.h"
 #include "core/FPSCamera.h"
+#include "core/frame_timings.hpp"
 #include "core/helpers.hpp"
+#include "core/input_journal.hpp"
 #include "core/InputHandler.h"
 #include "core/Log.h"
 #include "core/LogView.h"
 #include "core/Misc.h"
+#include "core/Profiler.h"
+#include "core/stream_buffer.hpp"
+#include "core/uniform_buffer.hpp"
 #include "core/utils.h"
 #include "core/Window.h"
 #include <imgui.h>
@@ -20,10 +25,16 @@
 #include "interpolation.hpp"
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <random>
 #include <stdexcept>
 #include <glm/src/glm/glm/gtc/type_ptr.hpp>
 #include <core/node.hpp>
+#include <core/instanced_node.hpp>
+#include <core/texture_cache.hpp>
 #include <stack>
+#include <vector>
 
 
 enum class polygon_mode_t : unsigned int {
@@ -86,9 +97,14 @@ edaf80::Assignment5::run()
         LogError("Failed to load shader");
         return;
     }
+    auto def_instanced_shader = bonobo::createProgram("default_instanced.vert", "default.frag");
+    if (def_instanced_shader == 0u) {
+        LogError("Failed to load instanced shader");
+        return;
+    }
 
-	GLuint diffuse_shader = 0u, normal_shader = 0u, texcoord_shader = 0u, phong_shader = 0u, cube_shader = 0u, bump_shader = 0u;
-	auto const reload_shaders = [&diffuse_shader,&normal_shader,&texcoord_shader, &phong_shader, &cube_shader, &bump_shader](){
+	GLuint diffuse_shader = 0u, normal_shader = 0u, texcoord_shader = 0u, phong_shader = 0u, cube_shader = 0u, bump_shader = 0u, bump_instanced_shader = 0u;
+	auto const reload_shaders = [&diffuse_shader,&normal_shader,&texcoord_shader, &phong_shader, &cube_shader, &bump_shader, &bump_instanced_shader](){
 		if (diffuse_shader != 0u)
 			glDeleteProgram(diffuse_shader);
 		diffuse_shader = bonobo::createProgram("diffuse.vert", "diffuse.frag");
@@ -125,57 +141,59 @@ edaf80::Assignment5::run()
 		if (bump_shader == 0u)
 			LogError("Failed to load cube map shader");
 
+		if (bump_instanced_shader != 0u)
+			glDeleteProgram(bump_instanced_shader);
+		bump_instanced_shader = bonobo::createProgram("bumpmap_instanced.vert", "bumpmap_instanced.frag");
+		if (bump_instanced_shader == 0u)
+			LogError("Failed to load instanced bump map shader");
+
 	};
 	reload_shaders();
 
 	auto light_position = glm::vec3(-2.0f, 4.0f, 2.0f);
-	auto const set_uniforms = [&light_position](GLuint program){
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-	};
+	// The light and camera positions are part of the uniform blocks.
+	auto const set_uniforms = [](GLuint /*program*/){};
 
 	// ***Phong Shader
-	auto camera_position = mCamera.mWorld.GetTranslation();
 	auto ambient = glm::vec3(0.2f, 0.2f, 0.2f);
 	auto diffuse = glm::vec3(0.7f, 0.2f, 0.4f);
 	auto specular = glm::vec3(1.0f, 1.0f, 1.0f);
 	auto shininess = 1.0f;
-	auto const phong_set_uniforms = [&light_position,&camera_position,&ambient,&diffuse,&specular,&shininess](GLuint program){
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-		glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
+	auto const phong_set_uniforms = [&ambient,&diffuse,&specular,&shininess](GLuint program){
 		glUniform3fv(glGetUniformLocation(program, "ambient"), 1, glm::value_ptr(ambient));
 		glUniform3fv(glGetUniformLocation(program, "diffuse"), 1, glm::value_ptr(diffuse));
 		glUniform3fv(glGetUniformLocation(program, "specular"), 1, glm::value_ptr(specular));
 		glUniform1f(glGetUniformLocation(program, "shininess"), shininess);
 	};
 
+	// Textures loaded several times, e.g. fieldstone_bump.png, are only
+	// loaded once; they are all deleted when the cache goes out of scope.
+	bonobo::TextureCache texture_cache;
+
 	//***Cube Map Shader
-	auto my_cube_map_id = bonobo::loadTextureCubeMap("sunset_sky/posx.png","sunset_sky/negx.png",
+	auto my_cube_map_id = texture_cache.load_cube_map("sunset_sky/posx.png","sunset_sky/negx.png",
 													 "sunset_sky/posy.png","sunset_sky/negy.png",
 													 "sunset_sky/posz.png","sunset_sky/negz.png", true);
-    auto my_cube_map_id2 = bonobo::loadTextureCubeMap("space.png","space.png",
+    auto my_cube_map_id2 = texture_cache.load_cube_map("space.png","space.png",
                                                      "space.png","space.png",
                                                      "space.png","space.png", true);
-    auto my_cube_map_id3 = bonobo::loadTextureCubeMap("northlight.png","northlight.png",
+    auto my_cube_map_id3 = texture_cache.load_cube_map("northlight.png","northlight.png",
                                                       "northlight.png","northlight.png",
                                                       "northlight.png","northlight.png", true);
 
 
 
-	auto const cube_set_uniforms = [&camera_position](GLuint program) {
-		glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
-	};
+	auto const cube_set_uniforms = set_uniforms;
 
 	//***Bump Map Shader
-	auto my_bump_map_id = bonobo::loadTexture2D("earth_bump.png", true);
-    auto bullet_bump_map = bonobo::loadTexture2D("red.png", true);
-    auto exploded_bump_map = bonobo::loadTexture2D("exploded.png", true);
-    auto exploded2_bump_map = bonobo::loadTexture2D("exploded2.png", true);
+	auto my_bump_map_id = texture_cache.load_2d("earth_bump.png");
+    auto bullet_bump_map = texture_cache.load_2d("red.png");
+    auto exploded_bump_map = texture_cache.load_2d("exploded.png");
+    auto exploded2_bump_map = texture_cache.load_2d("exploded2.png");
 
-	auto my_bump_map_id2 = bonobo::loadTexture2D("earth_diffuse.png", true);
+	auto my_bump_map_id2 = texture_cache.load_2d("earth_diffuse.png");
 
-	auto const bump_set_uniforms = [&light_position,&camera_position,&ambient,&diffuse,&specular,&shininess](GLuint program) {
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-		glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
+	auto const bump_set_uniforms = [&ambient,&diffuse,&specular,&shininess](GLuint program) {
 		glUniform3fv(glGetUniformLocation(program, "ambient"), 1, glm::value_ptr(ambient));
 		glUniform3fv(glGetUniformLocation(program, "diffuse"), 1, glm::value_ptr(diffuse));
 		glUniform3fv(glGetUniformLocation(program, "specular"), 1, glm::value_ptr(specular));
@@ -195,90 +213,93 @@ edaf80::Assignment5::run()
 	// Todo: Load your geometry
 	//
 
-    auto s43_text = bonobo::loadTexture2D("stone43_bump.png", true);
-    auto s43_dif = bonobo::loadTexture2D("stone43_diffuse.png", true);
+    auto s43_text = texture_cache.load_2d("stone43_bump.png");
+    auto s43_dif = texture_cache.load_2d("stone43_diffuse.png");
 
-    auto s47_text = bonobo::loadTexture2D("stone47_bump.png",true);
-    auto s47_dif = bonobo::loadTexture2D("stone47_diffuse.png", true);
+    auto s47_text = texture_cache.load_2d("stone47_bump.png");
+    auto s47_dif = texture_cache.load_2d("stone47_diffuse.png");
 
-    auto fs_text = bonobo::loadTexture2D("fieldstone_bump.png", true);
-    auto fs_dif = bonobo::loadTexture2D("fieldstone_bump.png", true);
+    auto fs_text = texture_cache.load_2d("fieldstone_bump.png");
+    auto fs_dif = texture_cache.load_2d("fieldstone_bump.png");
 
-    GLuint text[8] = {my_bump_map_id, my_bump_map_id2, s43_text, s43_dif, s47_text, s47_dif, fs_text, fs_dif};
+    GLuint text[8] = {my_bump_map_id.get(), my_bump_map_id2.get(), s43_text.get(), s43_dif.get(), s47_text.get(), s47_dif.get(), fs_text.get(), fs_dif.get()};
+
+    // Asteroids and bullets each share a single sphere, and are drawn with
+    // one instanced draw call per material; their Nodes only hold their
+    // transforms, which are copied to the instances before rendering.
+    InstancedNode asteroid_instances;
+    auto const asteroid_shape = parametric_shapes::createSphere(6u, 7u, 1.0f);
+    asteroid_instances.set_geometry(asteroid_shape);
+    asteroid_instances.set_program(bump_instanced_shader, set_uniforms);
+    for (int i = 0; i < 3; i++) {
+        auto const material = asteroid_instances.add_material();
+        asteroid_instances.add_texture(material, "my_normal_map", text[2 * i], GL_TEXTURE_2D);
+        asteroid_instances.add_texture(material, "my_diffuse", text[2 * i + 1], GL_TEXTURE_2D);
+    }
 
-    GLuint texture_type;
-    GLuint diffuse_type;
+    // Game sessions: --input-record=path journals the input of every tick,
+    // and --input-replay=path feeds such a journal back, with the same
+    // random seed and a fixed timestep, then quits. --seed=n picks the
+    // seed of new sessions, 1 by default.
+    bonobo::InputJournal input_journal;
+    auto const seed_option = Bonobo::GetOption("seed");
+    auto seed = seed_option.empty() ? u64(1) : static_cast<u64>(std::strtoull(seed_option.c_str(), nullptr, 10));
+    auto const input_replay_path = Bonobo::GetOption("input-replay");
+    auto const input_record_path = Bonobo::GetOption("input-record");
+    if (!input_replay_path.empty() && input_journal.load(input_replay_path))
+        seed = input_journal.get_seed();
+    else if (!input_record_path.empty() && !input_journal.start_recording(input_record_path, seed))
+        LogError("Failed to record the input to \"%s\"", input_record_path.c_str());
+    inputHandler->SetJournal(&input_journal);
+    auto const journaling = input_journal.is_recording() || input_journal.is_replaying();
+    auto const fixed_timestep = 1000.0 / 60.0; // in ms
+    bonobo::FrameTimings replay_timings;
+
+    // A headless replay runs the whole session, which then closes the
+    // window, instead of stopping after the frames of --headless.
+    if (input_journal.is_replaying() && Window::IsHeadless())
+        Window::SetHeadless(static_cast<unsigned int>(std::max<u64>(input_journal.get_end_tick(), 1u)));
+
+    std::mt19937 rng(static_cast<std::mt19937::result_type>(seed));
+    auto const random_below = [&rng](int n){
+        return static_cast<int>(rng() % static_cast<u32>(n));
+    };
 
     //Load asteroids
-	auto ast_par = Node();
     int ast_num = 20;
-    Node asteroids[ast_num];
-    for (int i = 1; i <= ast_num; i++) {
-        auto radius = 1.0f;
-        auto ast = Node(radius);
-        auto const s = parametric_shapes::createSphere(6u, 7u, radius);
-        ast.set_geometry(s);
-        ast.set_program(bump_shader, set_uniforms);
-        auto scale = static_cast<float >(rand() % 1 + 0.7) + 0.5f;
-        ast.set_scaling(glm::vec3(scale));
-        //todo randomize texture for variety of texture
-
-        switch (rand() % 3) {
-            case 0:
-                texture_type = text[0];
-                diffuse_type = text[1];
-                break;
-            case 1:
-                texture_type = text[2];
-                diffuse_type = text[3];
-                break;
-            case 2:
-                texture_type = text[4];
-                diffuse_type = text[5];
-                break;
-            default:
-                texture_type = text[6];
-                diffuse_type = text[7];
-                break;
+    std::vector<Node> asteroids;
+    auto const spawn_asteroids = [&asteroids, &asteroid_instances, &random_below](int count){
+        auto const radius = 1.0f;
+        asteroids.assign(static_cast<size_t>(count), Node(radius));
+        asteroid_instances.clear_instances();
+        for (auto& ast : asteroids) {
+            auto scale = static_cast<float >(random_below(1) + 0.7) + 0.5f;
+            ast.set_scaling(glm::vec3(scale));
 
-        }
-        ast.add_texture("my_normal_map", texture_type, GL_TEXTURE_2D);
-        ast.add_texture("my_diffuse", diffuse_type, GL_TEXTURE_2D);
-
-
-        asteroids[i-1] = ast;
-        ast_par.add_child(&ast);
-    }
+            //setting the planets coords
+            float yCoord = static_cast<float >(random_below(30) + 10);
+            float xCoord = static_cast<float >(random_below(20) - 10);
+            ast.set_translation(glm::vec3(xCoord, yCoord, 0.0f));
 
-    //setting the planets coords
-    for (int i = 1; i <= ast_num; i++ ) {
-        float x = static_cast<float >(std::floor(i));
-        printf("ran here\n");
-        float yCoord = static_cast<float >(rand() % 30 + 10);
-        float xCoord = static_cast<float >(rand() % 20 - 10);
-        asteroids[i - 1].set_translation(glm::vec3(xCoord, yCoord, 0.0f));
-    }
+            asteroid_instances.add_instance(ast.get_transform(), static_cast<u32>(random_below(3)));
+        }
+    };
+    spawn_asteroids(ast_num);
 
 
     // Creating bullets
-    auto bullet_par = Node();
+    InstancedNode bullet_instances;
+    auto const bullet_shape = parametric_shapes::createSphere(6u, 7u, 1.0f);
+    bullet_instances.set_geometry(bullet_shape);
+    bullet_instances.set_program(def_instanced_shader, [](GLuint /*program*/){});
+    bullet_instances.add_texture(bullet_instances.add_material(), "diffuse_texture", bullet_bump_map.get(), GL_TEXTURE_2D);
+
     int bullet_num = 10;
-    Node bullets[bullet_num];
-    int isBulletBusy[bullet_num];  // 0 is not, 1 is busy (meaning render bullet cor to that pos)
-    for (int i = 1; i <= bullet_num; i++) {
-        auto radius = 1.0f;
-        auto bullet = Node(radius);
-        auto const s = parametric_shapes::createSphere(6u, 7u, radius);
-        bullet.set_geometry(s);
-        bullet.set_program(def_shader, [](GLuint /*program*/){});
-
-        bullet.add_texture("diffuse_texture", bullet_bump_map, GL_TEXTURE_2D);
+    std::vector<Node> bullets(static_cast<size_t>(bullet_num), Node(1.0f));
+    std::vector<int> isBulletBusy(static_cast<size_t>(bullet_num), 0);  // 0 is not, 1 is busy (meaning render bullet cor to that pos)
+    for (auto& bullet : bullets) {
         bullet.set_scaling(glm::vec3(0.2));
-
-        bullets[i-1] = bullet;
-        isBulletBusy[i-1] = 0;
-        bullet_par.add_child(&bullet);
-
+        bullet_instances.add_instance(bullet.get_transform());
     }
 
     //explosion
@@ -289,7 +310,7 @@ edaf80::Assignment5::run()
     explosion.set_geometry(s);
     explosion.set_program(def_shader, [](GLuint /*program*/){});
 //    explosion.add_texture("diffuse_texture", exploded_bump_map, GL_TEXTURE_2D);
-    explosion.add_texture("diffuse_texture", exploded2_bump_map, GL_TEXTURE_2D);
+    explosion.add_texture("diffuse_texture", exploded2_bump_map.get(), GL_TEXTURE_2D);
     explosion.set_scaling(glm::vec3(0.8));
     explosion.set_translation(glm::vec3(0,20,0));
 
@@ -301,7 +322,7 @@ edaf80::Assignment5::run()
 	cube_bg.set_program(cube_shader, cube_set_uniforms);
 	cube_bg.set_scaling(glm::vec3(10));
 
-	cube_bg.add_texture("my_cube_map", my_cube_map_id2, GL_TEXTURE_CUBE_MAP);
+	cube_bg.add_texture("my_cube_map", my_cube_map_id2.get(), GL_TEXTURE_CUBE_MAP);
 
 	// the spaceship
 	// Load the ship geometry
@@ -317,8 +338,10 @@ edaf80::Assignment5::run()
     ship.set_translation(glm::vec3(0,-4,0));
 
     // Load the sun's texture
-    auto ship_texture = bonobo::loadTexture2D("metal-crate.png");
-    ship.add_texture("diffuse_texture", ship_texture, GL_TEXTURE_2D); //add ship texture
+    auto ship_texture = texture_cache.load_2d("metal-crate.png");
+    ship.add_texture("diffuse_texture", ship_texture.get(), GL_TEXTURE_2D); //add ship texture
+
+    texture_cache.log_report();
 
 
 
@@ -342,10 +365,15 @@ edaf80::Assignment5::run()
 
 
 
+	bonobo::UniformBuffer frame_uniforms_buffer(bonobo::uniform_block_bindings::frame, sizeof(bonobo::frame_uniforms));
+	bonobo::UniformBuffer pass_uniforms_buffer(bonobo::uniform_block_bindings::pass, sizeof(bonobo::pass_uniforms));
+	auto pass = bonobo::pass_uniforms{};
+
 	f64 ddeltatime;
 	size_t fpsSamples = 0;
 	double nowTime, lastTime = GetTimeMilliseconds();
 	double fpsNextTick = lastTime + 1000.0;
+	auto const startTime = lastTime;
 
     int my_score = 0;
     int my_lives = 3;
@@ -353,8 +381,9 @@ edaf80::Assignment5::run()
     float l_inter = 0.0f;
     float fall_speed = 0.05f;
 	while (!glfwWindowShouldClose(window->GetGLFW_Window())) {
+		PROFILE_SCOPE("Frame");
 		nowTime = GetTimeMilliseconds();
-		ddeltatime = nowTime - lastTime;
+		ddeltatime = journaling ? fixed_timestep : nowTime - lastTime;
 		if (nowTime > fpsNextTick) {
 			fpsNextTick += 1000.0;
 			fpsSamples = 0;
@@ -397,7 +426,6 @@ edaf80::Assignment5::run()
             for (int i = 0; i < bullet_num; i++) {
                 if (isBulletBusy[i] == 0) {
                     isBulletBusy[i] = 1;
-                    bullets[i].render(mCamera.GetWorldToClipMatrix(), bullets[i].get_transform());
                     printf("bullet number %d \n", i);
                     break;
                 }
@@ -420,10 +448,8 @@ edaf80::Assignment5::run()
             //setting the planets coords
             if (my_lives > 0) {
                 for (int i = 1; i <= ast_num; i++) {
-                    float x = static_cast<float >(std::floor(i));
-                    printf("ran here\n");
-                    float yCoord = static_cast<float >(rand() % 30 + 10);
-                    float xCoord = static_cast<float >(rand() % 20 - 10);
+                    float yCoord = static_cast<float >(random_below(30) + 10);
+                    float xCoord = static_cast<float >(random_below(20) - 10);
                     asteroids[i - 1].set_translation(glm::vec3(xCoord, yCoord, 0.0f));
                 }
                 ship.set_translation(glm::vec3(0, -4, 0));
@@ -432,10 +458,8 @@ edaf80::Assignment5::run()
         if (inputHandler->GetKeycodeState(GLFW_KEY_N) & JUST_PRESSED) { //reset game
             //setting the planets coords
             for (int i = 1; i <= ast_num; i++ ) {
-                float x = static_cast<float >(std::floor(i));
-                printf("ran here\n");
-                float yCoord = static_cast<float >(rand() % 30 + 10);
-                float xCoord = static_cast<float >(rand() % 20 - 10);
+                float yCoord = static_cast<float >(random_below(30) + 10);
+                float xCoord = static_cast<float >(random_below(20) - 10);
                 asteroids[i - 1].set_translation(glm::vec3(xCoord, yCoord, 0.0f));
             }
             ship.set_translation(glm::vec3(0, -4, 0));
@@ -444,74 +468,82 @@ edaf80::Assignment5::run()
 
         }
 
-        // fire bullet,
-        for (int i = 0; i < bullet_num; i ++) {
-            if (isBulletBusy[i] == 1) {
-                bullets[i].translate(glm::vec3(0,1,0));
-            }
-        }
-
-        //reset bullet when pass
-        for (int i = 0; i < bullet_num; i++) {
-            if (bullets[i].get_translation().y > 20) {
-                isBulletBusy[i] = 0;
-                bullets[i].set_translation(ship.get_translation());
+        {
+            PROFILE_SCOPE("Update bullets");
+            // fire bullet,
+            for (int i = 0; i < bullet_num; i ++) {
+                if (isBulletBusy[i] == 1) {
+                    bullets[i].translate(glm::vec3(0,1,0));
+                }
             }
-        }
 
-        //bullets follow ship
-        for (int i = 0; i < bullet_num; i++) {
-            if (isBulletBusy[i] == 0) {
-                bullets[i].set_translation(ship.get_translation());
-            } else {
+            //reset bullet when pass
+            for (int i = 0; i < bullet_num; i++) {
                 if (bullets[i].get_translation().y > 20) {
                     isBulletBusy[i] = 0;
                     bullets[i].set_translation(ship.get_translation());
                 }
             }
+
+            //bullets follow ship
+            for (int i = 0; i < bullet_num; i++) {
+                if (isBulletBusy[i] == 0) {
+                    bullets[i].set_translation(ship.get_translation());
+                } else {
+                    if (bullets[i].get_translation().y > 20) {
+                        isBulletBusy[i] = 0;
+                        bullets[i].set_translation(ship.get_translation());
+                    }
+                }
+            }
         }
 
 
-        //fall of solar systems
-        for (int i = 0; i < ast_num; i++ ) {
-            asteroids[i].rotate_x(nowTime/(nowTime*20));
-            asteroids[i].rotate_y(nowTime/(nowTime*10));
-            asteroids[i].translate(glm::vec3(0,-fall_speed,0));
-        }
+        {
+            PROFILE_SCOPE("Update asteroids");
+            //fall of solar systems
+            for (int i = 0; i < ast_num; i++ ) {
+                asteroids[i].rotate_x(nowTime/(nowTime*20));
+                asteroids[i].rotate_y(nowTime/(nowTime*10));
+                asteroids[i].translate(glm::vec3(0,-fall_speed,0));
+            }
 
-		//reset planets that fall below y < -3
-        for (int i = 0; i < ast_num; i++) {
-            float yCoord = static_cast<float >(rand() % 100 + 50);
-            auto ast = asteroids[i];
-            if (ast.get_translation().y < -3) {
-                asteroids[i].set_translation(glm::vec3(asteroids[i].get_translation().x, yCoord, 0));
-                my_score -= 1;
+            //reset planets that fall below y < -3
+            for (int i = 0; i < ast_num; i++) {
+                float yCoord = static_cast<float >(random_below(100) + 50);
+                if (asteroids[i].get_translation().y < -3) {
+                    asteroids[i].set_translation(glm::vec3(asteroids[i].get_translation().x, yCoord, 0));
+                    my_score -= 1;
+                }
             }
         }
 
-        //detection bullet colliding with falling objects
-        for (int i = 0; i < bullet_num; i++) {
-            if (isBulletBusy[i] == 1) {
-                auto bx = bullets[i].get_translation().x;
-                auto by = bullets[i].get_translation().y;
-                auto br = bullets[i]._r;
-                for (int j = 0; j < ast_num; j++) {
-                    auto ax = asteroids[j].get_translation().x;
-                    auto ay = asteroids[j].get_translation().y;
-                    auto ar = asteroids[j]._r;
-                    auto collidedRadius = ar + br;
-                    if ( std::abs(ax - bx) < collidedRadius && std::abs(ay - by) < collidedRadius ) {
-                        float yCoord = static_cast<float >(rand() % 100 + 50);
-
-                        explosion.set_translation(asteroids[j].get_translation());
-                        //reset the asteroids
-                        asteroids[j].set_translation(glm::vec3(asteroids[j].get_translation().x, yCoord, 0));
-
-                        // reset the bullet
-                        bullets[i].set_translation(ship.get_translation());
-                        isBulletBusy[i] = 0;
-
-                        my_score += 1;
+        {
+            PROFILE_SCOPE("Bullet collisions");
+            //detection bullet colliding with falling objects
+            for (int i = 0; i < bullet_num; i++) {
+                if (isBulletBusy[i] == 1) {
+                    auto bx = bullets[i].get_translation().x;
+                    auto by = bullets[i].get_translation().y;
+                    auto br = bullets[i]._r;
+                    for (int j = 0; j < ast_num; j++) {
+                        auto ax = asteroids[j].get_translation().x;
+                        auto ay = asteroids[j].get_translation().y;
+                        auto ar = asteroids[j]._r;
+                        auto collidedRadius = ar + br;
+                        if ( std::abs(ax - bx) < collidedRadius && std::abs(ay - by) < collidedRadius ) {
+                            float yCoord = static_cast<float >(random_below(100) + 50);
+
+                            explosion.set_translation(asteroids[j].get_translation());
+                            //reset the asteroids
+                            asteroids[j].set_translation(glm::vec3(asteroids[j].get_translation().x, yCoord, 0));
+
+                            // reset the bullet
+                            bullets[i].set_translation(ship.get_translation());
+                            isBulletBusy[i] = 0;
+
+                            my_score += 1;
+                        }
                     }
                 }
             }
@@ -521,21 +553,24 @@ edaf80::Assignment5::run()
 
 
 
-        // detection for the jet and asteroids ------
-        auto sx = ship.get_translation().x;
-        auto sy = ship.get_translation().y;
-        auto sr = 1.5;
-        for (int j = 0; j < ast_num; j++) {
+        {
+            PROFILE_SCOPE("Ship collisions");
+            // detection for the jet and asteroids ------
+            auto sx = ship.get_translation().x;
+            auto sy = ship.get_translation().y;
+            auto sr = 1.5;
+            for (int j = 0; j < ast_num; j++) {
 
-            auto ax = asteroids[j].get_translation().x;
-            auto ay = asteroids[j].get_translation().y;
-            auto ar = asteroids[j]._r;
-            auto collidedRadius = ar + sr;
-            if (std::abs(ax - sx) < collidedRadius && std::abs(ay - sy) < collidedRadius ) {
-                my_lives -= 1;
-                ship.set_translation(glm::vec3(-100, 30, 0));
-            }
+                auto ax = asteroids[j].get_translation().x;
+                auto ay = asteroids[j].get_translation().y;
+                auto ar = asteroids[j]._r;
+                auto collidedRadius = ar + sr;
+                if (std::abs(ax - sx) < collidedRadius && std::abs(ay - sy) < collidedRadius ) {
+                    my_lives -= 1;
+                    ship.set_translation(glm::vec3(-100, 30, 0));
+                }
 
+            }
         }
 
 
@@ -606,18 +641,32 @@ edaf80::Assignment5::run()
 
 
 
-		cube_bg.render(mCamera.GetWorldToClipMatrix(), cube_bg.get_transform());
-		ship.render(mCamera.GetWorldToClipMatrix(), ship.get_transform());
-        for (int i = 0; i < ast_num; i++) {
-            asteroids[i].render(mCamera.GetWorldToClipMatrix(), asteroids[i].get_transform());
-        }
+		// While journaling, time only advances with the ticks, so that a
+		// replay also feeds the shaders the same times.
+		auto const elapsed_time = journaling ? static_cast<double>(inputHandler->GetTick()) * fixed_timestep : nowTime - startTime;
+		auto const& camera = mCamera.GetSnapshot();
+		frame_uniforms_buffer.upload(bonobo::make_frame_uniforms(camera, window_size, static_cast<float>(elapsed_time / 1000.0), static_cast<float>(ddeltatime / 1000.0)));
+		pass.vertex_world_to_clip = camera.mWorldToClip;
+		pass.light_position = light_position;
+		pass_uniforms_buffer.upload(pass);
 
-        for (int i = 0; i < bullet_num; i++) {
-            bullets[i].render(mCamera.GetWorldToClipMatrix(), bullets[i].get_transform());
-        }
+		{
+			PROFILE_SCOPE("Render");
+			cube_bg.render(camera.mWorldToClip, cube_bg.get_transform());
+			ship.render(camera.mWorldToClip, ship.get_transform());
+            for (int i = 0; i < ast_num; i++) {
+                asteroid_instances.set_instance_transform(i, asteroids[i].get_transform());
+            }
+            asteroid_instances.render(camera.mWorldToClip, bump_instanced_shader, set_uniforms);
 
-        explosion.render(mCamera.GetWorldToClipMatrix(), explosion.get_transform());
-        //bullets[0].render(mCamera.GetWorldToClipMatrix(), bullets[0].get_transform());
+            for (int i = 0; i < bullet_num; i++) {
+                bullet_instances.set_instance_transform(i, bullets[i].get_transform());
+            }
+            bullet_instances.render(camera.mWorldToClip);
+
+            explosion.render(camera.mWorldToClip, explosion.get_transform());
+		}
+        //bullets[0].render(camera.mWorldToClip, bullets[0].get_transform());
         //
 		// Todo: If you want a custom ImGUI window, you can set it up
 		//       here
@@ -638,8 +687,14 @@ edaf80::Assignment5::run()
 //            char * text = (char) std::to_string(my_score);
 
 
+            // Neither slider is journaled, and the asteroids are spawned
+            // from the seeded generator: both are frozen while journaling,
+            // so that a session replays the way it was recorded.
             //speed of asteroid
-            ImGui::SliderFloat("Falling Speed", &fall_speed, 0.05f, 1.5f);
+            if (journaling)
+                ImGui::Text("Falling Speed: %.3f", fall_speed);
+            else
+                ImGui::SliderFloat("Falling Speed", &fall_speed, 0.05f, 1.5f);
             // score board
             std::string s = "My Score " + std::to_string(my_score);
             char const *score = s.c_str();
@@ -649,6 +704,21 @@ edaf80::Assignment5::run()
             std::string l = "My Lives: " + std::to_string(my_lives);
             char const *life = l.c_str();
             ImGui::Checkbox(life, &use_linear);
+
+            ImGui::Text("Textures: %.2f MiB", static_cast<double>(texture_cache.get_memory_usage()) / (1024.0 * 1024.0));
+
+            if (journaling)
+                ImGui::Text("Asteroids: %d", ast_num);
+            else if (ImGui::SliderInt("Asteroids", &ast_num, 1, 50000))
+                spawn_asteroids(ast_num);
+            auto const& asteroid_stats = asteroid_instances.get_stats();
+            ImGui::Text("Asteroids: %u drawn, %u culled, %u draw calls",
+                        static_cast<unsigned int>(asteroid_stats.instances), static_cast<unsigned int>(asteroid_stats.culled),
+                        static_cast<unsigned int>(asteroid_stats.draws));
+            auto const& stream_stats = window->GetStreamBuffer()->get_stats();
+            ImGui::Text("Streamed: %.1f KiB, %u allocations, %u stalls (%.2f ms)",
+                        static_cast<double>(stream_stats.bytes_streamed) / 1024.0, static_cast<unsigned int>(stream_stats.allocations),
+                        static_cast<unsigned int>(stream_stats.stalls), stream_stats.stall_time);
         }
         ImGui::End();
 
@@ -658,7 +728,22 @@ edaf80::Assignment5::run()
 
 		window->Swap();
 		lastTime = nowTime;
+
+		if (input_journal.is_replaying()) {
+			replay_timings.add(GetTimeMilliseconds() - nowTime);
+			if (input_journal.is_finished(inputHandler->GetTick())) {
+				replay_timings.log("Input replay");
+				glfwSetWindowShouldClose(window->GetGLFW_Window(), GLFW_TRUE);
+			}
+		}
+	}
+	if (input_journal.is_replaying() && !input_journal.is_finished(inputHandler->GetTick())) {
+		LogWarning("Input replay stopped at tick %llu of %llu", static_cast<unsigned long long>(inputHandler->GetTick()),
+		           static_cast<unsigned long long>(input_journal.get_end_tick()));
+		replay_timings.log("Input replay");
 	}
+	input_journal.stop_recording(inputHandler->GetTick());
+	inputHandler->SetJournal(nullptr);
 
 	//
 	// Todo: Do not forget to delete your shader programs, by calling
@@ -678,14 +763,18 @@ edaf80::Assignment5::run()
 	cube_shader = 0u;
 	glDeleteProgram(bump_shader);
 	bump_shader = 0u;
+	glDeleteProgram(bump_instanced_shader);
+	bump_instanced_shader = 0u;
     glDeleteProgram(def_shader);
     def_shader = 0u;
+    glDeleteProgram(def_instanced_shader);
+    def_instanced_shader = 0u;
 
 }
 
-int main()
+int main(int argc, char* argv[])
 {
-	Bonobo::Init();
+	Bonobo::Init(argc, argv);
 	try {
 		edaf80::Assignment5 assignment5;
 		assignment5.run();
@@ -3,6 +3,7 @@
 #include "core/utils.h"
 
 #include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 #include <array>
 #include <cassert>
@@ -11,7 +12,7 @@
 #include <vector>
 
 bonobo::mesh_data
-parametric_shapes::createQuad(unsigned int width, unsigned int height)
+parametric_shapes::createQuad(unsigned int width, unsigned int height, bonobo::vertex_format const& format)
 {
 	//! \todo Fill in the blanks
 	auto const vertices = std::array<glm::vec3, 4>{
@@ -26,110 +27,10 @@ parametric_shapes::createQuad(unsigned int width, unsigned int height)
 		glm::uvec3(0u, 2u, 3u)
 	};
 
-	bonobo::mesh_data data;
-
-    data.vertices_nb = static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec3));
-	//
-	// NOTE:
-	//
-	// Only the values preceeded by a `\todo` tag should be changed, the
-	// other ones are correct!
-	//
-
-	// Create a Vertex Array Object: it will remember where we stored the
-	// data on the GPU, and  which part corresponds to the vertices, which
-	// one for the normals, etc.
-	//
-	// The following function will create new Vertex Arrays, and pass their
-	// name in the given array (second argument). Since we only need one,
-	// pass a pointer to `data.vao`.
-//	glGenVertexArrays(1, /*! \todo fill me */nullptr);
-	glGenVertexArrays(1, &data.vao);
-	// To be able to store information, the Vertex Array has to be bound
-	// first.
-//	glBindVertexArray(/*! \todo bind the previously generated Vertex Array */0u);
-
-	glBindVertexArray(data.vao);
-
-	// To store the data, we need to allocate buffers on the GPU. Let's
-	// allocate a first one for the vertices.
-	//
-	// The following function's syntax is similar to `glGenVertexArray()`:
-	// it will create multiple OpenGL objects, in this case buffers, and
-	// return their names in an array. Have the buffer's name stored into
-	// `data.bo`.
-//	glGenBuffers(1, /*! \todo fill me */nullptr);
-	glGenBuffers(1, &data.bo);
-	// Similar to the Vertex Array, we need to bind it first before storing
-	// anything in it. The data stored in it can be interpreted in
-	// different ways. Here, we will say that it is just a simple 1D-array
-	// and therefore bind the buffer to the corresponding target.
-//	glBindBuffer(GL_ARRAY_BUFFER, /*! \todo bind the previously generated Buffer */0u);
-
-	glBindBuffer(GL_ARRAY_BUFFER, /*! \todo bind the previously generated Buffer */data.bo);
-//	glBufferData(GL_ARRAY_BUFFER, /*! \todo how many bytes should the buffer contain? */0u,
-//	             /* where is the data stored on the CPU? */vertices.data(),
-//	             /* inform OpenGL that the data is modified once, but used often */GL_STATIC_DRAW);
-
-	glBufferData(GL_ARRAY_BUFFER, /*! \todo how many bytes should the buffer contain? */data.vertices_nb,
-			/* where is the data stored on the CPU? */vertices.data(),
-			/* inform OpenGL that the data is modified once, but used often */GL_STATIC_DRAW);
-
-	// Vertices have been just stored into a buffer, but we still need to
-	// tell Vertex Array where to find them, and how to interpret the data
-	// within that buffer.
-	//
-	// You will see shaders in more detail in lab 3, but for now they are
-	// just pieces of code running on the GPU and responsible for moving
-	// all the vertices to clip space, and assigning a colour to each pixel
-	// covered by geometry.
-	// Those shaders have inputs, some of them are the data we just stored
-	// in a buffer object. We need to tell the Vertex Array which inputs
-	// are enabled, and this is done by the following line of code, which
-	// enables the input for vertices:
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-
-	// Once an input is enabled, we need to explain where the data comes
-	// from, and how it interpret it. When calling the following function,
-	// the Vertex Array will automatically use the current buffer bound to
-	// GL_ARRAY_BUFFER as its source for the data. How to interpret it is
-	// specified below:
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices),
-	                      /*! \todo how many components do our vertices have? */3u,
-	                      /* what is the type of each component? */GL_FLOAT,
-	                      /* should it automatically normalise the values stored */GL_FALSE,
-	                      /* once all components of a vertex have been read, how far away (in bytes) is the next vertex? */0,
-	                      /* how far away (in bytes) from the start of the buffer is the first vertex? */reinterpret_cast<GLvoid const*>(0x0));
-
-	// Now, let's allocate a second one for the indices.
-	//
-	// Have the buffer's name stored into `data.ibo`.
-//	glGenBuffers(1, /*! \todo fill me */nullptr);
-
-	glGenBuffers(1, /*! \todo fill me */&data.ibo);
-
-    data.indices_nb = /*! \todo how many indices do we have? */static_cast<GLsizeiptr>(indices.size() * sizeof(glm::vec3));;
-	// We still want a 1D-array, but this time it should be a 1D-array of
-	// elements, aka. indices!
-//	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, /*! \todo bind the previously generated Buffer */0u);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, /*! \todo bind the previously generated Buffer */data.ibo);
-
-//	glBufferData(GL_ELEMENT_ARRAY_BUFFER, /*! \todo how many bytes should the buffer contain? */0u,
-//	             /* where is the data stored on the CPU? */indices.data(),
-//	             /* inform OpenGL that the data is modified once, but used often */GL_STATIC_DRAW);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, /*! \todo how many bytes should the buffer contain? */data.indices_nb,
-			/* where is the data stored on the CPU? */indices.data(),
-			/* inform OpenGL that the data is modified once, but used often */GL_STATIC_DRAW);
-
-
-
-	// All the data has been recorded, we can unbind them.
-	glBindVertexArray(0u);
-	glBindBuffer(GL_ARRAY_BUFFER, 0u);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
-
-	return data;
+	bonobo::vertex_streams streams;
+	streams.vertices_nb = vertices.size();
+	streams.vertices = vertices.data();
+	return bonobo::createMesh(streams, glm::value_ptr(indices.front()), indices.size() * 3u, format);
 }
 
 
@@ -317,7 +218,7 @@ parametric_shapes::createQuad(unsigned int width, unsigned int height)
 //}
 
 bonobo::mesh_data
-parametric_shapes::createHQuad(unsigned int res_width, unsigned int res_height)
+parametric_shapes::createHQuad(unsigned int res_width, unsigned int res_height, bonobo::vertex_format const& format)
 {
     //! \todo Fill in the blanks
 
@@ -366,115 +267,21 @@ parametric_shapes::createHQuad(unsigned int res_width, unsigned int res_height)
         }
     }
 
-    bonobo::mesh_data data;
-
-    data.vertices_nb = vertices.size();  //static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec3));
-    //
-    // NOTE:
-    //
-    // Only the values preceeded by a `\todo` tag should be changed, the
-    // other ones are correct!
-    //
-
-    // Create a Vertex Array Object: it will remember where we stored the
-    // data on the GPU, and  which part corresponds to the vertices, which
-    // one for the normals, etc.
-    //
-    // The following function will create new Vertex Arrays, and pass their
-    // name in the given array (second argument). Since we only need one,
-    // pass a pointer to `data.vao`.
-//	glGenVertexArrays(1, /*! \todo fill me */nullptr);
-    glGenVertexArrays(1, &data.vao);
-    // To be able to store information, the Vertex Array has to be bound
-    // first.
-//	glBindVertexArray(/*! \todo bind the previously generated Vertex Array */0u);
-
-    glBindVertexArray(data.vao);
-
-    // To store the data, we need to allocate buffers on the GPU. Let's
-    // allocate a first one for the vertices.
-    //
-    // The following function's syntax is similar to `glGenVertexArray()`:
-    // it will create multiple OpenGL objects, in this case buffers, and
-    // return their names in an array. Have the buffer's name stored into
-    // `data.bo`.
-//	glGenBuffers(1, /*! \todo fill me */nullptr);
-    glGenBuffers(1, &data.bo);
-    // Similar to the Vertex Array, we need to bind it first before storing
-    // anything in it. The data stored in it can be interpreted in
-    // different ways. Here, we will say that it is just a simple 1D-array
-    // and therefore bind the buffer to the corresponding target.
-//	glBindBuffer(GL_ARRAY_BUFFER, /*! \todo bind the previously generated Buffer */0u);
-
-    glBindBuffer(GL_ARRAY_BUFFER, /*! \todo bind the previously generated Buffer */data.bo);
-//	glBufferData(GL_ARRAY_BUFFER, /*! \todo how many bytes should the buffer contain? */0u,
-//	             /* where is the data stored on the CPU? */vertices.data(),
-//	             /* inform OpenGL that the data is modified once, but used often */GL_STATIC_DRAW);
-
-    glBufferData(GL_ARRAY_BUFFER, /*! \todo how many bytes should the buffer contain? */data.vertices_nb* sizeof(glm::vec3),
-            /* where is the data stored on the CPU? */vertices.data(),
-            /* inform OpenGL that the data is modified once, but used often */GL_STATIC_DRAW);
-
-    // Vertices have been just stored into a buffer, but we still need to
-    // tell Vertex Array where to find them, and how to interpret the data
-    // within that buffer.
-    //
-    // You will see shaders in more detail in lab 3, but for now they are
-    // just pieces of code running on the GPU and responsible for moving
-    // all the vertices to clip space, and assigning a colour to each pixel
-    // covered by geometry.
-    // Those shaders have inputs, some of them are the data we just stored
-    // in a buffer object. We need to tell the Vertex Array which inputs
-    // are enabled, and this is done by the following line of code, which
-    // enables the input for vertices:
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-
-    // Once an input is enabled, we need to explain where the data comes
-    // from, and how it interpret it. When calling the following function,
-    // the Vertex Array will automatically use the current buffer bound to
-    // GL_ARRAY_BUFFER as its source for the data. How to interpret it is
-    // specified below:
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices),
-            /*! \todo how many components do our vertices have? */3u,
-            /* what is the type of each component? */GL_FLOAT,
-            /* should it automatically normalise the values stored */GL_FALSE,
-            /* once all components of a vertex have been read, how far away (in bytes) is the next vertex? */0,
-            /* how far away (in bytes) from the start of the buffer is the first vertex? */reinterpret_cast<GLvoid const*>(0x0));
-
-    // Now, let's allocate a second one for the indices.
-    //
-    // Have the buffer's name stored into `data.ibo`.
-//	glGenBuffers(1, /*! \todo fill me */nullptr);
-
-    glGenBuffers(1, /*! \todo fill me */&data.ibo);
-
-    data.indices_nb = /*! \todo how many indices do we have? */indices.size() * 3u;
-    // We still want a 1D-array, but this time it should be a 1D-array of
-    // elements, aka. indices!
-//	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, /*! \todo bind the previously generated Buffer */0u);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, /*! \todo bind the previously generated Buffer */data.ibo);
-
-//	glBufferData(GL_ELEMENT_ARRAY_BUFFER, /*! \todo how many bytes should the buffer contain? */0u,
-//	             /* where is the data stored on the CPU? */indices.data(),
-//	             /* inform OpenGL that the data is modified once, but used often */GL_STATIC_DRAW);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, /*! \todo how many bytes should the buffer contain? */data.indices_nb*sizeof(glm::vec3),
-            /* where is the data stored on the CPU? */indices.data(),
-            /* inform OpenGL that the data is modified once, but used often */GL_STATIC_DRAW);
-
-
-
-    // All the data has been recorded, we can unbind them.
-    glBindVertexArray(0u);
-    glBindBuffer(GL_ARRAY_BUFFER, 0u);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
-
-    return data;
+    // The rows above are not ordered for the post-transform cache.
+    glm::vec3* const attributes[] = { vertices.data() };
+    bonobo::mesh_optimizer::optimize(bonobo::mesh_optimizer::default_stages, glm::value_ptr(indices.front()), indices.size() * 3u,
+                                     attributes, 1u, vertices.size());
+
+    bonobo::vertex_streams streams;
+    streams.vertices_nb = vertices.size();
+    streams.vertices = vertices.data();
+    return bonobo::createMesh(streams, glm::value_ptr(indices.front()), indices.size() * 3u, format);
 }
 
 bonobo::mesh_data
 parametric_shapes::createSphere(unsigned int const res_theta,
-                                unsigned int const res_phi, float const radius)
+                                unsigned int const res_phi, float const radius,
+                                bonobo::vertex_format const& format)
 {
     auto const vertices_nb = radius * res_phi * res_theta;
 
@@ -581,64 +388,19 @@ parametric_shapes::createSphere(unsigned int const res_theta,
         }
     }
 
-    bonobo::mesh_data data;
-    glGenVertexArrays(1, &data.vao);
-    assert(data.vao != 0u);
-    glBindVertexArray(data.vao);
-
-    auto const vertices_offset = 0u;
-    auto const vertices_size = static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec3));
-    auto const normals_offset = vertices_size;
-    auto const normals_size = static_cast<GLsizeiptr>(normals.size() * sizeof(glm::vec3));
-    auto const texcoords_offset = normals_offset + normals_size;
-    auto const texcoords_size = static_cast<GLsizeiptr>(texcoords.size() * sizeof(glm::vec3));
-    auto const tangents_offset = texcoords_offset + texcoords_size;
-    auto const tangents_size = static_cast<GLsizeiptr>(tangents.size() * sizeof(glm::vec3));
-    auto const binormals_offset = tangents_offset + tangents_size;
-    auto const binormals_size = static_cast<GLsizeiptr>(binormals.size() * sizeof(glm::vec3));
-    auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-                                                 +normals_size
-                                                 +texcoords_size
-                                                 +tangents_size
-                                                 +binormals_size
-    );
-    glGenBuffers(1, &data.bo);
-    assert(data.bo != 0u);
-    glBindBuffer(GL_ARRAY_BUFFER, data.bo);
-    glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
-
-    glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(vertices.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
-
-    glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(normals.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::normals));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-
-    glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(texcoords.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::texcoords));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
-
-    glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(tangents.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::tangents));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
-
-    glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(binormals.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::binormals));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0u);
-
-    data.indices_nb = indices.size() * 3u;
-    glGenBuffers(1, &data.ibo);
-    assert(data.ibo != 0u);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(glm::uvec3)), reinterpret_cast<GLvoid const*>(indices.data()), GL_STATIC_DRAW);
-
-    glBindVertexArray(0u);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
-
-    return data;
+    // The rows above are not ordered for the post-transform cache.
+    glm::vec3* const attributes[] = { vertices.data(), normals.data(), texcoords.data(), tangents.data(), binormals.data() };
+    bonobo::mesh_optimizer::optimize(bonobo::mesh_optimizer::default_stages, glm::value_ptr(indices.front()), indices.size() * 3u,
+                                     attributes, 5u, vertices.size());
+
+    bonobo::vertex_streams streams;
+    streams.vertices_nb = vertices.size();
+    streams.vertices = vertices.data();
+    streams.normals = normals.data();
+    streams.texcoords = texcoords.data();
+    streams.tangents = tangents.data();
+    streams.binormals = binormals.data();
+    return bonobo::createMesh(streams, glm::value_ptr(indices.front()), indices.size() * 3u, format);
 	//! \todo (Optional) Implement this function
 //	return bonobo::mesh_data();
 }
@@ -646,7 +408,7 @@ parametric_shapes::createSphere(unsigned int const res_theta,
 bonobo::mesh_data
 parametric_shapes::createTorus(unsigned int const res_theta,
                                unsigned int const res_phi, float const rA,
-                               float const rB)
+                               float const rB, bonobo::vertex_format const& format)
 {
     float radius = 0.0f,                                                                     // 'stepping'-variable for radius: will go inner_radius - outer_radius
             dradius = (rB - rA) / (static_cast<float>(rB - rA) - 1.0f); // step size, depending on the resolution
@@ -738,64 +500,19 @@ parametric_shapes::createTorus(unsigned int const res_theta,
         }
     }
 
-    bonobo::mesh_data data;
-    glGenVertexArrays(1, &data.vao);
-    assert(data.vao != 0u);
-    glBindVertexArray(data.vao);
-
-    auto const vertices_offset = 0u;
-    auto const vertices_size = static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec3));
-    auto const normals_offset = vertices_size;
-    auto const normals_size = static_cast<GLsizeiptr>(normals.size() * sizeof(glm::vec3));
-    auto const texcoords_offset = normals_offset + normals_size;
-    auto const texcoords_size = static_cast<GLsizeiptr>(texcoords.size() * sizeof(glm::vec3));
-    auto const tangents_offset = texcoords_offset + texcoords_size;
-    auto const tangents_size = static_cast<GLsizeiptr>(tangents.size() * sizeof(glm::vec3));
-    auto const binormals_offset = tangents_offset + tangents_size;
-    auto const binormals_size = static_cast<GLsizeiptr>(binormals.size() * sizeof(glm::vec3));
-    auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-                                                 +normals_size
-                                                 +texcoords_size
-                                                 +tangents_size
-                                                 +binormals_size
-    );
-    glGenBuffers(1, &data.bo);
-    assert(data.bo != 0u);
-    glBindBuffer(GL_ARRAY_BUFFER, data.bo);
-    glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
-
-    glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(vertices.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
-
-    glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(normals.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::normals));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-
-    glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(texcoords.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::texcoords));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
-
-    glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(tangents.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::tangents));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
-
-    glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(binormals.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::binormals));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0u);
-
-    data.indices_nb = indices.size() * 3u;
-    glGenBuffers(1, &data.ibo);
-    assert(data.ibo != 0u);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(glm::uvec3)), reinterpret_cast<GLvoid const*>(indices.data()), GL_STATIC_DRAW);
-
-    glBindVertexArray(0u);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
-
-    return data;
+    // The rows above are not ordered for the post-transform cache.
+    glm::vec3* const attributes[] = { vertices.data(), normals.data(), texcoords.data(), tangents.data(), binormals.data() };
+    bonobo::mesh_optimizer::optimize(bonobo::mesh_optimizer::default_stages, glm::value_ptr(indices.front()), indices.size() * 3u,
+                                     attributes, 5u, vertices.size());
+
+    bonobo::vertex_streams streams;
+    streams.vertices_nb = vertices.size();
+    streams.vertices = vertices.data();
+    streams.normals = normals.data();
+    streams.texcoords = texcoords.data();
+    streams.tangents = tangents.data();
+    streams.binormals = binormals.data();
+    return bonobo::createMesh(streams, glm::value_ptr(indices.front()), indices.size() * 3u, format);
 	//! \todo (Optional) Implement this function
 	return bonobo::mesh_data();
 }
@@ -804,7 +521,8 @@ bonobo::mesh_data
 parametric_shapes::createCircleRing(unsigned int const res_radius,
                                     unsigned int const res_theta,
                                     float const inner_radius,
-                                    float const outer_radius)
+                                    float const outer_radius,
+                                    bonobo::vertex_format const& format)
 {
 	auto const vertices_nb = res_radius * res_theta;
 
@@ -881,64 +599,19 @@ parametric_shapes::createCircleRing(unsigned int const res_radius,
 		}
 	}
 
-	bonobo::mesh_data data;
-	glGenVertexArrays(1, &data.vao);
-	assert(data.vao != 0u);
-	glBindVertexArray(data.vao);
-
-	auto const vertices_offset = 0u;
-	auto const vertices_size = static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec3));
-	auto const normals_offset = vertices_size;
-	auto const normals_size = static_cast<GLsizeiptr>(normals.size() * sizeof(glm::vec3));
-	auto const texcoords_offset = normals_offset + normals_size;
-	auto const texcoords_size = static_cast<GLsizeiptr>(texcoords.size() * sizeof(glm::vec3));
-	auto const tangents_offset = texcoords_offset + texcoords_size;
-	auto const tangents_size = static_cast<GLsizeiptr>(tangents.size() * sizeof(glm::vec3));
-	auto const binormals_offset = tangents_offset + tangents_size;
-	auto const binormals_size = static_cast<GLsizeiptr>(binormals.size() * sizeof(glm::vec3));
-	auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-	                                            +normals_size
-	                                            +texcoords_size
-	                                            +tangents_size
-	                                            +binormals_size
-	                                            );
-	glGenBuffers(1, &data.bo);
-	assert(data.bo != 0u);
-	glBindBuffer(GL_ARRAY_BUFFER, data.bo);
-	glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
-
-	glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(vertices.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
-
-	glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(normals.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::normals));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(texcoords.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::texcoords));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(tangents.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::tangents));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(binormals.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::binormals));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0u);
-
-	data.indices_nb = indices.size() * 3u;
-	glGenBuffers(1, &data.ibo);
-	assert(data.ibo != 0u);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(glm::uvec3)), reinterpret_cast<GLvoid const*>(indices.data()), GL_STATIC_DRAW);
-
-	glBindVertexArray(0u);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
-
-	return data;
+	// The rows above are not ordered for the post-transform cache.
+	glm::vec3* const attributes[] = { vertices.data(), normals.data(), texcoords.data(), tangents.data(), binormals.data() };
+	bonobo::mesh_optimizer::optimize(bonobo::mesh_optimizer::default_stages, glm::value_ptr(indices.front()), indices.size() * 3u,
+	                                 attributes, 5u, vertices.size());
+
+	bonobo::vertex_streams streams;
+	streams.vertices_nb = vertices.size();
+	streams.vertices = vertices.data();
+	streams.normals = normals.data();
+	streams.texcoords = texcoords.data();
+	streams.tangents = tangents.data();
+	streams.binormals = binormals.data();
+	return bonobo::createMesh(streams, glm::value_ptr(indices.front()), indices.size() * 3u, format);
 }
 
 //parametric_shapes::createTaco(unsigned int const res_theta,
@@ -9,18 +9,22 @@ namespace parametric_shapes
 	//!
 	//! @param width the width of the quad
 	//! @param height the height of the quad
+	//! @param format how to store the vertices
 	//! @return wrapper around OpenGL objects' name containing the geometry
 	//!         data
-	bonobo::mesh_data createQuad(unsigned int width, unsigned int height);
+	bonobo::mesh_data createQuad(unsigned int width, unsigned int height,
+	                             bonobo::vertex_format const& format = bonobo::vertex_format::planar());
 
 	//! \brief Create a quad consisting of two triangles and make it
 	//!        available to OpenGL.
 	//!
 	//! @param width the width of the quad
 	//! @param height the height of the quad
+	//! @param format how to store the vertices
 	//! @return wrapper around OpenGL objects' name containing the geometry
 	//!         data
-	bonobo::mesh_data createHQuad(unsigned int width, unsigned int height);
+	bonobo::mesh_data createHQuad(unsigned int width, unsigned int height,
+	                              bonobo::vertex_format const& format = bonobo::vertex_format::planar());
 
 	//! \brief Create a sphere for some tesselation level and make it
 	//!        available to OpenGL.
@@ -28,9 +32,11 @@ namespace parametric_shapes
 	//! @param res_theta tessellation resolution (nbr of vertices) in the latitude direction ( 0 < theta < PI/2 )
 	//! @param res_phi tessellation resolution (nbr of vertices) in the longitude direction ( 0 < phi < 2PI )
 	//! @param radius radius of the sphere
+	//! @param format how to store the vertices
 	//! @return wrapper around OpenGL objects' name containing the geometry
 	//!         data
-	bonobo::mesh_data createSphere(unsigned int const res_theta, unsigned int const res_phi, float const radius);
+	bonobo::mesh_data createSphere(unsigned int const res_theta, unsigned int const res_phi, float const radius,
+	                               bonobo::vertex_format const& format = bonobo::vertex_format::planar());
 
 	//! \brief Create a torus for some tesselation level and make it
 	//!        available to OpenGL.
@@ -39,9 +45,11 @@ namespace parametric_shapes
 	//! @param res_phi tessellation resolution (nbr of vertices) in the longitude direction ( 0 < phi < 2PI )
 	//! @param rA radius of the innermost border of the torus
 	//! @param rB radius of the outermost border of the torus
+	//! @param format how to store the vertices
 	//! @return wrapper around OpenGL objects' name containing the geometry
 	//!         data
-	bonobo::mesh_data createTorus(unsigned int const res_theta, unsigned int const res_phi, float const rA, float const rB);
+	bonobo::mesh_data createTorus(unsigned int const res_theta, unsigned int const res_phi, float const rA, float const rB,
+	                              bonobo::vertex_format const& format = bonobo::vertex_format::planar());
 
 	//! \brief Create a circle ring for some tesselation level and make it
 	//!        available to OpenGL.
@@ -50,9 +58,11 @@ namespace parametric_shapes
 	//! @param theta_res tessellation resolution (nbr of vertices) in the angular direction ( 0 < theta < 2PI )
 	//! @param inner_radius radius of the innermost border of the ring
 	//! @param outer_radius radius of the outermost border of the ring
+	//! @param format how to store the vertices
 	//! @return wrapper around OpenGL objects' name containing the geometry
 	//!         data
-	bonobo::mesh_data createCircleRing(unsigned int const radius_res, unsigned int const theta_res, float const inner_radius, float const outer_radius);
+	bonobo::mesh_data createCircleRing(unsigned int const radius_res, unsigned int const theta_res, float const inner_radius, float const outer_radius,
+	                                   bonobo::vertex_format const& format = bonobo::vertex_format::planar());
 
 
 //    bonobo::mesh_data createTaco(unsigned int const res_theta,
@@ -3,17 +3,30 @@
 #include "config.hpp"
 #include "external/glad/glad.h"
 #include "core/Bonobo.h"
+#include "core/camera_path.hpp"
 #include "core/FPSCamera.h"
+#include "core/frame_graph.hpp"
+#include "core/frame_timings.hpp"
+#include "core/geometry_arena.hpp"
 #include "core/GLStateInspection.h"
+#include "core/gpu_profiler.hpp"
 #include "core/GLStateInspectionView.h"
 #include "core/helpers.hpp"
 #include "core/InputHandler.h"
+#include "core/light_clusters.hpp"
 #include "core/Log.h"
 #include "core/LogView.h"
 #include "core/Misc.h"
 #include "core/node.hpp"
+#include "core/Profiler.h"
+#include "core/render_queue.hpp"
+#include "core/shadow_atlas.hpp"
+#include "core/stream_buffer.hpp"
+#include "core/texture_cache.hpp"
+#include "core/uniform_buffer.hpp"
 #include "core/utils.h"
 #include "core/Window.h"
+#include "EDAF80/interpolation.hpp"
 #include <imgui.h>
 #include "external/imgui_impl_glfw_gl3.h"
 
@@ -23,9 +36,14 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cfloat>
+#include <cstdio>
 #include <cstdlib>
+#include <random>
 #include <stdexcept>
+#include <vector>
 
 enum class polygon_mode_t : unsigned int {
 	fill = 0u,
@@ -38,17 +56,106 @@ static polygon_mode_t get_next_mode(polygon_mode_t mode)
 	return static_cast<polygon_mode_t>((static_cast<unsigned int>(mode) + 1u) % 3u);
 }
 
+//! Render targets of the g-buffer and of the light accumulation buffers.
+struct deferred_targets {
+	bonobo::render_target_desc diffuse, specular, normal, depth;
+	bonobo::render_target_desc light_diffuse, light_specular;
+};
+
 namespace constant
 {
-	constexpr uint32_t shadowmap_res_x = 1024;
-	constexpr uint32_t shadowmap_res_y = 1024;
+	// Packed as in `shaders/common/gbuffer.glsl`
+	constexpr deferred_targets targets = {
+		{ "diffuse",        GL_RGBA8,              GL_NEAREST },
+		{ "specular",       GL_RG8,                GL_NEAREST }, // intensity and glossiness
+		{ "normal",         GL_RG16F,              GL_NEAREST }, // octahedral
+		{ "depth",          GL_DEPTH_COMPONENT32F, GL_NEAREST },
+		{ "light diffuse",  GL_R11F_G11F_B10F,     GL_NEAREST },
+		{ "light specular", GL_R11F_G11F_B10F,     GL_NEAREST }
+	};
+	// What all targets but depth used to be, kept to report the savings
+	constexpr deferred_targets rgba8_targets = {
+		{ "diffuse",        GL_RGBA8,              GL_NEAREST },
+		{ "specular",       GL_RGBA8,              GL_NEAREST },
+		{ "normal",         GL_RGBA8,              GL_NEAREST },
+		{ "depth",          GL_DEPTH_COMPONENT32F, GL_NEAREST },
+		{ "light diffuse",  GL_RGBA8,              GL_NEAREST },
+		{ "light specular", GL_RGBA8,              GL_NEAREST }
+	};
+
+	constexpr GLsizei shadow_atlas_res   = 4096;
+	constexpr GLsizei shadowmap_max_res  = 2048;
+	constexpr GLsizei shadowmap_min_res  = 256;
 
 	constexpr size_t lights_nb           = 4;
 	constexpr float  light_intensity     = 720000.0f;
 	constexpr float  light_angle_falloff = 0.8f;
 	constexpr float  light_cutoff        = 0.05f;
+
+	// Unshadowed lights, shaded through the light clusters
+	constexpr std::array<size_t, 4> clustered_lights_nbs = {{ 4, 64, 256, 1024 }};
+	constexpr float  clustered_light_intensity = 5000.0f;
+	constexpr float  clustered_light_wander    = 100.0f;
+
+	constexpr size_t frame_time_samples = 128; // per light count
+	constexpr size_t sweep_frames       = 256; // per light count
+
+	constexpr size_t camera_keyframe_frames = 120;           // between two keyframes
+	constexpr double camera_replay_timestep = 1000.0 / 60.0; // in ms
+}
+
+//! Bytes read and written per pixel and per frame through the deferred
+//! targets, assuming every light pass covers the whole screen: an upper
+//! bound, as the cone lights only shade the pixels they reach.
+static size_t
+get_deferred_bytes_per_pixel(deferred_targets const& targets, size_t light_passes_nb)
+{
+	auto const size = [](bonobo::render_target_desc const& target){
+		return bonobo::getTexelSize(target.internal_format);
+	};
+	auto const accumulation = size(targets.light_diffuse) + size(targets.light_specular);
+	auto const fill = size(targets.diffuse) + size(targets.specular) + size(targets.normal) + size(targets.depth);
+	// Reads the g-buffer, then blends into the accumulation buffers
+	auto const light = size(targets.depth) + size(targets.normal) + size(targets.specular) + 2u * accumulation;
+	auto const resolve = size(targets.diffuse) + size(targets.specular) + accumulation;
+	return fill + light_passes_nb * light + resolve;
 }
 
+//! Timings of the frames rendered with a given number of clustered lights
+struct frame_time_curve {
+	std::array<float, constant::frame_time_samples> frame_times{};   // in ms
+	std::array<float, constant::frame_time_samples> pass_times{};    // in ms, on the GPU
+	std::array<float, constant::frame_time_samples> binning_times{}; // in ms
+	size_t samples_nb = 0;
+
+	void add(float frame_time, float pass_time, float binning_time)
+	{
+		auto const i = samples_nb++ % constant::frame_time_samples;
+		frame_times[i] = frame_time;
+		pass_times[i] = pass_time;
+		binning_times[i] = binning_time;
+	}
+
+	static float average(std::array<float, constant::frame_time_samples> const& times, size_t samples_nb)
+	{
+		auto const n = std::min(samples_nb, constant::frame_time_samples);
+		auto sum = 0.0f;
+		for (size_t i = 0; i < n; ++i)
+			sum += times[i];
+		return n > 0 ? sum / static_cast<float>(n) : 0.0f;
+	}
+};
+
+//! Light count and CPU timings of a frame, kept until its GPU timings are
+//! read back
+struct issued_frame {
+	u64 id = 0u;
+	int lights_choice = 0;
+	float frame_time = 0.0f;   // in ms
+	float binning_time = 0.0f; // in ms
+	bool valid = false;
+};
+
 static bonobo::mesh_data loadCone();
 
 edan35::Assignment2::Assignment2()
@@ -89,8 +196,15 @@ edan35::Assignment2::~Assignment2()
 void
 edan35::Assignment2::run()
 {
-	// Load the geometry of Sponza
-	auto const sponza_geometry = bonobo::loadObjects("../crysponza/sponza.obj");
+	// Load the geometry of Sponza; `fill_gbuffer.vert` rebuilds the
+	// binormals the compact vertex format leaves out. All submeshes share
+	// the buffers of an arena, so that the render queues can draw them
+	// with a few multi-draw calls. Their textures go through a cache,
+	// which deletes them once the meshes are gone.
+	bonobo::TextureCache sponza_textures;
+	bonobo::GeometryArena sponza_arena;
+	auto const sponza_geometry = bonobo::loadObjects("../crysponza/sponza.obj", false, bonobo::vertex_format::compact(),
+	                                                 bonobo::mesh_optimizer::default_stages, &sponza_arena, &sponza_textures);
 	if (sponza_geometry.empty()) {
 		LogError("Failed to load the Sponza model");
 		return;
@@ -107,6 +221,19 @@ edan35::Assignment2::run()
 	Node cone;
 	cone.set_geometry(cone_geometry);
 
+	// A sphere orbiting the courtyard, the only caster that moves
+	auto const sphere_geometry = bonobo::loadObjects("sphere.obj");
+	Node dynamic_caster;
+	if (!sphere_geometry.empty())
+		dynamic_caster.set_geometry(sphere_geometry.front());
+	auto animate_dynamic_caster = true;
+	auto dynamic_caster_angle = 0.0f;
+	auto const dynamic_caster_world = [](float angle){
+		return glm::translate(glm::mat4(), glm::vec3(400.0f * std::cos(angle), 200.0f, 150.0f * std::sin(angle)))
+		     * glm::scale(glm::mat4(), glm::vec3(40.0f));
+	};
+	auto previous_dynamic_caster_world = glm::mat4(0.0f);
+
 	auto const window_size = window->GetDimensions();
 
 	//
@@ -121,6 +248,36 @@ edan35::Assignment2::run()
 	mCamera.mMovementSpeed = 0.25f;
 	window->SetCamera(&mCamera);
 
+	// Fly-throughs: --camera-record=path writes the camera of every frame,
+	// and --camera-replay=path drives it from such a file, or from
+	// keyframes, with a fixed timestep and timing every frame.
+	bonobo::CameraPath camera_path;
+	auto const camera_record_path = Bonobo::GetOption("camera-record");
+	if (!camera_record_path.empty() && !camera_path.start_recording(camera_record_path))
+		LogError("Failed to record the camera path to \"%s\"", camera_record_path.c_str());
+	auto const camera_replay_path = Bonobo::GetOption("camera-replay");
+	auto const replaying = !camera_replay_path.empty()
+	                    && camera_path.load(camera_replay_path, constant::camera_keyframe_frames,
+	                                        [](glm::vec3 const& p0, glm::vec3 const& p1, glm::vec3 const& p2, glm::vec3 const& p3, float x){
+	                                            return interpolation::evalCatmullRom(p0, p1, p2, p3, 0.5f, x);
+	                                        });
+	size_t replay_frame = 0u;
+	u64 replay_first_gpu_frame = 0u;
+	bonobo::FrameTimings replay_cpu_timings, replay_gpu_timings;
+	auto const write_replay_timings = [&replay_cpu_timings,&replay_gpu_timings](){
+		replay_cpu_timings.log("Camera replay, CPU");
+		replay_gpu_timings.log("Camera replay, GPU");
+		if (bonobo::FrameTimings::dump_csv("camera_replay.csv", { { "cpu", &replay_cpu_timings }, { "gpu", &replay_gpu_timings } }))
+			LogInfo("Camera replay timings written to \"camera_replay.csv\"");
+		else
+			LogError("Failed to write \"camera_replay.csv\"");
+	};
+
+	// A headless replay runs to the end of the path, which then closes
+	// the window, instead of stopping after the frames of --headless.
+	if (replaying && Window::IsHeadless())
+		Window::SetHeadless(static_cast<unsigned int>(std::max<size_t>(camera_path.get_frames_nb(), 1u)));
+
 	//
 	// Load all the shader programs used
 	//
@@ -138,37 +295,69 @@ edan35::Assignment2::run()
 			program = fallback_shader;
 		}
 	};
-	GLuint fill_gbuffer_shader = 0u, fill_shadowmap_shader = 0u, accumulate_lights_shader = 0u, resolve_deferred_shader = 0u;
-	auto const reload_shaders = [&reload_shader,&fill_gbuffer_shader,&fill_shadowmap_shader,&accumulate_lights_shader,&resolve_deferred_shader](){
+	GLuint fill_gbuffer_shader = 0u, fill_shadowmap_shader = 0u, fill_shadowmap_alpha_tested_shader = 0u, accumulate_lights_shader = 0u, shade_clustered_lights_shader = 0u, resolve_deferred_shader = 0u;
+	auto const reload_shaders = [&reload_shader,&fill_gbuffer_shader,&fill_shadowmap_shader,&fill_shadowmap_alpha_tested_shader,&accumulate_lights_shader,&shade_clustered_lights_shader,&resolve_deferred_shader](){
 		LogInfo("Reloading shaders");
-		reload_shader("fill_gbuffer.vert",      "fill_gbuffer.frag",      fill_gbuffer_shader);
-		reload_shader("fill_shadowmap.vert",    "fill_shadowmap.frag",    fill_shadowmap_shader);
-		reload_shader("accumulate_lights.vert", "accumulate_lights.frag", accumulate_lights_shader);
-		reload_shader("resolve_deferred.vert",  "resolve_deferred.frag",  resolve_deferred_shader);
+		reload_shader("fill_gbuffer.vert",      "fill_gbuffer.frag",           fill_gbuffer_shader);
+		reload_shader("fill_shadowmap.vert",    "fill_shadowmap.frag",         fill_shadowmap_shader);
+		reload_shader("fill_shadowmap_alpha_tested.vert", "fill_shadowmap_alpha_tested.frag", fill_shadowmap_alpha_tested_shader);
+		reload_shader("accumulate_lights.vert", "accumulate_lights.frag",      accumulate_lights_shader);
+		reload_shader("resolve_deferred.vert",  "shade_clustered_lights.frag", shade_clustered_lights_shader);
+		reload_shader("resolve_deferred.vert",  "resolve_deferred.frag",       resolve_deferred_shader);
 	};
 	reload_shaders();
 
-	auto const set_uniforms = [](GLuint /*program*/){};
-
+	std::function<void (GLuint)> const set_uniforms = [](GLuint /*program*/){};
+
+	RenderQueue gbuffer_queue, depth_prepass_queue, shadowmap_queue;
+	std::array<RenderQueue::stats, constant::lights_nb> shadowmap_stats{};
+	auto use_multi_draw = true;
+	// Counters of the last frame drawn without (0) and with (1)
+	// multi-draw, to compare both modes; the shadow counters are summed
+	// over the lights whose static casters were redrawn.
+	std::array<RenderQueue::stats, 2> gbuffer_mode_stats{}, shadowmap_mode_stats{};
+	auto const log_multi_draw_comparison = [&gbuffer_mode_stats,&shadowmap_mode_stats](){
+		auto const& off = gbuffer_mode_stats[0];
+		auto const& on = gbuffer_mode_stats[1];
+		if (off.draws == 0u || on.draws == 0u)
+			return;
+		LogInfo("G-buffer: %zu draws in %.3f ms without multi-draw, %zu draws in %.3f ms with it",
+		        off.draws, off.submit_time, on.draws, on.submit_time);
+		auto const& shadow_off = shadowmap_mode_stats[0];
+		auto const& shadow_on = shadowmap_mode_stats[1];
+		if (shadow_off.draws == 0u || shadow_on.draws == 0u)
+			return;
+		LogInfo("Shadow maps: %zu draws in %.3f ms without multi-draw, %zu draws in %.3f ms with it",
+		        shadow_off.draws, shadow_off.submit_time, shadow_on.draws, shadow_on.submit_time);
+	};
 
-	//
-	// Setup textures
-	//
-	auto const diffuse_texture                     = bonobo::createTexture(window_size.x, window_size.y);
-	auto const specular_texture                    = bonobo::createTexture(window_size.x, window_size.y);
-	auto const normal_texture                      = bonobo::createTexture(window_size.x, window_size.y);
-	auto const light_diffuse_contribution_texture  = bonobo::createTexture(window_size.x, window_size.y);
-	auto const light_specular_contribution_texture = bonobo::createTexture(window_size.x, window_size.y);
-	auto const depth_texture                       = bonobo::createTexture(window_size.x, window_size.y, GL_TEXTURE_2D, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT);
-	auto const shadowmap_texture                   = bonobo::createTexture(constant::shadowmap_res_x, constant::shadowmap_res_y, GL_TEXTURE_2D, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT);
+	// Shadow maps and the optional depth pre-pass only need positions,
+	// and texture coordinates for alpha-tested materials; filling the
+	// g-buffer after a pre-pass then shades each pixel once.
+	auto use_depth_only_shadows = true;
+	auto use_depth_prepass = false;
+	auto const sponza_arena_stats = sponza_arena.get_stats();
 
 
 	//
-	// Setup FBOs
+	// Setup textures: the render targets are created by the passes of the
+	// frame graph, which also binds their framebuffers
 	//
-	auto const deferred_fbo  = bonobo::createFBO({diffuse_texture, specular_texture, normal_texture}, depth_texture);
-	auto const shadowmap_fbo = bonobo::createFBO({}, shadowmap_texture);
-	auto const light_fbo     = bonobo::createFBO({light_diffuse_contribution_texture, light_specular_contribution_texture}, depth_texture);
+	bonobo::FrameGraph frame_graph;
+	frame_graph.set_default_framebuffer(window->GetFramebuffer());
+	auto const width = static_cast<u32>(window_size.x);
+	auto const height = static_cast<u32>(window_size.y);
+	auto show_render_targets = true;
+
+	// The shadowed lights, then the clustered ones in a single pass
+	auto const light_passes_nb = constant::lights_nb + 1u;
+	auto const pixels_nb = static_cast<double>(window_size.x) * static_cast<double>(window_size.y);
+	auto const deferred_bytes = get_deferred_bytes_per_pixel(constant::targets, light_passes_nb);
+	auto const rgba8_deferred_bytes = get_deferred_bytes_per_pixel(constant::rgba8_targets, light_passes_nb);
+	LogInfo("Deferred targets: at most %zu bytes per pixel and %.1f MiB per frame, against %zu bytes and %.1f MiB in RGBA8",
+	        deferred_bytes, static_cast<double>(deferred_bytes) * pixels_nb / (1024.0 * 1024.0),
+	        rgba8_deferred_bytes, static_cast<double>(rgba8_deferred_bytes) * pixels_nb / (1024.0 * 1024.0));
+	bonobo::ShadowAtlas shadow_atlas(constant::shadow_atlas_res, constant::shadowmap_max_res, constant::shadowmap_min_res);
 
 	//
 	// Setup samplers
@@ -222,9 +411,56 @@ edan35::Assignment2::run()
 	TRSTransform<f32, glm::defaultp> lightOffsetTransform = TRSTransform<f32, glm::defaultp>();
 	lightOffsetTransform.SetTranslate(glm::vec3(0.0f, 0.0f, -40.0f));
 
-	auto lightProjection = glm::perspective(bonobo::pi * 0.5f,
-	                                        static_cast<float>(constant::shadowmap_res_x) / static_cast<float>(constant::shadowmap_res_y),
-	                                        1.0f, 10000.0f);
+	//
+	// Setup the unshadowed lights: they wander around random spots within
+	// Sponza, the same for every run so that timings can be compared
+	//
+	auto const max_clustered_lights_nb = constant::clustered_lights_nbs.back();
+	std::mt19937 light_rng(1u);
+	std::uniform_real_distribution<float> unit_distribution(0.0f, 1.0f);
+	std::vector<glm::vec3> clustered_light_origins(max_clustered_lights_nb);
+	std::vector<float> clustered_light_phases(max_clustered_lights_nb);
+	std::vector<bonobo::point_light> clustered_lights(max_clustered_lights_nb);
+	for (size_t i = 0; i < max_clustered_lights_nb; ++i) {
+		clustered_light_origins[i] = glm::vec3(-1800.0f + 3600.0f * unit_distribution(light_rng),
+		                                         20.0f + 1200.0f * unit_distribution(light_rng),
+		                                       -700.0f + 1400.0f * unit_distribution(light_rng));
+		clustered_light_phases[i] = 2.0f * bonobo::pi * unit_distribution(light_rng);
+		clustered_lights[i].color = glm::vec3(0.5f + 0.5f * unit_distribution(light_rng),
+		                                      0.5f + 0.5f * unit_distribution(light_rng),
+		                                      0.5f + 0.5f * unit_distribution(light_rng));
+		clustered_lights[i].intensity = constant::clustered_light_intensity;
+		clustered_lights[i].radius = std::sqrt(constant::clustered_light_intensity / constant::light_cutoff);
+	}
+	std::vector<bonobo::point_light> frame_clustered_lights;
+	frame_clustered_lights.reserve(max_clustered_lights_nb);
+	bonobo::LightClusters light_clusters;
+
+	int clustered_lights_choice = 0;
+	std::array<frame_time_curve, constant::clustered_lights_nbs.size()> frame_time_curves;
+	std::array<issued_frame, bonobo::GPUProfiler::frames_nb> issued_frames;
+	auto sweeping = false;
+	size_t sweep_frame = 0;
+
+	// Each pass of the frame graph is timed in a scope named after it
+	bonobo::GPUProfiler gpu_profiler;
+
+	auto lightProjection = glm::perspective(bonobo::pi * 0.5f, 1.0f, 1.0f, 10000.0f);
+	auto const light_range = std::sqrt(constant::light_intensity / constant::light_cutoff);
+	auto rotate_lights = true;
+	auto lights_angle = 0.0f;
+
+
+	//
+	// Setup uniform blocks: one `Pass` block for the g-buffer, then two per
+	// light, for its shadow map and for its contribution
+	//
+	bonobo::UniformBuffer frame_uniforms_buffer(bonobo::uniform_block_bindings::frame, sizeof(bonobo::frame_uniforms));
+	bonobo::UniformBuffer pass_uniforms_buffer(bonobo::uniform_block_bindings::pass, sizeof(bonobo::pass_uniforms));
+	std::vector<bonobo::pass_uniforms> passes(1u + 2u * constant::lights_nb, bonobo::pass_uniforms{});
+	auto const shadowmap_pass = [](size_t light){ return 1u + 2u * light; };
+	auto const light_pass = [](size_t light){ return 2u + 2u * light; };
+	std::array<glm::mat4, constant::lights_nb> light_matrices;
 
 
 	auto seconds_nb = 0.0f;
@@ -240,8 +476,9 @@ edan35::Assignment2::run()
 	double fpsNextTick = lastTime + 1000.0;
 
 	while (!glfwWindowShouldClose(window->GetGLFW_Window())) {
+		PROFILE_SCOPE("Frame");
 		nowTime = GetTimeMilliseconds();
-		ddeltatime = nowTime - lastTime;
+		ddeltatime = replaying ? constant::camera_replay_timestep : nowTime - lastTime;
 		if (nowTime > fpsNextTick) {
 			fpsNextTick += 1000.0;
 			fpsSamples = 0;
@@ -253,8 +490,70 @@ edan35::Assignment2::run()
 		inputHandler->SetUICapture(io.WantCaptureMouse, io.WantCaptureMouse);
 
 		glfwPollEvents();
+		bonobo::updateTextures(4u, &sponza_textures);
 		inputHandler->Advance();
-		mCamera.Update(ddeltatime, *inputHandler);
+		if (replaying)
+			camera_path.apply(replay_frame, mCamera);
+		else
+			mCamera.Update(ddeltatime, *inputHandler);
+		camera_path.record(mCamera);
+		auto const& camera = mCamera.GetSnapshot();
+
+		frame_uniforms_buffer.upload(bonobo::make_frame_uniforms(camera, window_size, seconds_nb,
+		                                                         static_cast<float>(ddeltatime / 1000.0)));
+		passes[0u].vertex_world_to_clip = camera.mWorldToClip;
+
+		// Only the slots of the shadow atlas whose light turned, or which
+		// see the dynamic caster move, get rendered again.
+		if (rotate_lights)
+			lights_angle += static_cast<float>(ddeltatime / 1000.0) * 0.1f;
+		if (animate_dynamic_caster)
+			dynamic_caster_angle += static_cast<float>(ddeltatime / 1000.0) * 0.5f;
+		auto const current_dynamic_caster_world = dynamic_caster_world(dynamic_caster_angle);
+		auto const dynamic_caster_moved = current_dynamic_caster_world != previous_dynamic_caster_world;
+		shadow_atlas.begin_frame();
+		for (size_t i = 0; i < constant::lights_nb; ++i) {
+			auto& lightTransform = lightTransforms[i];
+			lightTransform.SetRotate(lights_angle + i * 1.57f, glm::vec3(0.0f, 1.0f, 0.0f));
+			light_matrices[i] = lightProjection * lightOffsetTransform.GetMatrixInverse() * lightTransform.GetMatrixInverse();
+
+			auto const light_frustum = bonobo::Frustum(light_matrices[i]);
+			auto const sees_dynamic_caster_move = dynamic_caster_moved
+			                                   && (light_frustum.intersects(dynamic_caster.get_bounds(), previous_dynamic_caster_world)
+			                                       || light_frustum.intersects(dynamic_caster.get_bounds(), current_dynamic_caster_world));
+			shadow_atlas.add_light(light_matrices[i],
+			                       bonobo::ShadowAtlas::compute_importance(camera, lightTransform.GetTranslation(), light_range),
+			                       sees_dynamic_caster_move);
+		}
+		shadow_atlas.allocate();
+		previous_dynamic_caster_world = current_dynamic_caster_world;
+
+		for (size_t i = 0; i < constant::lights_nb; ++i) {
+			auto const& lightTransform = lightTransforms[i];
+
+			passes[shadowmap_pass(i)].vertex_world_to_clip = light_matrices[i];
+
+			auto& light = passes[light_pass(i)];
+			light.vertex_world_to_clip = camera.mWorldToClip;
+			light.shadow_view_projection = light_matrices[i];
+			light.light_position = lightTransform.GetTranslation();
+			light.light_intensity = constant::light_intensity;
+			light.light_direction = lightTransform.GetFront();
+			light.light_angle_falloff = constant::light_angle_falloff;
+			light.light_color = lightColors[i];
+			light.shadowmap_texel_size = glm::vec2(1.0f / static_cast<float>(shadow_atlas.get_size()));
+			light.shadowmap_atlas_rect = shadow_atlas.get_slot(i).rect;
+		}
+		pass_uniforms_buffer.upload(passes);
+
+		frame_clustered_lights.assign(clustered_lights.begin(),
+		                              clustered_lights.begin() + constant::clustered_lights_nbs[clustered_lights_choice]);
+		for (size_t i = 0; i < frame_clustered_lights.size(); ++i) {
+			auto const angle = seconds_nb * 0.5f + clustered_light_phases[i];
+			frame_clustered_lights[i].position = clustered_light_origins[i]
+			                                   + constant::clustered_light_wander * glm::vec3(std::cos(angle), 0.0f, std::sin(angle));
+		}
+		light_clusters.update(camera, frame_clustered_lights);
 
 		ImGui_ImplGlfwGL3_NewFrame();
 
@@ -264,98 +563,204 @@ edan35::Assignment2::run()
 
 
 
-		glDepthFunc(GL_LESS);
+		shadowmap_queue.clear();
+		for (auto const& element : sponza_elements) {
+			if (use_depth_only_shadows)
+				shadowmap_queue.push_depth_only(element, glm::mat4(), fill_shadowmap_shader, fill_shadowmap_alpha_tested_shader, set_uniforms);
+			else
+				shadowmap_queue.push(element, glm::mat4(), fill_gbuffer_shader, set_uniforms);
+		}
+		shadowmap_queue.set_multi_draw(use_multi_draw);
+
+
 		//
-		// Pass 1: Render scene into the g-buffer
+		// Describe the passes of the frame with the render targets they
+		// read and write; the frame graph clears each target on its first
+		// write, and shares textures between targets whose uses do not
+		// overlap
 		//
-		glBindFramebuffer(GL_FRAMEBUFFER, deferred_fbo);
-		GLenum const deferred_draw_buffers[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-		glDrawBuffers(3, deferred_draw_buffers);
-		auto const status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-		if (status != GL_FRAMEBUFFER_COMPLETE)
-			LogError("Something went wrong with framebuffer %u", deferred_fbo);
-		glViewport(0, 0, window_size.x, window_size.y);
-		glClear(GL_DEPTH_BUFFER_BIT);
-		// XXX: Is any other clearing needed?
+		gpu_profiler.begin_frame();
+		frame_graph.reset();
+		auto const backbuffer = frame_graph.import_texture("backbuffer", 0u, { "backbuffer", GL_RGBA8, GL_NEAREST }, width, height);
+		auto const atlas_size = static_cast<u32>(shadow_atlas.get_size());
+		auto const shadowmap_atlas = frame_graph.import_texture("shadow atlas", shadow_atlas.get_texture(),
+		                                                        { "shadow atlas", GL_DEPTH_COMPONENT32F, GL_NEAREST }, atlas_size, atlas_size);
+		auto diffuse = bonobo::FrameGraph::invalid_resource, specular = diffuse, normal = diffuse, depth = diffuse;
+		auto light_diffuse = bonobo::FrameGraph::invalid_resource, light_specular = light_diffuse;
+		auto const accumulate_lights = [&light_diffuse,&light_specular,width,height](bonobo::FrameGraph::builder& builder){
+			if (light_diffuse == bonobo::FrameGraph::invalid_resource) {
+				light_diffuse = builder.create(constant::targets.light_diffuse, width, height);
+				light_specular = builder.create(constant::targets.light_specular, width, height);
+			}
+			builder.write(light_diffuse);
+			builder.write(light_specular);
+		};
 
-		GLStateInspection::CaptureSnapshot("Filling Pass");
 
-		for (auto const& element : sponza_elements)
-			element.render(mCamera.GetWorldToClipMatrix(), element.get_transform(), fill_gbuffer_shader, set_uniforms);
+		//
+		// Pass 1.1: Optionally lay down the depth first, so that the
+		// g-buffer is then only written for visible fragments
+		//
+		if (use_depth_prepass) {
+			frame_graph.add_pass("Depth Pre-pass", [&](bonobo::FrameGraph::builder& builder){
+				depth = builder.create(constant::targets.depth, width, height);
+				builder.use_depth(depth, true);
+			}, [&](){
+				glDepthFunc(GL_LESS);
+				pass_uniforms_buffer.bind(0u);
+
+				GLStateInspection::CaptureSnapshot("Depth Pre-pass");
+
+				depth_prepass_queue.clear();
+				for (auto const& element : sponza_elements)
+					depth_prepass_queue.push_depth_only(element, element.get_transform(), fill_shadowmap_shader,
+					                                    fill_shadowmap_alpha_tested_shader, set_uniforms);
+				depth_prepass_queue.push_depth_only(dynamic_caster, current_dynamic_caster_world, fill_shadowmap_shader,
+				                                    fill_shadowmap_alpha_tested_shader, set_uniforms);
+				depth_prepass_queue.set_multi_draw(use_multi_draw);
+				depth_prepass_queue.submit(camera.mWorldToClip, camera.mFrustum);
+			});
+		}
 
+		//
+		// Pass 1: Render scene into the g-buffer
+		//
+		frame_graph.add_pass("Filling Pass", [&](bonobo::FrameGraph::builder& builder){
+			diffuse = builder.create(constant::targets.diffuse, width, height);
+			specular = builder.create(constant::targets.specular, width, height);
+			normal = builder.create(constant::targets.normal, width, height);
+			if (depth == bonobo::FrameGraph::invalid_resource)
+				depth = builder.create(constant::targets.depth, width, height);
+			builder.write(diffuse);
+			builder.write(specular);
+			builder.write(normal);
+			builder.use_depth(depth, !use_depth_prepass);
+		}, [&](){
+			if (use_depth_prepass) {
+				glDepthFunc(GL_EQUAL);
+				glDepthMask(GL_FALSE);
+			} else {
+				glDepthFunc(GL_LESS);
+			}
+			pass_uniforms_buffer.bind(0u);
+
+			GLStateInspection::CaptureSnapshot("Filling Pass");
+
+			gbuffer_queue.clear();
+			for (auto const& element : sponza_elements)
+				gbuffer_queue.push(element, element.get_transform(), fill_gbuffer_shader, set_uniforms);
+			gbuffer_queue.push(dynamic_caster, current_dynamic_caster_world, fill_gbuffer_shader, set_uniforms);
+			gbuffer_queue.set_multi_draw(use_multi_draw);
+			gbuffer_queue.submit(camera.mWorldToClip, camera.mFrustum);
+
+			glDepthMask(GL_TRUE);
+			glDepthFunc(GL_LESS);
+		});
 
 
-		glCullFace(GL_FRONT);
 		//
 		// Pass 2: Generate shadowmaps and accumulate lights' contribution
 		//
-		glBindFramebuffer(GL_FRAMEBUFFER, light_fbo);
-		GLenum light_draw_buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-		glDrawBuffers(2, light_draw_buffers);
-		glViewport(0, 0, window_size.x, window_size.y);
-		// XXX: Is any clearing needed?
 		for (size_t i = 0; i < constant::lights_nb; ++i) {
-			auto& lightTransform = lightTransforms[i];
-			lightTransform.SetRotate(seconds_nb * 0.1f + i * 1.57f, glm::vec3(0.0f, 1.0f, 0.0f));
-
-			auto light_matrix = lightProjection * lightOffsetTransform.GetMatrixInverse() * lightTransform.GetMatrixInverse();
-
 			//
-			// Pass 2.1: Generate shadow map for light i
+			// Pass 2.1: Update the shadow map of light i, if needed: first
+			// the static casters, then the dynamic one on top of them
 			//
-			glBindFramebuffer(GL_FRAMEBUFFER, shadowmap_fbo);
-			glViewport(0, 0, constant::shadowmap_res_x, constant::shadowmap_res_y);
-			// XXX: Is any clearing needed?
-
-			GLStateInspection::CaptureSnapshot("Shadow Map Generation");
-
-			for (auto const& element : sponza_elements)
-				element.render(light_matrix, glm::mat4(), fill_gbuffer_shader, set_uniforms);
+			frame_graph.add_pass("Shadow Map Generation", [&](bonobo::FrameGraph::builder& builder){
+				builder.update(shadowmap_atlas);
+			}, [&, i](){
+				auto const& light_matrix = light_matrices[i];
+
+				glCullFace(GL_FRONT);
+				pass_uniforms_buffer.bind(shadowmap_pass(i));
+				shadowmap_stats[i] = RenderQueue::stats();
+				if (shadow_atlas.needs_static_update(i)) {
+					bonobo::GPUProfiler::scope static_scope(gpu_profiler, "Static Casters");
+					shadow_atlas.bind_static(i);
+
+					GLStateInspection::CaptureSnapshot("Shadow Map Generation");
+
+					shadowmap_queue.submit(light_matrix);
+					shadowmap_stats[i] = shadowmap_queue.get_stats();
+				}
+				if (shadow_atlas.needs_composite(i)) {
+					bonobo::GPUProfiler::scope dynamic_scope(gpu_profiler, "Dynamic Casters");
+					shadow_atlas.bind_composite(i);
+					dynamic_caster.render(light_matrix, current_dynamic_caster_world,
+					                      use_depth_only_shadows ? fill_shadowmap_shader : fill_gbuffer_shader, set_uniforms);
+				}
+				glCullFace(GL_BACK);
+			});
 
+			//
+			// Pass 2.2: Accumulate light i contribution
+			//
+			frame_graph.add_pass("Accumulating", [&](bonobo::FrameGraph::builder& builder){
+				builder.read(depth);
+				builder.read(normal);
+				builder.read(shadowmap_atlas);
+				builder.use_depth(depth, false);
+				accumulate_lights(builder);
+			}, [&, i](){
+				auto const& lightTransform = lightTransforms[i];
+
+				glCullFace(GL_FRONT);
+				glEnable(GL_BLEND);
+				glDepthFunc(GL_GREATER);
+				glDepthMask(GL_FALSE);
+				glBlendEquationSeparate(GL_FUNC_ADD, GL_MIN);
+				glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
+				glUseProgram(accumulate_lights_shader);
+
+				bind_texture_with_sampler(GL_TEXTURE_2D, 0, accumulate_lights_shader, "depth_texture", frame_graph.get_texture(depth), depth_sampler);
+				bind_texture_with_sampler(GL_TEXTURE_2D, 1, accumulate_lights_shader, "normal_texture", frame_graph.get_texture(normal), default_sampler);
+				bind_texture_with_sampler(GL_TEXTURE_2D, 2, accumulate_lights_shader, "shadow_texture", frame_graph.get_texture(shadowmap_atlas), shadow_sampler);
+
+				GLStateInspection::CaptureSnapshot("Accumulating");
+
+				pass_uniforms_buffer.bind(light_pass(i));
+				cone.render(camera.mWorldToClip,
+				            lightTransform.GetMatrix() * lightOffsetTransform.GetMatrix() * coneScaleTransform.GetMatrix(),
+				            accumulate_lights_shader, set_uniforms);
+
+				glBindSampler(2u, 0u);
+				glBindSampler(1u, 0u);
+				glBindSampler(0u, 0u);
+
+				glDepthMask(GL_TRUE);
+				glDepthFunc(GL_LESS);
+				glDisable(GL_BLEND);
+				glCullFace(GL_BACK);
+			});
+		}
 
+		//
+		// Pass 2.3: Accumulate the contribution of all unshadowed lights, in
+		// a single fullscreen pass over the lists of their clusters
+		//
+		frame_graph.add_pass("Clustered Lights", [&](bonobo::FrameGraph::builder& builder){
+			builder.read(depth);
+			builder.read(normal);
+			builder.read(specular);
+			accumulate_lights(builder);
+		}, [&](){
 			glEnable(GL_BLEND);
-			glDepthFunc(GL_GREATER);
+			glDepthFunc(GL_ALWAYS);
 			glDepthMask(GL_FALSE);
 			glBlendEquationSeparate(GL_FUNC_ADD, GL_MIN);
 			glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
-			//
-			// Pass 2.2: Accumulate light i contribution
-			glBindFramebuffer(GL_FRAMEBUFFER, light_fbo);
-			glDrawBuffers(2, light_draw_buffers);
-			glUseProgram(accumulate_lights_shader);
-			glViewport(0, 0, window_size.x, window_size.y);
-			// XXX: Is any clearing needed?
-
-			auto const spotlight_set_uniforms = [&window_size,&mCamera,&light_matrix,&lightColors,&lightTransform,&i](GLuint program){
-				glUniform2f(glGetUniformLocation(program, "inv_res"),
-				            1.0f / static_cast<float>(window_size.x),
-				            1.0f / static_cast<float>(window_size.y));
-				glUniformMatrix4fv(glGetUniformLocation(program, "view_projection_inverse"), 1, GL_FALSE,
-				                   glm::value_ptr(mCamera.GetClipToWorldMatrix()));
-				glUniform3fv(glGetUniformLocation(program, "camera_position"), 1,
-				                   glm::value_ptr(mCamera.mWorld.GetTranslation()));
-				glUniformMatrix4fv(glGetUniformLocation(program, "shadow_view_projection"), 1, GL_FALSE,
-				                   glm::value_ptr(light_matrix));
-				glUniform3fv(glGetUniformLocation(program, "light_color"), 1, glm::value_ptr(lightColors[i]));
-				glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(lightTransform.GetTranslation()));
-				glUniform3fv(glGetUniformLocation(program, "light_direction"), 1, glm::value_ptr(lightTransform.GetFront()));
-				glUniform1f(glGetUniformLocation(program, "light_intensity"), constant::light_intensity);
-				glUniform1f(glGetUniformLocation(program, "light_angle_falloff"), constant::light_angle_falloff);
-				glUniform2f(glGetUniformLocation(program, "shadowmap_texel_size"),
-				            1.0f / static_cast<float>(constant::shadowmap_res_x),
-				            1.0f / static_cast<float>(constant::shadowmap_res_y));
-			};
+			glUseProgram(shade_clustered_lights_shader);
 
-			bind_texture_with_sampler(GL_TEXTURE_2D, 0, accumulate_lights_shader, "depth_texture", depth_texture, depth_sampler);
-			bind_texture_with_sampler(GL_TEXTURE_2D, 1, accumulate_lights_shader, "normal_texture", normal_texture, default_sampler);
-			bind_texture_with_sampler(GL_TEXTURE_2D, 2, accumulate_lights_shader, "shadow_texture", shadowmap_texture, shadow_sampler);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 0, shade_clustered_lights_shader, "depth_texture", frame_graph.get_texture(depth), depth_sampler);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 1, shade_clustered_lights_shader, "normal_texture", frame_graph.get_texture(normal), default_sampler);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 2, shade_clustered_lights_shader, "specular_texture", frame_graph.get_texture(specular), default_sampler);
+			light_clusters.bind(shade_clustered_lights_shader, 3u);
 
-			GLStateInspection::CaptureSnapshot("Accumulating");
+			GLStateInspection::CaptureSnapshot("Clustered Lights");
 
-			cone.render(mCamera.GetWorldToClipMatrix(),
-			            lightTransform.GetMatrix() * lightOffsetTransform.GetMatrix() * coneScaleTransform.GetMatrix(),
-			            accumulate_lights_shader, spotlight_set_uniforms);
+			bonobo::drawFullscreen();
 
+			light_clusters.unbind(3u);
 			glBindSampler(2u, 0u);
 			glBindSampler(1u, 0u);
 			glBindSampler(0u, 0u);
@@ -363,33 +768,36 @@ edan35::Assignment2::run()
 			glDepthMask(GL_TRUE);
 			glDepthFunc(GL_LESS);
 			glDisable(GL_BLEND);
-		}
+		});
 
-
-		glCullFace(GL_BACK);
-		glDepthFunc(GL_ALWAYS);
 		//
 		// Pass 3: Compute final image using both the g-buffer and  the light accumulation buffer
 		//
-		glBindFramebuffer(GL_FRAMEBUFFER, 0u);
-		glUseProgram(resolve_deferred_shader);
-		glViewport(0, 0, window_size.x, window_size.y);
-		// XXX: Is any clearing needed?
+		frame_graph.add_pass("Resolve Pass", [&](bonobo::FrameGraph::builder& builder){
+			builder.read(diffuse);
+			builder.read(specular);
+			builder.read(light_diffuse);
+			builder.read(light_specular);
+			builder.write(backbuffer);
+		}, [&](){
+			glDepthFunc(GL_ALWAYS);
+			glUseProgram(resolve_deferred_shader);
 
-		bind_texture_with_sampler(GL_TEXTURE_2D, 0, resolve_deferred_shader, "diffuse_texture", diffuse_texture, default_sampler);
-		bind_texture_with_sampler(GL_TEXTURE_2D, 1, resolve_deferred_shader, "specular_texture", specular_texture, default_sampler);
-		bind_texture_with_sampler(GL_TEXTURE_2D, 2, resolve_deferred_shader, "light_d_texture", light_diffuse_contribution_texture, default_sampler);
-		bind_texture_with_sampler(GL_TEXTURE_2D, 3, resolve_deferred_shader, "light_s_texture", light_specular_contribution_texture, default_sampler);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 0, resolve_deferred_shader, "diffuse_texture", frame_graph.get_texture(diffuse), default_sampler);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 1, resolve_deferred_shader, "specular_texture", frame_graph.get_texture(specular), default_sampler);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 2, resolve_deferred_shader, "light_d_texture", frame_graph.get_texture(light_diffuse), default_sampler);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 3, resolve_deferred_shader, "light_s_texture", frame_graph.get_texture(light_specular), default_sampler);
 
-		GLStateInspection::CaptureSnapshot("Resolve Pass");
+			GLStateInspection::CaptureSnapshot("Resolve Pass");
 
-		bonobo::drawFullscreen();
+			bonobo::drawFullscreen();
 
-		glBindSampler(3, 0u);
-		glBindSampler(2, 0u);
-		glBindSampler(1, 0u);
-		glBindSampler(0, 0u);
-		glUseProgram(0u);
+			glBindSampler(3, 0u);
+			glBindSampler(2, 0u);
+			glBindSampler(1, 0u);
+			glBindSampler(0, 0u);
+			glUseProgram(0u);
+		});
 
 
 		//
@@ -397,7 +805,7 @@ edan35::Assignment2::run()
 		//
 //		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 //		for (size_t i = 0; i < constant::lights_nb; ++i) {
-//			cone.render(mCamera.GetWorldToClipMatrix(),
+//			cone.render(camera.mWorldToClip,
 //			            lightTransforms[i].GetMatrix() * lightOffsetTransform.GetMatrix() * coneScaleTransform.GetMatrix(),
 //			            fill_shadowmap_shader, set_uniforms);
 //		}
@@ -407,13 +815,62 @@ edan35::Assignment2::run()
 		//
 		// Output content of the g-buffer as well as of the shadowmap, for debugging purposes
 		//
-		bonobo::displayTexture({-0.95f, -0.95f}, {-0.55f, -0.55f}, diffuse_texture,                     default_sampler, {0, 1, 2, -1}, window_size);
-		bonobo::displayTexture({-0.45f, -0.95f}, {-0.05f, -0.55f}, specular_texture,                    default_sampler, {0, 1, 2, -1}, window_size);
-		bonobo::displayTexture({ 0.05f, -0.95f}, { 0.45f, -0.55f}, normal_texture,                      default_sampler, {0, 1, 2, -1}, window_size);
-		bonobo::displayTexture({ 0.55f, -0.95f}, { 0.95f, -0.55f}, depth_texture,                       default_sampler, {0, 0, 0, -1}, window_size, &mCamera);
-		bonobo::displayTexture({-0.95f,  0.55f}, {-0.55f,  0.95f}, shadowmap_texture,                   default_sampler, {0, 0, 0, -1}, window_size, &mCamera);
-		bonobo::displayTexture({-0.45f,  0.55f}, {-0.05f,  0.95f}, light_diffuse_contribution_texture,  default_sampler, {0, 1, 2, -1}, window_size);
-		bonobo::displayTexture({ 0.05f,  0.55f}, { 0.45f,  0.95f}, light_specular_contribution_texture, default_sampler, {0, 1, 2, -1}, window_size);
+		if (show_render_targets) {
+			frame_graph.add_pass("Render Targets", [&](bonobo::FrameGraph::builder& builder){
+				for (auto const target : { diffuse, specular, normal, depth, shadowmap_atlas, light_diffuse, light_specular })
+					builder.read(target);
+				builder.write(backbuffer);
+			}, [&](){
+				bonobo::displayTexture({-0.95f, -0.95f}, {-0.55f, -0.55f}, frame_graph.get_texture(diffuse),         default_sampler, {0, 1, 2, -1}, window_size);
+				bonobo::displayTexture({-0.45f, -0.95f}, {-0.05f, -0.55f}, frame_graph.get_texture(specular),        default_sampler, {0, 0, 0, -1}, window_size);
+				bonobo::displayTexture({ 0.05f, -0.95f}, { 0.45f, -0.55f}, frame_graph.get_texture(normal),          default_sampler, {0, 1, 2, -1}, window_size);
+				bonobo::displayTexture({ 0.55f, -0.95f}, { 0.95f, -0.55f}, frame_graph.get_texture(depth),           default_sampler, {0, 0, 0, -1}, window_size, &mCamera);
+				bonobo::displayTexture({-0.95f,  0.55f}, {-0.55f,  0.95f}, frame_graph.get_texture(shadowmap_atlas), default_sampler, {0, 0, 0, -1}, window_size, &mCamera);
+				bonobo::displayTexture({-0.45f,  0.55f}, {-0.05f,  0.95f}, frame_graph.get_texture(light_diffuse),   default_sampler, {0, 1, 2, -1}, window_size);
+				bonobo::displayTexture({ 0.05f,  0.55f}, { 0.45f,  0.95f}, frame_graph.get_texture(light_specular),  default_sampler, {0, 1, 2, -1}, window_size);
+			});
+		}
+
+		frame_graph.execute(&gpu_profiler);
+
+		gbuffer_mode_stats[use_multi_draw ? 1 : 0] = gbuffer_queue.get_stats();
+		auto shadowmap_frame_stats = RenderQueue::stats();
+		for (auto const& light_stats : shadowmap_stats) {
+			shadowmap_frame_stats.draws += light_stats.draws;
+			shadowmap_frame_stats.meshes += light_stats.meshes;
+			shadowmap_frame_stats.submit_time += light_stats.submit_time;
+		}
+		if (shadowmap_frame_stats.draws > 0u)
+			shadowmap_mode_stats[use_multi_draw ? 1 : 0] = shadowmap_frame_stats;
+
+		// GPU timings are read back frames_nb frames late, and not at all
+		// for frames the profiler dropped: each one goes in the row of the
+		// replay frame it was issued in, and the last frames_nb frames of
+		// a replay have none.
+		if (replaying && replay_frame == 0u)
+			replay_first_gpu_frame = gpu_profiler.get_frame_id();
+		auto const gpu_frame_time = gpu_profiler.get_resolved_frame_time();
+		auto const gpu_frame_id = gpu_profiler.get_resolved_frame_id();
+		if (replaying && gpu_frame_time >= 0.0f && gpu_frame_id >= replay_first_gpu_frame)
+			replay_gpu_timings.add(static_cast<size_t>(gpu_frame_id - replay_first_gpu_frame), gpu_frame_time);
+
+		// The pass time read back belongs to a frame issued a few frames
+		// ago, possibly with another light count: credit it, along with
+		// the CPU timings of that frame, to the count it was issued with.
+		// The slot of that frame is looked up before this frame takes it.
+		auto const clustered_pass_time = gpu_profiler.get_resolved_time("Clustered Lights");
+		auto const resolved_frame_id = gpu_profiler.get_resolved_frame_id();
+		auto const& resolved_frame = issued_frames[resolved_frame_id % issued_frames.size()];
+		if (clustered_pass_time >= 0.0f && resolved_frame.valid && resolved_frame.id == resolved_frame_id)
+			frame_time_curves[resolved_frame.lights_choice].add(resolved_frame.frame_time, clustered_pass_time,
+			                                                    resolved_frame.binning_time);
+		auto& current_frame = issued_frames[gpu_profiler.get_frame_id() % issued_frames.size()];
+		current_frame.id = gpu_profiler.get_frame_id();
+		current_frame.lights_choice = clustered_lights_choice;
+		current_frame.frame_time = static_cast<float>(ddeltatime);
+		current_frame.binning_time = static_cast<float>(light_clusters.get_stats().binning_time);
+		current_frame.valid = true;
+
 		//
 		// Reset viewport back to normal
 		//
@@ -421,22 +878,156 @@ edan35::Assignment2::run()
 
 		GLStateInspection::View::Render();
 		Log::View::Render();
+		gpu_profiler.render_ui();
 
 		bool opened = ImGui::Begin("Render Time", nullptr, ImVec2(120, 50), -1.0f, 0);
-		if (opened)
+		if (opened) {
 			ImGui::Text("%.3f ms", ddeltatime);
+			auto const& gbuffer_stats = gbuffer_queue.get_stats();
+			ImGui::Text("G-buffer: %zu draws, %zu programs, %zu VAOs, %zu textures",
+			            gbuffer_stats.draws, gbuffer_stats.program_binds,
+			            gbuffer_stats.vao_binds, gbuffer_stats.texture_binds);
+			ImGui::Text("G-buffer: %zu visible meshes in %zu draws (%zu multi-draws), %zu culled",
+			            gbuffer_stats.meshes, gbuffer_stats.draws, gbuffer_stats.multi_draws, gbuffer_stats.culled);
+			ImGui::Text("G-buffer submission: %zu draws in %.3f ms without multi-draw, %zu draws in %.3f ms with it",
+			            gbuffer_mode_stats[0].draws, gbuffer_mode_stats[0].submit_time,
+			            gbuffer_mode_stats[1].draws, gbuffer_mode_stats[1].submit_time);
+			ImGui::Text("Shadow map submission: %zu draws in %.3f ms without multi-draw, %zu draws in %.3f ms with it",
+			            shadowmap_mode_stats[0].draws, shadowmap_mode_stats[0].submit_time,
+			            shadowmap_mode_stats[1].draws, shadowmap_mode_stats[1].submit_time);
+			if (ImGui::Checkbox("Multi-draw", &use_multi_draw))
+				log_multi_draw_comparison();
+			ImGui::SameLine();
+			ImGui::Checkbox("Depth pre-pass", &use_depth_prepass);
+			ImGui::SameLine();
+			ImGui::Checkbox("Depth-only shadow maps", &use_depth_only_shadows);
+			auto const average_time = [&gpu_profiler](char const* path){
+				auto const* const stats = gpu_profiler.find(path);
+				return stats != nullptr ? stats->average : 0.0f;
+			};
+			ImGui::Text("GPU: g-buffer %.3f ms%s, shadow maps %.3f ms",
+			            average_time("Filling Pass") + (use_depth_prepass ? average_time("Depth Pre-pass") : 0.0f),
+			            use_depth_prepass ? " (with pre-pass)" : "", average_time("Shadow Map Generation"));
+			ImGui::Text("Deferred targets: <= %.1f MiB per frame (%.1f MiB in RGBA8)",
+			            static_cast<double>(deferred_bytes) * pixels_nb / (1024.0 * 1024.0),
+			            static_cast<double>(rgba8_deferred_bytes) * pixels_nb / (1024.0 * 1024.0));
+			auto const& graph_stats = frame_graph.get_stats();
+			ImGui::Text("Frame graph: %zu passes (%zu culled), %zu render targets, %zu clears",
+			            graph_stats.passes, graph_stats.culled_passes, graph_stats.transient_targets, graph_stats.clears);
+			ImGui::Text("Render targets: %.1f MiB at peak, %.1f MiB without aliasing, %.1f MiB pooled",
+			            static_cast<double>(graph_stats.peak_bytes) / (1024.0 * 1024.0),
+			            static_cast<double>(graph_stats.unaliased_bytes) / (1024.0 * 1024.0),
+			            static_cast<double>(graph_stats.pooled_bytes) / (1024.0 * 1024.0));
+			ImGui::Checkbox("Show render targets", &show_render_targets);
+			ImGui::Text("Arena: %zu meshes, %.1f MiB", sponza_arena_stats.meshes,
+			            static_cast<double>(sponza_arena_stats.vertex_bytes + sponza_arena_stats.index_bytes) / (1024.0 * 1024.0));
+			ImGui::Checkbox("Rotate lights", &rotate_lights);
+			ImGui::SameLine();
+			ImGui::Checkbox("Move dynamic caster", &animate_dynamic_caster);
+			auto const& atlas_stats = shadow_atlas.get_stats();
+			ImGui::Text("Shadow atlas: %zu static renders, %zu composites, %zu cached, %.1f%% used",
+			            atlas_stats.static_renders, atlas_stats.composites, atlas_stats.cached,
+			            100.0 * static_cast<double>(atlas_stats.texels) / (static_cast<double>(constant::shadow_atlas_res) * constant::shadow_atlas_res));
+			for (size_t i = 0; i < constant::lights_nb; ++i)
+				ImGui::Text("Shadow map %zu (%dx%d): %zu meshes in %zu draws, %zu culled", i,
+				            shadow_atlas.get_slot(i).resolution, shadow_atlas.get_slot(i).resolution,
+				            shadowmap_stats[i].meshes, shadowmap_stats[i].draws, shadowmap_stats[i].culled);
+			auto const* const stream = window->GetStreamBuffer();
+			auto const& stream_stats = stream->get_stats();
+			ImGui::Text("Streamed (%s): %.1f KiB, %zu allocations, %zu overflows",
+			            stream->is_persistent() ? "persistent" : "orphaned",
+			            static_cast<double>(stream_stats.bytes_streamed) / 1024.0, stream_stats.allocations, stream_stats.overflows);
+			ImGui::Text("Stream fences: %zu stalls, %.3f ms", stream_stats.stalls, stream_stats.stall_time);
+		}
+		ImGui::End();
+
+		opened = ImGui::Begin("Clustered Lights", nullptr, ImVec2(300, 400), -1.0f, 0);
+		if (opened) {
+			for (size_t i = 0; i < constant::clustered_lights_nbs.size(); ++i) {
+				if (i > 0)
+					ImGui::SameLine();
+				auto const label = std::to_string(constant::clustered_lights_nbs[i]) + " lights";
+				ImGui::RadioButton(label.c_str(), &clustered_lights_choice, static_cast<int>(i));
+			}
+			if (ImGui::Button(sweeping ? "Sweeping..." : "Sweep all light counts") && !sweeping) {
+				sweeping = true;
+				sweep_frame = 0;
+				clustered_lights_choice = 0;
+				for (auto& curve : frame_time_curves)
+					curve = frame_time_curve();
+				issued_frames.fill(issued_frame());
+			}
+			auto const& cluster_stats = light_clusters.get_stats();
+			ImGui::Text("%zu/%zu lights visible, %zu references", cluster_stats.visible_lights,
+			            cluster_stats.lights, cluster_stats.references);
+			ImGui::Text("%zu/%u clusters occupied, at most %zu lights each", cluster_stats.occupied_clusters,
+			            bonobo::LightClusters::clusters_nb, cluster_stats.max_per_cluster);
+			ImGui::Text("Binning and upload: %.3f ms", cluster_stats.binning_time);
+			for (size_t i = 0; i < frame_time_curves.size(); ++i) {
+				auto const& curve = frame_time_curves[i];
+				auto const offset = static_cast<int>(curve.samples_nb % constant::frame_time_samples);
+				char overlay[128];
+				snprintf(overlay, sizeof(overlay), "%u lights: %.3f ms on the GPU, %.3f ms per frame",
+				         static_cast<unsigned int>(constant::clustered_lights_nbs[i]),
+				         frame_time_curve::average(curve.pass_times, curve.samples_nb),
+				         frame_time_curve::average(curve.frame_times, curve.samples_nb));
+				char label[32];
+				snprintf(label, sizeof(label), "##curve%zu", i);
+				ImGui::PlotLines(label, curve.pass_times.data(), static_cast<int>(curve.pass_times.size()), offset,
+				                 overlay, 0.0f, FLT_MAX, ImVec2(0, 60));
+			}
+		}
 		ImGui::End();
 
-		ImGui::Render();
+		// Render a fixed number of frames with each light count, then log
+		// the averages.
+		if (sweeping && ++sweep_frame == constant::sweep_frames) {
+			sweep_frame = 0;
+			if (static_cast<size_t>(++clustered_lights_choice) == constant::clustered_lights_nbs.size()) {
+				sweeping = false;
+				clustered_lights_choice = 0;
+				for (size_t i = 0; i < frame_time_curves.size(); ++i) {
+					auto const& curve = frame_time_curves[i];
+					LogInfo("%u clustered lights: %.3f ms per frame, %.3f ms on the GPU, %.3f ms binning",
+					        static_cast<unsigned int>(constant::clustered_lights_nbs[i]),
+					        frame_time_curve::average(curve.frame_times, curve.samples_nb),
+					        frame_time_curve::average(curve.pass_times, curve.samples_nb),
+					        frame_time_curve::average(curve.binning_times, curve.samples_nb));
+				}
+			}
+		}
+
+		{
+			bonobo::GPUProfiler::scope ui_scope(gpu_profiler, "ImGui");
+			ImGui::Render();
+		}
+		gpu_profiler.end_frame();
 
 		window->Swap();
 		lastTime = nowTime;
+
+		if (replaying) {
+			replay_cpu_timings.add(GetTimeMilliseconds() - nowTime);
+			if (++replay_frame == camera_path.get_frames_nb()) {
+				write_replay_timings();
+				glfwSetWindowShouldClose(window->GetGLFW_Window(), GLFW_TRUE);
+			}
+		}
+	}
+	if (replaying && replay_frame < camera_path.get_frames_nb()) {
+		LogWarning("Camera replay stopped after %zu of its %zu frames", replay_frame, camera_path.get_frames_nb());
+		write_replay_timings();
 	}
+	camera_path.stop_recording();
 
 	glDeleteProgram(resolve_deferred_shader);
 	resolve_deferred_shader = 0u;
+	glDeleteProgram(shade_clustered_lights_shader);
+	shade_clustered_lights_shader = 0u;
 	glDeleteProgram(accumulate_lights_shader);
 	accumulate_lights_shader = 0u;
+	glDeleteProgram(fill_shadowmap_alpha_tested_shader);
+	fill_shadowmap_alpha_tested_shader = 0u;
 	glDeleteProgram(fill_shadowmap_shader);
 	fill_shadowmap_shader = 0u;
 	glDeleteProgram(fill_gbuffer_shader);
@@ -445,9 +1036,9 @@ edan35::Assignment2::run()
 	fallback_shader = 0u;
 }
 
-int main()
+int main(int argc, char* argv[])
 {
-	Bonobo::Init();
+	Bonobo::Init(argc, argv);
 	try {
 		edan35::Assignment2 assignment2;
 		assignment2.run();
@@ -1,14 +1,81 @@
 #include "Bonobo.h"
 #include "Log.h"
+#include "Profiler.h"
 #include "Window.h"
 
-void Bonobo::Init()
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <vector>
+
+static unsigned int const default_headless_frames_nb = 500u;
+static std::vector<std::string> arguments;
+
+static unsigned int GetHeadlessFramesNb()
+{
+	if (!Bonobo::HasOption("headless"))
+		return 0u;
+	auto const value = Bonobo::GetOption("headless");
+	if (value.empty())
+		return default_headless_frames_nb;
+	auto const frames_nb = std::strtoul(value.c_str(), nullptr, 10);
+	if (frames_nb == 0u) {
+		LogWarning("Invalid number of headless frames \"%s\": using %u instead.", value.c_str(), default_headless_frames_nb);
+		return default_headless_frames_nb;
+	}
+	return static_cast<unsigned int>(frames_nb);
+}
+
+// Returns whether the option was found, and its value if any.
+static bool FindOption(std::string const &name, std::string &value)
+{
+	auto const flag = "--" + name;
+	for (auto const &argument : arguments) {
+		if (argument == flag) {
+			value.clear();
+			return true;
+		}
+		if (argument.compare(0, flag.size() + 1u, flag + "=") == 0) {
+			value = argument.substr(flag.size() + 1u);
+			return true;
+		}
+	}
+
+	auto variable = "BONOBO_" + name;
+	std::transform(variable.begin(), variable.end(), variable.begin(), [](char c){
+		return c == '-' ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+	});
+	char const *env = std::getenv(variable.c_str());
+	if (env == nullptr)
+		return false;
+	value = env;
+	return true;
+}
+
+bool Bonobo::HasOption(std::string const &name)
+{
+	std::string value;
+	return FindOption(name, value);
+}
+
+std::string Bonobo::GetOption(std::string const &name)
+{
+	std::string value;
+	FindOption(name, value);
+	return value;
+}
+
+void Bonobo::Init(int argc, char const* const argv[])
 {
+	// Before any other thread, e.g. a texture loader, records an event.
+	PROFILE_THREAD("Main");
 	Log::Init();
+	arguments.assign(argv != nullptr ? argv + std::min(argc, 1) : nullptr, argv != nullptr ? argv + argc : nullptr);
 	LogInfo("Running Bonobo v0.2");
 
 	LogInfo("Initiating window management system...");
 	Window::Init();
+	Window::SetHeadless(GetHeadlessFramesNb());
 
 	LogInfo("Done");
 }
@@ -16,6 +83,12 @@ void Bonobo::Init()
 void Bonobo::Destroy()
 {
 	Window::Destroy();
+#if defined ENABLE_PROFILING && ENABLE_PROFILING != 0
+	if (Profiler::ExportChromeTrace("profile.json"))
+		LogInfo("CPU profile written to profile.json");
+	else
+		LogWarning("Failed to write the CPU profile to profile.json");
+#endif
 	Log::Destroy();
 }
 
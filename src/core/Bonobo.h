@@ -1,7 +1,21 @@
 #pragma once
 
+#include <string>
+
 class Bonobo {
 public:
-	static void Init();
+	// Options are given on the command line as `--name[=value]`, or
+	// through the environment as `BONOBO_NAME=value`, with the name
+	// upper-cased and its dashes turned into underscores. Recognised by
+	// Init():
+	//   --headless[=frames]  BONOBO_HEADLESS=frames
+	//     Render the given number of frames (500 by default) offscreen,
+	//     with vsync off, then log their timings and quit; see
+	//     Window::SetHeadless().
+	static void Init(int argc = 0, char const* const argv[] = nullptr);
 	static void Destroy();
+
+	static bool HasOption(std::string const &name);
+	// Empty if the option is missing or has no value
+	static std::string GetOption(std::string const &name);
 };
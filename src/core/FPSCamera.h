@@ -1,15 +1,39 @@
 #pragma once
 
+#include "culling.hpp"
 #include "TRSTransform.h"
 #include "InputHandler.h"
 
 #include <glm/glm.hpp>
 
+#include <cstddef>
 #include <iostream>
 
+/**
+ * The matrices and the frustum planes of the camera are computed on demand,
+ * and cached until Update() moves the camera, SetProjection() is called, or
+ * mWorld is modified directly. Render code should fetch them once per frame
+ * through GetSnapshot(), and pass the snapshot by reference to the passes.
+ */
 template<typename T, glm::precision P>
 class FPSCamera
 {
+public:
+	/* State of the camera, as seen by render code during a frame */
+	struct Snapshot {
+		glm::tmat4x4<T, P> mViewToWorld;
+		glm::tmat4x4<T, P> mWorldToView;
+		glm::tmat4x4<T, P> mViewToClip;
+		glm::tmat4x4<T, P> mClipToView;
+		glm::tmat4x4<T, P> mWorldToClip;
+		glm::tmat4x4<T, P> mClipToWorld;
+		glm::tvec3<T, P> mPosition;
+		T mFov, mAspect, mNear, mFar;
+		bonobo::Frustum mFrustum;
+
+		Snapshot() : mFov(0), mAspect(0), mNear(0), mFar(0), mFrustum(glm::mat4(1.0f)) {}
+	};
+
 public:
 	FPSCamera(T fovy, T aspect, T nnear, T nfar);
 	~FPSCamera();
@@ -22,6 +46,9 @@ public:
 	void SetAspect(T a);
 	T GetAspect();
 
+	/* Get the cached matrices and frustum, recomputing them if needed */
+	Snapshot const &GetSnapshot();
+
 	glm::tmat4x4<T, P> GetViewToWorldMatrix();
 	glm::tmat4x4<T, P> GetWorldToViewMatrix();
 	glm::tmat4x4<T, P> GetClipToWorldMatrix();
@@ -44,6 +71,11 @@ public:
 	glm::tvec2<T, P> mRotation;
 	glm::tvec2<T, P> mMousePosition;
 
+private:
+	Snapshot mSnapshot;
+	size_t mSnapshotWorldVersion;
+	bool mSnapshotDirty;
+
 public:
 	friend std::ostream &operator<<(std::ostream &os, FPSCamera<T, P> &v) {
 		os << v.mFov << " " << v.mAspect << " " << v.mNear << " " << v.mFar << std::endl;
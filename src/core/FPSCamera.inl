@@ -1,5 +1,5 @@
 template<typename T, glm::precision P>
-FPSCamera<T, P>::FPSCamera(T fovy, T aspect, T nnear, T nfar) : mWorld(), mMovementSpeed(1), mMouseSensitivity(1), mFov(fovy), mAspect(aspect), mNear(nnear), mFar(nfar), mProjection(), mProjectionInverse(), mRotation(glm::tvec2<T, P>(0.0f)), mMousePosition(glm::tvec2<T, P>(0.0f))
+FPSCamera<T, P>::FPSCamera(T fovy, T aspect, T nnear, T nfar) : mWorld(), mMovementSpeed(1), mMouseSensitivity(1), mFov(fovy), mAspect(aspect), mNear(nnear), mFar(nfar), mProjection(), mProjectionInverse(), mRotation(glm::tvec2<T, P>(0.0f)), mMousePosition(glm::tvec2<T, P>(0.0f)), mSnapshot(), mSnapshotWorldVersion(0), mSnapshotDirty(true)
 {
 	SetProjection(fovy, aspect, nnear, nfar);
 }
@@ -18,6 +18,7 @@ void FPSCamera<T, P>::SetProjection(T fovy, T aspect, T nnear, T nfar)
 	mFar = nfar;
 	mProjection = glm::perspective(fovy, aspect, nnear, nfar);
 	mProjectionInverse = glm::inverse(mProjection);
+	mSnapshotDirty = true;
 }
 
 template<typename T, glm::precision P>
@@ -74,45 +75,73 @@ void FPSCamera<T, P>::Update(double dt, InputHandler &ih)
 		if ((ih.GetKeycodeState(GLFW_KEY_E) & PRESSED)) levitate += movement;
 	}
 
-	mWorld.Translate(mWorld.GetFront() * move);
-	mWorld.Translate(mWorld.GetRight() * strafe);
-	mWorld.Translate(mWorld.GetUp() * levitate);
+	// Only touch the transform when moving, to keep the snapshot cached.
+	if (move != T(0))
+		mWorld.Translate(mWorld.GetFront() * move);
+	if (strafe != T(0))
+		mWorld.Translate(mWorld.GetRight() * strafe);
+	if (levitate != T(0))
+		mWorld.Translate(mWorld.GetUp() * levitate);
+}
+
+template<typename T, glm::precision P>
+typename FPSCamera<T, P>::Snapshot const &FPSCamera<T, P>::GetSnapshot()
+{
+	if (!mSnapshotDirty && mSnapshotWorldVersion == mWorld.GetVersion())
+		return mSnapshot;
+
+	mSnapshot.mViewToWorld = mWorld.GetMatrix();
+	mSnapshot.mWorldToView = mWorld.GetMatrixInverse();
+	mSnapshot.mViewToClip = mProjection;
+	mSnapshot.mClipToView = mProjectionInverse;
+	mSnapshot.mWorldToClip = mProjection * mSnapshot.mWorldToView;
+	mSnapshot.mClipToWorld = mSnapshot.mViewToWorld * mProjectionInverse;
+	mSnapshot.mPosition = mWorld.GetTranslation();
+	mSnapshot.mFov = mFov;
+	mSnapshot.mAspect = mAspect;
+	mSnapshot.mNear = mNear;
+	mSnapshot.mFar = mFar;
+	mSnapshot.mFrustum = bonobo::Frustum(glm::mat4(mSnapshot.mWorldToClip));
+
+	mSnapshotWorldVersion = mWorld.GetVersion();
+	mSnapshotDirty = false;
+	return mSnapshot;
 }
 
 template<typename T, glm::precision P>
 glm::tmat4x4<T, P> FPSCamera<T, P>::GetViewToWorldMatrix()
 {
-	return mWorld.GetMatrix();
+	return GetSnapshot().mViewToWorld;
 }
 
 template<typename T, glm::precision P>
 glm::tmat4x4<T, P> FPSCamera<T, P>::GetWorldToViewMatrix()
 {
-	return mWorld.GetMatrixInverse();
+	return GetSnapshot().mWorldToView;
 }
 
 template<typename T, glm::precision P>
 glm::tmat4x4<T, P> FPSCamera<T, P>::GetClipToWorldMatrix()
 {
-	return GetViewToWorldMatrix() * mProjectionInverse;
+	return GetSnapshot().mClipToWorld;
 }
 
 template<typename T, glm::precision P>
 glm::tmat4x4<T, P> FPSCamera<T, P>::GetWorldToClipMatrix()
 {
-	return mProjection * GetWorldToViewMatrix();
+	return GetSnapshot().mWorldToClip;
 }
 
 template<typename T, glm::precision P>
 glm::tmat4x4<T, P> FPSCamera<T, P>::GetClipToViewMatrix()
 {
-	return mProjectionInverse;
+	return GetSnapshot().mClipToView;
 }
 
 template<typename T, glm::precision P>
 glm::tmat4x4<T, P> FPSCamera<T, P>::GetViewToClipMatrix()
 {
-	return mProjection;
+	return GetSnapshot().mViewToClip;
 }
 
 template<typename T, glm::precision P>
@@ -1,128 +1,202 @@
 #include "InputHandler.h"
 #include "Log.h"
 
+#include <cstring>
+
 /*----------------------------------------------------------------------------*/
 
 InputHandler::InputHandler()
 {
 	mMouseCapturedByUI = false;
 	mKeyboardCapturedByUI = false;
+	mTick = 0;
+	mJournal = nullptr;
 }
 
 void InputHandler::Advance()
 {
+	if (IsReplaying()) {
+		bonobo::InputJournal::event e;
+		while (mJournal->next(mTick, e))
+			ApplyEvent(e);
+	}
 	mTick++;
 }
 
-void InputHandler::DownEvent(std::unordered_map<size_t, IState> &map, size_t loc)
+void InputHandler::DownEvent(IStates &states, size_t loc)
 {
-	auto sc = map.find(loc);
-	if (sc == map.end())
-		map[static_cast<size_t>(loc)] = IState();
-	map[loc].mIsDown = true;
-	map[loc].mDownTick = mTick;
+	if (loc >= states.size())
+		return;
+	states[loc].mIsDown = true;
+	states[loc].mDownTick = mTick;
 }
 
-void InputHandler::DownModEvent(std::unordered_map<size_t, IState> &map, u32 mods)
+void InputHandler::DownModEvent(IStates &states, u32 mods)
 {
 	for (u32 i = 1u; mods != 0; i <<= 1) {
 		if ((mods & i) == 0)
 			continue;
 
-		InputHandler::DownEvent(map, static_cast<size_t>(i));
+		InputHandler::DownEvent(states, static_cast<size_t>(i));
 		mods &= ~i;
 	}
 }
 
-void InputHandler::UpEvent(std::unordered_map<size_t, IState> &map, size_t loc)
+void InputHandler::UpEvent(IStates &states, size_t loc)
 {
-	auto sc = map.find(loc);
-	if (sc == map.end())
-		map[static_cast<size_t>(loc)] = IState();
-	map[loc].mIsDown = false;
-	map[loc].mUpTick = mTick;
+	if (loc >= states.size())
+		return;
+	states[loc].mIsDown = false;
+	states[loc].mUpTick = mTick;
 }
 
-void InputHandler::UpModEvent(std::unordered_map<size_t, IState> &map, u32 mods)
+void InputHandler::UpModEvent(IStates &states, u32 mods)
 {
 	for (u32 i = 1u; mods != 0; i <<= 1) {
 		if ((mods & i) == 0)
 			continue;
 
-		InputHandler::UpEvent(map, static_cast<size_t>(i));
+		InputHandler::UpEvent(states, static_cast<size_t>(i));
 		mods &= ~i;
 	}
 }
 
 void InputHandler::FeedKeyboard(int key, int scancode, int action, int mods)
+{
+	if (IsReplaying())
+		return;
+	Record(bonobo::InputJournal::event_type::keyboard, action, mods, key, scancode);
+	ApplyKeyboard(key, scancode, action, mods);
+}
+
+void InputHandler::FeedMouseMotion(glm::vec2 const& position)
+{
+	if (IsReplaying())
+		return;
+	i32 x, y;
+	std::memcpy(&x, &position.x, sizeof(x));
+	std::memcpy(&y, &position.y, sizeof(y));
+	Record(bonobo::InputJournal::event_type::mouse_motion, 0, 0, x, y);
+	mMousePosition = position;
+}
+
+void InputHandler::FeedMouseButtons(int button, int action, int mods)
+{
+	if (IsReplaying())
+		return;
+	Record(bonobo::InputJournal::event_type::mouse_buttons, action, mods, button, 0);
+	ApplyMouseButtons(button, action, mods);
+}
+
+void InputHandler::ApplyKeyboard(int key, int scancode, int action, int mods)
 {
 	switch (action)
 	{
 		case GLFW_PRESS:
-			DownEvent(mScancodeMap, static_cast<size_t>(scancode));
-			DownModEvent(mScancodeMap, static_cast<u32>(mods));
-			DownEvent(mKeycodeMap, static_cast<size_t>(key));
-			DownModEvent(mKeycodeMap, static_cast<u32>(mods));
+			DownEvent(mScancodeStates, static_cast<size_t>(scancode));
+			DownModEvent(mScancodeStates, static_cast<u32>(mods));
+			DownEvent(mKeycodeStates, static_cast<size_t>(key));
+			DownModEvent(mKeycodeStates, static_cast<u32>(mods));
 			break;
 		case GLFW_RELEASE:
-			UpEvent(mScancodeMap, static_cast<size_t>(scancode));
-			UpModEvent(mScancodeMap, static_cast<u32>(mods));
-			UpEvent(mKeycodeMap, static_cast<size_t>(key));
-			UpModEvent(mKeycodeMap, static_cast<u32>(mods));
+			UpEvent(mScancodeStates, static_cast<size_t>(scancode));
+			UpModEvent(mScancodeStates, static_cast<u32>(mods));
+			UpEvent(mKeycodeStates, static_cast<size_t>(key));
+			UpModEvent(mKeycodeStates, static_cast<u32>(mods));
 			break;
 		default:
 			break;
 	}
 }
 
-void InputHandler::FeedMouseMotion(glm::vec2 const& position)
-{
-  mMousePosition = position;
-}
-
-void InputHandler::FeedMouseButtons(int button, int action, int mods)
+void InputHandler::ApplyMouseButtons(int button, int action, int mods)
 {
 	switch (action)
 	{
 		case GLFW_PRESS:
-			DownEvent(mMouseMap, static_cast<size_t>(button));
-			DownModEvent(mMouseMap, static_cast<u32>(mods));
-			mMousePositionSwitched[button] = mMousePosition;
+			DownEvent(mMouseStates, static_cast<size_t>(button));
+			DownModEvent(mMouseStates, static_cast<u32>(mods));
 			break;
 		case GLFW_RELEASE:
-			UpEvent(mMouseMap, static_cast<size_t>(button));
-			UpModEvent(mMouseMap, static_cast<u32>(mods));
-			mMousePositionSwitched[button] = mMousePosition;
+			UpEvent(mMouseStates, static_cast<size_t>(button));
+			UpModEvent(mMouseStates, static_cast<u32>(mods));
+			break;
+		default:
+			return;
+	}
+	if (button >= 0 && button < MAX_MOUSE_BUTTONS)
+		mMousePositionSwitched[button] = mMousePosition;
+}
+
+void InputHandler::ApplyEvent(bonobo::InputJournal::event const &e)
+{
+	switch (e.type)
+	{
+		case bonobo::InputJournal::event_type::keyboard:
+			ApplyKeyboard(e.a, e.b, e.action, e.mods);
+			break;
+		case bonobo::InputJournal::event_type::mouse_buttons:
+			ApplyMouseButtons(e.a, e.action, e.mods);
+			break;
+		case bonobo::InputJournal::event_type::mouse_motion:
+			std::memcpy(&mMousePosition.x, &e.a, sizeof(e.a));
+			std::memcpy(&mMousePosition.y, &e.b, sizeof(e.b));
+			break;
+		case bonobo::InputJournal::event_type::ui_capture:
+			mMouseCapturedByUI = (e.action & 1u) != 0u;
+			mKeyboardCapturedByUI = (e.action & 2u) != 0u;
 			break;
 		default:
 			break;
 	}
 }
 
-u32 InputHandler::GetState(std::unordered_map<size_t, IState> &map, size_t loc)
+void InputHandler::Record(bonobo::InputJournal::event_type type, int action, int mods, i32 a, i32 b)
+{
+	if (mJournal == nullptr || !mJournal->is_recording())
+		return;
+	bonobo::InputJournal::event e;
+	e.tick = static_cast<u32>(mTick);
+	e.type = type;
+	e.action = static_cast<u8>(action);
+	e.mods = static_cast<u8>(mods);
+	e.padding = 0u;
+	e.a = a;
+	e.b = b;
+	mJournal->record(e);
+}
+
+bool InputHandler::IsReplaying() const
 {
-	auto sc = map.find(loc);
-	if (sc == map.end())
+	return mJournal != nullptr && mJournal->is_replaying();
+}
+
+u32 InputHandler::GetState(IStates const &states, size_t loc) const
+{
+	if (loc >= states.size())
 		return RELEASED;
-	u32 s = map[static_cast<u32>(loc)].mIsDown ? PRESSED : RELEASED;
-	s |= mTick-1 == map[loc].mDownTick ? JUST_PRESSED : 0;
-	s |= mTick-1 == map[loc].mUpTick ? JUST_RELEASED : 0;
+	auto const &state = states[loc];
+	u32 s = state.mIsDown ? PRESSED : RELEASED;
+	if (mTick == 0)
+		return s; // ticks of untouched states are -1
+	s |= mTick-1 == state.mDownTick ? JUST_PRESSED : 0;
+	s |= mTick-1 == state.mUpTick ? JUST_RELEASED : 0;
 	return s;
 }
 
 u32 InputHandler::GetScancodeState(int scancode)
 {
-	return GetState(mScancodeMap, static_cast<size_t>(scancode));
+	return GetState(mScancodeStates, static_cast<size_t>(scancode));
 }
 
 u32 InputHandler::GetKeycodeState(int  key)
 {
-	return GetState(mKeycodeMap, static_cast<size_t>(key));
+	return GetState(mKeycodeStates, static_cast<size_t>(key));
 }
 
 u32 InputHandler::GetMouseState(u32 button)
 {
-	return GetState(mMouseMap, static_cast<size_t>(button));
+	return GetState(mMouseStates, static_cast<size_t>(button));
 }
 
 glm::vec2 InputHandler::GetMousePositionAtStateShift(u32 button)
@@ -147,6 +221,20 @@ bool InputHandler::IsKeyboardCapturedByUI() const
 
 void InputHandler::SetUICapture(bool mouseCapture, bool keyboardCapture)
 {
+	if (IsReplaying())
+		return;
+	if (mouseCapture != mMouseCapturedByUI || keyboardCapture != mKeyboardCapturedByUI)
+		Record(bonobo::InputJournal::event_type::ui_capture, (mouseCapture ? 1 : 0) | (keyboardCapture ? 2 : 0), 0, 0, 0);
 	mMouseCapturedByUI = mouseCapture;
 	mKeyboardCapturedByUI = keyboardCapture;
 }
+
+u64 InputHandler::GetTick() const
+{
+	return mTick;
+}
+
+void InputHandler::SetJournal(bonobo::InputJournal *journal)
+{
+	mJournal = journal;
+}
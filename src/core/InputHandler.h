@@ -1,8 +1,9 @@
 #pragma once
 
 #include "Types.h"
+#include "input_journal.hpp"
 
-#include <unordered_map>
+#include <array>
 
 #include <GLFW/glfw3.h>
 #include <glm/vec2.hpp>
@@ -15,6 +16,7 @@
 #define JUST_RELEASED				(1 << 3)
 
 #define MAX_MOUSE_BUTTONS			8
+#define MAX_INPUT_STATES			512		// keycodes up to GLFW_KEY_LAST, scancodes and modifier bits
 
 class InputHandler
 {
@@ -26,6 +28,8 @@ public:
 		bool	mIsDown;
 	};
 
+	typedef std::array<IState, MAX_INPUT_STATES> IStates;
+
 public:
 	InputHandler();
 
@@ -42,18 +46,30 @@ public:
 	bool IsMouseCapturedByUI() const;
 	bool IsKeyboardCapturedByUI() const;
 	void SetUICapture(bool mouseCapture, bool keyboardCapture);
+	u64 GetTick() const;
+
+	// While the journal records, every event fed is appended to it; while
+	// it replays, the events fed are ignored, and Advance() feeds back the
+	// recorded ones instead. Pass nullptr to detach it.
+	void SetJournal(bonobo::InputJournal *journal);
 
 private:
-	void DownEvent(std::unordered_map<size_t, IState> &map, size_t loc);
-	void DownModEvent(std::unordered_map<size_t, IState> &map, u32 mods);
-	void UpEvent(std::unordered_map<size_t, IState> &map, size_t loc);
-	void UpModEvent(std::unordered_map<size_t, IState> &map, u32 mods);
+	void ApplyKeyboard(int key, int scancode, int action, int mods);
+	void ApplyMouseButtons(int button, int action, int mods);
+	void ApplyEvent(bonobo::InputJournal::event const &e);
+	void Record(bonobo::InputJournal::event_type type, int action, int mods, i32 a, i32 b);
+	bool IsReplaying() const;
 
-	u32 GetState(std::unordered_map<size_t, IState> &map, size_t loc);
+	void DownEvent(IStates &states, size_t loc);
+	void DownModEvent(IStates &states, u32 mods);
+	void UpEvent(IStates &states, size_t loc);
+	void UpModEvent(IStates &states, u32 mods);
 
-	std::unordered_map<size_t, IState> mScancodeMap;
-	std::unordered_map<size_t, IState> mKeycodeMap;
-	std::unordered_map<size_t, IState> mMouseMap;
+	u32 GetState(IStates const &states, size_t loc) const;
+
+	IStates mScancodeStates;
+	IStates mKeycodeStates;
+	IStates mMouseStates;
 
 	glm::vec2 mMousePosition;
 	glm::vec2 mMousePositionSwitched[MAX_MOUSE_BUTTONS];
@@ -63,5 +79,7 @@ private:
 
 	u64 mTick;
 
+	bonobo::InputJournal *mJournal;
+
 };
 
@@ -0,0 +1,137 @@
+#include "Profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Profiler {
+
+/*----------------------------------------------------------------------------*/
+
+// 64k events of 24 bytes, i.e. 1.5 MiB per thread
+static size_t const EVENTS_PER_THREAD = 1u << 16;
+
+struct Event {
+	char const		*mName		;
+	u64				mStart		;	// in ns, since the profiler started
+	u64				mEnd		;
+};
+
+struct ThreadBuffer {
+	std::vector<Event>		mEvents		;
+	std::atomic<u64>		mWritten	;	// events ever written
+	std::string				mName		;
+	u32						mId			;
+};
+
+// Buffers are only added, under the lock, and never freed, so that the
+// events of threads which exited can still be exported.
+static std::mutex registryMutex;
+static std::vector<std::unique_ptr<ThreadBuffer>> registry;
+static std::chrono::steady_clock::time_point const origin = std::chrono::steady_clock::now();
+
+static thread_local ThreadBuffer *threadBuffer = nullptr;
+
+static ThreadBuffer *GetThreadBuffer()
+{
+	if (threadBuffer != nullptr)
+		return threadBuffer;
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+	buffer->mEvents.resize(EVENTS_PER_THREAD);
+	buffer->mWritten.store(0u, std::memory_order_relaxed);
+	buffer->mId = static_cast<u32>(registry.size());
+	buffer->mName = "Thread " + std::to_string(buffer->mId);
+	threadBuffer = buffer.get();
+	registry.push_back(std::move(buffer));
+	return threadBuffer;
+}
+
+static u64 Now()
+{
+	return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count());
+}
+
+static void WriteEscaped(std::ostream &os, char const *text)
+{
+	for (; *text != '\0'; ++text) {
+		if (*text == '"' || *text == '\\')
+			os << '\\';
+		os << *text;
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+
+Scope::Scope(char const *name) : mName(name), mStart(Now())
+{
+}
+
+Scope::~Scope()
+{
+	auto const end = Now();
+	auto *buffer = GetThreadBuffer();
+	auto const written = buffer->mWritten.load(std::memory_order_relaxed);
+	buffer->mEvents[written % EVENTS_PER_THREAD] = { mName, mStart, end };
+	buffer->mWritten.store(written + 1u, std::memory_order_release);
+}
+
+void SetThreadName(std::string const &name)
+{
+	auto *buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(registryMutex);
+	buffer->mName = name;
+}
+
+bool ExportChromeTrace(std::string const &path)
+{
+	std::ofstream os(path, std::ios::trunc);
+	if (!os.is_open())
+		return false;
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	os << std::fixed;
+	os.precision(3);
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	auto first = true;
+	std::vector<Event> events;
+	for (auto const &buffer : registry) {
+		os << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->mId << ",\"args\":{\"name\":\"";
+		WriteEscaped(os, buffer->mName.c_str());
+		os << "\"}}";
+		first = false;
+
+		// Copy the events, then drop those the owning thread may have
+		// overwritten meanwhile, including the slot of the event it may
+		// be writing right now.
+		auto const before = buffer->mWritten.load(std::memory_order_acquire);
+		auto const begin = before > EVENTS_PER_THREAD ? before - EVENTS_PER_THREAD : 0u;
+		events.clear();
+		for (auto i = begin; i < before; ++i)
+			events.push_back(buffer->mEvents[i % EVENTS_PER_THREAD]);
+		// Keep the copy above from being reordered after this load.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		auto const after = buffer->mWritten.load(std::memory_order_relaxed);
+		auto const valid = after + 1u > EVENTS_PER_THREAD ? after + 1u - EVENTS_PER_THREAD : 0u;
+
+		for (auto i = begin; i < before; ++i) {
+			if (i < valid)
+				continue;
+			auto const &event = events[i - begin];
+			os << ",\n{\"name\":\"";
+			WriteEscaped(os, event.mName);
+			os << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->mId
+			   << ",\"ts\":" << static_cast<double>(event.mStart) / 1000.0
+			   << ",\"dur\":" << static_cast<double>(event.mEnd - event.mStart) / 1000.0 << "}";
+		}
+	}
+	os << "\n]}\n";
+
+	return os.good();
+}
+
+};
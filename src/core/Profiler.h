@@ -0,0 +1,50 @@
+/*
+ * CPU profiler
+ */
+
+#pragma once
+#include <string>
+#include "BuildSettings.h"
+#include "Types.h"
+
+namespace Profiler {
+
+// Records the time spent between its construction and its destruction
+// into the ring buffer of the calling thread. Each thread only ever
+// writes to its own buffer, without any lock; the oldest events are
+// overwritten once the buffer is full.
+class Scope {
+public:
+	// `name` is stored as is, so it has to outlive the profiler, e.g. a
+	// string literal.
+	explicit Scope(char const *name);
+	~Scope();
+
+	Scope(Scope const &) = delete;
+	Scope &operator=(Scope const &) = delete;
+
+private:
+	char const *mName;
+	u64 mStart;
+};
+
+// Name the calling thread in exported traces; unnamed threads show up as
+// "Thread <n>", numbered in the order they first recorded an event.
+// `Bonobo::Init()` names the thread calling it "Main".
+void SetThreadName(std::string const &name);
+
+// Write the events of all threads as Chrome trace_event JSON, which can
+// be opened in chrome://tracing or Perfetto.
+bool ExportChromeTrace(std::string const &path);
+
+};
+
+#if defined ENABLE_PROFILING && ENABLE_PROFILING != 0
+	#define PROFILE_CONCATENATE_(a, b)	a##b
+	#define PROFILE_CONCATENATE(a, b)	PROFILE_CONCATENATE_(a, b)
+	#define PROFILE_SCOPE(a)			Profiler::Scope PROFILE_CONCATENATE(profileScope, __LINE__)(a)
+	#define PROFILE_THREAD(a)			Profiler::SetThreadName(a)
+#else
+	#define PROFILE_SCOPE(a)
+	#define PROFILE_THREAD(a)
+#endif
@@ -2,8 +2,46 @@
 
 #include <glm/glm.hpp>
 
+#include <cstddef>
 #include <iostream>
 
+/* Text form of the glm types serialised by TRSTransform and FPSCamera:
+ * components separated by spaces, matrices column by column. They live in
+ * namespace glm so that argument-dependent lookup finds them. */
+namespace glm
+{
+	template<typename T, precision P>
+	std::ostream &operator<<(std::ostream &os, tvec2<T, P> const &v)
+	{
+		return os << v.x << " " << v.y;
+	}
+	template<typename T, precision P>
+	std::ostream &operator<<(std::ostream &os, tvec3<T, P> const &v)
+	{
+		return os << v.x << " " << v.y << " " << v.z;
+	}
+	template<typename T, precision P>
+	std::ostream &operator<<(std::ostream &os, tmat3x3<T, P> const &m)
+	{
+		return os << m[0] << " " << m[1] << " " << m[2];
+	}
+	template<typename T, precision P>
+	std::istream &operator>>(std::istream &is, tvec2<T, P> &v)
+	{
+		return is >> v.x >> v.y;
+	}
+	template<typename T, precision P>
+	std::istream &operator>>(std::istream &is, tvec3<T, P> &v)
+	{
+		return is >> v.x >> v.y >> v.z;
+	}
+	template<typename T, precision P>
+	std::istream &operator>>(std::istream &is, tmat3x3<T, P> &m)
+	{
+		return is >> m[0] >> m[1] >> m[2];
+	}
+}
+
 /**
  * A TRS-transform M is composed of rotation, translation and scale. We define
  * M as:
@@ -27,6 +65,10 @@
  * of node B to construct new model->world matrices, in the same manner as in
  * the example above.
  *
+ * The matrix and its inverse are cached, and only recomputed after the
+ * transform was modified; GetVersion() changes with every modification, so
+ * that users can cache values derived from the transform as well.
+ *
  */
 template<typename T, glm::precision P>
 class TRSTransform {
@@ -75,8 +117,11 @@ public:
 
 		/* Useful getters */
 
-	glm::tmat4x4<T, P> GetMatrix() const;
-	glm::tmat4x4<T, P> GetMatrixInverse() const;
+	glm::tmat4x4<T, P> const &GetMatrix() const;
+	glm::tmat4x4<T, P> const &GetMatrixInverse() const;
+
+	/* Number of modifications since construction */
+	size_t GetVersion() const;
 
 	glm::tmat3x3<T, P> GetRotation() const;
 	glm::tvec3<T, P> GetTranslation() const;
@@ -99,11 +144,21 @@ public:
 	glm::tvec3<T, P> GetFront() const;
 	glm::tvec3<T, P> GetBack() const;
 
+protected:
+	/* Mark the cached matrices as outdated */
+	void Invalidate();
+
 protected:
 	glm::tmat3x3<T, P>	mR;
 	glm::tvec3<T, P>	mT;
 	glm::tvec3<T, P>	mS;
 
+	size_t				mVersion;
+	mutable glm::tmat4x4<T, P>	mMatrix;
+	mutable glm::tmat4x4<T, P>	mMatrixInverse;
+	mutable bool		mMatrixDirty;
+	mutable bool		mMatrixInverseDirty;
+
 public:
 	friend std::ostream &operator<<(std::ostream &os, TRSTransform<T, P> &v)
 	{
@@ -117,6 +172,7 @@ public:
 		is >> v.mT;
 		is >> v.mR;
 		is >> v.mS;
+		v.Invalidate();
 		return is;
 	}
 };
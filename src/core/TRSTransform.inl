@@ -6,7 +6,7 @@
 /*----------------------------------------------------------------------------*/
 
 template<typename T, glm::precision P>
-TRSTransform<T, P>::TRSTransform()
+TRSTransform<T, P>::TRSTransform() : mVersion(0), mMatrixDirty(true), mMatrixInverseDirty(true)
 {
 	ResetTransform();
 }
@@ -26,6 +26,7 @@ void TRSTransform<T, P>::ResetTransform()
 	mT = glm::tvec3<T, P>(static_cast<T>(0));
 	mS = glm::tvec3<T, P>(static_cast<T>(1));
 	mR = glm::tmat3x3<T, P>(static_cast<T>(1));
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -34,6 +35,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::Translate(glm::tvec3<T, P> v)
 {
 	mT += v;
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -42,6 +44,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::Scale(glm::tvec3<T, P> v)
 {
 	mS *= v;
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -50,6 +53,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::Scale(T uniform)
 {
 	mS *= uniform;
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -58,6 +62,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::Rotate(T angle, glm::tvec3<T, P> v)
 {
 	mR = glm::tmat3x3<T, P>(glm::rotate(glm::tmat4x4<T, P>(mR), angle, v));
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -71,6 +76,7 @@ void TRSTransform<T, P>::RotateX(T angle)
 		mR[0][0], C * mR[0][1] - mR[0][2] * S, C * mR[0][2] + mR[0][1] * S,
 		mR[1][0], C * mR[1][1] - mR[1][2] * S, C * mR[1][2] + mR[1][1] * S,
 		mR[2][0], C * mR[2][1] - mR[2][2] * S, C * mR[2][2] + mR[2][1] * S);
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -84,6 +90,7 @@ void TRSTransform<T, P>::RotateY(T angle)
 		C * mR[0][0] + mR[0][2] * S, mR[0][1], C * mR[0][2] - mR[0][0] * S,
 		C * mR[1][0] + mR[1][2] * S, mR[1][1], C * mR[1][2] - mR[1][0] * S,
 		C * mR[2][0] + mR[2][2] * S, mR[2][1], C * mR[2][2] - mR[2][0] * S);
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -97,6 +104,7 @@ void TRSTransform<T, P>::RotateZ(T angle)
 		C * mR[0][0] - mR[0][1] * S, C * mR[0][1] + mR[0][0] * S, mR[0][2],
 		C * mR[1][0] - mR[1][1] * S, C * mR[1][1] + mR[1][0] * S, mR[1][2],
 		C * mR[2][0] - mR[2][1] * S, C * mR[2][1] + mR[2][0] * S, mR[2][2]);
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -105,6 +113,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::PreRotate(T angle, glm::tvec3<T, P> v)
 {
 	mR = glm::tmat3x3<T, P>::RotationMatrix(angle, v) * mR;
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -118,6 +127,7 @@ void TRSTransform<T, P>::PreRotateX(T angle)
 		mR[0][0], mR[0][1], mR[0][2],
 		C * mR[1][0] + mR[2][0] * S, C * mR[1][1] + mR[2][1] * S, C * mR[1][2] + mR[2][2] * S,
 		C * mR[2][0] - mR[1][0] * S, C * mR[2][1] - mR[1][1] * S, C * mR[2][2] - mR[1][2] * S);
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -131,6 +141,7 @@ void TRSTransform<T, P>::PreRotateY(T angle)
 		C * mR[0][0] - mR[2][0] * S, C * mR[0][1] - mR[2][1] * S, C * mR[0][2] - mR[2][2] * S,
 		mR[1][0], mR[1][1], mR[1][2],
 		C * mR[2][0] + mR[0][0] * S, C * mR[2][1] + mR[0][1] * S, C * mR[2][2] + mR[0][2] * S);
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -144,6 +155,7 @@ void TRSTransform<T, P>::PreRotateZ(T angle)
 		C * mR[0][0] + mR[1][0] * S, C * mR[0][1] + mR[1][1] * S, C * mR[0][2] + mR[1][2] * S,
 		C * mR[1][0] - mR[0][0] * S, C * mR[1][1] - mR[0][1] * S, C * mR[1][2] - mR[0][2] * S,
 		mR[2][0], mR[2][1], mR[2][2]);
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -152,6 +164,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::SetTranslate(glm::tvec3<T, P> v)
 {
 	mT = v;
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -160,6 +173,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::SetScale(glm::tvec3<T, P> v)
 {
 	mS = v;
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -168,6 +182,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::SetScale(T uniform)
 {
 	mS = glm::tvec3<T, P>(uniform);
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -176,6 +191,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::SetRotate(T angle, glm::tvec3<T, P> v)
 {
 	mR = glm::tmat3x3<T, P>(glm::rotate(glm::tmat4x4<T, P>(), angle, v));
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -184,6 +200,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::SetRotateX(T angle)
 {
 	mR = glm::tmat3x3<T, P>(glm::rotate(glm::tmat4x4<T, P>(), angle, glm::tvec3<T, P>(1, 0, 0)));
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -192,6 +209,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::SetRotateY(T angle)
 {
 	mR = glm::tmat3x3<T, P>(glm::rotate(glm::tmat4x4<T, P>(), angle, glm::tvec3<T, P>(0, 1, 0)));
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -200,6 +218,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::SetRotateZ(T angle)
 {
 	mR = glm::tmat3x3<T, P>(glm::rotate(glm::tmat4x4<T, P>(), angle, glm::tvec3<T, P>(0, 0, 1)));
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -224,6 +243,7 @@ void TRSTransform<T, P>::LookTowards(glm::tvec3<T, P> front_vec, glm::tvec3<T, P
 	mR[0] = right;
 	mR[1] = up;
 	mR[2] = -front_vec;
+	Invalidate();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -337,9 +357,13 @@ glm::tmat4x4<T, P> TRSTransform<T, P>::GetTranslationRotationMatrix() const
 /*----------------------------------------------------------------------------*/
 
 template<typename T, glm::precision P>
-glm::tmat4x4<T, P> TRSTransform<T, P>::GetMatrix() const
+glm::tmat4x4<T, P> const &TRSTransform<T, P>::GetMatrix() const
 {
-	return glm::tmat4x4<T, P>(
+	if (!mMatrixDirty)
+		return mMatrix;
+
+	mMatrixDirty = false;
+	return mMatrix = glm::tmat4x4<T, P>(
 			mR[0][0]*mS.x, mR[0][1]*mS.x, mR[0][2]*mS.x, 0,
 			mR[1][0]*mS.y, mR[1][1]*mS.y, mR[1][2]*mS.y, 0,
 			mR[2][0]*mS.z, mR[2][1]*mS.z, mR[2][2]*mS.z, 0,
@@ -349,8 +373,11 @@ glm::tmat4x4<T, P> TRSTransform<T, P>::GetMatrix() const
 /*----------------------------------------------------------------------------*/
 
 template<typename T, glm::precision P>
-glm::tmat4x4<T, P> TRSTransform<T, P>::GetMatrixInverse() const
+glm::tmat4x4<T, P> const &TRSTransform<T, P>::GetMatrixInverse() const
 {
+	if (!mMatrixInverseDirty)
+		return mMatrixInverse;
+
 	glm::tvec3<T, P> X = glm::tvec3<T, P>(T(1) / mS.x, T(1) / mS.y, T(1) / mS.z);
 
 	T a = mR[0][0] * X.x;
@@ -363,7 +390,8 @@ glm::tmat4x4<T, P> TRSTransform<T, P>::GetMatrixInverse() const
 	T h = mR[1][2] * X.y;
 	T i = mR[2][2] * X.z;
 
-	return glm::tmat4x4<T, P>(
+	mMatrixInverseDirty = false;
+	return mMatrixInverse = glm::tmat4x4<T, P>(
 			a, b, c, 0,
 			d, e, f, 0,
 			g, h, i, 0,
@@ -372,6 +400,24 @@ glm::tmat4x4<T, P> TRSTransform<T, P>::GetMatrixInverse() const
 
 /*----------------------------------------------------------------------------*/
 
+template<typename T, glm::precision P>
+size_t TRSTransform<T, P>::GetVersion() const
+{
+	return mVersion;
+}
+
+/*----------------------------------------------------------------------------*/
+
+template<typename T, glm::precision P>
+void TRSTransform<T, P>::Invalidate()
+{
+	++mVersion;
+	mMatrixDirty = true;
+	mMatrixInverseDirty = true;
+}
+
+/*----------------------------------------------------------------------------*/
+
 template<typename T, glm::precision P>
 glm::tmat3x3<T, P> TRSTransform<T, P>::GetRotation() const
 {
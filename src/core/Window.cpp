@@ -7,6 +7,8 @@
 #include "InputHandler.h"
 #include "Log.h"
 #include "opengl.hpp"
+#include "Profiler.h"
+#include "stream_buffer.hpp"
 #include "Window.h"
 
 #include "external/imgui_impl_glfw_gl3.h"
@@ -14,6 +16,16 @@
 static std::unordered_map<std::string, Window *> *windowMap = nullptr;
 static int default_opengl_major_version = 4;
 static int default_opengl_minor_version = 1;
+static size_t default_stream_capacity = 1u << 20;
+static unsigned int headless_frames_nb = 0u;
+static unsigned int headless_warmup_frames_nb = 10u; // not timed: shader compilation, texture uploads, etc.
+
+static unsigned int StreamImGuiGeometry(void* user_data, void const* data, size_t size, size_t* offset)
+{
+	auto const allocation = static_cast<bonobo::StreamBuffer*>(user_data)->write(data, size, 16u);
+	*offset = static_cast<size_t>(allocation.offset);
+	return allocation.bo;
+}
 
 void Window::ErrorCallback(int error, char const* description)
 {
@@ -109,13 +121,18 @@ std::string Window::GetTitle() const
 }
 
 Window::Window(std::string mTitle_, unsigned w_, unsigned h_, unsigned int msaa_, bool fullscreen_, bool resizable_, SwapStrategy swap_) :
-	mTitle(mTitle_), mWidth(w_), mHeight(h_), mMSAA(msaa_), mFullscreen(fullscreen_), mResizable(resizable_), mSwap(swap_), mWindowGLFW(nullptr), mInputHandler(nullptr), mCamera(nullptr)
+	mTitle(mTitle_), mWidth(w_), mHeight(h_), mMSAA(msaa_), mFullscreen(fullscreen_), mResizable(resizable_), mSwap(swap_), mWindowGLFW(nullptr), mInputHandler(nullptr), mCamera(nullptr), mStreamBuffer(nullptr),
+	mOffscreenFBO(0u), mOffscreenColour(0u), mOffscreenDepth(0u), mSwappedFrames(0u), mLastSwap(std::chrono::steady_clock::now()), mFrameTimings()
 {
 	Show();
 }
 
 Window::~Window()
 {
+	DestroyOffscreenFramebuffer();
+	ImGui_ImplGlfwGL3_SetStreamWriter(nullptr, nullptr);
+	delete mStreamBuffer;
+	mStreamBuffer = nullptr;
 }
 
 bool Window::Show()
@@ -130,9 +147,12 @@ bool Window::Show()
 
 		glfwWindowHint(GLFW_RESIZABLE, mResizable ? GLFW_TRUE : GLFW_FALSE);
 		glfwWindowHint(GLFW_SAMPLES, static_cast<int>(mMSAA));
+		// The window only provides the context; its own framebuffer is
+		// never drawn to.
+		glfwWindowHint(GLFW_VISIBLE, IsHeadless() ? GLFW_FALSE : GLFW_TRUE);
 
-		GLFWmonitor* const monitor = mFullscreen ? glfwGetPrimaryMonitor()
-                                                 : nullptr;
+		GLFWmonitor* const monitor = mFullscreen && !IsHeadless() ? glfwGetPrimaryMonitor()
+                                                                  : nullptr;
 		mWindowGLFW = glfwCreateWindow(static_cast<int>(mWidth), static_cast<int>(mHeight)
                                 ,mTitle.c_str() ,monitor, nullptr);
 
@@ -140,10 +160,12 @@ bool Window::Show()
 			return false;
 	}
 
-	int width, height;
-	glfwGetFramebufferSize(mWindowGLFW, &width, &height);
-	mWidth = static_cast<unsigned int>(width);
-	mHeight = static_cast<unsigned int>(height);
+	if (!IsHeadless()) {
+		int width, height;
+		glfwGetFramebufferSize(mWindowGLFW, &width, &height);
+		mWidth = static_cast<unsigned int>(width);
+		mHeight = static_cast<unsigned int>(height);
+	}
 
 	glfwMakeContextCurrent(mWindowGLFW);
 
@@ -156,6 +178,11 @@ bool Window::Show()
 
 	ImGui_ImplGlfwGL3_Init(mWindowGLFW, false);
 
+	if (mStreamBuffer == nullptr)
+		mStreamBuffer = new bonobo::StreamBuffer(default_stream_capacity);
+	bonobo::StreamBuffer::set_default(mStreamBuffer);
+	ImGui_ImplGlfwGL3_SetStreamWriter(StreamImGuiGeometry, mStreamBuffer);
+
 	glfwSetKeyCallback(mWindowGLFW, Window::KeyCallback);
 	glfwSetInputMode(mWindowGLFW, GLFW_STICKY_KEYS, 1);
 	glfwSetMouseButtonCallback(mWindowGLFW, Window::MouseCallback);
@@ -196,15 +223,28 @@ bool Window::Show()
 		LogInfo("DebugCallback is not core in OpenGL %d.%d, and sadly the GL_KHR_DEBUG extension is not available either.", major_version, minor_version);
 	}
 
-	glfwSwapInterval(mSwap);
+	if (IsHeadless()) {
+		if (!CreateOffscreenFramebuffer()) {
+			glfwDestroyWindow(mWindowGLFW);
+			mWindowGLFW = nullptr;
+			return false;
+		}
+		LogInfo("Headless: rendering %u frames, after %u warm-up ones, into a %ux%u offscreen framebuffer.", headless_frames_nb, headless_warmup_frames_nb, mWidth, mHeight);
+	}
+
+	glfwSwapInterval(IsHeadless() ? DISABLE_VSYNC : mSwap);
 	// TODO: Reinitiate renderer
 	return true;
 }
 
 void Window::SetFullscreen(bool state)
 {
-	if (mFullscreen == state)
+	if (mFullscreen == state || IsHeadless())
 		return;
+	// The stream buffer belongs to the context about to be destroyed.
+	ImGui_ImplGlfwGL3_SetStreamWriter(nullptr, nullptr);
+	delete mStreamBuffer;
+	mStreamBuffer = nullptr;
 	if (mWindowGLFW)
 		glfwDestroyWindow(mWindowGLFW);
 	mFullscreen = state;
@@ -225,6 +265,16 @@ void Window::Init()
 	windowMap = new std::unordered_map<std::string, Window *>();
 }
 
+void Window::SetHeadless(unsigned int frames_nb)
+{
+	headless_frames_nb = frames_nb;
+}
+
+bool Window::IsHeadless()
+{
+	return headless_frames_nb != 0u;
+}
+
 void Window::Destroy()
 {
 	if (windowMap == nullptr)
@@ -237,9 +287,15 @@ void Window::Destroy()
 	glfwTerminate();
 }
 
-void Window::Swap() const
+void Window::Swap()
 {
-	glfwSwapBuffers(mWindowGLFW);
+	PROFILE_SCOPE("Window::Swap");
+	if (mOffscreenFBO != 0u)
+		EndHeadlessFrame();
+	else
+		glfwSwapBuffers(mWindowGLFW);
+	if (mStreamBuffer != nullptr)
+		mStreamBuffer->end_frame();
 }
 
 glm::ivec2 Window::GetDimensions() const
@@ -257,6 +313,75 @@ void Window::SetInputHandler(InputHandler *inputHandler)
 	mInputHandler = inputHandler;
 }
 
+bonobo::StreamBuffer *Window::GetStreamBuffer() const
+{
+	return mStreamBuffer;
+}
+
+unsigned int Window::GetFramebuffer() const
+{
+	return mOffscreenFBO;
+}
+
+bool Window::CreateOffscreenFramebuffer()
+{
+	auto const samples = static_cast<GLsizei>(mMSAA);
+	auto const width = static_cast<GLsizei>(mWidth);
+	auto const height = static_cast<GLsizei>(mHeight);
+
+	glGenRenderbuffers(1, &mOffscreenColour);
+	glBindRenderbuffer(GL_RENDERBUFFER, mOffscreenColour);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &mOffscreenDepth);
+	glBindRenderbuffer(GL_RENDERBUFFER, mOffscreenDepth);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0u);
+
+	glGenFramebuffers(1, &mOffscreenFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, mOffscreenFBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, mOffscreenColour);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, mOffscreenDepth);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		LogError("Failed to create a %ux%u offscreen framebuffer.", mWidth, mHeight);
+		DestroyOffscreenFramebuffer();
+		return false;
+	}
+
+	// Left bound: whatever gets drawn to the "default" framebuffer lands
+	// in it, unless it is explicitly rebound.
+	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	return true;
+}
+
+void Window::DestroyOffscreenFramebuffer()
+{
+	if (mOffscreenFBO == 0u)
+		return;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0u);
+	glDeleteFramebuffers(1, &mOffscreenFBO);
+	glDeleteRenderbuffers(1, &mOffscreenDepth);
+	glDeleteRenderbuffers(1, &mOffscreenColour);
+	mOffscreenFBO = mOffscreenColour = mOffscreenDepth = 0u;
+}
+
+// Nothing is presented, so waiting for the GPU marks the end of the frame;
+// this also keeps the CPU from queuing frames ahead.
+void Window::EndHeadlessFrame()
+{
+	glFinish();
+	auto const now = std::chrono::steady_clock::now();
+	if (mSwappedFrames >= headless_warmup_frames_nb)
+		mFrameTimings.add(std::chrono::duration<double, std::milli>(now - mLastSwap).count());
+	mLastSwap = now;
+	++mSwappedFrames;
+
+	if (mFrameTimings.get_frames_nb() == headless_frames_nb) {
+		mFrameTimings.log(mTitle + " (headless, " + std::to_string(mWidth) + "x" + std::to_string(mHeight) + ")");
+		glfwSetWindowShouldClose(mWindowGLFW, GLFW_TRUE);
+	}
+}
+
 void Window::SetCamera(FPSCameraf *camera)
 {
 	mCamera = camera;
@@ -1,15 +1,22 @@
 #pragma once
 
 #include "FPSCamera.h"
+#include "frame_timings.hpp"
 
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include <chrono>
 #include <string>
 
 
 class InputHandler;
 
+namespace bonobo
+{
+	class StreamBuffer;
+}
+
 
 class Window
 {
@@ -21,6 +28,13 @@ public:
 	};
 public:
 	static void Init();
+	// Windows created afterwards are hidden and render into an offscreen
+	// framebuffer, with vsync off; once `frames_nb` frames were swapped
+	// after a short warm-up, their timings are logged and the window is
+	// asked to close. 0 disables the headless mode. Calling it again once
+	// a headless window exists only changes its number of frames.
+	static void SetHeadless(unsigned int frames_nb);
+	static bool IsHeadless();
 	static Window *Create(std::string title, unsigned int w, unsigned int h, unsigned int msaa = 4, bool fullscreen = false, bool resizable_ = true, SwapStrategy swap = ENABLE_VSYNC);
 	static bool Destroy(Window *window);
 	static void Destroy();
@@ -31,13 +45,20 @@ protected:
 public:
 	void SetFullscreen(bool state);
 	std::string GetTitle() const;
-	void Swap() const;
+	void Swap();
 	glm::ivec2 GetDimensions() const;
 	GLFWwindow *GetGLFW_Window() const;
 	void SetInputHandler(InputHandler *inputHandler);
 	void SetCamera(FPSCameraf *camera);
+	bonobo::StreamBuffer *GetStreamBuffer() const;
+	// The framebuffer standing for the default one: 0, or the offscreen
+	// one in headless mode.
+	unsigned int GetFramebuffer() const;
 private:
 	bool Show();
+	bool CreateOffscreenFramebuffer();
+	void DestroyOffscreenFramebuffer();
+	void EndHeadlessFrame();
 	static void ErrorCallback(int error, char const* description);
 	static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 	static void MouseCallback(GLFWwindow* window, int button, int action, int mods);
@@ -53,5 +74,10 @@ private:
 	GLFWwindow *mWindowGLFW;
 	InputHandler *mInputHandler;
 	FPSCameraf *mCamera;
+	bonobo::StreamBuffer *mStreamBuffer; // Per-frame data of the window's context, see Swap()
+	unsigned int mOffscreenFBO, mOffscreenColour, mOffscreenDepth; // Headless mode only
+	unsigned int mSwappedFrames;
+	std::chrono::steady_clock::time_point mLastSwap;
+	bonobo::FrameTimings mFrameTimings;
 };
 
@@ -0,0 +1,124 @@
+#include "camera_path.hpp"
+
+#include "Log.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+	char const* const frames_header = "frames";
+	char const* const keyframes_header = "keyframes";
+}
+
+bonobo::CameraPath::CameraPath() : _recording(), _placements()
+{
+}
+
+bool
+bonobo::CameraPath::start_recording(std::string const& path)
+{
+	stop_recording();
+	_recording.open(path, std::ios::trunc);
+	if (!_recording.is_open())
+		return false;
+	// Enough digits for the values read back to be the ones written
+	_recording.precision(std::numeric_limits<float>::max_digits10);
+	_recording << frames_header << std::endl;
+	return true;
+}
+
+void
+bonobo::CameraPath::record(FPSCameraf& camera)
+{
+	if (_recording.is_open())
+		_recording << camera;
+}
+
+void
+bonobo::CameraPath::stop_recording()
+{
+	if (_recording.is_open())
+		_recording.close();
+}
+
+bool
+bonobo::CameraPath::is_recording() const
+{
+	return _recording.is_open();
+}
+
+bool
+bonobo::CameraPath::load(std::string const& path, size_t frames_per_keyframe, interpolator const& interpolate)
+{
+	_placements.clear();
+
+	std::ifstream stream(path);
+	std::string header;
+	if (!(stream >> header) || (header != frames_header && header != keyframes_header)) {
+		LogError("\"%s\" is not a camera path", path.c_str());
+		return false;
+	}
+
+	std::vector<placement> states;
+	FPSCameraf camera(bonobo::pi / 4.0f, 1.0f, 1.0f, 1000.0f);
+	while (stream >> camera) {
+		placement p;
+		p.position = camera.mWorld.GetTranslation();
+		p.front = camera.mWorld.GetFront();
+		p.up = camera.mWorld.GetUp();
+		p.fov = camera.GetFov();
+		states.push_back(p);
+	}
+	if (states.empty()) {
+		LogError("No camera state found in \"%s\"", path.c_str());
+		return false;
+	}
+
+	if (header == frames_header || states.size() == 1u || frames_per_keyframe == 0u) {
+		_placements = std::move(states);
+		LogInfo("Camera path \"%s\": %zu frames", path.c_str(), _placements.size());
+		return true;
+	}
+
+	// Each segment between two keyframes uses its neighbours as control
+	// points, the first and last keyframes standing in at the ends.
+	auto const last = states.size() - 1u;
+	for (size_t i = 0u; i < last; ++i) {
+		auto const& k0 = states[i > 0u ? i - 1u : 0u];
+		auto const& k1 = states[i];
+		auto const& k2 = states[i + 1u];
+		auto const& k3 = states[std::min(i + 2u, last)];
+		for (size_t j = 0u; j < frames_per_keyframe; ++j) {
+			auto const x = static_cast<float>(j) / static_cast<float>(frames_per_keyframe);
+			placement p;
+			p.position = interpolate(k0.position, k1.position, k2.position, k3.position, x);
+			p.front = glm::normalize(interpolate(k0.front, k1.front, k2.front, k3.front, x));
+			p.up = glm::normalize(interpolate(k0.up, k1.up, k2.up, k3.up, x));
+			p.fov = k1.fov + (k2.fov - k1.fov) * x;
+			_placements.push_back(p);
+		}
+	}
+	_placements.push_back(states.back());
+	LogInfo("Camera path \"%s\": %zu keyframes, %zu frames", path.c_str(), states.size(), _placements.size());
+	return true;
+}
+
+size_t
+bonobo::CameraPath::get_frames_nb() const
+{
+	return _placements.size();
+}
+
+void
+bonobo::CameraPath::apply(size_t frame, FPSCameraf& camera) const
+{
+	if (_placements.empty())
+		return;
+	auto const& p = _placements[std::min(frame, _placements.size() - 1u)];
+	camera.mWorld.SetTranslate(p.position);
+	camera.mWorld.LookTowards(p.front, p.up);
+	if (p.fov != camera.GetFov())
+		camera.SetFov(p.fov);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "FPSCamera.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Camera placements, one per frame, to fly through a scene the
+	//!        same way in every run.
+	//!
+	//! Paths are text files made of a header line, either "frames" or
+	//! "keyframes", followed by camera states as written by FPSCamera's
+	//! `operator<<`. Recorded paths hold the state of every frame, while
+	//! keyframed ones, usually written by hand, are interpolated.
+	class CameraPath
+	{
+	public:
+		//! \brief Interpolate between p1 and p2, at ratio x ∈ [0,1].
+		using interpolator = std::function<glm::vec3 (glm::vec3 const& p0, glm::vec3 const& p1,
+		                                              glm::vec3 const& p2, glm::vec3 const& p3, float x)>;
+
+		CameraPath();
+
+		//! \brief Start writing the camera of every `record()` call to a
+		//!        file, replacing it.
+		//!
+		//! @return whether the file could be opened
+		bool start_recording(std::string const& path);
+
+		//! \brief Append the current state of the camera, if recording.
+		void record(FPSCameraf& camera);
+
+		//! \brief Close the file being recorded, if any.
+		void stop_recording();
+
+		bool is_recording() const;
+
+		//! \brief Load a recorded or keyframed path.
+		//!
+		//! @param [in] path file to read
+		//! @param [in] frames_per_keyframe number of frames between two
+		//!             keyframes; only used by keyframed paths
+		//! @param [in] interpolate used on the positions and orientations
+		//!             of the keyframes; only used by keyframed paths
+		//! @return whether at least one placement could be read
+		bool load(std::string const& path, size_t frames_per_keyframe, interpolator const& interpolate);
+
+		//! \brief Get the number of frames of the loaded path.
+		size_t get_frames_nb() const;
+
+		//! \brief Place the camera as in a frame of the loaded path.
+		void apply(size_t frame, FPSCameraf& camera) const;
+
+	private:
+		struct placement {
+			glm::vec3 position;
+			glm::vec3 front;
+			glm::vec3 up;
+			float fov;
+		};
+
+		std::ofstream _recording;
+		std::vector<placement> _placements;
+	};
+}
@@ -0,0 +1,109 @@
+#include "culling.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr size_t bonobo::Frustum::planes_nb;
+
+bonobo::bounding_volume
+bonobo::compute_bounding_volume(glm::vec3 const* positions, size_t positions_nb)
+{
+	bounding_volume volume;
+	if (positions == nullptr || positions_nb == 0u)
+		return volume;
+
+	volume.min = positions[0];
+	volume.max = positions[0];
+	for (size_t i = 1u; i < positions_nb; ++i) {
+		volume.min = glm::min(volume.min, positions[i]);
+		volume.max = glm::max(volume.max, positions[i]);
+	}
+
+	// Centering the sphere on the box is not optimal, but it is cheap and
+	// tight enough for culling.
+	volume.center = (volume.min + volume.max) * 0.5f;
+	auto max_distance2 = 0.0f;
+	for (size_t i = 0u; i < positions_nb; ++i) {
+		auto const offset = positions[i] - volume.center;
+		max_distance2 = std::max(max_distance2, glm::dot(offset, offset));
+	}
+	volume.radius = std::sqrt(max_distance2);
+	volume.is_valid = true;
+
+	return volume;
+}
+
+bonobo::Frustum::Frustum(glm::mat4 const& world_to_clip)
+{
+	// Gribb & Hartmann: each plane is the sum or difference of the fourth
+	// row with one of the other rows.
+	auto const row = [&world_to_clip](int i){
+		return glm::vec4(world_to_clip[0][i], world_to_clip[1][i], world_to_clip[2][i], world_to_clip[3][i]);
+	};
+	glm::vec4 const planes[6] = {
+		row(3) + row(0), // left
+		row(3) - row(0), // right
+		row(3) + row(1), // bottom
+		row(3) - row(1), // top
+		row(3) + row(2), // near
+		row(3) - row(2)  // far
+	};
+
+	for (size_t i = 0u; i < planes_nb; ++i) {
+		auto plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		if (i < 6u) {
+			auto const length = glm::length(glm::vec3(planes[i]));
+			plane = length > 0.0f ? planes[i] / length : planes[i];
+		}
+		_x[i] = plane.x;
+		_y[i] = plane.y;
+		_z[i] = plane.z;
+		_w[i] = plane.w;
+	}
+}
+
+bool
+bonobo::Frustum::intersects(bounding_volume const& volume, glm::mat4 const& model_to_world) const
+{
+	if (!volume.is_valid)
+		return true;
+
+	auto const scale = std::max(glm::length(glm::vec3(model_to_world[0])),
+	                            std::max(glm::length(glm::vec3(model_to_world[1])),
+	                                     glm::length(glm::vec3(model_to_world[2]))));
+	auto const sphere_center = glm::vec3(model_to_world * glm::vec4(volume.center, 1.0f));
+	if (!intersects_sphere(sphere_center, volume.radius * scale))
+		return false;
+
+	// Arvo's method: the world-space half-extent of the transformed box is
+	// the absolute value of the linear part applied to the model-space one.
+	auto const box_center = glm::vec3(model_to_world * glm::vec4((volume.min + volume.max) * 0.5f, 1.0f));
+	auto const box_extent = (volume.max - volume.min) * 0.5f;
+	auto const world_extent = glm::abs(glm::vec3(model_to_world[0])) * box_extent.x
+	                        + glm::abs(glm::vec3(model_to_world[1])) * box_extent.y
+	                        + glm::abs(glm::vec3(model_to_world[2])) * box_extent.z;
+	return intersects_box(box_center, world_extent);
+}
+
+bool
+bonobo::Frustum::intersects_sphere(glm::vec3 const& center, float radius) const
+{
+	int inside = 1;
+	for (size_t i = 0u; i < planes_nb; ++i) {
+		auto const distance = _x[i] * center.x + _y[i] * center.y + _z[i] * center.z + _w[i];
+		inside &= static_cast<int>(distance >= -radius);
+	}
+	return inside != 0;
+}
+
+bool
+bonobo::Frustum::intersects_box(glm::vec3 const& center, glm::vec3 const& extent) const
+{
+	int inside = 1;
+	for (size_t i = 0u; i < planes_nb; ++i) {
+		auto const distance = _x[i] * center.x + _y[i] * center.y + _z[i] * center.z + _w[i];
+		auto const projected_extent = std::abs(_x[i]) * extent.x + std::abs(_y[i]) * extent.y + std::abs(_z[i]) * extent.z;
+		inside &= static_cast<int>(distance >= -projected_extent);
+	}
+	return inside != 0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+namespace bonobo
+{
+	//! \brief Bounds of a mesh, in model-space.
+	//!
+	//! Both an axis-aligned bounding box and a bounding sphere are kept:
+	//! the sphere gives a cheap first test, the box a tighter second one.
+	struct bounding_volume {
+		glm::vec3 min;    //!< lower corner of the axis-aligned bounding box
+		glm::vec3 max;    //!< upper corner of the axis-aligned bounding box
+		glm::vec3 center; //!< center of the bounding sphere
+		float radius;     //!< radius of the bounding sphere
+		bool is_valid;    //!< whether the bounds were computed; invalid
+		                  //!< bounds are never culled
+
+		bounding_volume() : min(0.0f), max(0.0f), center(0.0f), radius(0.0f), is_valid(false)
+		{
+		}
+	};
+
+	//! \brief Compute the bounds enclosing a set of positions.
+	//!
+	//! @param [in] positions array of positions, in model-space
+	//! @param [in] positions_nb number of entries in `positions`
+	//! @return the bounds; they are invalid if `positions_nb` is 0
+	bounding_volume compute_bounding_volume(glm::vec3 const* positions, size_t positions_nb);
+
+	//! \brief View frustum, as six planes extracted from a world-space to
+	//!        clip-space matrix.
+	//!
+	//! The planes are stored as a structure of arrays, padded to eight
+	//! planes that always pass, so that the tests are branch-free loops
+	//! the compiler can vectorise.
+	class Frustum
+	{
+	public:
+		//! \brief Extract the planes of the frustum.
+		//!
+		//! @param [in] world_to_clip Matrix transforming from world-space
+		//!             to clip-space, e.g. `FPSCamera::GetWorldToClipMatrix()`
+		//!             or a light's view-projection
+		explicit Frustum(glm::mat4 const& world_to_clip);
+
+		//! \brief Test whether some bounds are at least partly inside the
+		//!        frustum.
+		//!
+		//! @param [in] volume bounds in model-space
+		//! @param [in] model_to_world Matrix transforming from model-space
+		//!             to world-space
+		//! @return false only if the bounds are entirely outside
+		bool intersects(bounding_volume const& volume, glm::mat4 const& model_to_world) const;
+
+		//! \brief Test a world-space sphere against the frustum.
+		bool intersects_sphere(glm::vec3 const& center, float radius) const;
+
+		//! \brief Test a world-space axis-aligned box, given by its center
+		//!        and half-extent, against the frustum.
+		bool intersects_box(glm::vec3 const& center, glm::vec3 const& extent) const;
+
+	private:
+		static constexpr size_t planes_nb = 8u;
+
+		alignas(16) float _x[planes_nb];
+		alignas(16) float _y[planes_nb];
+		alignas(16) float _z[planes_nb];
+		alignas(16) float _w[planes_nb];
+	};
+}
@@ -0,0 +1,461 @@
+#include "dds.hpp"
+
+#include "mapped_file.hpp"
+#include "core/Log.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace
+{
+	// Not exposed by our OpenGL 4.1 core loader, as S3TC is an extension.
+	constexpr GLenum compressed_rgb_s3tc_dxt1  = 0x83F0;
+	constexpr GLenum compressed_rgba_s3tc_dxt5 = 0x83F3;
+
+	constexpr u32 make_fourcc(char a, char b, char c, char d)
+	{
+		return static_cast<u32>(static_cast<u8>(a))
+		     | (static_cast<u32>(static_cast<u8>(b)) << 8u)
+		     | (static_cast<u32>(static_cast<u8>(c)) << 16u)
+		     | (static_cast<u32>(static_cast<u8>(d)) << 24u);
+	}
+
+	constexpr u32 dds_magic      = make_fourcc('D', 'D', 'S', ' ');
+	constexpr u32 fourcc_dxt1    = make_fourcc('D', 'X', 'T', '1');
+	constexpr u32 fourcc_dxt5    = make_fourcc('D', 'X', 'T', '5');
+	constexpr u32 fourcc_ati2    = make_fourcc('A', 'T', 'I', '2');
+	constexpr u32 flipped_marker = make_fourcc('B', 'N', 'B', 'F'); // stored in reserved1[0]
+
+	constexpr u32 ddsd_caps        = 0x1u;
+	constexpr u32 ddsd_height      = 0x2u;
+	constexpr u32 ddsd_width       = 0x4u;
+	constexpr u32 ddsd_pixelformat = 0x1000u;
+	constexpr u32 ddsd_mipmapcount = 0x20000u;
+	constexpr u32 ddsd_linearsize  = 0x80000u;
+	constexpr u32 ddpf_fourcc      = 0x4u;
+	constexpr u32 ddscaps_complex  = 0x8u;
+	constexpr u32 ddscaps_texture  = 0x1000u;
+	constexpr u32 ddscaps_mipmap   = 0x400000u;
+
+	struct dds_pixel_format {
+		u32 size;
+		u32 flags;
+		u32 fourcc;
+		u32 rgb_bit_count;
+		u32 r_mask;
+		u32 g_mask;
+		u32 b_mask;
+		u32 a_mask;
+	};
+
+	struct dds_header {
+		u32 size;
+		u32 flags;
+		u32 height;
+		u32 width;
+		u32 pitch_or_linear_size;
+		u32 depth;
+		u32 mipmap_count;
+		u32 reserved1[11];
+		dds_pixel_format pixel_format;
+		u32 caps;
+		u32 caps2;
+		u32 caps3;
+		u32 caps4;
+		u32 reserved2;
+	};
+	static_assert(sizeof(dds_header) == 124u, "DDS header should be 124 bytes long");
+
+	size_t get_block_size(bonobo::dds::format block_format)
+	{
+		return block_format == bonobo::dds::format::bc1 ? 8u : 16u;
+	}
+
+	size_t get_level_size(u32 width, u32 height, bonobo::dds::format block_format)
+	{
+		return static_cast<size_t>(std::max(1u, (width + 3u) / 4u))
+		     * static_cast<size_t>(std::max(1u, (height + 3u) / 4u))
+		     * get_block_size(block_format);
+	}
+
+	GLenum get_gl_format(bonobo::dds::format block_format)
+	{
+		switch (block_format) {
+		case bonobo::dds::format::bc1: return compressed_rgb_s3tc_dxt1;
+		case bonobo::dds::format::bc3: return compressed_rgba_s3tc_dxt5;
+		case bonobo::dds::format::bc5: return GL_COMPRESSED_RG_RGTC2;
+		}
+		return GL_NONE;
+	}
+
+	u16 to_565(glm::vec3 const& colour)
+	{
+		auto const r = static_cast<u16>(std::lround(glm::clamp(colour.x, 0.0f, 255.0f) * 31.0f / 255.0f));
+		auto const g = static_cast<u16>(std::lround(glm::clamp(colour.y, 0.0f, 255.0f) * 63.0f / 255.0f));
+		auto const b = static_cast<u16>(std::lround(glm::clamp(colour.z, 0.0f, 255.0f) * 31.0f / 255.0f));
+		return static_cast<u16>((r << 11u) | (g << 5u) | b);
+	}
+
+	glm::vec3 from_565(u16 colour)
+	{
+		return glm::vec3(static_cast<float>((colour >> 11u) & 0x1Fu) * 255.0f / 31.0f,
+		                 static_cast<float>((colour >> 5u)  & 0x3Fu) * 255.0f / 63.0f,
+		                 static_cast<float>( colour         & 0x1Fu) * 255.0f / 31.0f);
+	}
+
+	void write_u16(u8* out, u16 value)
+	{
+		out[0] = static_cast<u8>(value & 0xFFu);
+		out[1] = static_cast<u8>(value >> 8u);
+	}
+
+	//! \brief Encode the RGB channels of a 4×4 block of RGBA8 texels.
+	//!
+	//! The endpoints are the extreme texels along the principal axis of
+	//! the block's colours.
+	void encode_colour_block(u8 const* block, u8* out)
+	{
+		glm::vec3 colours[16];
+		auto mean = glm::vec3(0.0f);
+		for (int i = 0; i < 16; ++i) {
+			colours[i] = glm::vec3(block[4 * i + 0], block[4 * i + 1], block[4 * i + 2]);
+			mean += colours[i];
+		}
+		mean /= 16.0f;
+
+		float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		for (auto const& colour : colours) {
+			auto const d = colour - mean;
+			covariance[0] += d.x * d.x;
+			covariance[1] += d.x * d.y;
+			covariance[2] += d.x * d.z;
+			covariance[3] += d.y * d.y;
+			covariance[4] += d.y * d.z;
+			covariance[5] += d.z * d.z;
+		}
+
+		auto axis = glm::vec3(1.0f, 1.0f, 1.0f);
+		for (int iteration = 0; iteration < 4; ++iteration) {
+			auto const next = glm::vec3(covariance[0] * axis.x + covariance[1] * axis.y + covariance[2] * axis.z,
+			                            covariance[1] * axis.x + covariance[3] * axis.y + covariance[4] * axis.z,
+			                            covariance[2] * axis.x + covariance[4] * axis.y + covariance[5] * axis.z);
+			auto const length = std::max(std::abs(next.x), std::max(std::abs(next.y), std::abs(next.z)));
+			if (length < 1e-4f)
+				break;
+			axis = next / length;
+		}
+
+		int min_index = 0, max_index = 0;
+		auto min_projection = glm::dot(colours[0], axis), max_projection = min_projection;
+		for (int i = 1; i < 16; ++i) {
+			auto const projection = glm::dot(colours[i], axis);
+			if (projection < min_projection) {
+				min_projection = projection;
+				min_index = i;
+			}
+			if (projection > max_projection) {
+				max_projection = projection;
+				max_index = i;
+			}
+		}
+
+		auto endpoint0 = to_565(colours[max_index]);
+		auto endpoint1 = to_565(colours[min_index]);
+		// The four-colour mode is selected by endpoint0 > endpoint1.
+		if (endpoint0 < endpoint1)
+			std::swap(endpoint0, endpoint1);
+		write_u16(out + 0, endpoint0);
+		write_u16(out + 2, endpoint1);
+		std::memset(out + 4, 0, 4u);
+		if (endpoint0 == endpoint1)
+			return;
+
+		auto const p0 = from_565(endpoint0);
+		auto const p1 = from_565(endpoint1);
+		glm::vec3 const palette[4] = { p0, p1, (2.0f * p0 + p1) / 3.0f, (p0 + 2.0f * p1) / 3.0f };
+		u32 indices = 0u;
+		for (int i = 0; i < 16; ++i) {
+			u32 best = 0u;
+			auto best_distance = std::numeric_limits<float>::max();
+			for (u32 j = 0u; j < 4u; ++j) {
+				auto const d = colours[i] - palette[j];
+				auto const distance = glm::dot(d, d);
+				if (distance < best_distance) {
+					best_distance = distance;
+					best = j;
+				}
+			}
+			indices |= best << (2u * static_cast<u32>(i));
+		}
+		for (u32 i = 0u; i < 4u; ++i)
+			out[4u + i] = static_cast<u8>((indices >> (8u * i)) & 0xFFu);
+	}
+
+	//! \brief Encode one channel of a 4×4 block of RGBA8 texels, as BC4.
+	void encode_channel_block(u8 const* block, int channel, u8* out)
+	{
+		u8 values[16];
+		u8 low = 255u, high = 0u;
+		for (int i = 0; i < 16; ++i) {
+			values[i] = block[4 * i + channel];
+			low = std::min(low, values[i]);
+			high = std::max(high, values[i]);
+		}
+
+		// The eight-value mode is selected by endpoint0 > endpoint1.
+		out[0] = high;
+		out[1] = low;
+		std::memset(out + 2, 0, 6u);
+		if (high == low)
+			return;
+
+		int palette[8];
+		palette[0] = high;
+		palette[1] = low;
+		for (int i = 1; i < 7; ++i)
+			palette[i + 1] = ((7 - i) * high + i * low) / 7;
+
+		u64 indices = 0u;
+		for (int i = 0; i < 16; ++i) {
+			u64 best = 0u;
+			auto best_distance = 256;
+			for (int j = 0; j < 8; ++j) {
+				auto const distance = std::abs(static_cast<int>(values[i]) - palette[j]);
+				if (distance < best_distance) {
+					best_distance = distance;
+					best = static_cast<u64>(j);
+				}
+			}
+			indices |= best << (3u * static_cast<u32>(i));
+		}
+		for (u32 i = 0u; i < 6u; ++i)
+			out[2u + i] = static_cast<u8>((indices >> (8u * i)) & 0xFFu);
+	}
+
+	bonobo::dds::level compress_level(std::vector<u8> const& pixels, u32 width, u32 height, bonobo::dds::format block_format, bool flip)
+	{
+		bonobo::dds::level level;
+		level.width = width;
+		level.height = height;
+		level.data.resize(get_level_size(width, height, block_format));
+
+		auto out = level.data.data();
+		u8 block[64];
+		for (u32 block_y = 0u; block_y < height; block_y += 4u) {
+			for (u32 block_x = 0u; block_x < width; block_x += 4u) {
+				// Texels outside of the image repeat the edge ones.
+				for (u32 y = 0u; y < 4u; ++y) {
+					auto const row = std::min(block_y + y, height - 1u);
+					auto const source_row = flip ? height - 1u - row : row;
+					for (u32 x = 0u; x < 4u; ++x) {
+						auto const column = std::min(block_x + x, width - 1u);
+						std::memcpy(block + 4u * (4u * y + x), pixels.data() + 4u * (static_cast<size_t>(source_row) * width + column), 4u);
+					}
+				}
+
+				switch (block_format) {
+				case bonobo::dds::format::bc1:
+					encode_colour_block(block, out);
+					break;
+				case bonobo::dds::format::bc3:
+					encode_channel_block(block, 3, out);
+					encode_colour_block(block, out + 8);
+					break;
+				case bonobo::dds::format::bc5:
+					encode_channel_block(block, 0, out);
+					encode_channel_block(block, 1, out + 8);
+					break;
+				}
+				out += get_block_size(block_format);
+			}
+		}
+
+		return level;
+	}
+
+	std::vector<u8> downsample(std::vector<u8> const& pixels, u32 width, u32 height, u32 next_width, u32 next_height)
+	{
+		std::vector<u8> next(static_cast<size_t>(next_width) * next_height * 4u);
+		for (u32 y = 0u; y < next_height; ++y) {
+			auto const y0 = std::min(2u * y, height - 1u);
+			auto const y1 = std::min(2u * y + 1u, height - 1u);
+			for (u32 x = 0u; x < next_width; ++x) {
+				auto const x0 = std::min(2u * x, width - 1u);
+				auto const x1 = std::min(2u * x + 1u, width - 1u);
+				for (u32 c = 0u; c < 4u; ++c) {
+					auto const sum = pixels[4u * (static_cast<size_t>(y0) * width + x0) + c]
+					               + pixels[4u * (static_cast<size_t>(y0) * width + x1) + c]
+					               + pixels[4u * (static_cast<size_t>(y1) * width + x0) + c]
+					               + pixels[4u * (static_cast<size_t>(y1) * width + x1) + c];
+					next[4u * (static_cast<size_t>(y) * next_width + x) + c] = static_cast<u8>((sum + 2u) / 4u);
+				}
+			}
+		}
+		return next;
+	}
+}
+
+std::string
+bonobo::dds::get_path(std::string const& png_path)
+{
+	auto const extension = png_path.rfind('.');
+	if (extension == std::string::npos || png_path.find('/', extension) != std::string::npos)
+		return png_path + ".dds";
+	return png_path.substr(0u, extension) + ".dds";
+}
+
+bonobo::dds::texture
+bonobo::dds::compress(u8 const* pixels, u32 width, u32 height, format block_format, bool generate_mipmap, bool flip)
+{
+	texture compressed;
+	compressed.block_format = block_format;
+	compressed.flipped = flip;
+	if (pixels == nullptr || width == 0u || height == 0u)
+		return compressed;
+
+	auto level_pixels = std::vector<u8>(pixels, pixels + static_cast<size_t>(width) * height * 4u);
+	for (;;) {
+		compressed.levels.push_back(compress_level(level_pixels, width, height, block_format, flip));
+		if (!generate_mipmap || (width == 1u && height == 1u))
+			break;
+
+		auto const next_width = std::max(1u, width / 2u);
+		auto const next_height = std::max(1u, height / 2u);
+		level_pixels = downsample(level_pixels, width, height, next_width, next_height);
+		width = next_width;
+		height = next_height;
+	}
+
+	return compressed;
+}
+
+bool
+bonobo::dds::write(std::string const& path, texture const& compressed)
+{
+	if (compressed.levels.empty())
+		return false;
+
+	dds_header header;
+	std::memset(&header, 0, sizeof(header));
+	header.size = sizeof(dds_header);
+	header.flags = ddsd_caps | ddsd_height | ddsd_width | ddsd_pixelformat | ddsd_linearsize | ddsd_mipmapcount;
+	header.height = compressed.levels.front().height;
+	header.width = compressed.levels.front().width;
+	header.pitch_or_linear_size = static_cast<u32>(compressed.levels.front().data.size());
+	header.mipmap_count = static_cast<u32>(compressed.levels.size());
+	header.reserved1[0] = compressed.flipped ? flipped_marker : 0u;
+	header.pixel_format.size = sizeof(dds_pixel_format);
+	header.pixel_format.flags = ddpf_fourcc;
+	header.pixel_format.fourcc = compressed.block_format == format::bc1 ? fourcc_dxt1
+	                           : compressed.block_format == format::bc3 ? fourcc_dxt5
+	                           : fourcc_ati2;
+	header.caps = ddscaps_texture | (compressed.levels.size() > 1u ? ddscaps_complex | ddscaps_mipmap : 0u);
+
+	std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+	if (!stream.is_open())
+		return false;
+	stream.write(reinterpret_cast<char const*>(&dds_magic), sizeof(dds_magic));
+	stream.write(reinterpret_cast<char const*>(&header), sizeof(header));
+	for (auto const& level : compressed.levels)
+		stream.write(reinterpret_cast<char const*>(level.data.data()), static_cast<std::streamsize>(level.data.size()));
+
+	return stream.good();
+}
+
+bool
+bonobo::dds::read(std::string const& path, texture& compressed)
+{
+	MappedFile file;
+	if (!file.open(path))
+		return false;
+
+	auto const bytes = static_cast<u8 const*>(file.data());
+	u32 magic = 0u;
+	dds_header header;
+	if (file.size() < sizeof(magic) + sizeof(header))
+		return false;
+	std::memcpy(&magic, bytes, sizeof(magic));
+	std::memcpy(&header, bytes + sizeof(magic), sizeof(header));
+	if (magic != dds_magic || header.size != sizeof(dds_header) || (header.pixel_format.flags & ddpf_fourcc) == 0u
+	    || header.width == 0u || header.height == 0u)
+		return false;
+
+	switch (header.pixel_format.fourcc) {
+	case fourcc_dxt1: compressed.block_format = format::bc1; break;
+	case fourcc_dxt5: compressed.block_format = format::bc3; break;
+	case fourcc_ati2: compressed.block_format = format::bc5; break;
+	default:          return false;
+	}
+	compressed.flipped = header.reserved1[0] == flipped_marker;
+
+	auto const levels_nb = (header.flags & ddsd_mipmapcount) != 0u ? std::max(1u, header.mipmap_count) : 1u;
+	compressed.levels.clear();
+	compressed.levels.reserve(levels_nb);
+	auto offset = sizeof(magic) + sizeof(header);
+	auto width = header.width, height = header.height;
+	for (u32 i = 0u; i < levels_nb; ++i) {
+		auto const size = get_level_size(width, height, compressed.block_format);
+		if (size > file.size() - offset)
+			return false;
+
+		level current;
+		current.width = width;
+		current.height = height;
+		current.data.assign(bytes + offset, bytes + offset + size);
+		compressed.levels.push_back(std::move(current));
+
+		offset += size;
+		width = std::max(1u, width / 2u);
+		height = std::max(1u, height / 2u);
+	}
+
+	return true;
+}
+
+bool
+bonobo::dds::is_supported(format block_format)
+{
+	// RGTC is part of core OpenGL since 3.0.
+	if (block_format == format::bc5)
+		return true;
+
+	static int s3tc_supported = -1;
+	if (s3tc_supported < 0) {
+		s3tc_supported = 0;
+		GLint extensions_nb = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensions_nb);
+		for (GLint i = 0; i < extensions_nb && s3tc_supported == 0; ++i) {
+			auto const extension = reinterpret_cast<char const*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+			if (extension != nullptr && std::strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0)
+				s3tc_supported = 1;
+		}
+		if (s3tc_supported == 0)
+			LogWarning("S3TC textures are not supported: falling back to PNG images");
+	}
+	return s3tc_supported == 1;
+}
+
+void
+bonobo::dds::upload(GLuint texture_id, texture const& compressed, bool use_mipmap)
+{
+	auto const levels_nb = use_mipmap ? compressed.levels.size() : std::min<size_t>(1u, compressed.levels.size());
+	auto const internal_format = get_gl_format(compressed.block_format);
+
+	glBindTexture(GL_TEXTURE_2D, texture_id);
+	for (size_t i = 0u; i < levels_nb; ++i) {
+		auto const& level = compressed.levels[i];
+		glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), internal_format,
+		                       static_cast<GLsizei>(level.width), static_cast<GLsizei>(level.height), 0,
+		                       static_cast<GLsizei>(level.data.size()), reinterpret_cast<GLvoid const*>(level.data.data()));
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels_nb > 0u ? levels_nb - 1u : 0u));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels_nb > 1u ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0u);
+}
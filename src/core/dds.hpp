@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Types.h"
+
+#include "external/glad/glad.h"
+
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Block-compressed textures stored in DDS files.
+	//!
+	//! The files are regular DDS files (DXT1, DXT5 or ATI2 FourCC) holding
+	//! a full mip chain, so they can be inspected with common tools. They
+	//! are produced offline by the `texture_converter` tool, next to the
+	//! PNG images they replace.
+	namespace dds
+	{
+		//! \brief Supported block-compression formats.
+		enum class format : u32 {
+			bc1, //!< RGB, 4 bits per texel
+			bc3, //!< RGBA, 8 bits per texel
+			bc5  //!< RG, 8 bits per texel; only suited to two-channel data
+		};
+
+		//! \brief One level of a mip chain.
+		struct level {
+			u32 width;
+			u32 height;
+			std::vector<u8> data; //!< compressed blocks
+		};
+
+		//! \brief A block-compressed texture and its mip chain.
+		struct texture {
+			format block_format;
+			bool flipped;              //!< whether the first row is the bottom one
+			std::vector<level> levels; //!< from the largest to the smallest
+		};
+
+		//! \brief Return where the compressed version of a PNG image is
+		//!        stored: the same path, with a `.dds` extension.
+		std::string get_path(std::string const& png_path);
+
+		//! \brief Compress an RGBA8 image, and optionally its mip chain.
+		//!
+		//! @param [in] pixels RGBA8 texels, first row first
+		//! @param [in] width width of the image
+		//! @param [in] height height of the image
+		//! @param [in] block_format compression format to use
+		//! @param [in] generate_mipmap whether to compute the full mip chain
+		//! @param [in] flip whether to store the image flipped vertically
+		//! @return the compressed texture
+		texture compress(u8 const* pixels, u32 width, u32 height,
+		                 format block_format, bool generate_mipmap, bool flip);
+
+		//! \brief Write a compressed texture to a DDS file.
+		//!
+		//! @return whether the file could be written
+		bool write(std::string const& path, texture const& compressed);
+
+		//! \brief Read a compressed texture from a DDS file.
+		//!
+		//! This does not use OpenGL, so it can be called from any thread.
+		//!
+		//! @return whether the file exists and is a supported DDS file
+		bool read(std::string const& path, texture& compressed);
+
+		//! \brief Return whether the current OpenGL context can sample a
+		//!        format.
+		bool is_supported(format block_format);
+
+		//! \brief Upload a compressed texture into a 2D-texture.
+		//!
+		//! @param [in] texture_id name of the OpenGL texture to fill in
+		//! @param [in] compressed the texture to upload
+		//! @param [in] use_mipmap whether to upload and sample the mip
+		//!             chain, or the first level only
+		void upload(GLuint texture_id, texture const& compressed, bool use_mipmap);
+	}
+}
@@ -0,0 +1,423 @@
+#include "frame_graph.hpp"
+
+#include "gpu_profiler.hpp"
+#include "Log.h"
+
+#include <algorithm>
+#include <cassert>
+
+constexpr bonobo::FrameGraph::resource bonobo::FrameGraph::invalid_resource;
+
+namespace
+{
+	//! Frames a pooled texture or framebuffer can stay unused, e.g. while
+	//! the passes using it are culled, before it is deleted.
+	constexpr size_t max_unused_frames = 8u;
+
+	bool
+	contains(std::vector<bonobo::FrameGraph::resource> const& resources, bonobo::FrameGraph::resource target)
+	{
+		return std::find(resources.begin(), resources.end(), target) != resources.end();
+	}
+}
+
+bonobo::FrameGraph::builder::builder(FrameGraph& graph, size_t pass) : _graph(graph), _pass(pass)
+{
+}
+
+bonobo::FrameGraph::resource
+bonobo::FrameGraph::builder::create(render_target_desc const& desc, u32 width, u32 height)
+{
+	resource_entry target;
+	target.name = desc.name;
+	target.desc = desc;
+	target.width = width;
+	target.height = height;
+	target.texture = 0u;
+	target.imported = false;
+	target.readers_nb = 0u;
+	_graph._resources.push_back(target);
+	return _graph._resources.size() - 1u;
+}
+
+void
+bonobo::FrameGraph::builder::read(resource target)
+{
+	assert(target < _graph._resources.size());
+	_graph._passes[_pass].reads.push_back(target);
+	++_graph._resources[target].readers_nb;
+}
+
+void
+bonobo::FrameGraph::builder::write(resource target)
+{
+	_graph.add_write(_pass, target);
+	_graph._passes[_pass].colours.push_back(target);
+}
+
+void
+bonobo::FrameGraph::builder::use_depth(resource target, bool writes)
+{
+	auto& pass = _graph._passes[_pass];
+	assert(pass.depth == invalid_resource);
+	pass.depth = target;
+	pass.depth_written = writes;
+	if (writes)
+		_graph.add_write(_pass, target);
+	else
+		read(target);
+}
+
+void
+bonobo::FrameGraph::builder::update(resource target)
+{
+	_graph.add_write(_pass, target);
+	_graph._passes[_pass].updates.push_back(target);
+}
+
+void
+bonobo::FrameGraph::builder::set_side_effect()
+{
+	_graph._passes[_pass].side_effect = true;
+}
+
+bonobo::FrameGraph::FrameGraph() : _resources(), _passes(), _pool(), _fbos(), _stats(), _default_fbo(0u)
+{
+}
+
+bonobo::FrameGraph::~FrameGraph()
+{
+	for (auto const& fbo : _fbos)
+		glDeleteFramebuffers(1, &fbo.second.fbo);
+	for (auto const& pooled : _pool)
+		glDeleteTextures(1, &pooled.texture);
+}
+
+void
+bonobo::FrameGraph::reset()
+{
+	_resources.clear();
+	_passes.clear();
+}
+
+void
+bonobo::FrameGraph::set_default_framebuffer(GLuint fbo)
+{
+	_default_fbo = fbo;
+}
+
+bonobo::FrameGraph::resource
+bonobo::FrameGraph::import_texture(char const* name, GLuint texture, render_target_desc const& desc, u32 width, u32 height)
+{
+	resource_entry target;
+	target.name = name;
+	target.desc = desc;
+	target.width = width;
+	target.height = height;
+	target.texture = texture;
+	target.imported = true;
+	target.readers_nb = 0u;
+	_resources.push_back(target);
+	return _resources.size() - 1u;
+}
+
+void
+bonobo::FrameGraph::add_pass(char const* name, std::function<void (builder&)> const& setup, std::function<void ()> const& execute)
+{
+	pass_entry pass;
+	pass.name = name;
+	pass.execute = execute;
+	pass.depth = invalid_resource;
+	pass.depth_written = false;
+	pass.side_effect = false;
+	pass.culled = false;
+	pass.references = 0u;
+	_passes.push_back(pass);
+
+	builder b(*this, _passes.size() - 1u);
+	setup(b);
+
+	// Sampling a texture while rendering to it is undefined.
+	auto const& added = _passes.back();
+	for (auto const target : added.reads) {
+		if (contains(added.colours, target) || (added.depth_written && added.depth == target))
+			LogError("Pass \"%s\" both samples and renders to \"%s\"", name, _resources[target].name.c_str());
+	}
+}
+
+void
+bonobo::FrameGraph::execute(GPUProfiler* profiler)
+{
+	cull();
+	allocate();
+
+	for (auto const& pass : _passes) {
+		if (pass.culled)
+			continue;
+		if (profiler != nullptr)
+			profiler->push(pass.name.c_str());
+		bind_attachments(pass);
+		pass.execute();
+		if (profiler != nullptr)
+			profiler->pop();
+	}
+}
+
+GLuint
+bonobo::FrameGraph::get_texture(resource target) const
+{
+	assert(target < _resources.size());
+	return _resources[target].texture;
+}
+
+bonobo::FrameGraph::stats const&
+bonobo::FrameGraph::get_stats() const
+{
+	return _stats;
+}
+
+// The first pass writing to a transient target clears it; the following
+// ones draw over what it contains, so they depend on the previous writers.
+void
+bonobo::FrameGraph::add_write(size_t pass, resource target)
+{
+	assert(target < _resources.size());
+	auto& t = _resources[target];
+	auto& p = _passes[pass];
+	if (!t.writers.empty()) {
+		p.loads.push_back(target);
+		++t.readers_nb;
+	} else if (!t.imported) {
+		p.clears.push_back(target);
+	}
+	if (t.imported)
+		p.side_effect = true;
+	t.writers.push_back(pass);
+}
+
+// Release the targets nobody reads, then the passes whose targets were all
+// released, and so on.
+void
+bonobo::FrameGraph::cull()
+{
+	std::vector<size_t> references(_resources.size());
+	std::vector<resource> unused;
+	for (resource r = 0u; r < _resources.size(); ++r) {
+		references[r] = _resources[r].readers_nb;
+		if (references[r] == 0u)
+			unused.push_back(r);
+	}
+	for (auto& pass : _passes) {
+		pass.culled = false;
+		pass.references = pass.colours.size() + pass.updates.size() + (pass.depth_written ? 1u : 0u);
+	}
+
+	while (!unused.empty()) {
+		auto const r = unused.back();
+		unused.pop_back();
+		for (auto const writer : _resources[r].writers) {
+			auto& pass = _passes[writer];
+			if (pass.culled || pass.side_effect || --pass.references > 0u)
+				continue;
+			pass.culled = true;
+			for (auto const& inputs : { std::cref(pass.reads), std::cref(pass.loads) })
+				for (auto const input : inputs.get())
+					if (--references[input] == 0u)
+						unused.push_back(input);
+		}
+	}
+}
+
+void
+bonobo::FrameGraph::allocate()
+{
+	auto const none = static_cast<size_t>(-1);
+	for (auto& target : _resources) {
+		target.first_use = none;
+		target.last_use = none;
+	}
+	for (size_t i = 0u; i < _passes.size(); ++i) {
+		auto const& pass = _passes[i];
+		if (pass.culled)
+			continue;
+		auto const use = [this, i](resource r){
+			auto& target = _resources[r];
+			if (target.first_use == none)
+				target.first_use = i;
+			target.last_use = i;
+		};
+		for (auto const r : pass.reads)   use(r);
+		for (auto const r : pass.loads)   use(r);
+		for (auto const r : pass.colours) use(r);
+		for (auto const r : pass.updates) use(r);
+		if (pass.depth != invalid_resource)
+			use(pass.depth);
+	}
+
+	_stats = stats();
+	_stats.passes = _passes.size();
+	for (auto& pooled : _pool) {
+		pooled.in_use = false;
+		++pooled.unused_frames;
+	}
+	for (auto& fbo : _fbos)
+		++fbo.second.unused_frames;
+
+	// Walk the passes in order, taking a texture from the pool at the first
+	// use of a target and giving it back after its last one.
+	size_t live_bytes = 0u;
+	for (size_t i = 0u; i < _passes.size(); ++i) {
+		if (_passes[i].culled) {
+			++_stats.culled_passes;
+			continue;
+		}
+		_stats.clears += _passes[i].clears.size();
+		for (auto& target : _resources) {
+			if (target.imported || target.first_use != i)
+				continue;
+			target.texture = acquire(target);
+			live_bytes += get_size(target);
+			_stats.unaliased_bytes += get_size(target);
+			++_stats.transient_targets;
+		}
+		_stats.peak_bytes = std::max(_stats.peak_bytes, live_bytes);
+		for (auto const& target : _resources) {
+			if (target.imported || target.last_use != i)
+				continue;
+			release(target.texture);
+			live_bytes -= get_size(target);
+		}
+	}
+
+	evict();
+	for (auto const& pooled : _pool)
+		_stats.pooled_bytes += getTexelSize(pooled.desc.internal_format) * pooled.width * pooled.height;
+}
+
+void
+bonobo::FrameGraph::bind_attachments(pass_entry const& pass)
+{
+	if (pass.colours.empty() && pass.depth == invalid_resource)
+		return;
+
+	std::vector<GLuint> attachments;
+	for (auto const r : pass.colours)
+		attachments.push_back(_resources[r].texture);
+	attachments.push_back(pass.depth != invalid_resource ? _resources[pass.depth].texture : 0u);
+
+	// The default framebuffer is imported as texture 0.
+	auto const is_default = !pass.colours.empty() && attachments.front() == 0u;
+	GLuint fbo = _default_fbo;
+	if (!is_default) {
+		auto it = _fbos.find(attachments);
+		if (it == _fbos.end()) {
+			auto const colours = std::vector<GLuint>(attachments.begin(), attachments.end() - 1);
+			it = _fbos.emplace(attachments, framebuffer{ createFBO(colours, attachments.back()), 0u }).first;
+		}
+		it->second.unused_frames = 0u;
+		fbo = it->second.fbo;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	if (is_default) {
+		glDrawBuffer(_default_fbo == 0u ? GL_BACK : GL_COLOR_ATTACHMENT0);
+	} else if (pass.colours.empty()) {
+		glDrawBuffer(GL_NONE);
+	} else {
+		std::vector<GLenum> draw_buffers(pass.colours.size());
+		for (size_t i = 0u; i < draw_buffers.size(); ++i)
+			draw_buffers[i] = static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + i);
+		glDrawBuffers(static_cast<GLsizei>(draw_buffers.size()), draw_buffers.data());
+	}
+
+	auto const& sized = _resources[!pass.colours.empty() ? pass.colours.front() : pass.depth];
+	glViewport(0, 0, static_cast<GLsizei>(sized.width), static_cast<GLsizei>(sized.height));
+
+	for (auto const r : pass.clears) {
+		auto const colour = std::find(pass.colours.begin(), pass.colours.end(), r);
+		if (colour != pass.colours.end()) {
+			GLfloat const zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			glClearBufferfv(GL_COLOR, static_cast<GLint>(colour - pass.colours.begin()), zero);
+		} else if (r == pass.depth) {
+			GLfloat const one = 1.0f;
+			glDepthMask(GL_TRUE);
+			glClearBufferfv(GL_DEPTH, 0, &one);
+		}
+	}
+}
+
+GLuint
+bonobo::FrameGraph::acquire(resource_entry const& target)
+{
+	for (auto& pooled : _pool) {
+		if (pooled.in_use || pooled.desc.internal_format != target.desc.internal_format || pooled.desc.filter != target.desc.filter
+		    || pooled.width != target.width || pooled.height != target.height)
+			continue;
+		pooled.in_use = true;
+		pooled.unused_frames = 0u;
+		return pooled.texture;
+	}
+
+	pooled_texture pooled;
+	pooled.texture = createRenderTarget(target.width, target.height, target.desc);
+	pooled.desc = target.desc;
+	pooled.width = target.width;
+	pooled.height = target.height;
+	pooled.in_use = true;
+	pooled.unused_frames = 0u;
+	_pool.push_back(pooled);
+	LogInfo("Frame graph: allocated a %ux%u texture for \"%s\"", target.width, target.height, target.name.c_str());
+	return pooled.texture;
+}
+
+void
+bonobo::FrameGraph::release(GLuint texture)
+{
+	for (auto& pooled : _pool) {
+		if (pooled.texture == texture) {
+			pooled.in_use = false;
+			return;
+		}
+	}
+}
+
+// Delete the pooled textures left unused for a while, along with the
+// framebuffers they are attached to, then the framebuffers that were not
+// bound for a while; without this, every size a window goes through while
+// being resized would keep its own set of targets.
+void
+bonobo::FrameGraph::evict()
+{
+	std::vector<GLuint> evicted;
+	auto const is_stale = [](pooled_texture const& pooled){
+		return pooled.unused_frames > max_unused_frames;
+	};
+	for (auto const& pooled : _pool) {
+		if (!is_stale(pooled))
+			continue;
+		LogInfo("Frame graph: freed a %ux%u texture", pooled.width, pooled.height);
+		glDeleteTextures(1, &pooled.texture);
+		evicted.push_back(pooled.texture);
+	}
+	_pool.erase(std::remove_if(_pool.begin(), _pool.end(), is_stale), _pool.end());
+
+	for (auto it = _fbos.begin(); it != _fbos.end();) {
+		auto const& attachments = it->first;
+		auto const uses_evicted = std::any_of(attachments.begin(), attachments.end(), [&evicted](GLuint texture){
+			return texture != 0u && std::find(evicted.begin(), evicted.end(), texture) != evicted.end();
+		});
+		if (!uses_evicted && it->second.unused_frames <= max_unused_frames) {
+			++it;
+			continue;
+		}
+		glDeleteFramebuffers(1, &it->second.fbo);
+		it = _fbos.erase(it);
+	}
+}
+
+size_t
+bonobo::FrameGraph::get_size(resource_entry const& target) const
+{
+	return getTexelSize(target.desc.internal_format) * target.width * target.height;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "helpers.hpp"
+#include "Types.h"
+
+#include "external/glad/glad.h"
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	class GPUProfiler;
+
+	//! \brief Sequence of render passes, rebuilt every frame from what
+	//!        each pass reads and writes.
+	//!
+	//! Every frame, the graph is reset, then passes are added; each one
+	//! declares through a `builder` the render targets it samples, the
+	//! ones it renders to, and the transient render targets it creates.
+	//! `execute()` then:
+	//! * culls the passes whose results are never used, unless they have
+	//!   side effects, such as writing to an imported texture or to the
+	//!   default framebuffer;
+	//! * gives each transient render target a texture from a pool kept
+	//!   across frames, only for the passes between its first and its
+	//!   last use, so that targets of the same format and size whose
+	//!   lifetimes do not overlap share a texture; pooled textures and
+	//!   framebuffers left unused for a few frames, e.g. those of the
+	//!   previous size after a resize, are deleted;
+	//! * before each pass, binds a framebuffer with its attachments, sets
+	//!   the draw buffers and the viewport, and clears the transient
+	//!   targets it is the first to write to: colours to 0, depth to 1.
+	//!
+	//! Passes run in the order they were added, as a pass can only refer
+	//! to resources returned to earlier ones; OpenGL itself orders
+	//! rendering to a texture before sampling it in a later draw, so no
+	//! barriers are needed between passes.
+	class FrameGraph
+	{
+	public:
+		//! \brief Handle of a render target within the current frame.
+		using resource = size_t;
+		static constexpr resource invalid_resource = static_cast<resource>(-1);
+
+		//! \brief Counters of the last frame executed.
+		struct stats {
+			size_t passes;
+			size_t culled_passes;
+			size_t transient_targets;
+			size_t clears;
+			size_t peak_bytes;      //!< of the transient targets alive at
+			                        //!< the same time, i.e. with aliasing
+			size_t unaliased_bytes; //!< of all transient targets
+			size_t pooled_bytes;    //!< of all textures in the pool
+		};
+
+		//! \brief Declares the resources a pass uses, while it is added.
+		class builder
+		{
+		public:
+			//! \brief Create a transient render target, which only lives
+			//!        during the current frame.
+			resource create(render_target_desc const& desc, u32 width, u32 height);
+
+			//! \brief Sample a render target.
+			void read(resource target);
+
+			//! \brief Render to a render target, as the next colour
+			//!        attachment.
+			void write(resource target);
+
+			//! \brief Use a render target as depth attachment, with depth
+			//!        writes if `writes` is true, or only for testing.
+			void use_depth(resource target, bool writes);
+
+			//! \brief Write to a render target through other means than
+			//!        the attachments, e.g. the pass' own framebuffers.
+			void update(resource target);
+
+			//! \brief Never cull the pass.
+			void set_side_effect();
+
+		private:
+			friend class FrameGraph;
+			builder(FrameGraph& graph, size_t pass);
+
+			FrameGraph& _graph;
+			size_t _pass;
+		};
+
+		FrameGraph();
+
+		//! \brief Release all pooled textures and framebuffers.
+		~FrameGraph();
+
+		FrameGraph(FrameGraph const&) = delete;
+		FrameGraph& operator=(FrameGraph const&) = delete;
+
+		//! \brief Forget the passes and resources of the previous frame.
+		void reset();
+
+		//! \brief Set the framebuffer that texture 0 stands for, e.g. the
+		//!        offscreen one of a headless window; 0 by default.
+		void set_default_framebuffer(GLuint fbo);
+
+		//! \brief Make a texture managed elsewhere usable by the passes;
+		//!        it is never cleared nor aliased.
+		//!
+		//! @param [in] texture name of the texture, or 0 for the default
+		//!             framebuffer
+		resource import_texture(char const* name, GLuint texture, render_target_desc const& desc, u32 width, u32 height);
+
+		//! \brief Add a pass.
+		//!
+		//! @param [in] name shown in logs
+		//! @param [in] setup called right away, to declare the resources
+		//!             of the pass
+		//! @param [in] execute called by `execute()` unless the pass is
+		//!             culled, with the pass' framebuffer bound
+		void add_pass(char const* name, std::function<void (builder&)> const& setup, std::function<void ()> const& execute);
+
+		//! \brief Cull, allocate and run the passes added since `reset()`.
+		//!
+		//! @param [in] profiler if not null, times each pass in a scope
+		//!             named after it
+		void execute(GPUProfiler* profiler = nullptr);
+
+		//! \brief Get the texture backing a resource; only valid while
+		//!        its passes are executed.
+		GLuint get_texture(resource target) const;
+
+		//! \brief Get the counters of the last frame executed.
+		stats const& get_stats() const;
+
+	private:
+		struct resource_entry {
+			std::string name;
+			render_target_desc desc;
+			u32 width, height;
+			GLuint texture;
+			bool imported;
+			std::vector<size_t> writers;
+			size_t readers_nb;      // including passes loading it
+			size_t first_use, last_use;
+		};
+
+		struct pass_entry {
+			std::string name;
+			std::function<void ()> execute;
+			std::vector<resource> reads;
+			std::vector<resource> loads;   // written over by the pass
+			std::vector<resource> colours;
+			std::vector<resource> updates;
+			resource depth;
+			bool depth_written;
+			bool side_effect;
+			bool culled;
+			size_t references;
+			std::vector<resource> clears;
+		};
+
+		struct pooled_texture {
+			GLuint texture;
+			render_target_desc desc;
+			u32 width, height;
+			bool in_use;
+			size_t unused_frames;   // since it was last acquired
+		};
+
+		struct framebuffer {
+			GLuint fbo;
+			size_t unused_frames;   // since it was last bound
+		};
+
+		void add_write(size_t pass, resource target);
+		void cull();
+		void allocate();
+		void bind_attachments(pass_entry const& pass);
+		GLuint acquire(resource_entry const& target);
+		void release(GLuint texture);
+		void evict();
+		size_t get_size(resource_entry const& target) const;
+
+		std::vector<resource_entry> _resources;
+		std::vector<pass_entry> _passes;
+		std::vector<pooled_texture> _pool;
+		std::map<std::vector<GLuint>, framebuffer> _fbos; // by colour
+		                                                  // attachments,
+		                                                  // then depth
+		stats _stats;
+		GLuint _default_fbo;
+	};
+}
@@ -0,0 +1,114 @@
+#include "frame_timings.hpp"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+
+namespace
+{
+	double
+	get_percentile(std::vector<double> const& sorted_times, double percentile)
+	{
+		auto const rank = static_cast<size_t>(std::ceil(percentile / 100.0 * static_cast<double>(sorted_times.size())));
+		return sorted_times[std::max<size_t>(rank, 1u) - 1u];
+	}
+}
+
+bonobo::FrameTimings::FrameTimings() : _times(), _frames()
+{
+}
+
+void
+bonobo::FrameTimings::reset()
+{
+	_times.clear();
+	_frames.clear();
+}
+
+void
+bonobo::FrameTimings::add(double time)
+{
+	add(_frames.empty() ? 0u : _frames.back() + 1u, time);
+}
+
+void
+bonobo::FrameTimings::add(size_t frame, double time)
+{
+	assert(_frames.empty() || frame > _frames.back());
+	_times.push_back(time);
+	_frames.push_back(frame);
+}
+
+size_t
+bonobo::FrameTimings::get_frames_nb() const
+{
+	return _times.size();
+}
+
+bonobo::FrameTimings::summary
+bonobo::FrameTimings::summarise() const
+{
+	summary s;
+	s.frames_nb = _times.size();
+	s.total = s.average = s.min = s.max = s.p50 = s.p95 = s.p99 = 0.0;
+	if (_times.empty())
+		return s;
+
+	auto sorted_times = _times;
+	std::sort(sorted_times.begin(), sorted_times.end());
+	for (auto const time : sorted_times)
+		s.total += time;
+	s.average = s.total / static_cast<double>(s.frames_nb);
+	s.min = sorted_times.front();
+	s.max = sorted_times.back();
+	s.p50 = get_percentile(sorted_times, 50.0);
+	s.p95 = get_percentile(sorted_times, 95.0);
+	s.p99 = get_percentile(sorted_times, 99.0);
+	return s;
+}
+
+void
+bonobo::FrameTimings::log(std::string const& label) const
+{
+	auto const s = summarise();
+	LogInfo("%s: %zu frames in %.3f ms; avg %.3f, min %.3f, max %.3f, p50 %.3f, p95 %.3f, p99 %.3f ms (%.1f FPS)",
+	        label.c_str(), s.frames_nb, s.total, s.average, s.min, s.max, s.p50, s.p95, s.p99,
+	        s.average > 0.0 ? 1000.0 / s.average : 0.0);
+}
+
+bool
+bonobo::FrameTimings::dump_csv(std::string const& path,
+                               std::vector<std::pair<std::string, FrameTimings const*>> const& columns)
+{
+	std::ofstream stream(path, std::ios::trunc);
+	if (!stream.is_open())
+		return false;
+
+	stream << "frame";
+	size_t rows_nb = 0u;
+	for (auto const& column : columns) {
+		stream << "," << column.first;
+		if (!column.second->_frames.empty())
+			rows_nb = std::max(rows_nb, column.second->_frames.back() + 1u);
+	}
+	stream << "\n";
+
+	// Frames are recorded in increasing order, so each column is walked
+	// once alongside the rows.
+	std::vector<size_t> next(columns.size(), 0u);
+	for (size_t i = 0u; i < rows_nb; ++i) {
+		stream << i;
+		for (size_t j = 0u; j < columns.size(); ++j) {
+			auto const& timings = *columns[j].second;
+			stream << ",";
+			if (next[j] < timings._frames.size() && timings._frames[next[j]] == i)
+				stream << timings._times[next[j]++];
+		}
+		stream << "\n";
+	}
+
+	return stream.good();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Durations of a series of frames, and their statistics.
+	class FrameTimings
+	{
+	public:
+		//! \brief Statistics of the frames recorded, all in ms.
+		struct summary {
+			size_t frames_nb;
+			double total;
+			double average;
+			double min;
+			double max;
+			double p50;
+			double p95;
+			double p99;
+		};
+
+		FrameTimings();
+
+		//! \brief Forget all recorded frames.
+		void reset();
+
+		//! \brief Record the duration of the frame following the last one
+		//!        recorded.
+		//!
+		//! @param [in] time the duration of the frame, in ms
+		void add(double time);
+
+		//! \brief Record the duration of a given frame, for series with
+		//!        gaps, e.g. GPU timings of frames that were dropped.
+		//!
+		//! @param [in] frame index of the frame; it has to be greater than
+		//!                   that of the last frame recorded
+		//! @param [in] time the duration of the frame, in ms
+		void add(size_t frame, double time);
+
+		//! \brief Get the number of frames recorded.
+		size_t get_frames_nb() const;
+
+		//! \brief Compute the statistics of the frames recorded; the
+		//!        percentiles use the nearest rank.
+		summary summarise() const;
+
+		//! \brief Log the statistics of the frames recorded.
+		//!
+		//! @param [in] label what was timed, e.g. the name of a benchmark
+		void log(std::string const& label) const;
+
+		//! \brief Write several series side by side, one row per frame
+		//!        and one column per series; frames missing from a series
+		//!        leave their cells empty.
+		//!
+		//! @param [in] path file to write
+		//! @param [in] columns name and timings of each series
+		//! @return whether the file could be written
+		static bool dump_csv(std::string const& path,
+		                     std::vector<std::pair<std::string, FrameTimings const*>> const& columns);
+
+	private:
+		std::vector<double> _times;
+		std::vector<size_t> _frames; //!< index of the frame of each time
+	};
+}
@@ -0,0 +1,257 @@
+#include "geometry_arena.hpp"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	// Pools start large enough for a few typical meshes, and then double.
+	constexpr size_t min_vertices_capacity = 1u << 16u;
+	constexpr size_t min_indices_capacity = 1u << 18u;
+
+	// Give `bo` a capacity of `capacity` bytes, keeping its first `used`
+	// bytes and its name, so that vertex arrays referencing it stay valid.
+	void
+	grow_buffer(GLuint bo, size_t used, size_t capacity)
+	{
+		GLuint scratch = 0u;
+		if (used > 0u) {
+			glGenBuffers(1, &scratch);
+			assert(scratch != 0u);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+			glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(used), nullptr, GL_STATIC_COPY);
+			glBindBuffer(GL_COPY_READ_BUFFER, bo);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(used));
+		}
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, bo);
+		glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr, GL_STATIC_DRAW);
+
+		if (used > 0u) {
+			glBindBuffer(GL_COPY_READ_BUFFER, scratch);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(used));
+			glDeleteBuffers(1, &scratch);
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+	}
+
+	bool
+	have_same_attributes(std::vector<bonobo::packed_vertices::attribute> const& lhs,
+	                     std::vector<bonobo::packed_vertices::attribute> const& rhs)
+	{
+		return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+		                  [](bonobo::packed_vertices::attribute const& a, bonobo::packed_vertices::attribute const& b){
+			return a.binding == b.binding && a.components_nb == b.components_nb
+			    && a.type == b.type && a.normalized == b.normalized;
+		});
+	}
+}
+
+bonobo::GeometryArena::GeometryArena() : _pools()
+{
+}
+
+bonobo::GeometryArena::~GeometryArena()
+{
+	for (auto& p : _pools) {
+		for (auto& s : p.streams)
+			glDeleteBuffers(1, &s.bo);
+		glDeleteBuffers(1, &p.positions_bo);
+		glDeleteBuffers(1, &p.ibo);
+		glDeleteVertexArrays(1, &p.depth_vao);
+		glDeleteVertexArrays(1, &p.vao);
+	}
+	_pools.clear();
+}
+
+bonobo::mesh_data
+bonobo::GeometryArena::add(vertex_streams const& streams, GLuint const* indices, size_t indices_nb, vertex_format const& format, GLenum drawing_mode)
+{
+	auto const vertices = bonobo::pack_vertices(streams, format);
+	return add(vertices, vertices.data.data(), streams.vertices, indices, indices_nb, format, drawing_mode);
+}
+
+bonobo::mesh_data
+bonobo::GeometryArena::add(packed_vertices const& layout, void const* vertex_data, glm::vec3 const* positions, GLuint const* indices, size_t indices_nb, vertex_format const& format, GLenum drawing_mode)
+{
+	bonobo::mesh_data data;
+	if (layout.vertices_nb == 0u) {
+		LogWarning("Skipping a mesh without any vertices.");
+		return data;
+	}
+
+	auto& p = get_pool(layout, format);
+	reserve(p, p.vertices_nb + layout.vertices_nb, p.indices_nb + indices_nb);
+
+	data.vao = p.vao;
+	data.depth_vao = p.depth_vao;
+	data.bo = p.streams.front().bo;
+	data.ibo = p.ibo;
+	data.vertices_nb = layout.vertices_nb;
+	data.indices_nb = indices_nb;
+	data.base_vertex = static_cast<GLint>(p.vertices_nb);
+	data.first_index = p.indices_nb;
+	data.drawing_mode = drawing_mode;
+	data.bounds = bonobo::compute_bounding_volume(positions, layout.vertices_nb);
+	data.format = format;
+
+	// Planar vertices hold one stream per attribute, in the order of the
+	// pool's streams; interleaved ones are a single stream.
+	for (size_t i = 0u; i < p.streams.size(); ++i) {
+		auto const& s = p.streams[i];
+		auto const source_offset = p.streams.size() > 1u ? layout.attributes[i].offset : 0u;
+		glBindBuffer(GL_COPY_WRITE_BUFFER, s.bo);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(p.vertices_nb * s.element_size),
+		                static_cast<GLsizeiptr>(layout.vertices_nb * s.element_size),
+		                reinterpret_cast<GLvoid const*>(static_cast<u8 const*>(vertex_data) + source_offset));
+	}
+	if (p.positions_bo != 0u) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, p.positions_bo);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(p.vertices_nb * sizeof(glm::vec3)),
+		                static_cast<GLsizeiptr>(layout.vertices_nb * sizeof(glm::vec3)),
+		                reinterpret_cast<GLvoid const*>(positions));
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, p.ibo);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(p.indices_nb * sizeof(GLuint)),
+	                static_cast<GLsizeiptr>(indices_nb * sizeof(GLuint)), reinterpret_cast<GLvoid const*>(indices));
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+
+	p.vertices_nb += layout.vertices_nb;
+	p.indices_nb += indices_nb;
+	++p.meshes_nb;
+
+	return data;
+}
+
+bonobo::GeometryArena::stats
+bonobo::GeometryArena::get_stats() const
+{
+	stats s = {};
+	s.pools = _pools.size();
+	for (auto const& p : _pools) {
+		s.meshes += p.meshes_nb;
+		s.vertices_nb += p.vertices_nb;
+		s.indices_nb += p.indices_nb;
+		for (auto const& st : p.streams)
+			s.vertex_bytes += p.vertices_nb * st.element_size;
+		if (p.positions_bo != 0u)
+			s.vertex_bytes += p.vertices_nb * sizeof(glm::vec3);
+		s.index_bytes += p.indices_nb * sizeof(GLuint);
+	}
+	return s;
+}
+
+bonobo::GeometryArena::pool&
+bonobo::GeometryArena::get_pool(packed_vertices const& vertices, vertex_format const& format)
+{
+	for (auto& p : _pools)
+		if (p.format == format && have_same_attributes(p.attributes, vertices.attributes))
+			return p;
+
+	_pools.emplace_back();
+	auto& p = _pools.back();
+	p.format = format;
+	p.attributes = vertices.attributes;
+	create_pool(p, vertices);
+	LogInfo("Created a geometry pool for the %s format, with %u attributes.", format.get_name().c_str(),
+	        static_cast<unsigned int>(vertices.attributes.size()));
+	return p;
+}
+
+void
+bonobo::GeometryArena::create_pool(pool& p, packed_vertices const& vertices)
+{
+	p.vao = 0u;
+	p.depth_vao = 0u;
+	p.positions_bo = 0u;
+	p.ibo = 0u;
+	p.vertices_nb = 0u;
+	p.vertices_capacity = 0u;
+	p.indices_nb = 0u;
+	p.indices_capacity = 0u;
+	p.meshes_nb = 0u;
+
+	glGenVertexArrays(1, &p.vao);
+	assert(p.vao != 0u);
+	glBindVertexArray(p.vao);
+
+	auto const create_stream = [&p](size_t element_size){
+		stream s = { 0u, element_size };
+		glGenBuffers(1, &s.bo);
+		assert(s.bo != 0u);
+		glBindBuffer(GL_ARRAY_BUFFER, s.bo);
+		p.streams.push_back(s);
+	};
+
+	if (p.format.arrangement == vertex_format::layout::interleaved) {
+		create_stream(vertices.vertex_size);
+		bonobo::set_vertex_attributes(vertices);
+	} else {
+		// Each planar stream spans from its offset to the next one's.
+		auto const vertices_nb = vertices.vertices_nb;
+		for (size_t i = 0u; i < vertices.attributes.size(); ++i) {
+			auto const& attribute = vertices.attributes[i];
+			auto const end = i + 1u < vertices.attributes.size() ? vertices.attributes[i + 1u].offset : vertices.vertex_size * vertices_nb;
+			create_stream((end - attribute.offset) / vertices_nb);
+
+			auto const location = static_cast<unsigned int>(attribute.binding);
+			glEnableVertexAttribArray(location);
+			glVertexAttribPointer(location, attribute.components_nb, attribute.type, attribute.normalized,
+			                      0, reinterpret_cast<GLvoid const*>(0x0));
+		}
+	}
+
+	glGenBuffers(1, &p.ibo);
+	assert(p.ibo != 0u);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, p.ibo);
+
+	// The depth-only vertex array reads the positions from their own
+	// planar stream, or from a copy of them for interleaved pools.
+	glGenVertexArrays(1, &p.depth_vao);
+	assert(p.depth_vao != 0u);
+	glBindVertexArray(p.depth_vao);
+	auto const location = static_cast<unsigned int>(shader_bindings::vertices);
+	if (p.format.arrangement == vertex_format::layout::interleaved) {
+		glGenBuffers(1, &p.positions_bo);
+		assert(p.positions_bo != 0u);
+		glBindBuffer(GL_ARRAY_BUFFER, p.positions_bo);
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
+	} else {
+		for (size_t i = 0u; i < vertices.attributes.size(); ++i) {
+			auto const& attribute = vertices.attributes[i];
+			if (attribute.binding != shader_bindings::vertices)
+				continue;
+			glBindBuffer(GL_ARRAY_BUFFER, p.streams[i].bo);
+			glEnableVertexAttribArray(location);
+			glVertexAttribPointer(location, attribute.components_nb, attribute.type, attribute.normalized,
+			                      0, reinterpret_cast<GLvoid const*>(0x0));
+		}
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, p.ibo);
+
+	glBindVertexArray(0u);
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+}
+
+void
+bonobo::GeometryArena::reserve(pool& p, size_t vertices_nb, size_t indices_nb)
+{
+	if (vertices_nb > p.vertices_capacity) {
+		auto const capacity = std::max({ vertices_nb, 2u * p.vertices_capacity, min_vertices_capacity });
+		for (auto const& s : p.streams)
+			grow_buffer(s.bo, p.vertices_nb * s.element_size, capacity * s.element_size);
+		if (p.positions_bo != 0u)
+			grow_buffer(p.positions_bo, p.vertices_nb * sizeof(glm::vec3), capacity * sizeof(glm::vec3));
+		p.vertices_capacity = capacity;
+	}
+	if (indices_nb > p.indices_capacity) {
+		auto const capacity = std::max({ indices_nb, 2u * p.indices_capacity, min_indices_capacity });
+		grow_buffer(p.ibo, p.indices_nb * sizeof(GLuint), capacity * sizeof(GLuint));
+		p.indices_capacity = capacity;
+	}
+}
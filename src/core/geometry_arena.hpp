@@ -0,0 +1,108 @@
+#pragma once
+
+#include "helpers.hpp"
+#include "vertex_format.hpp"
+
+#include "external/glad/glad.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Vertex and index buffers shared by many static meshes.
+	//!
+	//! Meshes are suballocated from pools, one per vertex format and set
+	//! of attributes; all meshes of a pool share its vertex array, so that
+	//! drawing them one after the other needs no rebinding, and runs of
+	//! them can be drawn with a single `glMultiDrawElementsBaseVertex()`.
+	//! Each `mesh_data` records where its vertices and indices start
+	//! within the pool, in `base_vertex` and `first_index`.
+	//!
+	//! Planar pools keep one buffer object per attribute, so that the
+	//! attributes of a vertex stay at the same index whatever the mesh.
+	//! Each pool also has a second vertex array, `mesh_data::depth_vao`,
+	//! reading only positions from a tightly packed stream, for depth-only
+	//! passes: planar pools already have one, interleaved pools keep a
+	//! copy of the positions next to their vertices.
+	//! Buffer objects grow by copying their content into larger storage,
+	//! and keep their name while doing so: the `bo` and `ibo` of the meshes
+	//! stay valid, but belong to the arena.
+	class GeometryArena
+	{
+	public:
+		//! \brief Sizes of the arena, summed over all pools.
+		struct stats {
+			size_t pools;
+			size_t meshes;
+			size_t vertices_nb;
+			size_t indices_nb;
+			size_t vertex_bytes;
+			size_t index_bytes;
+		};
+
+		//! \brief Default constructor; no OpenGL object is created until
+		//!        the first mesh is added.
+		GeometryArena();
+
+		//! \brief Release the vertex arrays and buffer objects of all
+		//!        pools.
+		~GeometryArena();
+
+		GeometryArena(GeometryArena const&) = delete;
+		GeometryArena& operator=(GeometryArena const&) = delete;
+
+		//! \brief Upload a mesh into the pool of its vertex format.
+		//!
+		//! Same parameters as `bonobo::createMesh()`.
+		//! @return the filled in `mesh_data`, without any texture bindings
+		mesh_data add(vertex_streams const& streams, GLuint const* indices,
+		              size_t indices_nb,
+		              vertex_format const& format = vertex_format::planar(),
+		              GLenum drawing_mode = GL_TRIANGLES);
+
+		//! \brief Upload vertices that were packed ahead of time into the
+		//!        pool of their vertex format.
+		//!
+		//! Same parameters as the equivalent `bonobo::createMesh()`.
+		//! @return the filled in `mesh_data`, without any texture bindings
+		mesh_data add(packed_vertices const& layout, void const* vertex_data,
+		              glm::vec3 const* positions, GLuint const* indices,
+		              size_t indices_nb, vertex_format const& format,
+		              GLenum drawing_mode = GL_TRIANGLES);
+
+		//! \brief Get the sizes of the arena.
+		stats get_stats() const;
+
+	private:
+		//! \brief One buffer object of a pool, holding elements of a fixed
+		//!        size: a single attribute when planar, whole vertices
+		//!        when interleaved.
+		struct stream {
+			GLuint bo;
+			size_t element_size; //!< in bytes
+		};
+
+		struct pool {
+			vertex_format format;
+			std::vector<packed_vertices::attribute> attributes;
+			std::vector<stream> streams;
+			GLuint vao;
+			GLuint depth_vao;
+			GLuint positions_bo; //!< copy of the positions, only for
+			                     //!< interleaved pools
+			GLuint ibo;
+			size_t vertices_nb;
+			size_t vertices_capacity;
+			size_t indices_nb;
+			size_t indices_capacity;
+			size_t meshes_nb;
+		};
+
+		pool& get_pool(packed_vertices const& vertices, vertex_format const& format);
+		void create_pool(pool& p, packed_vertices const& vertices);
+		void reserve(pool& p, size_t vertices_nb, size_t indices_nb);
+
+		std::vector<pool> _pools;
+	};
+}
@@ -0,0 +1,287 @@
+#include "gpu_profiler.hpp"
+
+#include "Log.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cstdio>
+#include <fstream>
+#include <set>
+
+constexpr size_t bonobo::GPUProfiler::frames_nb;
+constexpr size_t bonobo::GPUProfiler::history_nb;
+
+bonobo::GPUProfiler::scope::scope(GPUProfiler& profiler, char const* name) : _profiler(profiler)
+{
+	_profiler.push(name);
+}
+
+bonobo::GPUProfiler::scope::~scope()
+{
+	_profiler.pop();
+}
+
+bonobo::GPUProfiler::GPUProfiler() : _frames(), _current(0u), _frame_id(0u), _open(), _scopes(), _scopes_by_path(), _resolved_times(), _frame_times(), _frame_ids(), _frame_samples_nb(0u), _resolved_frame(0u), _has_resolved(false), _dropped_frames(0u)
+{
+	for (auto& f : _frames) {
+		f.id = 0u;
+		f.issued = false;
+		f.queries_nb = 0u;
+		f.frame_end = 0u;
+	}
+}
+
+bonobo::GPUProfiler::~GPUProfiler()
+{
+	for (auto const& f : _frames)
+		if (!f.queries.empty())
+			glDeleteQueries(static_cast<GLsizei>(f.queries.size()), f.queries.data());
+}
+
+void
+bonobo::GPUProfiler::begin_frame()
+{
+	_current = (_current + 1u) % frames_nb;
+	auto& f = _frames[_current];
+
+	_has_resolved = false;
+	if (f.issued)
+		resolve(f);
+
+	f.id = _frame_id++;
+	f.issued = false;
+	f.queries_nb = 0u;
+	f.scopes.clear();
+	_open.clear();
+	issue_timestamp(f);
+}
+
+void
+bonobo::GPUProfiler::end_frame()
+{
+	assert(_open.empty());
+	auto& f = _frames[_current];
+	f.frame_end = issue_timestamp(f);
+	f.issued = true;
+}
+
+void
+bonobo::GPUProfiler::push(char const* name)
+{
+	auto& f = _frames[_current];
+	auto const path = _open.empty() ? std::string(name)
+	                                : _scopes[f.scopes[_open.back()].stats].path + "/" + name;
+
+	timed_scope s;
+	s.stats = find_or_add(path, name, _open.size());
+	s.begin = issue_timestamp(f);
+	s.end = s.begin;
+	f.scopes.push_back(s);
+	_open.push_back(f.scopes.size() - 1u);
+}
+
+void
+bonobo::GPUProfiler::pop()
+{
+	assert(!_open.empty());
+	auto& f = _frames[_current];
+	f.scopes[_open.back()].end = issue_timestamp(f);
+	_open.pop_back();
+}
+
+float
+bonobo::GPUProfiler::get_resolved_time(std::string const& path) const
+{
+	auto const stats = find(path);
+	if (!_has_resolved || stats == nullptr || stats->samples_nb == 0u
+	    || stats->frames[(stats->samples_nb - 1u) % history_nb] != _resolved_frame)
+		return -1.0f;
+	return stats->last;
+}
+
+float
+bonobo::GPUProfiler::get_resolved_frame_time() const
+{
+	if (!_has_resolved)
+		return -1.0f;
+	return _frame_times[(_frame_samples_nb - 1u) % history_nb];
+}
+
+u64
+bonobo::GPUProfiler::get_frame_id() const
+{
+	return _frames[_current].id;
+}
+
+u64
+bonobo::GPUProfiler::get_resolved_frame_id() const
+{
+	return _resolved_frame;
+}
+
+bonobo::GPUProfiler::scope_stats const*
+bonobo::GPUProfiler::find(std::string const& path) const
+{
+	auto const it = _scopes_by_path.find(path);
+	return it != _scopes_by_path.end() ? &_scopes[it->second] : nullptr;
+}
+
+void
+bonobo::GPUProfiler::render_ui()
+{
+	bool const opened = ImGui::Begin("GPU Profiler", nullptr, ImVec2(420, 300), -1.0f, 0);
+	if (opened) {
+		auto const count = std::min(_frame_samples_nb, history_nb);
+		auto total = 0.0f;
+		for (size_t i = 0u; i < count; ++i)
+			total += _frame_times[i];
+		char overlay[64];
+		snprintf(overlay, sizeof(overlay), "Frame: %.3f ms on average", count > 0u ? total / static_cast<float>(count) : 0.0f);
+		ImGui::PlotLines("", _frame_times.data(), static_cast<int>(history_nb), static_cast<int>(_frame_samples_nb % history_nb),
+		                 overlay, 0.0f, FLT_MAX, ImVec2(0, 60));
+		ImGui::Text("%zu frames dropped, as their queries were not ready in time", _dropped_frames);
+
+		for (auto const& s : _scopes)
+			ImGui::Text("%*s%-*s avg %7.3f  min %7.3f  max %7.3f ms", static_cast<int>(2u * s.depth), "",
+			            static_cast<int>(24u - std::min<size_t>(2u * s.depth, 20u)), s.name.c_str(), s.average, s.min, s.max);
+
+		if (ImGui::Button("Dump to CSV")) {
+			if (dump_csv("gpu_profile.csv"))
+				LogInfo("GPU timings written to \"gpu_profile.csv\"");
+			else
+				LogError("Failed to write \"gpu_profile.csv\"");
+		}
+	}
+	ImGui::End();
+}
+
+bool
+bonobo::GPUProfiler::dump_csv(std::string const& path) const
+{
+	std::ofstream stream(path, std::ios::trunc);
+	if (!stream.is_open())
+		return false;
+
+	stream << "frame,total";
+	for (auto const& s : _scopes)
+		stream << "," << s.path;
+	stream << "\n";
+
+	std::set<u64> frame_ids;
+	auto const frames_count = std::min(_frame_samples_nb, history_nb);
+	for (size_t i = 0u; i < frames_count; ++i)
+		frame_ids.insert(_frame_ids[i]);
+
+	for (auto const id : frame_ids) {
+		stream << id << ",";
+		for (size_t i = 0u; i < frames_count; ++i)
+			if (_frame_ids[i] == id)
+				stream << _frame_times[i];
+		for (auto const& s : _scopes) {
+			stream << ",";
+			auto const count = std::min(s.samples_nb, history_nb);
+			for (size_t i = 0u; i < count; ++i)
+				if (s.frames[i] == id)
+					stream << s.times[i];
+		}
+		stream << "\n";
+	}
+
+	return stream.good();
+}
+
+size_t
+bonobo::GPUProfiler::issue_timestamp(frame& f)
+{
+	if (f.queries_nb == f.queries.size()) {
+		GLuint query = 0u;
+		glGenQueries(1, &query);
+		assert(query != 0u);
+		f.queries.push_back(query);
+	}
+	glQueryCounter(f.queries[f.queries_nb], GL_TIMESTAMP);
+	return f.queries_nb++;
+}
+
+size_t
+bonobo::GPUProfiler::find_or_add(std::string const& path, char const* name, size_t depth)
+{
+	auto const it = _scopes_by_path.find(path);
+	if (it != _scopes_by_path.end())
+		return it->second;
+
+	scope_stats stats;
+	stats.path = path;
+	stats.name = name;
+	stats.depth = depth;
+	stats.times.fill(0.0f);
+	stats.frames.fill(0u);
+	stats.samples_nb = 0u;
+	stats.last = stats.average = stats.min = stats.max = 0.0f;
+	_scopes.push_back(stats);
+	_scopes_by_path.emplace(path, _scopes.size() - 1u);
+	return _scopes.size() - 1u;
+}
+
+// Timestamps complete in the order they were issued, so once the last one
+// of the frame is available, reading the others does not wait.
+void
+bonobo::GPUProfiler::resolve(frame& f)
+{
+	GLint available = 0;
+	glGetQueryObjectiv(f.queries[f.frame_end], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == 0) {
+		++_dropped_frames;
+		return;
+	}
+
+	auto const timestamp = [&f](size_t query){
+		GLuint64 time = 0u;
+		glGetQueryObjectui64v(f.queries[query], GL_QUERY_RESULT, &time);
+		return time;
+	};
+	auto const elapsed = [&timestamp](size_t begin, size_t end){
+		auto const begin_time = timestamp(begin);
+		auto const end_time = timestamp(end);
+		return end_time > begin_time ? static_cast<float>(static_cast<double>(end_time - begin_time) / 1000000.0) : 0.0f;
+	};
+
+	auto const sample = _frame_samples_nb++ % history_nb;
+	_frame_times[sample] = elapsed(0u, f.frame_end);
+	_frame_ids[sample] = f.id;
+
+	_resolved_times.assign(_scopes.size(), -1.0f);
+	for (auto const& s : f.scopes) {
+		auto& time = _resolved_times[s.stats];
+		time = std::max(time, 0.0f) + elapsed(s.begin, s.end);
+	}
+	for (size_t i = 0u; i < _scopes.size(); ++i)
+		if (_resolved_times[i] >= 0.0f)
+			add_sample(_scopes[i], _resolved_times[i], f.id);
+
+	_resolved_frame = f.id;
+	_has_resolved = true;
+}
+
+void
+bonobo::GPUProfiler::add_sample(scope_stats& stats, float time, u64 frame_id)
+{
+	auto const sample = stats.samples_nb++ % history_nb;
+	stats.times[sample] = time;
+	stats.frames[sample] = frame_id;
+	stats.last = time;
+
+	auto const count = std::min(stats.samples_nb, history_nb);
+	stats.min = FLT_MAX;
+	stats.max = 0.0f;
+	auto total = 0.0f;
+	for (size_t i = 0u; i < count; ++i) {
+		stats.min = std::min(stats.min, stats.times[i]);
+		stats.max = std::max(stats.max, stats.times[i]);
+		total += stats.times[i];
+	}
+	stats.average = total / static_cast<float>(count);
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Types.h"
+
+#include "external/glad/glad.h"
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief GPU timings of nested scopes, such as render passes.
+	//!
+	//! Each scope is bracketed by two `GL_TIMESTAMP` queries, which unlike
+	//! `GL_TIME_ELAPSED` ones can be nested. The queries of a frame are
+	//! only read back `frames_nb` frames later, when their ring slot is
+	//! reused by `begin_frame()`; if they are still not available, that
+	//! frame is dropped rather than waited for, so the profiler never
+	//! stalls the CPU.
+	//!
+	//! Scopes are identified by their path, e.g. "Shadows/Light 0"; scopes
+	//! opened several times with the same path during a frame are summed.
+	class GPUProfiler
+	{
+	public:
+		//! \brief Frames of latency between issuing and reading queries.
+		static constexpr size_t frames_nb = 3;
+
+		//! \brief Samples kept per scope, for the averages and graphs.
+		static constexpr size_t history_nb = 128;
+
+		//! \brief Timings of a scope over the last `history_nb` frames
+		//!        it was seen in, all in ms.
+		struct scope_stats {
+			std::string path;
+			std::string name;
+			size_t depth;
+			std::array<float, history_nb> times;
+			std::array<u64, history_nb> frames; //!< frame of each sample
+			size_t samples_nb;
+			float last;
+			float average;
+			float min;
+			float max;
+		};
+
+		//! \brief Time a scope until the marker is destroyed.
+		class scope
+		{
+		public:
+			scope(GPUProfiler& profiler, char const* name);
+			~scope();
+
+			scope(scope const&) = delete;
+			scope& operator=(scope const&) = delete;
+
+		private:
+			GPUProfiler& _profiler;
+		};
+
+		GPUProfiler();
+		~GPUProfiler();
+
+		GPUProfiler(GPUProfiler const&) = delete;
+		GPUProfiler& operator=(GPUProfiler const&) = delete;
+
+		//! \brief Read back the oldest frame in flight, if available, then
+		//!        start timing a new frame.
+		void begin_frame();
+
+		//! \brief Stop timing the current frame; all its scopes must have
+		//!        been closed.
+		void end_frame();
+
+		//! \brief Open a scope, nested within the currently open one.
+		void push(char const* name);
+
+		//! \brief Close the last scope opened.
+		void pop();
+
+		//! \brief Get the time of a scope in the frame read back by the
+		//!        last `begin_frame()`.
+		//!
+		//! @return the time in ms, or a negative value if no frame was
+		//!         read back or the scope was not part of it
+		float get_resolved_time(std::string const& path) const;
+
+		//! \brief Get the GPU time of the whole frame read back by the
+		//!        last `begin_frame()`.
+		//!
+		//! @return the time in ms, or a negative value if no frame was
+		//!         read back
+		float get_resolved_frame_time() const;
+
+		//! \brief Get the identifier of the frame started by the last
+		//!        `begin_frame()`; frames are numbered from 0.
+		u64 get_frame_id() const;
+
+		//! \brief Get the identifier of the frame read back by the last
+		//!        `begin_frame()`; only meaningful if
+		//!        `get_resolved_frame_time()` is not negative.
+		u64 get_resolved_frame_id() const;
+
+		//! \brief Get the timings of a scope, or nullptr if never seen.
+		scope_stats const* find(std::string const& path) const;
+
+		//! \brief Show the average, min and max of each scope, and a graph
+		//!        of the GPU time of the frames, in an ImGui window.
+		void render_ui();
+
+		//! \brief Write the time of each scope in the frames kept, one row
+		//!        per frame and one column per scope.
+		//!
+		//! @return whether the file could be written
+		bool dump_csv(std::string const& path) const;
+
+	private:
+		struct timed_scope {
+			size_t stats;         // index in `_scopes`
+			size_t begin, end;    // indices of the queries in the frame
+		};
+
+		struct frame {
+			u64 id;
+			bool issued;
+			std::vector<GLuint> queries;
+			size_t queries_nb;    // used this frame; the first one marks
+			size_t frame_end;     // the start of the frame, this one its end
+			std::vector<timed_scope> scopes;
+		};
+
+		size_t issue_timestamp(frame& f);
+		size_t find_or_add(std::string const& path, char const* name, size_t depth);
+		void resolve(frame& f);
+		void add_sample(scope_stats& stats, float time, u64 frame_id);
+
+		std::array<frame, frames_nb> _frames;
+		size_t _current;
+		u64 _frame_id;
+		std::vector<size_t> _open;   // indices in `_frames[_current].scopes`
+
+		std::vector<scope_stats> _scopes; // in the order they were first seen
+		std::unordered_map<std::string, size_t> _scopes_by_path;
+		std::vector<float> _resolved_times; // per scope, scratch space
+
+		std::array<float, history_nb> _frame_times;
+		std::array<u64, history_nb> _frame_ids;
+		size_t _frame_samples_nb;
+		u64 _resolved_frame;
+		bool _has_resolved;
+		size_t _dropped_frames;
+	};
+}
@@ -1,23 +1,68 @@
 #include "config.hpp"
 #include "helpers.hpp"
 
+#include "core/dds.hpp"
+#include "core/geometry_arena.hpp"
 #include "core/Log.h"
+#include "core/mesh_cache.hpp"
 #include "core/Misc.h"
 #include "core/opengl.hpp"
+#include "core/Profiler.h"
+#include "core/texture_loader.hpp"
+#include "core/uniform_buffer.hpp"
 #include "core/various.hpp"
 #include "external/lodepng.h"
 
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
 #include <glm/gtc/type_ptr.hpp>
 
 #include <cassert>
+#include <sstream>
 
 namespace local
 {
 	static GLuint fullscreen_shader;
 	static GLuint display_vao;
+
+	static bonobo::TextureLoader& texture_loader()
+	{
+		static bonobo::TextureLoader loader;
+		return loader;
+	}
+
+	// glTexImage2D() validates the pixel transfer format and type against
+	// the internal format, even when no data is given.
+	struct texel_format {
+		GLint internal_format;
+		GLenum format;
+		GLenum type;
+		size_t size; // in bytes
+	};
+
+	static texel_format const texel_formats[] = {
+		{ GL_R8,                 GL_RED,             GL_UNSIGNED_BYTE,                 1u },
+		{ GL_RG8,                GL_RG,              GL_UNSIGNED_BYTE,                 2u },
+		{ GL_RGBA8,              GL_RGBA,            GL_UNSIGNED_BYTE,                 4u },
+		{ GL_RGBA,               GL_RGBA,            GL_UNSIGNED_BYTE,                 4u },
+		{ GL_RGB10_A2,           GL_RGBA,            GL_UNSIGNED_INT_2_10_10_10_REV,   4u },
+		{ GL_R16F,               GL_RED,             GL_HALF_FLOAT,                    2u },
+		{ GL_RG16F,              GL_RG,              GL_HALF_FLOAT,                    4u },
+		{ GL_RGBA16F,            GL_RGBA,            GL_HALF_FLOAT,                    8u },
+		{ GL_R11F_G11F_B10F,     GL_RGB,             GL_UNSIGNED_INT_10F_11F_11F_REV,  4u },
+		{ GL_R32F,               GL_RED,             GL_FLOAT,                         4u },
+		{ GL_RG32F,              GL_RG,              GL_FLOAT,                         8u },
+		{ GL_RGBA32F,            GL_RGBA,            GL_FLOAT,                        16u },
+		{ GL_DEPTH_COMPONENT24,  GL_DEPTH_COMPONENT, GL_UNSIGNED_INT,                  4u },
+		{ GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT,                         4u },
+		{ GL_DEPTH24_STENCIL8,   GL_DEPTH_STENCIL,   GL_UNSIGNED_INT_24_8,             4u }
+	};
+
+	static texel_format const* find_texel_format(GLint internal_format)
+	{
+		for (auto const& texel : texel_formats)
+			if (texel.internal_format == internal_format)
+				return &texel;
+		return nullptr;
+	}
 }
 
 void
@@ -56,173 +101,172 @@ getTextureData(std::string const& filename, u32& width, u32& height, bool flip)
 	return flipBuffer;
 }
 
-std::vector<bonobo::mesh_data>
-bonobo::loadObjects(std::string const& filename)
+static bonobo::mesh_data
+createObject(bonobo::mesh_cache::mesh_entry const& mesh, std::vector<bonobo::texture_bindings> const& materials_bindings, std::vector<std::vector<bonobo::TextureCache::handle>> const& materials_textures, bonobo::vertex_format const& format, bonobo::GeometryArena* arena)
 {
-	std::vector<bonobo::mesh_data> objects;
-
-	auto const scene_filepath = config::resources_path("scenes/" + filename);
-	LogInfo("Loading \"%s\"", scene_filepath.c_str());
-	Assimp::Importer importer;
-	auto const assimp_scene = importer.ReadFile(scene_filepath, aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_CalcTangentSpace);
-	if (assimp_scene == nullptr || assimp_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || assimp_scene->mRootNode == nullptr) {
-		LogError("Assimp failed to load \"%s\": %s", scene_filepath.c_str(), importer.GetErrorString());
-		return objects;
+	// The vertices were packed in `format` when the cache was written, and
+	// are uploaded straight from it.
+	auto const layout = bonobo::mesh_cache::get_packed_layout(mesh, format);
+	auto object = arena != nullptr ? arena->add(layout, mesh.vertex_data, mesh.positions, mesh.indices, mesh.indices_nb, format)
+	                               : bonobo::createMesh(layout, mesh.vertex_data, mesh.positions, mesh.indices, mesh.indices_nb, format);
+	object.bounds = mesh.bounds;
+
+	if (mesh.material_id >= materials_bindings.size()) {
+		LogError("Object has a material index of %u, but only %u materials were retrieved.", mesh.material_id, materials_bindings.size());
+	} else {
+		object.bindings = materials_bindings[mesh.material_id];
+		object.textures = materials_textures[mesh.material_id];
 	}
 
-	if (assimp_scene->mNumMeshes == 0u) {
-		LogError("No mesh available; loading \"%s\" must have had issues", scene_filepath.c_str());
-		return objects;
-	}
+	return object;
+}
 
-	std::vector<texture_bindings> materials_bindings;
-	materials_bindings.reserve(assimp_scene->mNumMaterials);
+static glm::vec4
+getPlaceholderColour(std::string const& sampler_name)
+{
+	if (sampler_name == "normals_texture")
+		return glm::vec4(0.5f, 0.5f, 1.0f, 1.0f);
+	if (sampler_name == "specular_texture")
+		return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	if (sampler_name == "opacity_texture")
+		return glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+	return glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+}
 
+static std::vector<bonobo::mesh_data>
+createObjects(std::vector<bonobo::mesh_cache::material_entry> const& materials, std::vector<bonobo::mesh_cache::mesh_entry> const& meshes, bool wait_for_textures, bonobo::vertex_format const& format, bonobo::GeometryArena* arena, bonobo::TextureCache* texture_cache)
+{
+	// Textures are decoded in the background while the meshes are being
+	// uploaded.
 	LogInfo("\t* materials");
-	for (size_t i = 0; i < assimp_scene->mNumMaterials; ++i) {
-		texture_bindings bindings;
-		auto const material = assimp_scene->mMaterials[i];
-
-		auto const process_texture = [&bindings,&material,i](aiTextureType type, std::string const& type_as_str, std::string const& name){
-			if (material->GetTextureCount(type)) {
-				if (material->GetTextureCount(type) > 1)
-					LogWarning("Material %d has more than one %s texture: discarding all but the first one.", i, type_as_str.c_str());
-				aiString path;
-				material->GetTexture(type, 0, &path);
-				auto const id = bonobo::loadTexture2D("../crysponza/" + std::string(path.C_Str()), type_as_str != "opacity");
-				if (id != 0u)
-					bindings.emplace(name, id);
+	auto& loader = local::texture_loader();
+	std::vector<bonobo::texture_bindings> materials_bindings;
+	std::vector<std::vector<bonobo::TextureCache::handle>> materials_textures(materials.size());
+	materials_bindings.reserve(materials.size());
+	for (size_t i = 0u; i < materials.size(); ++i) {
+		bonobo::texture_bindings bindings;
+		for (auto const& texture : materials[i]) {
+			auto const placeholder = getPlaceholderColour(texture.name);
+			if (texture_cache != nullptr) {
+				auto handle = texture_cache->request_2d(loader, texture.path, texture.generate_mipmap, placeholder);
+				bindings.emplace(texture.name, handle.get());
+				materials_textures[i].push_back(std::move(handle));
+			} else {
+				bindings.emplace(texture.name, loader.request(texture.path, texture.generate_mipmap, placeholder));
 			}
-		};
-
-		process_texture(aiTextureType_DIFFUSE,  "diffuse",  "diffuse_texture");
-		process_texture(aiTextureType_SPECULAR, "specular", "specular_texture");
-		process_texture(aiTextureType_NORMALS,  "normals",  "normals_texture");
-		process_texture(aiTextureType_OPACITY,  "opacity",  "opacity_texture");
-
+		}
 		materials_bindings.push_back(bindings);
 	}
 
 	LogInfo("\t* meshes");
-	objects.reserve(assimp_scene->mNumMeshes);
-	for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
-		auto const assimp_object_mesh = assimp_scene->mMeshes[j];
-
-		if (!assimp_object_mesh->HasFaces()) {
-			LogError("Unsupported object \"%s\": has no faces", assimp_object_mesh->mName.C_Str());
-			continue;
-		}
-		if ((assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_POINT))    != 0u
-		 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_LINE))     != 0u
-		 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_TRIANGLE)) != 0u) {
-			LogError("Unsupported object \"%s\": uses multiple primitive types", assimp_object_mesh->mName.C_Str());
-			continue;
-		}
-		if ((assimp_object_mesh->mPrimitiveTypes & static_cast<uint32_t>(aiPrimitiveType_POLYGON)) == static_cast<uint32_t>(aiPrimitiveType_POLYGON)) {
-			LogError("Unsupported object \"%s\": uses polygons", assimp_object_mesh->mName.C_Str());
-			continue;
-		}
-		if (!assimp_object_mesh->HasPositions()) {
-			LogError("Unsupported object \"%s\": has no positions", assimp_object_mesh->mName.C_Str());
-			continue;
+	std::vector<bonobo::mesh_data> objects;
+	objects.reserve(meshes.size());
+	for (auto const& mesh : meshes)
+		objects.push_back(createObject(mesh, materials_bindings, materials_textures, format, arena));
+
+	if (wait_for_textures) {
+		LogInfo("\t* textures");
+		PROFILE_SCOPE("Wait for textures");
+		loader.wait();
+		if (texture_cache != nullptr)
+			texture_cache->update();
+		for (auto& object : objects) {
+			for (auto it = object.bindings.begin(); it != object.bindings.end();) {
+				if (loader.has_failed(it->second))
+					it = object.bindings.erase(it);
+				else
+					++it;
+			}
 		}
+	}
 
-		bonobo::mesh_data object;
-
-		glGenVertexArrays(1, &object.vao);
-		assert(object.vao != 0u);
-		glBindVertexArray(object.vao);
+	return objects;
+}
 
-		auto const vertices_offset = 0u;
-		auto const vertices_size = static_cast<GLsizeiptr>(assimp_object_mesh->mNumVertices * sizeof(glm::vec3));
+static GLuint
+loadCompressedTexture2D(std::string const& filename, bool generate_mipmap, bool flip)
+{
+	bonobo::dds::texture compressed;
+	if (!bonobo::dds::read(bonobo::dds::get_path(config::resources_path(filename)), compressed)
+	    || compressed.flipped != flip
+	    || !bonobo::dds::is_supported(compressed.block_format))
+		return 0u;
 
-		auto const normals_offset = vertices_size;
-		auto const normals_size = assimp_object_mesh->HasNormals() ? vertices_size : 0u;
+	GLuint texture = 0u;
+	glGenTextures(1, &texture);
+	assert(texture != 0u);
+	bonobo::dds::upload(texture, compressed, generate_mipmap);
 
-		auto const texcoords_offset = normals_offset + normals_size;
-		auto const texcoords_size = assimp_object_mesh->HasTextureCoords(0u) ? vertices_size : 0u;
+	return texture;
+}
 
-		auto const tangents_offset = texcoords_offset + texcoords_size;
-		auto const tangents_size = assimp_object_mesh->HasTangentsAndBitangents() ? vertices_size : 0u;
+std::vector<bonobo::mesh_data>
+bonobo::loadObjects(std::string const& filename, bool wait_for_textures, vertex_format const& format, u32 optimization_stages, GeometryArena* arena, TextureCache* texture_cache)
+{
+	PROFILE_SCOPE("loadObjects");
+	std::vector<bonobo::mesh_data> objects;
 
-		auto const binormals_offset = tangents_offset + tangents_size;
-		auto const binormals_size = assimp_object_mesh->HasTangentsAndBitangents() ? vertices_size : 0u;
+	auto const scene_filepath = config::resources_path("scenes/" + filename);
+	auto const start_time = GetTimeMilliseconds();
 
-		auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-		                                            +normals_size
-		                                            +texcoords_size
-		                                            +tangents_size
-		                                            +binormals_size
-		                                            );
-		glGenBuffers(1, &object.bo);
-		assert(object.bo != 0u);
-		glBindBuffer(GL_ARRAY_BUFFER, object.bo);
-		glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
+	mesh_cache::contents scene;
+	if (!mesh_cache::load(scene_filepath, optimization_stages, format, scene))
+		return objects;
+	auto const scene_time = GetTimeMilliseconds() - start_time;
 
-		glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(assimp_object_mesh->mVertices));
-		glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-		glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
+	objects = createObjects(scene.materials, scene.meshes, wait_for_textures, format, arena, texture_cache);
+	LogInfo("Loaded \"%s\" (%s) in %.3f ms, of which %.3f ms %s", scene_filepath.c_str(), format.get_name().c_str(),
+	        GetTimeMilliseconds() - start_time, scene_time, scene.from_cache ? "reading its mesh cache" : "importing it");
 
-		if (assimp_object_mesh->HasNormals()) {
-			glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(assimp_object_mesh->mNormals));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::normals));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-		}
+	return objects;
+}
 
-		if (assimp_object_mesh->HasTextureCoords(0u)) {
-			glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(assimp_object_mesh->mTextureCoords[0u]));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::texcoords));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
-		}
+bonobo::mesh_data
+bonobo::createMesh(vertex_streams const& streams, GLuint const* indices, size_t indices_nb, vertex_format const& format, GLenum drawing_mode)
+{
+	auto const vertices = bonobo::pack_vertices(streams, format);
+	return createMesh(vertices, vertices.data.data(), streams.vertices, indices, indices_nb, format, drawing_mode);
+}
 
-		if (assimp_object_mesh->HasTangentsAndBitangents()) {
-			glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(assimp_object_mesh->mTangents));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::tangents));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
+bonobo::mesh_data
+bonobo::createMesh(packed_vertices const& layout, void const* vertex_data, glm::vec3 const* positions, GLuint const* indices, size_t indices_nb, vertex_format const& format, GLenum drawing_mode)
+{
+	bonobo::mesh_data data;
+	data.format = format;
+	data.drawing_mode = drawing_mode;
+	data.vertices_nb = layout.vertices_nb;
+	data.indices_nb = indices_nb;
+	data.bounds = bonobo::compute_bounding_volume(positions, layout.vertices_nb);
+
+	glGenVertexArrays(1, &data.vao);
+	assert(data.vao != 0u);
+	glBindVertexArray(data.vao);
+
+	glGenBuffers(1, &data.bo);
+	assert(data.bo != 0u);
+	glBindBuffer(GL_ARRAY_BUFFER, data.bo);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(layout.vertex_size * layout.vertices_nb), vertex_data, GL_STATIC_DRAW);
+	bonobo::set_vertex_attributes(layout);
+
+	glGenBuffers(1, &data.ibo);
+	assert(data.ibo != 0u);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices_nb * sizeof(GLuint)), reinterpret_cast<GLvoid const*>(indices), GL_STATIC_DRAW);
 
-			glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(assimp_object_mesh->mBitangents));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::binormals));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
-		}
+	glBindVertexArray(0u);
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0u);
-
-		auto const num_vertices_per_face = assimp_object_mesh->mFaces[0u].mNumIndices;
-		object.indices_nb = assimp_object_mesh->mNumFaces * num_vertices_per_face;
-		auto object_indices = std::make_unique<GLuint[]>(static_cast<size_t>(object.indices_nb));
-		for (size_t i = 0u; i < assimp_object_mesh->mNumFaces; ++i) {
-			auto const& face = assimp_object_mesh->mFaces[i];
-			assert(face.mNumIndices <= 3);
-			object_indices[num_vertices_per_face * i + 0u] = face.mIndices[0u];
-			if (num_vertices_per_face >= 1u)
-				object_indices[num_vertices_per_face * i + 1u] = face.mIndices[1u];
-			if (num_vertices_per_face >= 2u)
-				object_indices[num_vertices_per_face * i + 2u] = face.mIndices[2u];
-		}
-		glGenBuffers(1, &object.ibo);
-		assert(object.ibo != 0u);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object.ibo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<unsigned int>(object.indices_nb) * sizeof(GL_UNSIGNED_INT), reinterpret_cast<GLvoid const*>(object_indices.get()), GL_STATIC_DRAW);
-		object_indices.reset(nullptr);
-
-		glBindVertexArray(0u);
-		glBindBuffer(GL_ARRAY_BUFFER, 0u);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
-
-		auto const material_id = assimp_object_mesh->mMaterialIndex;
-		if (material_id >= materials_bindings.size())
-			LogError("Object \"%s\" has a material index of %u, but only %u materials were retrieved.", assimp_object_mesh->mName.C_Str(), material_id, materials_bindings.size());
-		else
-			object.bindings = materials_bindings[material_id];
-
-		objects.push_back(object);
-
-//		LogInfo("Loaded object \"%s\" with normals:%d, tangents&bitangents:%d, texcoords:%d",
-//		        assimp_object_mesh->mName.C_Str(), assimp_object_mesh->HasNormals(),
-//		        assimp_object_mesh->HasTangentsAndBitangents(), assimp_object_mesh->HasTextureCoords(0));
-	}
+	return data;
+}
 
-	return objects;
+size_t
+bonobo::updateTextures(size_t max_uploads, TextureCache* texture_cache)
+{
+	auto const uploads_nb = local::texture_loader().upload_ready(max_uploads);
+	if (texture_cache != nullptr && uploads_nb != 0u)
+		texture_cache->update();
+	return uploads_nb;
 }
 
 GLuint
@@ -232,8 +276,8 @@ bonobo::createTexture(uint32_t width, uint32_t height, GLenum target, GLint inte
 	glGenTextures(1, &texture);
 	assert(texture != 0u);
 	glBindTexture(target, texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexImage2D(target, 0, internal_format, static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, format, type, data);
 	glBindTexture(target, 0u);
 
@@ -241,14 +285,50 @@ bonobo::createTexture(uint32_t width, uint32_t height, GLenum target, GLint inte
 }
 
 GLuint
-bonobo::loadTexture2D(std::string const& filename, bool generate_mipmap)
+bonobo::createRenderTarget(uint32_t width, uint32_t height, render_target_desc const& desc)
+{
+	auto const texel = local::find_texel_format(desc.internal_format);
+	if (texel == nullptr) {
+		LogError("Unknown format 0x%x for render target \"%s\"", static_cast<unsigned int>(desc.internal_format), desc.name);
+		return 0u;
+	}
+
+	auto const texture = createTexture(width, height, GL_TEXTURE_2D, desc.internal_format, texel->format, texel->type);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, static_cast<GLint>(desc.filter));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, static_cast<GLint>(desc.filter));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0u);
+
+	return texture;
+}
+
+size_t
+bonobo::getTexelSize(GLint internal_format)
+{
+	auto const texel = local::find_texel_format(internal_format);
+	return texel != nullptr ? texel->size : 0u;
+}
+
+GLuint
+bonobo::loadTexture2D(std::string const& filename, bool generate_mipmap, bool flip, GLint internal_format)
 {
+	PROFILE_SCOPE("loadTexture2D");
+	// Use the block-compressed version of the image when there is one, as
+	// it is smaller and comes with its mip chain.
+	if (internal_format == GL_RGBA) {
+		auto const texture = loadCompressedTexture2D("textures/" + filename, generate_mipmap, flip);
+		if (texture != 0u)
+			return texture;
+	}
+
 	u32 width, height;
-	auto const data = getTextureData("textures/" + filename, width, height, true);
+	auto const data = getTextureData("textures/" + filename, width, height, flip);
 	if (data.empty())
 		return 0u;
 
-	GLuint texture = bonobo::createTexture(width, height, GL_TEXTURE_2D, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(data.data()));
+	GLuint texture = bonobo::createTexture(width, height, GL_TEXTURE_2D, internal_format, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(data.data()));
 	glBindTexture(GL_TEXTURE_2D, texture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, generate_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -265,6 +345,7 @@ bonobo::loadTextureCubeMap(std::string const& posx, std::string const& negx,
                            std::string const& posz, std::string const& negz,
                            bool generate_mipmap)
 {
+	PROFILE_SCOPE("loadTextureCubeMap");
 	GLuint texture = 0u;
 	// Create an OpenGL texture object. Similarly to `glGenVertexArrays()`
 	// and `glGenBuffers()` that were used in assignment 2,
@@ -394,15 +475,54 @@ bonobo::loadTextureCubeMap(std::string const& posx, std::string const& negx,
 	return texture;
 }
 
+// Replace the `#include "path"` lines of a shader by the content of the
+// file, `path` being relative to the `shaders` folder; GLSL 4.10 has no
+// include directive of its own. `#line` directives keep the line numbers
+// of compilation errors meaningful, the included file being reported as
+// source string 1.
+static std::string
+expandIncludes(std::string const& source, unsigned int depth = 0u)
+{
+	auto const directive = std::string("#include");
+	if (source.find(directive) == std::string::npos)
+		return source;
+
+	std::istringstream lines(source);
+	std::string expanded, line;
+	unsigned int line_nb = 0u;
+	while (std::getline(lines, line)) {
+		++line_nb;
+		auto const first = line.find_first_not_of(" \t");
+		auto const open_quote = line.find('"');
+		auto const close_quote = line.rfind('"');
+		if (first == std::string::npos || line.compare(first, directive.size(), directive) != 0
+		    || open_quote == std::string::npos || open_quote == close_quote) {
+			expanded += line + "\n";
+			continue;
+		}
+		if (depth >= 8u) {
+			LogError("Shader includes nested too deeply, skipping \"%s\"", line.c_str());
+			continue;
+		}
+
+		auto const path = line.substr(open_quote + 1u, close_quote - open_quote - 1u);
+		expanded += "#line 1 1\n";
+		expanded += expandIncludes(utils::slurp_file(config::shaders_path(path)), depth + 1u);
+		expanded += "\n#line " + std::to_string(line_nb + 1u) + " 0\n";
+	}
+	return expanded;
+}
+
 GLuint
 bonobo::createProgram(std::string const& vert_shader_source_path, std::string const& frag_shader_source_path)
 {
-	auto const vertex_shader_source = utils::slurp_file(config::shaders_path("EDAF80/" + vert_shader_source_path));
+	PROFILE_SCOPE("createProgram");
+	auto const vertex_shader_source = expandIncludes(utils::slurp_file(config::shaders_path("EDAF80/" + vert_shader_source_path)));
 	GLuint vertex_shader = utils::opengl::shader::generate_shader(GL_VERTEX_SHADER, vertex_shader_source);
 	if (vertex_shader == 0u)
 		return 0u;
 
-	auto const fragment_shader_source = utils::slurp_file(config::shaders_path("EDAF80/" + frag_shader_source_path));
+	auto const fragment_shader_source = expandIncludes(utils::slurp_file(config::shaders_path("EDAF80/" + frag_shader_source_path)));
 	GLuint fragment_shader = utils::opengl::shader::generate_shader(GL_FRAGMENT_SHADER, fragment_shader_source);
 	if (fragment_shader == 0u)
 		return 0u;
@@ -410,6 +530,8 @@ bonobo::createProgram(std::string const& vert_shader_source_path, std::string co
 	GLuint program = utils::opengl::shader::generate_program({ vertex_shader, fragment_shader });
 	glDeleteShader(vertex_shader);
 	glDeleteShader(fragment_shader);
+	if (program != 0u)
+		bind_uniform_blocks(program);
 	return program;
 }
 
@@ -454,6 +576,9 @@ bonobo::createFBO(std::vector<GLuint> const& color_attachments, GLuint depth_att
 			LogError("Failed to attach %u at %u", attachment, attach_point);
 	};
 
+	GLint previous_fbo = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_fbo);
+
 	GLuint fbo = 0u;
 	glGenFramebuffers(1, &fbo);
 	assert(fbo != 0u);
@@ -462,7 +587,7 @@ bonobo::createFBO(std::vector<GLuint> const& color_attachments, GLuint depth_att
 		attach(static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + i), color_attachments[i]);
 	if (depth_attachment != 0u)
 		attach(GL_DEPTH_ATTACHMENT, depth_attachment);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous_fbo));
 
 	return fbo;
 }
@@ -5,6 +5,10 @@
 #include <glm/glm.hpp>
 
 #include "core/FPSCamera.h" // As it includes OpenGL headers, import it after glad
+#include "core/culling.hpp"
+#include "core/mesh_optimizer.hpp"
+#include "core/texture_cache.hpp"
+#include "core/vertex_format.hpp"
 
 #include <functional>
 #include <string>
@@ -14,21 +18,17 @@
 //! \brief Namespace containing a few helpers for the LUGG computer graphics labs.
 namespace bonobo
 {
-	//! \brief Formalise mapping between an OpenGL VAO attribute binding,
-	//!        and the meaning of that attribute.
-	enum class shader_bindings : unsigned int{
-		vertices = 0u, //!< = 0, value of the binding point for vertices
-		normals,       //!< = 1, value of the binding point for normals
-		texcoords,     //!< = 2, value of the binding point for texcoords
-		tangents,      //!< = 3, value of the binding point for tangents
-		binormals      //!< = 4, value of the binding point for binormals
-	};
-
 	//! \brief Association of a sampler name used in GLSL to a
 	//!        corresponding texture ID.
 	using texture_bindings = std::unordered_map<std::string, GLuint>;
 
+	class GeometryArena;
+
 	//! \brief Contains the data for a mesh in OpenGL.
+	//!
+	//! Meshes uploaded into a `GeometryArena` share their vertex array and
+	//! buffer objects with other meshes, and are drawn from `base_vertex`
+	//! and `first_index`; those of `createMesh()` own theirs.
 	struct mesh_data {
 		GLuint vao;                //!< OpenGL name of the Vertex Array Object
 		GLuint bo;                 //!< OpenGL name of the Buffer Object
@@ -37,8 +37,16 @@ namespace bonobo
 		size_t indices_nb;         //!< number of indices stored in ibo
 		texture_bindings bindings; //!< texture bindings for this mesh
 		GLenum drawing_mode;       //!< OpenGL drawing mode, i.e. GL_TRIANGLES, GL_LINES, etc.
+		bounding_volume bounds;    //!< model-space bounds of the vertices
+		vertex_format format;      //!< how the vertices are stored in bo
+		GLint base_vertex;         //!< first vertex of the mesh in bo, when shared with other meshes
+		size_t first_index;        //!< first index of the mesh in ibo, when shared with other meshes
+		GLuint depth_vao;          //!< Vertex Array Object reading only tightly packed positions, for
+		                           //!< depth-only passes; 0 if the mesh has none, in which case `vao` is used
+		std::vector<TextureCache::handle> textures; //!< keep the textures of `bindings` alive, when they
+		                                            //!< come from a `TextureCache`
 
-		mesh_data() : vao(0u), bo(0u), ibo(0u), vertices_nb(0u), indices_nb(0u), bindings(), drawing_mode(GL_TRIANGLES)
+		mesh_data() : vao(0u), bo(0u), ibo(0u), vertices_nb(0u), indices_nb(0u), bindings(), drawing_mode(GL_TRIANGLES), bounds(), format(), base_vertex(0), first_index(0u), depth_vao(0u), textures()
 		{
 		}
 	};
@@ -51,11 +59,81 @@ namespace bonobo
 
 	//! \brief Load objects found in an object/scene file, using assimp.
 	//!
+	//! The textures used by the objects are decoded in parallel, and each
+	//! image is only loaded once even if several materials use it.
+	//!
 	//! @param [in] filename of the object/scene file to load, relative to
 	//!             the `res/scenes` folder
+	//! @param [in] wait_for_textures whether to return only once all
+	//!             textures are uploaded; otherwise, the textures hold a
+	//!             placeholder colour until `updateTextures()` uploads them
+	//! @param [in] format how to store the vertices of the objects
+	//! @param [in] optimization_stages `mesh_optimizer::stage` flags to
+	//!             run on the meshes when importing them; the result is
+	//!             stored in the cache of the file
+	//! @param [in] arena if not null, the arena the meshes are uploaded
+	//!             into, rather than each getting their own buffers; it
+	//!             has to outlive the meshes
+	//! @param [in] texture_cache if not null, the cache the textures are
+	//!             requested through, so that they are shared with other
+	//!             users of the cache and deleted once no mesh uses them;
+	//!             it has to outlive the meshes, and be given to
+	//!             `updateTextures()`
 	//! @return a vector of filled in `mesh_data` structures, one per
 	//!         object found in the input file
-	std::vector<mesh_data> loadObjects(std::string const& filename);
+	std::vector<mesh_data> loadObjects(std::string const& filename,
+	                                   bool wait_for_textures = true,
+	                                   vertex_format const& format = vertex_format::planar(),
+	                                   u32 optimization_stages = mesh_optimizer::default_stages,
+	                                   GeometryArena* arena = nullptr,
+	                                   TextureCache* texture_cache = nullptr);
+
+	//! \brief Upload a mesh into a new VAO, vertex buffer and index buffer.
+	//!
+	//! Used by `loadObjects()` as well as by the parametric shapes, so that
+	//! all meshes can use any vertex format.
+	//!
+	//! @param [in] streams the vertex attributes of the mesh
+	//! @param [in] indices the indices of the mesh
+	//! @param [in] indices_nb the number of indices
+	//! @param [in] format how to store the vertices
+	//! @param [in] drawing_mode OpenGL drawing mode, i.e. GL_TRIANGLES
+	//! @return the filled in `mesh_data`, without any texture bindings
+	mesh_data createMesh(vertex_streams const& streams, GLuint const* indices,
+	                     size_t indices_nb,
+	                     vertex_format const& format = vertex_format::planar(),
+	                     GLenum drawing_mode = GL_TRIANGLES);
+
+	//! \brief Upload vertices that were packed ahead of time, i.e. read
+	//!        from a mesh cache, into a new VAO, vertex buffer and index
+	//!        buffer.
+	//!
+	//! @param [in] layout the attributes of the vertices, as returned by
+	//!             `get_packed_layout()`
+	//! @param [in] vertex_data the packed vertices, uploaded as is
+	//! @param [in] positions the positions alone, tightly packed, to
+	//!             compute the bounds
+	//! @param [in] indices the indices of the mesh
+	//! @param [in] indices_nb the number of indices
+	//! @param [in] format how the vertices were packed
+	//! @param [in] drawing_mode OpenGL drawing mode, i.e. GL_TRIANGLES
+	//! @return the filled in `mesh_data`, without any texture bindings
+	mesh_data createMesh(packed_vertices const& layout, void const* vertex_data,
+	                     glm::vec3 const* positions, GLuint const* indices,
+	                     size_t indices_nb, vertex_format const& format,
+	                     GLenum drawing_mode = GL_TRIANGLES);
+
+	//! \brief Upload textures that finished decoding in the background.
+	//!
+	//! Should be called once per frame by applications calling
+	//! `loadObjects()` without waiting for the textures.
+	//!
+	//! @param [in] max_uploads maximum number of textures to upload, to
+	//!             bound the time spent in this call
+	//! @param [in] texture_cache if not null, the cache given to
+	//!             `loadObjects()`, to account for the uploaded textures
+	//! @return the number of textures that were uploaded
+	size_t updateTextures(size_t max_uploads = 4u, TextureCache* texture_cache = nullptr);
 
 	//! \brief Creates an OpenGL texture without any content nor parameterised.
 	//!
@@ -76,14 +154,45 @@ namespace bonobo
 	                     GLenum type = GL_UNSIGNED_BYTE,
 	                     GLvoid const* data = nullptr);
 
+	//! \brief Description of a 2D texture rendered to, e.g. one of the
+	//!        targets of a g-buffer.
+	struct render_target_desc {
+		char const* name;      //!< shown in logs
+		GLint internal_format; //!< sized format, e.g. GL_RG16F
+		GLenum filter;         //!< minification and magnification filter
+	};
+
+	//! \brief Create a texture without any content, as described.
+	//!
+	//! @param [in] width width of the texture to create
+	//! @param [in] height height of the texture to create
+	//! @param [in] desc format and filtering of the texture
+	//! @return the name of the texture, or 0 if its format is not one
+	//!         `getTexelSize()` knows of
+	GLuint createRenderTarget(uint32_t width, uint32_t height, render_target_desc const& desc);
+
+	//! \brief Get the size of a texel of a sized internal format.
+	//!
+	//! @return the size in bytes, or 0 for unknown formats
+	size_t getTexelSize(GLint internal_format);
+
 	//! \brief Load a PNG image into an OpenGL 2D-texture.
 	//!
+	//! If a block-compressed version of the image exists next to it (see
+	//! `bonobo::dds`), and `internal_format` is GL_RGBA, that version is
+	//! loaded instead, together with its precomputed mip chain.
+	//!
 	//! @param [in] filename of the PNG image, relative to the `textures`
 	//!             folder within the `resources` folder.
 	//! @param [in] generate_mipmap whether or not to generate a mipmap hierarchy
+	//! @param [in] flip whether to flip the image vertically, as OpenGL
+	//!             expects the first row to be the bottom one
+	//! @param [in] internal_format internal format of the texture
 	//! @return the name of the OpenGL 2D-texture
 	GLuint loadTexture2D(std::string const& filename,
-	                     bool generate_mipmap = true);
+	                     bool generate_mipmap = true,
+	                     bool flip = true,
+	                     GLint internal_format = GL_RGBA);
 
 	//! \brief Load six PNG images into an OpenGL cubemap-texture.
 	//!
@@ -105,6 +214,10 @@ namespace bonobo
 	//! \brief Create an OpenGL program consisting of a vertex and a
 	//!        fragment shader.
 	//!
+	//! Lines of the form `#include "path"` are replaced by the content of
+	//! `shaders/path`, and the uniform blocks of the program are bound to
+	//! their `uniform_block_bindings`.
+	//!
 	//! @param [in] vert_shader_source_path of the vertex shader source
 	//!             code, relative to the `shaders/EDAF80` folder
 	//! @param [in] frag_shader_source_path of the fragment shader source
@@ -0,0 +1,126 @@
+#include "input_journal.hpp"
+
+#include "Log.h"
+
+#include <cstring>
+
+namespace
+{
+	char const magic[4] = { 'B', 'I', 'J', 'N' };
+	u32 const version = 1u;
+}
+
+static_assert(sizeof(bonobo::InputJournal::event) == 16u, "Journal events are written as 16-byte records");
+
+bonobo::InputJournal::InputJournal() : _recording(), _events(), _next(0u), _end_tick(0u), _seed(0u), _replaying(false)
+{
+}
+
+bool
+bonobo::InputJournal::start_recording(std::string const& path, u64 seed)
+{
+	_recording.open(path, std::ios::binary | std::ios::trunc);
+	if (!_recording.is_open())
+		return false;
+
+	header h;
+	std::memcpy(h.magic, magic, sizeof(magic));
+	h.version = version;
+	h.seed = seed;
+	_recording.write(reinterpret_cast<char const*>(&h), sizeof(h));
+	_seed = seed;
+	return _recording.good();
+}
+
+void
+bonobo::InputJournal::record(event const& e)
+{
+	if (_recording.is_open())
+		_recording.write(reinterpret_cast<char const*>(&e), sizeof(e));
+}
+
+void
+bonobo::InputJournal::stop_recording(u64 tick)
+{
+	if (!_recording.is_open())
+		return;
+	event e;
+	std::memset(&e, 0, sizeof(e));
+	e.tick = static_cast<u32>(tick);
+	e.type = event_type::end;
+	record(e);
+	_recording.close();
+}
+
+bool
+bonobo::InputJournal::is_recording() const
+{
+	return _recording.is_open();
+}
+
+bool
+bonobo::InputJournal::load(std::string const& path)
+{
+	_events.clear();
+	_next = 0u;
+	_replaying = false;
+
+	std::ifstream stream(path, std::ios::binary);
+	header h;
+	if (!stream.read(reinterpret_cast<char*>(&h), sizeof(h))
+	    || std::memcmp(h.magic, magic, sizeof(magic)) != 0 || h.version != version) {
+		LogError("\"%s\" is not an input journal", path.c_str());
+		return false;
+	}
+
+	// A session which did not stop cleanly ends after its last event.
+	_end_tick = 0u;
+	event e;
+	while (stream.read(reinterpret_cast<char*>(&e), sizeof(e))) {
+		if (e.type == event_type::end) {
+			_end_tick = e.tick;
+			break;
+		}
+		_events.push_back(e);
+		_end_tick = static_cast<u64>(e.tick) + 1u;
+	}
+
+	_seed = h.seed;
+	_replaying = true;
+	LogInfo("Input journal \"%s\": %zu events over %llu ticks", path.c_str(), _events.size(),
+	        static_cast<unsigned long long>(_end_tick));
+	return true;
+}
+
+bool
+bonobo::InputJournal::is_replaying() const
+{
+	return _replaying;
+}
+
+bool
+bonobo::InputJournal::next(u64 tick, event& e)
+{
+	if (_next == _events.size() || _events[_next].tick != tick)
+		return false;
+	e = _events[_next++];
+	return true;
+}
+
+bool
+bonobo::InputJournal::is_finished(u64 tick) const
+{
+	return _replaying && tick >= _end_tick;
+}
+
+u64
+bonobo::InputJournal::get_end_tick() const
+{
+	return _end_tick;
+}
+
+u64
+bonobo::InputJournal::get_seed() const
+{
+	return _seed;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Types.h"
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Input events of a session with the tick they were fed at,
+	//!        to feed them back identically in a later run.
+	//!
+	//! The file starts with a 16-byte header holding the seed of the
+	//! session's random number generator, followed by the events as fixed
+	//! 16-byte records, in the byte order of the machine that wrote them.
+	class InputJournal
+	{
+	public:
+		enum class event_type : u8 {
+			keyboard,
+			mouse_buttons,
+			mouse_motion,
+			ui_capture,
+			end           //!< tick at which the recording stopped
+		};
+
+		struct event {
+			u32 tick;
+			event_type type;
+			u8 action;    //!< GLFW action, or UI capture flags
+			u8 mods;
+			u8 padding;
+			i32 a;        //!< key, button, or the bits of the float x
+			i32 b;        //!< scancode, or the bits of the float y
+		};
+
+		InputJournal();
+
+		//! \brief Start writing the events to a file, replacing it.
+		//!
+		//! @param [in] path file to write
+		//! @param [in] seed of the random number generator of the session
+		//! @return whether the file could be opened
+		bool start_recording(std::string const& path, u64 seed);
+
+		//! \brief Append an event, if recording.
+		void record(event const& e);
+
+		//! \brief Mark the end of the session, then close the file.
+		void stop_recording(u64 tick);
+
+		bool is_recording() const;
+
+		//! \brief Load the events of a file, to replay them.
+		//!
+		//! @return whether the file is a valid journal
+		bool load(std::string const& path);
+
+		bool is_replaying() const;
+
+		//! \brief Pop the next event to replay, if it was fed at `tick`.
+		bool next(u64 tick, event& e);
+
+		//! \brief Whether the session being replayed ended before `tick`.
+		bool is_finished(u64 tick) const;
+
+		//! \brief Get the tick at which the session being replayed ended,
+		//!        i.e. how many ticks it lasted.
+		u64 get_end_tick() const;
+
+		u64 get_seed() const;
+
+	private:
+		struct header {
+			char magic[4];
+			u32 version;
+			u64 seed;
+		};
+
+		std::ofstream _recording;
+		std::vector<event> _events;
+		size_t _next;
+		u64 _end_tick;
+		u64 _seed;
+		bool _replaying;
+	};
+}
@@ -0,0 +1,248 @@
+#include "instanced_node.hpp"
+#include "helpers.hpp"
+#include "stream_buffer.hpp"
+
+#include "core/Log.h"
+#include "core/opengl.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+InstancedNode::InstancedNode() : _vao(0u), _indices_nb(0), _drawing_mode(GL_TRIANGLES), _base_vertex(0), _first_index(0u), _bounds(), _has_binormals(true), _program(0u), _set_uniforms(), _materials(), _instances(), _visible_instances(), _sorted_instances(), _material_offsets(), _instances_bo(0u), _instances_bo_capacity(0u), _culling(true), _stats()
+{
+}
+
+InstancedNode::~InstancedNode()
+{
+	glDeleteBuffers(1, &_instances_bo);
+	_instances_bo = 0u;
+}
+
+void
+InstancedNode::set_geometry(bonobo::mesh_data const& shape)
+{
+	if (shape.ibo == 0u) {
+		LogError("Instanced nodes only support indexed meshes.");
+		return;
+	}
+
+	_vao = shape.vao;
+	_indices_nb = static_cast<GLsizei>(shape.indices_nb);
+	_drawing_mode = shape.drawing_mode;
+	_base_vertex = shape.base_vertex;
+	_first_index = shape.first_index;
+	_bounds = shape.bounds;
+	_has_binormals = shape.format.store_binormals;
+
+	if (_instances_bo == 0u) {
+		glGenBuffers(1, &_instances_bo);
+		assert(_instances_bo != 0u);
+	}
+
+	glBindVertexArray(_vao);
+	auto const first_column = static_cast<unsigned int>(bonobo::shader_bindings::instance_transforms);
+	for (unsigned int i = 0u; i < 4u; ++i) {
+		glEnableVertexAttribArray(first_column + i);
+		glVertexAttribDivisor(first_column + i, 1u);
+	}
+	auto const materials = static_cast<unsigned int>(bonobo::shader_bindings::instance_materials);
+	glEnableVertexAttribArray(materials);
+	glVertexAttribDivisor(materials, 1u);
+	set_instance_attributes(_instances_bo, 0u);
+	glBindVertexArray(0u);
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+}
+
+void
+InstancedNode::set_program(GLuint program, std::function<void (GLuint)> const& set_uniforms)
+{
+	_program = program;
+	_set_uniforms = set_uniforms;
+}
+
+u32
+InstancedNode::add_material()
+{
+	_materials.emplace_back();
+	return static_cast<u32>(_materials.size() - 1u);
+}
+
+void
+InstancedNode::add_texture(u32 material, std::string const& name, GLuint tex_id, GLenum type)
+{
+	assert(material < _materials.size());
+	if (tex_id == 0u)
+		return;
+
+	_materials[material].emplace_back(name, tex_id, type);
+}
+
+size_t
+InstancedNode::add_instance(glm::mat4 const& world, u32 material)
+{
+	assert(material < std::max<size_t>(_materials.size(), 1u));
+	_instances.push_back({ world, material });
+	return _instances.size() - 1u;
+}
+
+void
+InstancedNode::set_instance_transform(size_t index, glm::mat4 const& world)
+{
+	assert(index < _instances.size());
+	_instances[index].world = world;
+}
+
+glm::mat4 const&
+InstancedNode::get_instance_transform(size_t index) const
+{
+	assert(index < _instances.size());
+	return _instances[index].world;
+}
+
+void
+InstancedNode::set_instance_material(size_t index, u32 material)
+{
+	assert(index < _instances.size());
+	assert(material < std::max<size_t>(_materials.size(), 1u));
+	_instances[index].material = material;
+}
+
+size_t
+InstancedNode::get_instances_nb() const
+{
+	return _instances.size();
+}
+
+void
+InstancedNode::clear_instances()
+{
+	_instances.clear();
+}
+
+void
+InstancedNode::set_culling(bool enabled)
+{
+	_culling = enabled;
+}
+
+void
+InstancedNode::render(glm::mat4 const& world_to_clip)
+{
+	render(world_to_clip, _program, _set_uniforms);
+}
+
+void
+InstancedNode::render(glm::mat4 const& world_to_clip, GLuint program, std::function<void (GLuint)> const& set_uniforms)
+{
+	_stats = stats();
+	if (_vao == 0u || program == 0u || _instances.empty())
+		return;
+
+	// Counting sort of the visible instances by material, so that each
+	// material covers a contiguous range of the buffer object.
+	auto const materials_nb = std::max<size_t>(_materials.size(), 1u);
+	_material_offsets.assign(materials_nb + 1u, 0u);
+	auto const frustum = bonobo::Frustum(world_to_clip);
+	_visible_instances.clear();
+	for (size_t i = 0u; i < _instances.size(); ++i) {
+		if (_culling && !frustum.intersects(_bounds, _instances[i].world)) {
+			++_stats.culled;
+			continue;
+		}
+		_visible_instances.push_back(i);
+		++_material_offsets[_instances[i].material + 1u];
+	}
+	for (size_t i = 1u; i <= materials_nb; ++i)
+		_material_offsets[i] += _material_offsets[i - 1u];
+	_stats.instances = _visible_instances.size();
+	if (_stats.instances == 0u)
+		return;
+
+	_sorted_instances.resize(_stats.instances);
+	auto next_slots = _material_offsets;
+	for (auto const i : _visible_instances)
+		_sorted_instances[next_slots[_instances[i].material]++] = _instances[i];
+
+	// Suballocate the instances from the window's stream buffer; without
+	// one, orphan the previous storage rather than waiting for the draws
+	// still reading it.
+	auto const instances_size = _sorted_instances.size() * sizeof(instance);
+	auto instances_bo = _instances_bo;
+	size_t instances_offset = 0u;
+	if (auto* const stream = bonobo::StreamBuffer::get_default()) {
+		auto const allocation = stream->write(_sorted_instances.data(), instances_size, alignof(instance));
+		instances_bo = allocation.bo;
+		instances_offset = static_cast<size_t>(allocation.offset);
+	} else {
+		glBindBuffer(GL_ARRAY_BUFFER, _instances_bo);
+		_instances_bo_capacity = std::max(_instances_bo_capacity, _sorted_instances.size());
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(_instances_bo_capacity * sizeof(instance)), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(instances_size), _sorted_instances.data());
+	}
+
+	glUseProgram(program);
+	set_uniforms(program);
+
+	auto const get_location = [program](std::string const& name){
+		return utils::opengl::shader::get_uniform_location(program, name);
+	};
+	glUniformMatrix4fv(get_location("vertex_world_to_clip"), 1, GL_FALSE, glm::value_ptr(world_to_clip));
+	glUniform1i(get_location("has_binormals"), _has_binormals);
+
+	glBindVertexArray(_vao);
+	for (size_t m = 0u; m < materials_nb; ++m) {
+		auto const first = _material_offsets[m];
+		auto const count = _material_offsets[m + 1u] - first;
+		if (count == 0u)
+			continue;
+
+		auto has_diffuse_texture = false, has_opacity_texture = false;
+		if (m < _materials.size()) {
+			auto const& textures = _materials[m];
+			for (size_t i = 0u; i < textures.size(); ++i) {
+				auto const& texture = textures[i];
+				glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+				glBindTexture(std::get<2>(texture), std::get<1>(texture));
+				glUniform1i(get_location(std::get<0>(texture)), static_cast<GLint>(i));
+				has_diffuse_texture = has_diffuse_texture || std::get<0>(texture) == "diffuse_texture";
+				has_opacity_texture = has_opacity_texture || std::get<0>(texture) == "opacity_texture";
+			}
+			glUniform1i(get_location("has_textures"), !textures.empty());
+		} else {
+			glUniform1i(get_location("has_textures"), 0);
+		}
+		glUniform1i(get_location("has_diffuse_texture"), has_diffuse_texture);
+		glUniform1i(get_location("has_opacity_texture"), has_opacity_texture);
+
+		set_instance_attributes(instances_bo, instances_offset + first * sizeof(instance));
+		glDrawElementsInstancedBaseVertex(_drawing_mode, _indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(_first_index * sizeof(GLuint)),
+		                                  static_cast<GLsizei>(count), _base_vertex);
+		++_stats.draws;
+	}
+	glBindVertexArray(0u);
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+
+	glUseProgram(0u);
+}
+
+InstancedNode::stats const&
+InstancedNode::get_stats() const
+{
+	return _stats;
+}
+
+void
+InstancedNode::set_instance_attributes(GLuint bo, size_t base_offset) const
+{
+	glBindBuffer(GL_ARRAY_BUFFER, bo);
+	auto const stride = static_cast<GLsizei>(sizeof(instance));
+	auto const first_column = static_cast<unsigned int>(bonobo::shader_bindings::instance_transforms);
+	for (unsigned int i = 0u; i < 4u; ++i)
+		glVertexAttribPointer(first_column + i, 4, GL_FLOAT, GL_FALSE, stride,
+		                      reinterpret_cast<GLvoid const*>(base_offset + offsetof(instance, world) + i * sizeof(glm::vec4)));
+	glVertexAttribIPointer(static_cast<unsigned int>(bonobo::shader_bindings::instance_materials), 1, GL_UNSIGNED_INT, stride,
+	                       reinterpret_cast<GLvoid const*>(base_offset + offsetof(instance, material)));
+}
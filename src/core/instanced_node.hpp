@@ -0,0 +1,173 @@
+#pragma once
+
+#include "culling.hpp"
+#include "Types.h"
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace bonobo
+{
+	struct mesh_data;
+}
+
+//! \brief Draws many copies of a single mesh, each with its own transform
+//!        and material, using hardware instancing.
+//!
+//! Every frame, the transforms and material indices of the instances are
+//! streamed through the window's `bonobo::StreamBuffer`, and read by the
+//! vertex shader through the attributes bound at
+//! `bonobo::shader_bindings::instance_transforms` (a `mat4`) and
+//! `bonobo::shader_bindings::instance_materials` (a `uint`).
+//! Instances are grouped by material, so that drawing all of them takes
+//! one `glDrawElementsInstanced()` per material rather than one draw call
+//! per instance.
+//!
+//! There is no per-instance `normal_model_to_world`: shaders transform
+//! normals with the upper 3x3 of the model-to-world matrix, which assumes
+//! the instances are scaled uniformly.
+class InstancedNode
+{
+public:
+	//! \brief Counters gathered during the last call to `render()`.
+	struct stats {
+		size_t instances; //!< number of instances drawn
+		size_t culled;    //!< number of instances outside the frustum
+		size_t draws;     //!< number of draw calls issued
+	};
+
+	//! \brief Default constructor.
+	InstancedNode();
+
+	//! \brief Release the buffer object of the instances.
+	~InstancedNode();
+
+	InstancedNode(InstancedNode const&) = delete;
+	InstancedNode& operator=(InstancedNode const&) = delete;
+
+	//! \brief Set the geometry shared by all instances.
+	//!
+	//! The instance attributes are added to the vertex array of `shape`,
+	//! which should therefore not be shared with other instanced nodes,
+	//! nor come from a `bonobo::GeometryArena`.
+	//!
+	//! @param [in] shape OpenGL data to use as geometry; it has to be
+	//!             indexed
+	void set_geometry(bonobo::mesh_data const& shape);
+
+	//! \brief Set the program of this node.
+	//!
+	//! @param [in] program OpenGL shader program to use
+	//! @param [in] set_uniforms function that will take as argument an
+	//!             OpenGL shader program, and will setup that program's
+	//!             uniforms
+	void set_program(GLuint program, std::function<void (GLuint)> const& set_uniforms);
+
+	//! \brief Add a material, i.e. an empty set of textures.
+	//!
+	//! @return the index of the new material
+	u32 add_material();
+
+	//! \brief Add a texture to a material.
+	//!
+	//! @param [in] material the index of the material, as returned by
+	//!             `add_material()`
+	//! @param [in] name the variable name used by the attached OpenGL
+	//!             shader program
+	//! @param [in] tex_id the name of an OpenGL texture
+	//! @param [in] type the type of texture, i.e. GL_TEXTURE_2D,
+	//!             GL_TEXTURE_CUBE_MAP, etc.
+	void add_texture(u32 material, std::string const& name, GLuint tex_id, GLenum type);
+
+	//! \brief Add an instance.
+	//!
+	//! @param [in] world Matrix transforming from model-space to
+	//!             world-space
+	//! @param [in] material the index of the material to use
+	//! @return the index of the new instance
+	size_t add_instance(glm::mat4 const& world, u32 material = 0u);
+
+	//! \brief Reset the transform of an instance.
+	void set_instance_transform(size_t index, glm::mat4 const& world);
+
+	//! \brief Get the transform of an instance.
+	glm::mat4 const& get_instance_transform(size_t index) const;
+
+	//! \brief Change the material of an instance.
+	void set_instance_material(size_t index, u32 material);
+
+	//! \brief Get the number of instances.
+	size_t get_instances_nb() const;
+
+	//! \brief Remove all instances; materials are kept.
+	void clear_instances();
+
+	//! \brief Enable or disable testing each instance against the view
+	//!        frustum before streaming it; enabled by default.
+	void set_culling(bool enabled);
+
+	//! \brief Render all instances.
+	//!
+	//! @param [in] world_to_clip Matrix transforming from world-space to
+	//!             clip-space
+	void render(glm::mat4 const& world_to_clip);
+
+	//! \brief Render all instances with a specific shader program.
+	//!
+	//! @param [in] world_to_clip Matrix transforming from world-space to
+	//!             clip-space
+	//! @param [in] program OpenGL shader program to use
+	//! @param [in] set_uniforms function that will take as argument an
+	//!             OpenGL shader program, and will setup that program's
+	//!             uniforms
+	void render(glm::mat4 const& world_to_clip, GLuint program,
+	            std::function<void (GLuint)> const& set_uniforms);
+
+	//! \brief Get the counters gathered during the last `render()`.
+	stats const& get_stats() const;
+
+private:
+	//! \brief Layout of an instance in the buffer object.
+	struct instance {
+		glm::mat4 world;
+		u32 material;
+	};
+
+	using material = std::vector<std::tuple<std::string, GLuint, GLenum>>;
+
+	//! \brief Point the instance attributes at the instances starting
+	//!        `base_offset` bytes into `bo`; OpenGL 4.1 has no
+	//!        `glDrawElementsInstancedBaseInstance()`.
+	void set_instance_attributes(GLuint bo, size_t base_offset) const;
+
+	// Geometry data
+	GLuint _vao;
+	GLsizei _indices_nb;
+	GLenum _drawing_mode;
+	GLint _base_vertex;
+	size_t _first_index;
+	bonobo::bounding_volume _bounds;
+	bool _has_binormals;
+
+	// Program data
+	GLuint _program;
+	std::function<void (GLuint)> _set_uniforms;
+
+	std::vector<material> _materials;
+
+	// Instances data
+	std::vector<instance> _instances;
+	std::vector<size_t> _visible_instances;  //!< indices into `_instances`
+	std::vector<instance> _sorted_instances; //!< visible ones, by material
+	std::vector<size_t> _material_offsets;   //!< into `_sorted_instances`
+	GLuint _instances_bo;
+	size_t _instances_bo_capacity;           //!< in instances
+	bool _culling;
+
+	stats _stats;
+};
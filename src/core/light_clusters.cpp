@@ -0,0 +1,233 @@
+#include "light_clusters.hpp"
+
+#include "Misc.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+constexpr u32 bonobo::LightClusters::tiles_x;
+constexpr u32 bonobo::LightClusters::tiles_y;
+constexpr u32 bonobo::LightClusters::slices;
+constexpr u32 bonobo::LightClusters::clusters_nb;
+
+namespace
+{
+	constexpr u32 tiles_per_slice = bonobo::LightClusters::tiles_x * bonobo::LightClusters::tiles_y;
+
+	// Texture buffers may not be empty, so they always get a few bytes.
+	constexpr size_t min_buffer_size = 16u;
+
+	void
+	create_buffer_texture(GLenum format, GLuint& bo, GLuint& texture)
+	{
+		glGenBuffers(1, &bo);
+		assert(bo != 0u);
+		glBindBuffer(GL_TEXTURE_BUFFER, bo);
+		glBufferData(GL_TEXTURE_BUFFER, min_buffer_size, nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0u);
+
+		glGenTextures(1, &texture);
+		assert(texture != 0u);
+		glBindTexture(GL_TEXTURE_BUFFER, texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, format, bo);
+		glBindTexture(GL_TEXTURE_BUFFER, 0u);
+	}
+
+	// Orphan the previous content, as the GPU may still be reading it.
+	void
+	upload_buffer(GLuint bo, void const* data, size_t size)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, bo);
+		glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(std::max(size, min_buffer_size)), nullptr, GL_STREAM_DRAW);
+		if (size > 0u)
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, static_cast<GLsizeiptr>(size), data);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0u);
+	}
+}
+
+bonobo::LightClusters::LightClusters() : _min_x(clusters_nb), _min_y(clusters_nb), _min_z(clusters_nb), _max_x(clusters_nb), _max_y(clusters_nb), _max_z(clusters_nb), _fov(0.0f), _aspect(0.0f), _near(0.0f), _far(0.0f), _depth_scale(0.0f), _depth_bias(0.0f), _grid(2u * clusters_nb, 0u), _indices(), _lights(), _hits(), _slice_mask(tiles_per_slice), _grid_bo(0u), _indices_bo(0u), _lights_bo(0u), _grid_texture(0u), _indices_texture(0u), _lights_texture(0u), _stats()
+{
+	create_buffer_texture(GL_RG32UI, _grid_bo, _grid_texture);
+	create_buffer_texture(GL_R32UI, _indices_bo, _indices_texture);
+	create_buffer_texture(GL_RGBA32F, _lights_bo, _lights_texture);
+}
+
+bonobo::LightClusters::~LightClusters()
+{
+	GLuint const textures[3] = { _grid_texture, _indices_texture, _lights_texture };
+	glDeleteTextures(3, textures);
+	GLuint const buffers[3] = { _grid_bo, _indices_bo, _lights_bo };
+	glDeleteBuffers(3, buffers);
+}
+
+void
+bonobo::LightClusters::update(FPSCameraf::Snapshot const& camera, std::vector<point_light> const& lights)
+{
+	auto const start = GetTimeMilliseconds();
+
+	if (camera.mFov != _fov || camera.mAspect != _aspect || camera.mNear != _near || camera.mFar != _far)
+		compute_bounds(camera);
+
+	_stats = stats();
+	_stats.lights = lights.size();
+	_hits.clear();
+	std::fill(_grid.begin(), _grid.end(), 0u);
+
+	auto const slice_of = [this](float depth){
+		auto const slice = std::floor(std::log(depth) * _depth_scale + _depth_bias);
+		return static_cast<u32>(std::min(std::max(slice, 0.0f), static_cast<float>(slices - 1u)));
+	};
+
+	for (size_t i = 0u; i < lights.size(); ++i) {
+		auto const& light = lights[i];
+		auto const center = glm::vec3(camera.mWorldToView * glm::vec4(light.position, 1.0f));
+		auto const radius = light.radius;
+
+		// The camera looks down -z in view-space.
+		auto const min_depth = -center.z - radius;
+		auto const max_depth = -center.z + radius;
+		if (max_depth < _near || min_depth > _far || !camera.mFrustum.intersects_sphere(light.position, radius))
+			continue;
+		++_stats.visible_lights;
+
+		auto const first_slice = slice_of(std::max(min_depth, _near));
+		auto const last_slice = slice_of(std::min(max_depth, _far));
+		auto const radius2 = radius * radius;
+		for (auto s = first_slice; s <= last_slice; ++s) {
+			auto const base = s * tiles_per_slice;
+			float const* const min_x = _min_x.data() + base;
+			float const* const min_y = _min_y.data() + base;
+			float const* const min_z = _min_z.data() + base;
+			float const* const max_x = _max_x.data() + base;
+			float const* const max_y = _max_y.data() + base;
+			float const* const max_z = _max_z.data() + base;
+			u8* const mask = _slice_mask.data();
+
+			// Distance from the sphere's center to each box, without any
+			// branch so that it is vectorised.
+			for (u32 t = 0u; t < tiles_per_slice; ++t) {
+				auto const dx = std::max(std::max(min_x[t] - center.x, center.x - max_x[t]), 0.0f);
+				auto const dy = std::max(std::max(min_y[t] - center.y, center.y - max_y[t]), 0.0f);
+				auto const dz = std::max(std::max(min_z[t] - center.z, center.z - max_z[t]), 0.0f);
+				mask[t] = static_cast<u8>(dx * dx + dy * dy + dz * dz <= radius2);
+			}
+
+			for (u32 t = 0u; t < tiles_per_slice; ++t) {
+				if (mask[t] == 0u)
+					continue;
+				_hits.push_back(base + t);
+				_hits.push_back(static_cast<u32>(i));
+				++_grid[2u * (base + t) + 1u];
+			}
+		}
+	}
+
+	// Turn the counts into offsets, then scatter the light indices, using
+	// the counts as cursors.
+	u32 offset = 0u;
+	for (u32 c = 0u; c < clusters_nb; ++c) {
+		auto const count = _grid[2u * c + 1u];
+		_grid[2u * c] = offset;
+		_grid[2u * c + 1u] = 0u;
+		offset += count;
+		_stats.occupied_clusters += count > 0u ? 1u : 0u;
+		_stats.max_per_cluster = std::max<size_t>(_stats.max_per_cluster, count);
+	}
+	_indices.resize(offset);
+	for (size_t h = 0u; h < _hits.size(); h += 2u) {
+		auto const cluster = _hits[h];
+		_indices[_grid[2u * cluster] + _grid[2u * cluster + 1u]++] = _hits[h + 1u];
+	}
+	_stats.references = offset;
+
+	_lights.resize(2u * lights.size());
+	for (size_t i = 0u; i < lights.size(); ++i) {
+		_lights[2u * i] = glm::vec4(lights[i].position, lights[i].radius);
+		_lights[2u * i + 1u] = glm::vec4(lights[i].color * lights[i].intensity, 0.0f);
+	}
+
+	upload();
+
+	_stats.binning_time = GetTimeMilliseconds() - start;
+}
+
+void
+bonobo::LightClusters::bind(GLuint program, GLuint first_unit) const
+{
+	GLuint const textures[3] = { _grid_texture, _indices_texture, _lights_texture };
+	char const* const names[3] = { "cluster_grid", "cluster_light_indices", "cluster_lights" };
+	for (GLuint i = 0u; i < 3u; ++i) {
+		glActiveTexture(GL_TEXTURE0 + first_unit + i);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+		glUniform1i(glGetUniformLocation(program, names[i]), static_cast<GLint>(first_unit + i));
+	}
+	glUniform3ui(glGetUniformLocation(program, "cluster_grid_size"), tiles_x, tiles_y, slices);
+	glUniform1f(glGetUniformLocation(program, "cluster_depth_scale"), _depth_scale);
+	glUniform1f(glGetUniformLocation(program, "cluster_depth_bias"), _depth_bias);
+}
+
+void
+bonobo::LightClusters::unbind(GLuint first_unit) const
+{
+	for (GLuint i = 0u; i < 3u; ++i) {
+		glActiveTexture(GL_TEXTURE0 + first_unit + i);
+		glBindTexture(GL_TEXTURE_BUFFER, 0u);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+bonobo::LightClusters::stats const&
+bonobo::LightClusters::get_stats() const
+{
+	return _stats;
+}
+
+void
+bonobo::LightClusters::compute_bounds(FPSCameraf::Snapshot const& camera)
+{
+	_fov = camera.mFov;
+	_aspect = camera.mAspect;
+	_near = camera.mNear;
+	_far = camera.mFar;
+
+	auto const depth_range = std::log(_far / _near);
+	_depth_scale = static_cast<float>(slices) / depth_range;
+	_depth_bias = -static_cast<float>(slices) * std::log(_near) / depth_range;
+
+	// At a depth d, the view-space point seen at (x, y) in NDC is at
+	// (x * tan(fov / 2) * aspect * d, y * tan(fov / 2) * d, -d).
+	auto const half_height = std::tan(_fov * 0.5f);
+	auto const half_width = half_height * _aspect;
+	auto const slice_depth = [this](u32 s){
+		return _near * std::pow(_far / _near, static_cast<float>(s) / static_cast<float>(slices));
+	};
+
+	for (u32 s = 0u; s < slices; ++s) {
+		auto const near_depth = slice_depth(s);
+		auto const far_depth = slice_depth(s + 1u);
+		for (u32 y = 0u; y < tiles_y; ++y) {
+			auto const bottom = (-1.0f + 2.0f * static_cast<float>(y) / static_cast<float>(tiles_y)) * half_height;
+			auto const top = (-1.0f + 2.0f * static_cast<float>(y + 1u) / static_cast<float>(tiles_y)) * half_height;
+			for (u32 x = 0u; x < tiles_x; ++x) {
+				auto const left = (-1.0f + 2.0f * static_cast<float>(x) / static_cast<float>(tiles_x)) * half_width;
+				auto const right = (-1.0f + 2.0f * static_cast<float>(x + 1u) / static_cast<float>(tiles_x)) * half_width;
+				auto const c = (s * tiles_y + y) * tiles_x + x;
+				_min_x[c] = std::min(left * near_depth, left * far_depth);
+				_max_x[c] = std::max(right * near_depth, right * far_depth);
+				_min_y[c] = std::min(bottom * near_depth, bottom * far_depth);
+				_max_y[c] = std::max(top * near_depth, top * far_depth);
+				_min_z[c] = -far_depth;
+				_max_z[c] = -near_depth;
+			}
+		}
+	}
+}
+
+void
+bonobo::LightClusters::upload()
+{
+	upload_buffer(_grid_bo, _grid.data(), _grid.size() * sizeof(u32));
+	upload_buffer(_indices_bo, _indices.data(), _indices.size() * sizeof(u32));
+	upload_buffer(_lights_bo, _lights.data(), _lights.size() * sizeof(glm::vec4));
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Types.h"
+
+#include "external/glad/glad.h"
+#include "FPSCamera.h" // As it includes OpenGL headers, import it after glad
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Unshadowed point light, shaded by the clustered light pass.
+	struct point_light {
+		glm::vec3 position; //!< in world-space
+		float radius;       //!< beyond which the light contributes nothing
+		glm::vec3 color;
+		float intensity;
+	};
+
+	//! \brief Bin lights into the clusters of a camera's view frustum, so
+	//!        that a single fullscreen pass can shade hundreds of lights.
+	//!
+	//! The frustum is split into `tiles_x` by `tiles_y` screen tiles and
+	//! `slices` depth slices, spaced exponentially between the near and
+	//! far planes; each of these froxels gets the list of lights whose
+	//! sphere of influence overlaps its view-space bounding box.
+	//!
+	//! The boxes are kept as a structure of arrays, and each light is
+	//! tested against all the tiles of a depth slice at once, in a
+	//! branch-free loop the compiler vectorises; only the depth slices the
+	//! light spans are visited. The lists are then packed, and uploaded to
+	//! three buffer textures read by the shaders:
+	//! * `cluster_grid`, RG32UI: offset and count of the cluster's lights
+	//!   in `cluster_light_indices`, clusters ordered x, then y, then z;
+	//! * `cluster_light_indices`, R32UI: indices into `cluster_lights`;
+	//! * `cluster_lights`, RGBA32F: two texels per light, position and
+	//!   radius, then color times intensity.
+	//!
+	//! `shaders/EDAN35/shade_clustered_lights.frag` shows how to find the
+	//! cluster of a fragment from `cluster_grid_size`,
+	//! `cluster_depth_scale` and `cluster_depth_bias`.
+	class LightClusters
+	{
+	public:
+		//! \brief Counters of the last `update()`.
+		struct stats {
+			size_t lights;            //!< lights given to `update()`
+			size_t visible_lights;    //!< lights overlapping the frustum
+			size_t references;        //!< sum of the lists' lengths
+			size_t occupied_clusters; //!< clusters with at least one light
+			size_t max_per_cluster;   //!< length of the longest list
+			double binning_time;      //!< in ms, including the upload
+		};
+
+		static constexpr u32 tiles_x = 16u;
+		static constexpr u32 tiles_y = 9u;
+		static constexpr u32 slices = 24u;
+		static constexpr u32 clusters_nb = tiles_x * tiles_y * slices;
+
+		//! \brief Create the buffer objects and their textures.
+		LightClusters();
+
+		//! \brief Release the buffer objects and their textures.
+		~LightClusters();
+
+		LightClusters(LightClusters const&) = delete;
+		LightClusters& operator=(LightClusters const&) = delete;
+
+		//! \brief Bin the lights into the clusters of the camera, and
+		//!        upload the lists.
+		//!
+		//! The cluster bounds are only recomputed when the projection of
+		//! the camera changes.
+		//!
+		//! @param [in] camera snapshot of the camera rendering the frame
+		//! @param [in] lights lights of the frame, in world-space
+		void update(FPSCameraf::Snapshot const& camera, std::vector<point_light> const& lights);
+
+		//! \brief Bind the three buffer textures to consecutive texture
+		//!        units, and set the uniforms locating the clusters.
+		//!
+		//! @param [in] program program currently in use
+		//! @param [in] first_unit texture unit of `cluster_grid`; the next
+		//!             two are used as well
+		void bind(GLuint program, GLuint first_unit) const;
+
+		//! \brief Unbind the textures bound by `bind()`.
+		void unbind(GLuint first_unit) const;
+
+		//! \brief Get the counters of the last `update()`.
+		stats const& get_stats() const;
+
+	private:
+		void compute_bounds(FPSCameraf::Snapshot const& camera);
+		void upload();
+
+		// View-space bounds of the clusters, as a structure of arrays
+		// ordered like `cluster_grid`
+		std::vector<float> _min_x, _min_y, _min_z;
+		std::vector<float> _max_x, _max_y, _max_z;
+		float _fov, _aspect, _near, _far;     //!< projection of the bounds
+		float _depth_scale, _depth_bias;      //!< slice = log(depth) * scale + bias
+
+		std::vector<u32> _grid;               //!< offset and count per cluster
+		std::vector<u32> _indices;
+		std::vector<glm::vec4> _lights;
+		std::vector<u32> _hits;               //!< (cluster, light) pairs
+		std::vector<u8> _slice_mask;          //!< hit test results of a slice
+
+		GLuint _grid_bo, _indices_bo, _lights_bo;
+		GLuint _grid_texture, _indices_texture, _lights_texture;
+
+		stats _stats;
+	};
+}
@@ -0,0 +1,127 @@
+#include "mapped_file.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+bonobo::MappedFile::MappedFile() : _data(nullptr), _size(0u)
+#ifdef _WIN32
+	, _file(nullptr), _mapping(nullptr)
+#endif
+{
+}
+
+bonobo::MappedFile::MappedFile(MappedFile&& other) : MappedFile()
+{
+	*this = std::move(other);
+}
+
+bonobo::MappedFile&
+bonobo::MappedFile::operator=(MappedFile&& other)
+{
+	if (this == &other)
+		return *this;
+
+	close();
+	_data = other._data;
+	_size = other._size;
+	other._data = nullptr;
+	other._size = 0u;
+#ifdef _WIN32
+	_file = other._file;
+	_mapping = other._mapping;
+	other._file = nullptr;
+	other._mapping = nullptr;
+#endif
+	return *this;
+}
+
+bonobo::MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool
+bonobo::MappedFile::open(std::string const& path)
+{
+	close();
+
+#ifdef _WIN32
+	auto const file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	auto const mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		return false;
+	}
+
+	auto const data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	_file = file;
+	_mapping = mapping;
+	_data = data;
+	_size = static_cast<size_t>(file_size.QuadPart);
+#else
+	auto const fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+
+	auto const size = static_cast<size_t>(file_stat.st_size);
+	auto const data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // the mapping keeps its own reference to the file
+	if (data == MAP_FAILED)
+		return false;
+
+	_data = data;
+	_size = size;
+#endif
+
+	return true;
+}
+
+void
+bonobo::MappedFile::close()
+{
+	if (_data == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(_data);
+	CloseHandle(_mapping);
+	CloseHandle(_file);
+	_mapping = nullptr;
+	_file = nullptr;
+#else
+	munmap(const_cast<void*>(_data), _size);
+#endif
+	_data = nullptr;
+	_size = 0u;
+}
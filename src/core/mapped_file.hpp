@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace bonobo
+{
+	//! \brief Read-only memory mapping of a whole file.
+	//!
+	//! The mapping is released when the object is destroyed; it can be
+	//! moved but not copied.
+	class MappedFile
+	{
+	public:
+		//! \brief Create an empty mapping.
+		MappedFile();
+
+		//! \brief Map a file.
+		//!
+		//! @param [in] path path to the file to map
+		//! @return whether the file could be opened and mapped; empty
+		//!         files are never mapped
+		bool open(std::string const& path);
+
+		//! \brief Release the mapping, if any.
+		void close();
+
+		//! \brief Return the start of the mapping, or nullptr if nothing is
+		//!        mapped.
+		void const* data() const { return _data; }
+
+		//! \brief Return the size, in bytes, of the mapping.
+		size_t size() const { return _size; }
+
+		MappedFile(MappedFile&& other);
+		MappedFile& operator=(MappedFile&& other);
+		MappedFile(MappedFile const&) = delete;
+		MappedFile& operator=(MappedFile const&) = delete;
+		~MappedFile();
+
+	private:
+		void const* _data;
+		size_t _size;
+#ifdef _WIN32
+		void* _file;
+		void* _mapping;
+#endif
+	};
+}
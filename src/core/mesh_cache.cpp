@@ -0,0 +1,546 @@
+#include "mesh_cache.hpp"
+
+#include "core/Log.h"
+#include "core/mesh_optimizer.hpp"
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <sys/stat.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	char const magic[8] = { 'B', 'N', 'B', 'M', 'E', 'S', 'H', '\0' };
+	constexpr size_t data_alignment = 16u;
+	constexpr u32 assimp_import_flags = aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_CalcTangentSpace;
+
+	struct file_header {
+		char magic[8];
+		u32 version;
+		u32 import_flags;
+		u32 optimization_stages;
+		u32 vertex_format[4];
+		u64 source_hash;
+		u64 source_size;
+		u64 source_modification_time;
+		u32 materials_nb;
+		u32 meshes_nb;
+	};
+
+	struct mesh_record {
+		u32 material_id;
+		u32 attributes;
+		u32 vertices_nb;
+		u32 indices_nb;
+		float bounds_min[3];
+		float bounds_max[3];
+		float bounds_center[3];
+		float bounds_radius;
+		u64 vertex_data_offset;
+		u64 vertex_data_size;
+		u64 positions_offset;
+		u64 indices_offset;
+	};
+
+	void encode_format(bonobo::vertex_format const& format, u32 (&encoded)[4])
+	{
+		encoded[0] = static_cast<u32>(format.arrangement);
+		encoded[1] = static_cast<u32>(format.directions);
+		encoded[2] = static_cast<u32>(format.texcoords);
+		encoded[3] = format.store_binormals ? 1u : 0u;
+	}
+
+	//! \brief Sequential reader over a mapping, failing instead of reading
+	//!        past its end.
+	class reader
+	{
+	public:
+		reader(void const* data, size_t size) : _data(static_cast<u8 const*>(data)), _size(size), _offset(0u)
+		{
+		}
+
+		bool read(void* destination, size_t size)
+		{
+			if (size > _size - _offset)
+				return false;
+			std::memcpy(destination, _data + _offset, size);
+			_offset += size;
+			return true;
+		}
+
+		template<typename T>
+		bool read(T& value)
+		{
+			return read(&value, sizeof(T));
+		}
+
+		bool read(std::string& value)
+		{
+			u32 length = 0u;
+			if (!read(length) || length > _size - _offset)
+				return false;
+			value.assign(reinterpret_cast<char const*>(_data + _offset), length);
+			_offset += length;
+			return true;
+		}
+
+	private:
+		u8 const* _data;
+		size_t _size;
+		size_t _offset;
+	};
+
+	void write_string(std::ofstream& stream, std::string const& value)
+	{
+		auto const length = static_cast<u32>(value.size());
+		stream.write(reinterpret_cast<char const*>(&length), sizeof(length));
+		stream.write(value.data(), length);
+	}
+
+	void pad_to_alignment(std::ofstream& stream)
+	{
+		static char const zeros[data_alignment] = {};
+		auto const position = static_cast<size_t>(stream.tellp());
+		auto const padding = (data_alignment - position % data_alignment) % data_alignment;
+		stream.write(zeros, static_cast<std::streamsize>(padding));
+	}
+}
+
+size_t
+bonobo::mesh_cache::get_streams_nb(u32 attributes)
+{
+	return 1u
+	     + ((attributes & attribute::normals)   != 0u ? 1u : 0u)
+	     + ((attributes & attribute::texcoords) != 0u ? 1u : 0u)
+	     + ((attributes & attribute::tangents)  != 0u ? 2u : 0u);
+}
+
+bonobo::vertex_streams
+bonobo::mesh_cache::get_vertex_streams(mesh_entry const& mesh)
+{
+	vertex_streams streams;
+	streams.vertices_nb = mesh.vertices_nb;
+	auto stream = static_cast<glm::vec3 const*>(mesh.vertex_data);
+	auto const next_stream = [&stream,&mesh](){
+		auto const current = stream;
+		stream += mesh.vertices_nb;
+		return current;
+	};
+	streams.vertices = next_stream();
+	if (mesh.attributes & attribute::normals)
+		streams.normals = next_stream();
+	if (mesh.attributes & attribute::texcoords)
+		streams.texcoords = next_stream();
+	if (mesh.attributes & attribute::tangents) {
+		streams.tangents = next_stream();
+		streams.binormals = next_stream();
+	}
+	return streams;
+}
+
+bonobo::packed_vertices
+bonobo::mesh_cache::get_packed_layout(mesh_entry const& mesh, vertex_format const& format)
+{
+	auto const has_tangents = (mesh.attributes & attribute::tangents) != 0u;
+	return bonobo::get_packed_layout(mesh.vertices_nb, (mesh.attributes & attribute::normals) != 0u,
+	                                 (mesh.attributes & attribute::texcoords) != 0u,
+	                                 has_tangents, has_tangents, format);
+}
+
+u64
+bonobo::mesh_cache::hash_file(std::string const& path)
+{
+	MappedFile file;
+	if (!file.open(path))
+		return 0u;
+
+	u64 hash = 14695981039346656037ull;
+	auto const bytes = static_cast<u8 const*>(file.data());
+	for (size_t i = 0u; i < file.size(); ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash != 0u ? hash : 1u;
+}
+
+bool
+bonobo::mesh_cache::get_stamp(std::string const& path, source_stamp& stamp)
+{
+	struct stat status;
+	if (stat(path.c_str(), &status) != 0)
+		return false;
+
+	stamp.size = static_cast<u64>(status.st_size);
+	stamp.modification_time = static_cast<u64>(status.st_mtime);
+	return true;
+}
+
+std::string
+bonobo::mesh_cache::get_path(std::string const& asset_path, vertex_format const& format)
+{
+	// i.e. "sponza.obj.p00b.meshcache" for `vertex_format::planar()`
+	return asset_path + "." + (format.arrangement == vertex_format::layout::planar ? "p" : "i")
+	     + std::to_string(static_cast<u32>(format.directions))
+	     + std::to_string(static_cast<u32>(format.texcoords))
+	     + (format.store_binormals ? "b" : "n") + ".meshcache";
+}
+
+bool
+bonobo::mesh_cache::read(std::string const& path, std::string const& source_path, u32 import_flags, u32 optimization_stages, vertex_format const& format, contents& cache)
+{
+	cache = contents();
+	cache.format = format;
+	source_stamp stamp;
+	if (!get_stamp(source_path, stamp) || !cache.file.open(path))
+		return false;
+
+	auto const base = static_cast<u8 const*>(cache.file.data());
+	auto const file_size = cache.file.size();
+	reader stream(base, file_size);
+
+	file_header header;
+	if (!stream.read(header) || std::memcmp(header.magic, magic, sizeof(magic)) != 0) {
+		LogWarning("Ignoring mesh cache \"%s\": not a mesh cache", path.c_str());
+		return false;
+	}
+	u32 encoded_format[4];
+	encode_format(format, encoded_format);
+	if (header.version != version || header.import_flags != import_flags
+	    || header.optimization_stages != optimization_stages
+	    || std::memcmp(header.vertex_format, encoded_format, sizeof(encoded_format)) != 0) {
+		LogInfo("Mesh cache \"%s\" is out of date", path.c_str());
+		return false;
+	}
+
+	// Hashing the source is only needed when it might have changed; it
+	// costs about as much as reading the whole cache.
+	if (header.source_size != stamp.size || header.source_modification_time != stamp.modification_time) {
+		if (header.source_hash != hash_file(source_path)) {
+			LogInfo("Mesh cache \"%s\" is out of date", path.c_str());
+			return false;
+		}
+		LogInfo("\"%s\" was touched but not modified; keeping its mesh cache", source_path.c_str());
+	}
+
+	cache.materials.resize(header.materials_nb);
+	for (auto& material : cache.materials) {
+		u32 textures_nb = 0u;
+		if (!stream.read(textures_nb))
+			return false;
+		material.resize(textures_nb);
+		for (auto& texture : material) {
+			u32 generate_mipmap = 0u;
+			if (!stream.read(texture.name) || !stream.read(texture.path) || !stream.read(generate_mipmap))
+				return false;
+			texture.generate_mipmap = generate_mipmap != 0u;
+		}
+	}
+
+	cache.meshes.reserve(header.meshes_nb);
+	for (u32 i = 0u; i < header.meshes_nb; ++i) {
+		mesh_record record;
+		if (!stream.read(record))
+			return false;
+
+		mesh_entry mesh;
+		mesh.material_id = record.material_id;
+		mesh.attributes = record.attributes;
+		mesh.vertices_nb = record.vertices_nb;
+		mesh.indices_nb = record.indices_nb;
+
+		auto const layout = get_packed_layout(mesh, format);
+		auto const vertex_data_size = static_cast<u64>(layout.vertex_size) * record.vertices_nb;
+		auto const positions_size = static_cast<u64>(record.vertices_nb) * sizeof(glm::vec3);
+		auto const indices_size = static_cast<u64>(record.indices_nb) * sizeof(u32);
+		if (record.vertex_data_size != vertex_data_size
+		    || record.vertex_data_offset % data_alignment != 0u
+		    || record.positions_offset % data_alignment != 0u
+		    || record.indices_offset % data_alignment != 0u
+		    || record.vertex_data_offset > file_size || vertex_data_size > file_size - record.vertex_data_offset
+		    || record.positions_offset > file_size || positions_size > file_size - record.positions_offset
+		    || record.indices_offset > file_size || indices_size > file_size - record.indices_offset) {
+			LogWarning("Ignoring mesh cache \"%s\": mesh %u is corrupted", path.c_str(), i);
+			return false;
+		}
+
+		mesh.bounds.min = glm::vec3(record.bounds_min[0], record.bounds_min[1], record.bounds_min[2]);
+		mesh.bounds.max = glm::vec3(record.bounds_max[0], record.bounds_max[1], record.bounds_max[2]);
+		mesh.bounds.center = glm::vec3(record.bounds_center[0], record.bounds_center[1], record.bounds_center[2]);
+		mesh.bounds.radius = record.bounds_radius;
+		mesh.bounds.is_valid = record.vertices_nb > 0u;
+		mesh.vertex_data = base + record.vertex_data_offset;
+		mesh.vertex_data_size = static_cast<size_t>(vertex_data_size);
+		mesh.positions = reinterpret_cast<glm::vec3 const*>(base + record.positions_offset);
+		mesh.indices = reinterpret_cast<u32 const*>(base + record.indices_offset);
+		cache.meshes.push_back(mesh);
+	}
+
+	return true;
+}
+
+bool
+bonobo::mesh_cache::write(std::string const& path, std::string const& source_path, u32 import_flags, u32 optimization_stages, vertex_format const& format, std::vector<material_entry> const& materials, std::vector<mesh_entry> const& meshes)
+{
+	source_stamp stamp;
+	auto const source_hash = hash_file(source_path);
+	if (source_hash == 0u || !get_stamp(source_path, stamp))
+		return false;
+
+	auto const temporary_path = path + ".tmp";
+	{
+		std::ofstream stream(temporary_path, std::ios::binary | std::ios::trunc);
+		if (!stream.is_open()) {
+			LogWarning("Couldn't create mesh cache \"%s\"", temporary_path.c_str());
+			return false;
+		}
+
+		file_header header;
+		std::memcpy(header.magic, magic, sizeof(magic));
+		header.version = version;
+		header.import_flags = import_flags;
+		header.optimization_stages = optimization_stages;
+		encode_format(format, header.vertex_format);
+		header.source_hash = source_hash;
+		header.source_size = stamp.size;
+		header.source_modification_time = stamp.modification_time;
+		header.materials_nb = static_cast<u32>(materials.size());
+		header.meshes_nb = static_cast<u32>(meshes.size());
+		stream.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+		for (auto const& material : materials) {
+			auto const textures_nb = static_cast<u32>(material.size());
+			stream.write(reinterpret_cast<char const*>(&textures_nb), sizeof(textures_nb));
+			for (auto const& texture : material) {
+				write_string(stream, texture.name);
+				write_string(stream, texture.path);
+				u32 const generate_mipmap = texture.generate_mipmap ? 1u : 0u;
+				stream.write(reinterpret_cast<char const*>(&generate_mipmap), sizeof(generate_mipmap));
+			}
+		}
+
+		// The records are written once the data offsets are known.
+		auto const records_position = stream.tellp();
+		std::vector<mesh_record> records(meshes.size());
+		stream.write(reinterpret_cast<char const*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(mesh_record)));
+
+		for (size_t i = 0u; i < meshes.size(); ++i) {
+			auto const& mesh = meshes[i];
+			auto& record = records[i];
+			record.material_id = mesh.material_id;
+			record.attributes = mesh.attributes;
+			record.vertices_nb = mesh.vertices_nb;
+			record.indices_nb = mesh.indices_nb;
+			for (int j = 0; j < 3; ++j) {
+				record.bounds_min[j] = mesh.bounds.min[j];
+				record.bounds_max[j] = mesh.bounds.max[j];
+				record.bounds_center[j] = mesh.bounds.center[j];
+			}
+			record.bounds_radius = mesh.bounds.radius;
+
+			pad_to_alignment(stream);
+			record.vertex_data_offset = static_cast<u64>(stream.tellp());
+			record.vertex_data_size = mesh.vertex_data_size;
+			stream.write(static_cast<char const*>(mesh.vertex_data), static_cast<std::streamsize>(mesh.vertex_data_size));
+
+			// Planar vertices start with their positions, interleaved ones
+			// need a separate copy.
+			if (static_cast<void const*>(mesh.positions) == mesh.vertex_data) {
+				record.positions_offset = record.vertex_data_offset;
+			} else {
+				pad_to_alignment(stream);
+				record.positions_offset = static_cast<u64>(stream.tellp());
+				stream.write(reinterpret_cast<char const*>(mesh.positions), static_cast<std::streamsize>(mesh.vertices_nb * sizeof(glm::vec3)));
+			}
+
+			pad_to_alignment(stream);
+			record.indices_offset = static_cast<u64>(stream.tellp());
+			stream.write(reinterpret_cast<char const*>(mesh.indices), static_cast<std::streamsize>(mesh.indices_nb * sizeof(u32)));
+		}
+
+		stream.seekp(records_position);
+		stream.write(reinterpret_cast<char const*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(mesh_record)));
+
+		if (!stream.good()) {
+			LogWarning("Failed to write mesh cache \"%s\"", temporary_path.c_str());
+			stream.close();
+			std::remove(temporary_path.c_str());
+			return false;
+		}
+	}
+
+	std::remove(path.c_str()); // rename() does not overwrite on Windows
+	if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+		LogWarning("Couldn't move mesh cache to \"%s\"", path.c_str());
+		std::remove(temporary_path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool
+bonobo::mesh_cache::import_scene(std::string const& scene_path, u32 optimization_stages, vertex_format const& format, contents& scene)
+{
+	scene = contents();
+	scene.format = format;
+
+	Assimp::Importer importer;
+	auto const assimp_scene = importer.ReadFile(scene_path, assimp_import_flags);
+	if (assimp_scene == nullptr || assimp_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || assimp_scene->mRootNode == nullptr) {
+		LogError("Assimp failed to load \"%s\": %s", scene_path.c_str(), importer.GetErrorString());
+		return false;
+	}
+
+	if (assimp_scene->mNumMeshes == 0u) {
+		LogError("No mesh available; loading \"%s\" must have had issues", scene_path.c_str());
+		return false;
+	}
+
+	scene.materials.reserve(assimp_scene->mNumMaterials);
+	for (size_t i = 0; i < assimp_scene->mNumMaterials; ++i) {
+		material_entry textures;
+		auto const material = assimp_scene->mMaterials[i];
+
+		auto const process_texture = [&textures,&material,i](aiTextureType type, std::string const& type_as_str, std::string const& name){
+			if (material->GetTextureCount(type)) {
+				if (material->GetTextureCount(type) > 1)
+					LogWarning("Material %d has more than one %s texture: discarding all but the first one.", i, type_as_str.c_str());
+				aiString path;
+				material->GetTexture(type, 0, &path);
+				textures.push_back({ name, "../crysponza/" + std::string(path.C_Str()), type_as_str != "opacity" });
+			}
+		};
+
+		process_texture(aiTextureType_DIFFUSE,  "diffuse",  "diffuse_texture");
+		process_texture(aiTextureType_SPECULAR, "specular", "specular_texture");
+		process_texture(aiTextureType_NORMALS,  "normals",  "normals_texture");
+		process_texture(aiTextureType_OPACITY,  "opacity",  "opacity_texture");
+
+		scene.materials.push_back(textures);
+	}
+
+	mesh_optimizer::cache_statistics statistics_before, statistics_after;
+	scene.meshes.reserve(assimp_scene->mNumMeshes);
+	scene.buffers.reserve(3u * assimp_scene->mNumMeshes);
+	for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
+		auto const assimp_object_mesh = assimp_scene->mMeshes[j];
+
+		if (!assimp_object_mesh->HasFaces()) {
+			LogError("Unsupported object \"%s\": has no faces", assimp_object_mesh->mName.C_Str());
+			continue;
+		}
+		if ((assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_POINT))    != 0u
+		 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_LINE))     != 0u
+		 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_TRIANGLE)) != 0u) {
+			LogError("Unsupported object \"%s\": uses multiple primitive types", assimp_object_mesh->mName.C_Str());
+			continue;
+		}
+		if ((assimp_object_mesh->mPrimitiveTypes & static_cast<uint32_t>(aiPrimitiveType_POLYGON)) == static_cast<uint32_t>(aiPrimitiveType_POLYGON)) {
+			LogError("Unsupported object \"%s\": uses polygons", assimp_object_mesh->mName.C_Str());
+			continue;
+		}
+		if (!assimp_object_mesh->HasPositions()) {
+			LogError("Unsupported object \"%s\": has no positions", assimp_object_mesh->mName.C_Str());
+			continue;
+		}
+
+		mesh_entry mesh;
+		mesh.material_id = assimp_object_mesh->mMaterialIndex;
+		mesh.attributes = (assimp_object_mesh->HasNormals()               ? attribute::normals   : 0u)
+		                | (assimp_object_mesh->HasTextureCoords(0u)        ? attribute::texcoords : 0u)
+		                | (assimp_object_mesh->HasTangentsAndBitangents() ? attribute::tangents  : 0u);
+		mesh.vertices_nb = assimp_object_mesh->mNumVertices;
+
+		// Pack all streams in a single buffer, to upload and cache it at once.
+		auto const stream_size = static_cast<size_t>(mesh.vertices_nb) * sizeof(glm::vec3);
+		std::vector<u8> vertex_data;
+		vertex_data.reserve(get_streams_nb(mesh.attributes) * stream_size);
+		auto const append_stream = [&vertex_data,stream_size](aiVector3D const* stream){
+			auto const first = reinterpret_cast<u8 const*>(stream);
+			vertex_data.insert(vertex_data.end(), first, first + stream_size);
+		};
+		append_stream(assimp_object_mesh->mVertices);
+		if (mesh.attributes & attribute::normals)
+			append_stream(assimp_object_mesh->mNormals);
+		if (mesh.attributes & attribute::texcoords)
+			append_stream(assimp_object_mesh->mTextureCoords[0u]);
+		if (mesh.attributes & attribute::tangents) {
+			append_stream(assimp_object_mesh->mTangents);
+			append_stream(assimp_object_mesh->mBitangents);
+		}
+		mesh.bounds = bonobo::compute_bounding_volume(reinterpret_cast<glm::vec3 const*>(vertex_data.data()), mesh.vertices_nb);
+
+		auto const num_vertices_per_face = assimp_object_mesh->mFaces[0u].mNumIndices;
+		std::vector<u8> indices_data(static_cast<size_t>(assimp_object_mesh->mNumFaces) * num_vertices_per_face * sizeof(u32));
+		auto const indices = reinterpret_cast<u32*>(indices_data.data());
+		for (size_t i = 0u; i < assimp_object_mesh->mNumFaces; ++i) {
+			auto const& face = assimp_object_mesh->mFaces[i];
+			assert(face.mNumIndices <= 3);
+			indices[num_vertices_per_face * i + 0u] = face.mIndices[0u];
+			if (num_vertices_per_face >= 1u)
+				indices[num_vertices_per_face * i + 1u] = face.mIndices[1u];
+			if (num_vertices_per_face >= 2u)
+				indices[num_vertices_per_face * i + 2u] = face.mIndices[2u];
+		}
+		mesh.indices_nb = static_cast<u32>(indices_data.size() / sizeof(u32));
+
+		if (optimization_stages != 0u && num_vertices_per_face == 3u) {
+			std::vector<glm::vec3*> streams(get_streams_nb(mesh.attributes));
+			for (size_t i = 0u; i < streams.size(); ++i)
+				streams[i] = reinterpret_cast<glm::vec3*>(vertex_data.data()) + i * mesh.vertices_nb;
+			statistics_before += mesh_optimizer::simulate_vertex_cache(indices, mesh.indices_nb, mesh.vertices_nb);
+			mesh_optimizer::optimize(optimization_stages, indices, mesh.indices_nb, streams.data(), streams.size(), mesh.vertices_nb);
+			statistics_after += mesh_optimizer::simulate_vertex_cache(indices, mesh.indices_nb, mesh.vertices_nb);
+		}
+
+		// Pack the vertices in the requested format once and for all.
+		mesh.vertex_data = vertex_data.data();
+		auto packed = bonobo::pack_vertices(get_vertex_streams(mesh), format);
+		scene.buffers.push_back(std::move(packed.data));
+		mesh.vertex_data = scene.buffers.back().data();
+		mesh.vertex_data_size = scene.buffers.back().size();
+		if (format.arrangement == vertex_format::layout::planar) {
+			mesh.positions = static_cast<glm::vec3 const*>(mesh.vertex_data);
+		} else {
+			vertex_data.resize(stream_size);
+			scene.buffers.push_back(std::move(vertex_data));
+			mesh.positions = reinterpret_cast<glm::vec3 const*>(scene.buffers.back().data());
+		}
+		scene.buffers.push_back(std::move(indices_data));
+		mesh.indices = reinterpret_cast<u32 const*>(scene.buffers.back().data());
+		scene.meshes.push_back(mesh);
+	}
+
+	if (statistics_before.triangles_nb != 0u)
+		LogInfo("Optimised the meshes of \"%s\": ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (FIFO cache of %u vertices)",
+		        scene_path.c_str(), statistics_before.get_acmr(), statistics_after.get_acmr(),
+		        statistics_before.get_atvr(), statistics_after.get_atvr(), mesh_optimizer::default_cache_size);
+
+	return true;
+}
+
+bool
+bonobo::mesh_cache::load(std::string const& scene_path, u32 optimization_stages, vertex_format const& format, contents& scene)
+{
+	auto const cache_path = get_path(scene_path, format);
+	if (read(cache_path, scene_path, assimp_import_flags, optimization_stages, format, scene)) {
+		LogInfo("Loading \"%s\" from \"%s\"", scene_path.c_str(), cache_path.c_str());
+		scene.from_cache = true;
+		return true;
+	}
+
+	LogInfo("Loading \"%s\" with Assimp", scene_path.c_str());
+	if (!import_scene(scene_path, optimization_stages, format, scene))
+		return false;
+
+	if (write(cache_path, scene_path, assimp_import_flags, optimization_stages, format, scene.materials, scene.meshes))
+		LogInfo("Wrote mesh cache \"%s\"", cache_path.c_str());
+
+	return true;
+}
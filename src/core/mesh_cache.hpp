@@ -0,0 +1,163 @@
+#pragma once
+
+#include "culling.hpp"
+#include "mapped_file.hpp"
+#include "Types.h"
+#include "vertex_format.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Binary cache of imported meshes, written next to the source
+	//!        asset so that later runs can skip Assimp altogether.
+	//!
+	//! A cache file is only used if it was written with the same format
+	//! version, from the same source file, and with the same Assimp import
+	//! flags. The source file is only hashed when its size or modification
+	//! time changed since the cache was written. Vertices are stored
+	//! already packed in a given `vertex_format`, with one cache per
+	//! format, so that they can be uploaded straight from a memory mapping
+	//! of the file.
+	namespace mesh_cache
+	{
+		//! \brief Version of the file layout; bump it whenever the layout
+		//!        changes, to invalidate existing caches.
+		constexpr u32 version = 3u;
+
+		//! \brief Optional vertex streams stored for a mesh.
+		enum attribute : u32 {
+			normals   = 1u << 0u,
+			texcoords = 1u << 1u,
+			tangents  = 1u << 2u //!< both tangents and binormals
+		};
+
+		//! \brief Texture referenced by a material.
+		struct texture_entry {
+			std::string name;     //!< sampler name, i.e. `diffuse_texture`
+			std::string path;     //!< as given to `bonobo::loadTexture2D()`
+			bool generate_mipmap; //!< as given to `bonobo::loadTexture2D()`
+		};
+
+		//! \brief All textures referenced by a material.
+		using material_entry = std::vector<texture_entry>;
+
+		//! \brief A mesh, as stored in a cache.
+		//!
+		//! The vertices are packed by `bonobo::pack_vertices()`, in the
+		//! vertex format of the cache; `get_packed_layout()` describes
+		//! their attributes.
+		struct mesh_entry {
+			u32 material_id;          //!< index into the materials, or ~0u
+			u32 attributes;           //!< combination of `attribute` flags
+			u32 vertices_nb;          //!< number of vertices per stream
+			u32 indices_nb;           //!< number of indices
+			bounding_volume bounds;   //!< model-space bounds
+			void const* vertex_data;  //!< start of the packed vertices
+			size_t vertex_data_size;  //!< size in bytes of the vertices
+			glm::vec3 const* positions; //!< positions alone, tightly packed;
+			                            //!< within `vertex_data` for planar
+			                            //!< formats
+			u32 const* indices;       //!< start of the indices
+		};
+
+		//! \brief Content of a cache file, or of an imported scene; the
+		//!        pointers of the meshes point into `file` or `buffers`,
+		//!        and are only valid as long as those are.
+		struct contents {
+			MappedFile file;
+			std::vector<std::vector<u8>> buffers; //!< data of imported meshes
+			std::vector<material_entry> materials;
+			std::vector<mesh_entry> meshes;
+			vertex_format format; //!< how the vertices are packed
+			bool from_cache = false; //!< whether read from a cache file
+		};
+
+		//! \brief Size and modification time of a source file, checked
+		//!        before falling back to its content hash.
+		struct source_stamp {
+			u64 size;
+			u64 modification_time;
+		};
+
+		//! \brief Return the number of vertex streams used by a mesh
+		//!        packed in `vertex_format::planar()`.
+		size_t get_streams_nb(u32 attributes);
+
+		//! \brief Return the vertex streams of a mesh packed in
+		//!        `vertex_format::planar()`, pointing into its vertex data.
+		vertex_streams get_vertex_streams(mesh_entry const& mesh);
+
+		//! \brief Return the layout of the packed vertices of a mesh.
+		packed_vertices get_packed_layout(mesh_entry const& mesh, vertex_format const& format);
+
+		//! \brief Hash the content of a file (64-bit FNV-1a).
+		//!
+		//! @return the hash, or 0 if the file could not be read
+		u64 hash_file(std::string const& path);
+
+		//! \brief Get the size and modification time of a file.
+		//!
+		//! @return whether the file exists
+		bool get_stamp(std::string const& path, source_stamp& stamp);
+
+		//! \brief Return where the cache of an asset, for a given vertex
+		//!        format, is stored.
+		std::string get_path(std::string const& asset_path, vertex_format const& format);
+
+		//! \brief Map and validate a cache file.
+		//!
+		//! @param [in] path path to the cache file
+		//! @param [in] source_path path to the source asset
+		//! @param [in] import_flags Assimp flags used for the import
+		//! @param [in] optimization_stages `mesh_optimizer::stage` flags
+		//!             used for the import
+		//! @param [in] format vertex format the cache should be in
+		//! @param [out] cache filled in on success
+		//! @return whether the cache exists and is up to date
+		bool read(std::string const& path, std::string const& source_path,
+		          u32 import_flags, u32 optimization_stages,
+		          vertex_format const& format, contents& cache);
+
+		//! \brief Write a cache file.
+		//!
+		//! The file is first written under a temporary name, so that a
+		//! partially written cache is never picked up.
+		//!
+		//! @return whether the cache could be written
+		bool write(std::string const& path, std::string const& source_path,
+		           u32 import_flags, u32 optimization_stages,
+		           vertex_format const& format,
+		           std::vector<material_entry> const& materials,
+		           std::vector<mesh_entry> const& meshes);
+
+		//! \brief Import a scene file with Assimp, reorder the triangles
+		//!        and vertices of its meshes, and pack their vertices.
+		//!
+		//! @param [in] scene_path path to the scene file
+		//! @param [in] optimization_stages `mesh_optimizer::stage` flags
+		//!             to run on each mesh
+		//! @param [in] format how to pack the vertices
+		//! @param [out] scene filled in on success
+		//! @return whether the scene could be imported
+		bool import_scene(std::string const& scene_path, u32 optimization_stages,
+		                  vertex_format const& format, contents& scene);
+
+		//! \brief Load a scene file from its cache when it is up to date,
+		//!        otherwise import it and write its cache.
+		//!
+		//! Only the main file is checked: editing a .mtl file alone
+		//! requires deleting the cache.
+		//!
+		//! @param [in] scene_path path to the scene file
+		//! @param [in] optimization_stages `mesh_optimizer::stage` flags
+		//!             to run on each mesh when importing it
+		//! @param [in] format how to pack the vertices
+		//! @param [out] scene filled in on success
+		//! @return whether the scene could be loaded
+		bool load(std::string const& scene_path, u32 optimization_stages,
+		          vertex_format const& format, contents& scene);
+	}
+}
@@ -0,0 +1,314 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+	// Parameters of the scoring function, as tuned by Tom Forsyth in
+	// "Linear-Speed Vertex Cache Optimisation".
+	constexpr int forsyth_cache_size = 32;
+	constexpr float forsyth_cache_decay_power = 1.5f;
+	constexpr float forsyth_last_triangle_score = 0.75f;
+	constexpr float forsyth_valence_boost_scale = 2.0f;
+	constexpr float forsyth_valence_boost_power = 0.5f;
+
+	float get_vertex_score(int cache_position, u32 live_triangles_nb)
+	{
+		if (live_triangles_nb == 0u)
+			return -1.0f; // no triangle left to draw with it
+
+		auto score = 0.0f;
+		if (cache_position >= 0) {
+			// The vertices of the last triangle get a fixed score, so that
+			// the next triangle does not simply reuse the same edge.
+			if (cache_position < 3)
+				score = forsyth_last_triangle_score;
+			else
+				score = std::pow(1.0f - static_cast<float>(cache_position - 3) / static_cast<float>(forsyth_cache_size - 3),
+				                 forsyth_cache_decay_power);
+		}
+
+		// Favour vertices with few triangles left, to get rid of them
+		// before they leave the cache.
+		score += forsyth_valence_boost_scale * std::pow(static_cast<float>(live_triangles_nb), -forsyth_valence_boost_power);
+		return score;
+	}
+}
+
+float
+bonobo::mesh_optimizer::cache_statistics::get_acmr() const
+{
+	return triangles_nb != 0u ? static_cast<float>(transformed_nb) / static_cast<float>(triangles_nb) : 0.0f;
+}
+
+float
+bonobo::mesh_optimizer::cache_statistics::get_atvr() const
+{
+	return vertices_nb != 0u ? static_cast<float>(transformed_nb) / static_cast<float>(vertices_nb) : 0.0f;
+}
+
+bonobo::mesh_optimizer::cache_statistics&
+bonobo::mesh_optimizer::cache_statistics::operator+=(cache_statistics const& other)
+{
+	transformed_nb += other.transformed_nb;
+	triangles_nb += other.triangles_nb;
+	vertices_nb += other.vertices_nb;
+	return *this;
+}
+
+bonobo::mesh_optimizer::cache_statistics
+bonobo::mesh_optimizer::simulate_vertex_cache(u32 const* indices, size_t indices_nb, size_t vertices_nb, u32 cache_size)
+{
+	cache_statistics statistics;
+	statistics.triangles_nb = indices_nb / 3u;
+
+	// A FIFO cache only changes on misses: a vertex is still cached if
+	// fewer than `cache_size` misses happened since it was inserted.
+	std::vector<size_t> insertion_time(vertices_nb, 0u);
+	std::vector<bool> is_referenced(vertices_nb, false);
+	size_t time = static_cast<size_t>(cache_size) + 1u;
+	for (size_t i = 0u; i < indices_nb; ++i) {
+		auto const vertex = indices[i];
+		if (!is_referenced[vertex]) {
+			is_referenced[vertex] = true;
+			++statistics.vertices_nb;
+		}
+		if (time - insertion_time[vertex] > cache_size) {
+			insertion_time[vertex] = time++;
+			++statistics.transformed_nb;
+		}
+	}
+
+	return statistics;
+}
+
+void
+bonobo::mesh_optimizer::optimize_vertex_cache(u32* indices, size_t indices_nb, size_t vertices_nb)
+{
+	auto const triangles_nb = indices_nb / 3u;
+	if (triangles_nb == 0u)
+		return;
+
+	// Triangles using each vertex, as offsets into a single array.
+	std::vector<u32> live_triangles_nb(vertices_nb, 0u);
+	for (size_t i = 0u; i < triangles_nb * 3u; ++i)
+		++live_triangles_nb[indices[i]];
+	std::vector<u32> adjacency_offsets(vertices_nb + 1u, 0u);
+	for (size_t v = 0u; v < vertices_nb; ++v)
+		adjacency_offsets[v + 1u] = adjacency_offsets[v] + live_triangles_nb[v];
+	std::vector<u32> adjacency(adjacency_offsets.back());
+	{
+		auto fill_offsets = adjacency_offsets;
+		for (size_t t = 0u; t < triangles_nb; ++t)
+			for (size_t k = 0u; k < 3u; ++k)
+				adjacency[fill_offsets[indices[3u * t + k]]++] = static_cast<u32>(t);
+	}
+
+	std::vector<int> cache_positions(vertices_nb, -1);
+	std::vector<float> vertex_scores(vertices_nb);
+	for (size_t v = 0u; v < vertices_nb; ++v)
+		vertex_scores[v] = get_vertex_score(-1, live_triangles_nb[v]);
+
+	// Triangle scores are only needed to pick the next triangle, so they
+	// are recomputed from the vertex scores rather than stored.
+	auto const get_triangle_score = [indices,&vertex_scores](size_t t){
+		return vertex_scores[indices[3u * t]] + vertex_scores[indices[3u * t + 1u]] + vertex_scores[indices[3u * t + 2u]];
+	};
+	std::vector<bool> is_emitted(triangles_nb, false);
+
+	std::vector<u32> output;
+	output.reserve(triangles_nb * 3u);
+	std::vector<u32> cache, next_cache;
+	cache.reserve(forsyth_cache_size + 3);
+	next_cache.reserve(forsyth_cache_size + 3);
+
+	size_t best_triangle = 0u;
+	auto initial_best_score = get_triangle_score(0u);
+	for (size_t t = 1u; t < triangles_nb; ++t) {
+		auto const score = get_triangle_score(t);
+		if (score > initial_best_score) {
+			initial_best_score = score;
+			best_triangle = t;
+		}
+	}
+	size_t next_unemitted = 0u;
+	for (size_t emitted_nb = 0u; emitted_nb < triangles_nb; ++emitted_nb) {
+		if (best_triangle == triangles_nb) {
+			// Nothing in the cache can be used anymore: restart from the
+			// first triangle left, as a full scan would be quadratic.
+			while (is_emitted[next_unemitted])
+				++next_unemitted;
+			best_triangle = next_unemitted;
+		}
+
+		auto const triangle = indices + 3u * best_triangle;
+		output.insert(output.end(), triangle, triangle + 3u);
+		is_emitted[best_triangle] = true;
+
+		// Move the vertices of the triangle to the front of the cache.
+		next_cache.assign(triangle, triangle + 3u);
+		for (auto const vertex : cache)
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+				next_cache.push_back(vertex);
+		std::swap(cache, next_cache);
+
+		for (size_t k = 0u; k < 3u; ++k) {
+			auto const vertex = triangle[k];
+			auto const first = adjacency.begin() + adjacency_offsets[vertex];
+			auto const last = first + live_triangles_nb[vertex];
+			std::iter_swap(std::find(first, last, static_cast<u32>(best_triangle)), last - 1);
+			--live_triangles_nb[vertex];
+		}
+
+		// Update the scores of the cached and evicted vertices; those of
+		// their triangles are recomputed from them while looking for the
+		// next best triangle.
+		for (size_t i = 0u; i < cache.size(); ++i) {
+			auto const vertex = cache[i];
+			cache_positions[vertex] = i < static_cast<size_t>(forsyth_cache_size) ? static_cast<int>(i) : -1;
+			vertex_scores[vertex] = get_vertex_score(cache_positions[vertex], live_triangles_nb[vertex]);
+		}
+
+		auto best_score = -1.0f;
+		best_triangle = triangles_nb;
+		for (auto const vertex : cache) {
+			auto const first = adjacency.begin() + adjacency_offsets[vertex];
+			for (auto it = first; it != first + live_triangles_nb[vertex]; ++it) {
+				auto const score = get_triangle_score(*it);
+				if (score > best_score) {
+					best_score = score;
+					best_triangle = *it;
+				}
+			}
+		}
+
+		if (cache.size() > static_cast<size_t>(forsyth_cache_size))
+			cache.resize(forsyth_cache_size);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void
+bonobo::mesh_optimizer::optimize_overdraw(u32* indices, size_t indices_nb, glm::vec3 const* positions, size_t vertices_nb, float threshold)
+{
+	auto const triangles_nb = indices_nb / 3u;
+	if (triangles_nb == 0u)
+		return;
+
+	auto const original_acmr = simulate_vertex_cache(indices, indices_nb, vertices_nb).get_acmr();
+
+	// Cut a cluster wherever a triangle misses the cache on all of its
+	// vertices: the cache order restarts there anyway.
+	std::vector<size_t> cluster_starts;
+	{
+		std::vector<size_t> insertion_time(vertices_nb, 0u);
+		size_t time = default_cache_size + 1u;
+		for (size_t t = 0u; t < triangles_nb; ++t) {
+			u32 misses_nb = 0u;
+			for (size_t k = 0u; k < 3u; ++k) {
+				auto const vertex = indices[3u * t + k];
+				if (time - insertion_time[vertex] > default_cache_size) {
+					insertion_time[vertex] = time++;
+					++misses_nb;
+				}
+			}
+			if (misses_nb == 3u)
+				cluster_starts.push_back(t);
+		}
+	}
+	cluster_starts.push_back(triangles_nb);
+
+	glm::vec3 mesh_centroid(0.0f);
+	auto mesh_area = 0.0f;
+	std::vector<glm::vec3> cluster_centroids(cluster_starts.size() - 1u, glm::vec3(0.0f));
+	std::vector<glm::vec3> cluster_normals(cluster_starts.size() - 1u, glm::vec3(0.0f));
+	for (size_t c = 0u; c + 1u < cluster_starts.size(); ++c) {
+		auto cluster_area = 0.0f;
+		for (auto t = cluster_starts[c]; t < cluster_starts[c + 1u]; ++t) {
+			auto const& p0 = positions[indices[3u * t]];
+			auto const& p1 = positions[indices[3u * t + 1u]];
+			auto const& p2 = positions[indices[3u * t + 2u]];
+			auto const normal = glm::cross(p1 - p0, p2 - p0); // twice the area
+			auto const area = glm::length(normal);
+			auto const centroid = (p0 + p1 + p2) / 3.0f;
+			cluster_centroids[c] += centroid * area;
+			cluster_normals[c] += normal;
+			cluster_area += area;
+			mesh_centroid += centroid * area;
+			mesh_area += area;
+		}
+		if (cluster_area > 0.0f)
+			cluster_centroids[c] /= cluster_area;
+		auto const normal_length = glm::length(cluster_normals[c]);
+		if (normal_length > 0.0f)
+			cluster_normals[c] /= normal_length;
+	}
+	if (mesh_area > 0.0f)
+		mesh_centroid /= mesh_area;
+
+	// Clusters facing away from the centre are likely to occlude the
+	// other ones, so they are drawn first.
+	std::vector<float> sort_keys(cluster_centroids.size());
+	for (size_t c = 0u; c < cluster_centroids.size(); ++c)
+		sort_keys[c] = glm::dot(cluster_centroids[c] - mesh_centroid, cluster_normals[c]);
+	std::vector<size_t> order(cluster_centroids.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&sort_keys](size_t lhs, size_t rhs){
+		return sort_keys[lhs] > sort_keys[rhs];
+	});
+
+	std::vector<u32> sorted;
+	sorted.reserve(triangles_nb * 3u);
+	for (auto const c : order)
+		sorted.insert(sorted.end(), indices + 3u * cluster_starts[c], indices + 3u * cluster_starts[c + 1u]);
+
+	if (simulate_vertex_cache(sorted.data(), sorted.size(), vertices_nb).get_acmr() <= original_acmr * threshold)
+		std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+std::vector<u32>
+bonobo::mesh_optimizer::optimize_vertex_fetch(u32* indices, size_t indices_nb, size_t vertices_nb)
+{
+	auto const unassigned = std::numeric_limits<u32>::max();
+	std::vector<u32> remap(vertices_nb, unassigned);
+	u32 next_vertex = 0u;
+	for (size_t i = 0u; i < indices_nb; ++i) {
+		auto& new_vertex = remap[indices[i]];
+		if (new_vertex == unassigned)
+			new_vertex = next_vertex++;
+		indices[i] = new_vertex;
+	}
+	for (auto& new_vertex : remap)
+		if (new_vertex == unassigned)
+			new_vertex = next_vertex++;
+	return remap;
+}
+
+void
+bonobo::mesh_optimizer::remap_stream(glm::vec3* stream, size_t vertices_nb, std::vector<u32> const& remap)
+{
+	std::vector<glm::vec3> original(stream, stream + vertices_nb);
+	for (size_t v = 0u; v < vertices_nb; ++v)
+		stream[remap[v]] = original[v];
+}
+
+void
+bonobo::mesh_optimizer::optimize(u32 stages, u32* indices, size_t indices_nb, glm::vec3* const* streams, size_t streams_nb, size_t vertices_nb)
+{
+	if (indices_nb % 3u != 0u || vertices_nb == 0u)
+		return;
+
+	if (stages & stage::vertex_cache)
+		optimize_vertex_cache(indices, indices_nb, vertices_nb);
+	if ((stages & stage::overdraw) && streams_nb > 0u)
+		optimize_overdraw(indices, indices_nb, streams[0], vertices_nb);
+	if (stages & stage::vertex_fetch) {
+		auto const remap = optimize_vertex_fetch(indices, indices_nb, vertices_nb);
+		for (size_t i = 0u; i < streams_nb; ++i)
+			remap_stream(streams[i], vertices_nb, remap);
+	}
+}
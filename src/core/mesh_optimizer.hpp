@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Types.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Reorder the triangles and vertices of indexed triangle
+	//!        meshes, so that GPUs transform and fetch fewer vertices.
+	//!
+	//! All functions work on triangle lists with 32-bit indices, and only
+	//! change the order of the triangles and vertices, never the shape of
+	//! the mesh.
+	namespace mesh_optimizer
+	{
+		//! \brief Optimisation stages, run in that order.
+		enum stage : u32 {
+			vertex_cache = 1u << 0u, //!< reorder triangles for the post-transform cache
+			overdraw     = 1u << 1u, //!< sort clusters of triangles, outer ones first
+			vertex_fetch = 1u << 2u  //!< reorder vertices in order of first use
+		};
+
+		//! \brief Stages used when nothing else is specified; sorting for
+		//!        overdraw slightly lowers the cache efficiency, so it is
+		//!        left for meshes known to have a lot of it.
+		constexpr u32 default_stages = vertex_cache | vertex_fetch;
+
+		//! \brief Size of the FIFO cache simulated by default, a common
+		//!        value for the post-transform cache of desktop GPUs.
+		constexpr u32 default_cache_size = 16u;
+
+		//! \brief Result of a vertex cache simulation.
+		struct cache_statistics {
+			size_t transformed_nb = 0u; //!< vertices missing the cache
+			size_t triangles_nb = 0u;
+			size_t vertices_nb = 0u;    //!< distinct vertices referenced
+
+			//! \brief Average Cache Miss Ratio: transformed vertices per
+			//!        triangle, 0.5 at best for a regular grid, 3 at worst.
+			float get_acmr() const;
+
+			//! \brief Average Transformed Vertex Ratio: transformed
+			//!        vertices per vertex, 1 at best.
+			float get_atvr() const;
+
+			cache_statistics& operator+=(cache_statistics const& other);
+		};
+
+		//! \brief Simulate a FIFO post-transform vertex cache.
+		//!
+		//! @param [in] indices the triangle list
+		//! @param [in] indices_nb the number of indices
+		//! @param [in] vertices_nb the number of vertices referenced by
+		//!             the indices
+		//! @param [in] cache_size the number of entries of the cache
+		cache_statistics simulate_vertex_cache(u32 const* indices, size_t indices_nb, size_t vertices_nb,
+		                                       u32 cache_size = default_cache_size);
+
+		//! \brief Reorder the triangles for the post-transform cache, using
+		//!        Tom Forsyth's linear-speed greedy algorithm.
+		//!
+		//! The next triangle is the best-scored one among those using a
+		//! cached vertex. When none is left, Forsyth rescans all remaining
+		//! triangles for the best one; this restarts from the first
+		//! triangle not yet emitted instead, which keeps the whole pass
+		//! linear at the cost of a slightly worse order on meshes made of
+		//! many disconnected pieces.
+		void optimize_vertex_cache(u32* indices, size_t indices_nb, size_t vertices_nb);
+
+		//! \brief Reorder clusters of triangles so that the ones facing
+		//!        outwards are drawn first, and occlude the other ones.
+		//!
+		//! Clusters are cut wherever the cache order restarts, so should be
+		//! run after `optimize_vertex_cache()`. The new order is discarded
+		//! if it raises the ACMR by more than `threshold`.
+		//!
+		//! @param [in] positions the positions of the vertices
+		//! @param [in] threshold maximal ratio between the ACMR after and
+		//!             before sorting
+		void optimize_overdraw(u32* indices, size_t indices_nb, glm::vec3 const* positions, size_t vertices_nb,
+		                       float threshold = 1.05f);
+
+		//! \brief Renumber the vertices in the order in which the indices
+		//!        first reference them; unreferenced vertices go last.
+		//!
+		//! @return for each vertex, its new index, to be passed to
+		//!         `remap_stream()` for every vertex attribute
+		std::vector<u32> optimize_vertex_fetch(u32* indices, size_t indices_nb, size_t vertices_nb);
+
+		//! \brief Move the elements of a vertex attribute to their new
+		//!        index.
+		void remap_stream(glm::vec3* stream, size_t vertices_nb, std::vector<u32> const& remap);
+
+		//! \brief Run optimisation stages on a mesh with planar vertex
+		//!        attributes, in place.
+		//!
+		//! @param [in] stages combination of `stage` flags
+		//! @param [in,out] indices the triangle list
+		//! @param [in] indices_nb the number of indices
+		//! @param [in,out] streams the vertex attributes, positions first
+		//! @param [in] streams_nb the number of vertex attributes
+		//! @param [in] vertices_nb the number of vertices
+		void optimize(u32 stages, u32* indices, size_t indices_nb,
+		              glm::vec3* const* streams, size_t streams_nb, size_t vertices_nb);
+	}
+}
@@ -1,20 +1,124 @@
 #include "node.hpp"
 #include "helpers.hpp"
+#include "stream_buffer.hpp"
+#include "uniform_buffer.hpp"
 
 #include "core/Log.h"
+#include "core/opengl.hpp"
 
-#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-Node::Node() : _vao(0u), _vertices_nb(0u), _indices_nb(0u), _drawing_mode(GL_TRIANGLES), _has_indices(true), _program(0u), _textures(), _scaling(1.0f, 1.0f, 1.0f), _rotation(), _translation(), _children()
+#include <algorithm>
+#include <utility>
+
+Node::Node() : Node(SceneGraph::get_default())
 {
 }
 
-Node::Node(float r) : _vao(0u), _vertices_nb(0u), _indices_nb(0u), _drawing_mode(GL_TRIANGLES), _has_indices(true), _program(0u), _textures(), _scaling(1.0f, 1.0f, 1.0f), _rotation(), _translation(), _children()
+Node::Node(float r) : Node(SceneGraph::get_default())
 {
     _r = r;
 }
 
+Node::Node(SceneGraph& graph) : _vao(0u), _depth_vao(0u), _vertices_nb(0u), _indices_nb(0u), _drawing_mode(GL_TRIANGLES), _has_indices(true), _base_vertex(0), _first_index(0u), _bounds(), _has_binormals(true), _program(0u), _textures(), _has_diffuse_texture(false), _has_opacity_texture(false), _uniform_locations(), _graph(&graph), _id(graph.create(this))
+{
+}
+
+Node::Node(Node const& other) : _r(other._r), _vao(other._vao), _depth_vao(other._depth_vao), _vertices_nb(other._vertices_nb), _indices_nb(other._indices_nb), _drawing_mode(other._drawing_mode), _has_indices(other._has_indices), _base_vertex(other._base_vertex), _first_index(other._first_index), _bounds(other._bounds), _has_binormals(other._has_binormals), _program(other._program), _set_uniforms(other._set_uniforms), _textures(other._textures), _has_diffuse_texture(other._has_diffuse_texture), _has_opacity_texture(other._has_opacity_texture), _uniform_locations(other._uniform_locations), _graph(other._graph), _id(other._graph->create(this))
+{
+	copy_transform(other);
+}
+
+Node::Node(Node&& other) noexcept : _r(other._r), _vao(other._vao), _depth_vao(other._depth_vao), _vertices_nb(other._vertices_nb), _indices_nb(other._indices_nb), _drawing_mode(other._drawing_mode), _has_indices(other._has_indices), _base_vertex(other._base_vertex), _first_index(other._first_index), _bounds(other._bounds), _has_binormals(other._has_binormals), _program(other._program), _set_uniforms(std::move(other._set_uniforms)), _textures(std::move(other._textures)), _has_diffuse_texture(other._has_diffuse_texture), _has_opacity_texture(other._has_opacity_texture), _uniform_locations(std::move(other._uniform_locations)), _graph(other._graph), _id(other._id)
+{
+	other._id = SceneGraph::invalid_id;
+	if (_id != SceneGraph::invalid_id)
+		_graph->set_owner(_id, this);
+}
+
+Node&
+Node::operator=(Node const& other)
+{
+	if (this == &other)
+		return *this;
+
+	// Only the transform is copied: this node keeps its place in the
+	// hierarchy.
+	copy_attributes(other);
+	copy_transform(other);
+	return *this;
+}
+
+Node&
+Node::operator=(Node&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	copy_attributes(other);
+	if (_id != SceneGraph::invalid_id)
+		_graph->destroy(_id);
+	_graph = other._graph;
+	_id = other._id;
+	other._id = SceneGraph::invalid_id;
+	if (_id != SceneGraph::invalid_id)
+		_graph->set_owner(_id, this);
+	return *this;
+}
+
+Node::~Node()
+{
+	if (_id != SceneGraph::invalid_id)
+		_graph->destroy(_id);
+}
+
+void
+Node::copy_attributes(Node const& other)
+{
+	_r = other._r;
+	_vao = other._vao;
+	_depth_vao = other._depth_vao;
+	_vertices_nb = other._vertices_nb;
+	_indices_nb = other._indices_nb;
+	_drawing_mode = other._drawing_mode;
+	_has_indices = other._has_indices;
+	_base_vertex = other._base_vertex;
+	_first_index = other._first_index;
+	_bounds = other._bounds;
+	_has_binormals = other._has_binormals;
+	_program = other._program;
+	_set_uniforms = other._set_uniforms;
+	_textures = other._textures;
+	_has_diffuse_texture = other._has_diffuse_texture;
+	_has_opacity_texture = other._has_opacity_texture;
+	_uniform_locations = other._uniform_locations;
+}
+
+void
+Node::copy_transform(Node const& other)
+{
+	auto const id = get_id();
+	if (other._id == SceneGraph::invalid_id) {
+		_graph->edit_translation(id) = glm::vec3(0.0f);
+		_graph->edit_rotation(id) = glm::vec3(0.0f);
+		_graph->edit_scaling(id) = glm::vec3(1.0f);
+		return;
+	}
+	_graph->edit_translation(id) = other._graph->get_translation(other._id);
+	_graph->edit_rotation(id) = other._graph->get_rotation(other._id);
+	_graph->edit_scaling(id) = other._graph->get_scaling(other._id);
+}
+
+SceneGraph::node_id
+Node::get_id()
+{
+	// A moved-from node gave its entry away; it gets a fresh one the
+	// first time it is used again.
+	if (_id == SceneGraph::invalid_id)
+		_id = _graph->create(this);
+	return _id;
+}
+
 void
 Node::render(glm::mat4 const& WVP, glm::mat4 const& world) const
 {
@@ -29,47 +133,104 @@ Node::render(glm::mat4 const& WVP, glm::mat4 const& world, GLuint program, std::
 
 	glUseProgram(program);
 
-	auto const normal_model_to_world = glm::transpose(glm::inverse(world));
-
 	set_uniforms(program);
 
-	glUniformMatrix4fv(glGetUniformLocation(program, "vertex_model_to_world"), 1, GL_FALSE, glm::value_ptr(world));
-	glUniformMatrix4fv(glGetUniformLocation(program, "normal_model_to_world"), 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
-	glUniformMatrix4fv(glGetUniformLocation(program, "vertex_world_to_clip"), 1, GL_FALSE, glm::value_ptr(WVP));
+	auto const& locations = get_uniform_locations(program);
+	set_object_uniforms(locations, world);
+	glUniformMatrix4fv(locations.vertex_world_to_clip, 1, GL_FALSE, glm::value_ptr(WVP));
 
-	glUniform1i(glGetUniformLocation(program, "has_textures"), !_textures.empty());
-	bool has_diffuse_texture = false, has_opacity_texture = false;
+	glUniform1i(locations.has_textures, !_textures.empty());
 	for (size_t i = 0u; i < _textures.size(); ++i) {
-		auto const texture = _textures[i];
+		auto const& texture = _textures[i];
 		glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
 		glBindTexture(std::get<2>(texture), std::get<1>(texture));
-		glUniform1i(glGetUniformLocation(program, std::get<0>(texture).c_str()), static_cast<GLint>(i));
-		if (std::get<0>(texture) == "diffuse_texture")
-			has_diffuse_texture = true;
-		else if (std::get<0>(texture) == "opacity_texture")
-			has_opacity_texture = true;
+		glUniform1i(locations.textures[i], static_cast<GLint>(i));
 	}
-	glUniform1i(glGetUniformLocation(program, "has_diffuse_texture"), has_diffuse_texture);
-	glUniform1i(glGetUniformLocation(program, "has_opacity_texture"), has_opacity_texture);
+	glUniform1i(locations.has_diffuse_texture, _has_diffuse_texture);
+	glUniform1i(locations.has_opacity_texture, _has_opacity_texture);
+	glUniform1i(locations.has_binormals, _has_binormals);
 
 	glBindVertexArray(_vao);
 	if (_has_indices)
-		glDrawElements(_drawing_mode, _indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
+		glDrawElementsBaseVertex(_drawing_mode, _indices_nb, GL_UNSIGNED_INT,
+		                         reinterpret_cast<GLvoid const*>(_first_index * sizeof(GLuint)), _base_vertex);
 	else
-		glDrawArrays(_drawing_mode, 0, _vertices_nb);
+		glDrawArrays(_drawing_mode, _base_vertex, _vertices_nb);
 	glBindVertexArray(0u);
 
 	glUseProgram(0u);
 }
 
+Node::uniform_locations const&
+Node::get_uniform_locations(GLuint program) const
+{
+	auto const reflection = utils::opengl::shader::get_reflection(program);
+	auto const generation = reflection != nullptr ? reflection->generation : 0u;
+
+	// A node is typically drawn with a handful of programs (g-buffer,
+	// shadow maps, depth pre-pass), so a linear search is enough.
+	auto it = std::find_if(_uniform_locations.begin(), _uniform_locations.end(),
+	                       [program](uniform_locations const& l){ return l.program == program; });
+	if (it != _uniform_locations.end()
+	    && it->generation == generation
+	    && it->textures.size() == _textures.size())
+		return *it;
+	if (it == _uniform_locations.end())
+		it = _uniform_locations.insert(it, uniform_locations());
+
+	auto const get_location = [program](std::string const& name){
+		return utils::opengl::shader::get_uniform_location(program, name);
+	};
+	auto& locations = *it;
+	locations.program = program;
+	locations.generation = generation;
+	locations.object_block = glGetUniformBlockIndex(program, "Object");
+	locations.vertex_model_to_world = get_location("vertex_model_to_world");
+	locations.normal_model_to_world = get_location("normal_model_to_world");
+	locations.vertex_world_to_clip = get_location("vertex_world_to_clip");
+	locations.has_textures = get_location("has_textures");
+	locations.has_diffuse_texture = get_location("has_diffuse_texture");
+	locations.has_opacity_texture = get_location("has_opacity_texture");
+	locations.has_binormals = get_location("has_binormals");
+	locations.textures.clear();
+	locations.textures.reserve(_textures.size());
+	for (auto const& texture : _textures)
+		locations.textures.push_back(get_location(std::get<0>(texture)));
+
+	return locations;
+}
+
+void
+Node::set_object_uniforms(uniform_locations const& locations, glm::mat4 const& world)
+{
+	auto const normal_model_to_world = glm::transpose(glm::inverse(world));
+
+	auto* const stream = bonobo::StreamBuffer::get_default();
+	if (locations.object_block != GL_INVALID_INDEX && stream != nullptr) {
+		auto const uniforms = bonobo::object_uniforms{ world, normal_model_to_world };
+		auto const block = stream->write(&uniforms, sizeof(uniforms), stream->get_uniform_alignment());
+		glBindBufferRange(GL_UNIFORM_BUFFER, static_cast<GLuint>(bonobo::uniform_block_bindings::object),
+		                  block.bo, block.offset, block.size);
+		return;
+	}
+
+	glUniformMatrix4fv(locations.vertex_model_to_world, 1, GL_FALSE, glm::value_ptr(world));
+	glUniformMatrix4fv(locations.normal_model_to_world, 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
+}
+
 void
 Node::set_geometry(bonobo::mesh_data const& shape)
 {
 	_vao = shape.vao;
+	_depth_vao = shape.depth_vao;
 	_vertices_nb = static_cast<GLsizei>(shape.vertices_nb);
 	_indices_nb = static_cast<GLsizei>(shape.indices_nb);
 	_drawing_mode = shape.drawing_mode;
 	_has_indices = shape.ibo != 0u;
+	_base_vertex = shape.base_vertex;
+	_first_index = shape.first_index;
+	_bounds = shape.bounds;
+	_has_binormals = shape.format.store_binormals;
 
 	if (!shape.bindings.empty()) {
 		for (auto const& binding : shape.bindings)
@@ -99,70 +260,109 @@ Node::set_indices_nb(size_t const& indices_nb)
 void
 Node::add_texture(std::string const& name, GLuint tex_id, GLenum type)
 {
-	if (tex_id != 0u)
-		_textures.emplace_back(name, tex_id, type);
+	if (tex_id == 0u)
+		return;
+
+	_textures.emplace_back(name, tex_id, type);
+	if (name == "diffuse_texture")
+		_has_diffuse_texture = true;
+	else if (name == "opacity_texture")
+		_has_opacity_texture = true;
 }
 
 void
 Node::add_child(Node const* child)
 {
-	if (child == nullptr)
+	if (child == nullptr) {
 		LogError("Trying to add a nullptr as child!");
-	_children.emplace_back(child);
+		return;
+	}
+	if (child->_graph != _graph) {
+		LogError("Trying to add a child from another scene graph!");
+		return;
+	}
+	if (child->_id == SceneGraph::invalid_id) {
+		LogError("Trying to add a moved-from node as child!");
+		return;
+	}
+	_graph->set_parent(child->_id, get_id());
 }
 
 size_t
 Node::get_children_nb() const
 {
-	return _children.size();
+	if (_id == SceneGraph::invalid_id)
+		return 0u;
+	return _graph->get_children_nb(_id);
 }
 
 Node const*
 Node::get_child(size_t index) const
 {
-	assert(index < _children.size());
-	return _children[index];
+	assert(index < get_children_nb());
+	return _graph->get_owner(_graph->get_child(_id, index));
 }
 
 void
 Node::set_translation(glm::vec3 const& translation)
 {
-	_translation = translation;
+	_graph->edit_translation(get_id()) = translation;
 }
 
 void
 Node::translate(glm::vec3 const& v)
 {
-	_translation += v;
+	_graph->edit_translation(get_id()) += v;
 }
 
 void
 Node::set_scaling(glm::vec3 const& scaling)
 {
-	_scaling = scaling;
+	_graph->edit_scaling(get_id()) = scaling;
 }
 
 void
 Node::scale(glm::vec3 const& s)
 {
-	_scaling *= s;
+	_graph->edit_scaling(get_id()) *= s;
 }
 
 glm::mat4x4
 Node::get_transform() const
 {
-	auto const scaling =  glm::scale(glm::mat4(), _scaling);
-	auto const translating = glm::translate(glm::mat4(), _translation);
-	auto const rotation_x = glm::rotate(glm::mat4(), _rotation.x, glm::vec3(1.0, 0.0, 0.0));
-	auto const rotation_y = glm::rotate(glm::mat4(), _rotation.y, glm::vec3(0.0, 1.0, 0.0));
-	auto const rotation_z = glm::rotate(glm::mat4(), _rotation.z, glm::vec3(0.0, 0.0, 1.0));
-	auto const rotating = rotation_z * rotation_y * rotation_x;
-
-	// Todo: Compute the correct transform matrix
-	return translating * rotating * scaling;
+	if (_id == SceneGraph::invalid_id)
+		return glm::mat4(1.0f);
+	return _graph->get_local_transform(_id);
 }
 
 glm::vec3
 Node::get_translation() const{
-	return _translation;
+	if (_id == SceneGraph::invalid_id)
+		return glm::vec3(0.0f);
+	return _graph->get_translation(_id);
+}
+
+glm::mat4 const&
+Node::get_world_transform() const
+{
+	static glm::mat4 const identity(1.0f);
+	if (_id == SceneGraph::invalid_id)
+		return identity;
+	return _graph->get_world_transform(_id);
+}
+
+void
+Node::render_hierarchy(glm::mat4 const& WVP) const
+{
+	if (_id == SceneGraph::invalid_id)
+		return;
+	_graph->visit(_id, [&WVP](Node const& node, glm::mat4 const& world){
+		node.render(WVP, world);
+	});
+}
+
+bonobo::bounding_volume const&
+Node::get_bounds() const
+{
+	return _bounds;
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "culling.hpp"
+#include "scene_graph.hpp"
+
 #include "external/glad/glad.h"
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -14,6 +17,12 @@ namespace bonobo
 }
 
 //! \brief Represents a node of a scene graph
+//!
+//! The transform of the node and its place in the hierarchy are stored in
+//! a `SceneGraph`, the node holding an identifier into it; nodes created
+//! without a graph go into `SceneGraph::get_default()`. Copies of a node
+//! get their own entry in the graph, with the same transform but neither
+//! parent nor children.
 class Node
 {
 public:
@@ -23,6 +32,18 @@ public:
     //! \brief Default constructor.
     Node(float r);
 
+	//! \brief Create a node in a specific scene graph.
+	explicit Node(SceneGraph& graph);
+
+	Node(Node const& other);
+	Node(Node&& other) noexcept;
+	Node& operator=(Node const& other);
+	Node& operator=(Node&& other) noexcept;
+
+	//! \brief Remove this node from its scene graph; its children become
+	//!        root nodes.
+	~Node();
+
     float _r = 100.0f;
 
 	//! \brief Render this node.
@@ -86,8 +107,11 @@ public:
 
 	//! \brief Add a child to this node.
 	//!
+	//! A node only has one parent: adding it to another node detaches it
+	//! from its previous parent.
+	//!
 	//! @param [in] child pointer to the child to add; the pointer has to
-	//!             be non-null
+	//!             be non-null, and belong to the same scene graph
 	void add_child(Node const* child);
 
 	//! \brief Return the number of children to this node.
@@ -117,40 +141,40 @@ public:
 	//!
 	//! @param [in] angle new rotation angle along the x-axis; it should be
 	//!                   given in radians
-	void set_rotation_x(float angle) { _rotation.x = angle; }
+	void set_rotation_x(float angle) { _graph->edit_rotation(get_id()).x = angle; }
 
 	//! \brief Rotate this node along the x-axis.
 	//!
 	//! @param [in] d_angle delta angle to add to the current rotation
 	//!                     angle around the x-axis; it should be given in
 	//!                     radians
-	void rotate_x(float d_angle) { _rotation.x += d_angle; }
+	void rotate_x(float d_angle) { _graph->edit_rotation(get_id()).x += d_angle; }
 
 	//! \brief Reset the rotation along the y-axis to a new value.
 	//!
 	//! @param [in] angle new rotation angle along the y-axis; it should be
 	//!                   given in radians
-	void set_rotation_y(float angle) { _rotation.y = angle; }
+	void set_rotation_y(float angle) { _graph->edit_rotation(get_id()).y = angle; }
 
 	//! \brief Rotate this node along the y-axis.
 	//!
 	//! @param [in] d_angle delta angle to add to the current rotation
 	//!                     angle around the y-axis; it should be given in
 	//!                     radians
-	void rotate_y(float d_angle) { _rotation.y += d_angle; }
+	void rotate_y(float d_angle) { _graph->edit_rotation(get_id()).y += d_angle; }
 
 	//! \brief Reset the rotation along the z-axis to a new value.
 	//!
 	//! @param [in] angle new rotation angle along the z-axis; it should be
 	//!                   given in radians
-	void set_rotation_z(float angle) { _rotation.z = angle; }
+	void set_rotation_z(float angle) { _graph->edit_rotation(get_id()).z = angle; }
 
 	//! \brief Rotate this node along the z-axis.
 	//!
 	//! @param [in] d_angle delta angle to add to the current rotation
 	//!                     angle around the z-axis; it should be given in
 	//!                     radians
-	void rotate_z(float d_angle) { _rotation.z += d_angle; }
+	void rotate_z(float d_angle) { _graph->edit_rotation(get_id()).z += d_angle; }
 
 	//! \brief Reset the scaling to a new value.
 	//!
@@ -172,15 +196,84 @@ public:
 
 	glm::vec3 get_translation() const;
 
+	//! \brief Return the matrix transforming from this node's model-space
+	//!        to world-space.
+	//!
+	//! @return the cached world matrix, recomputed by the scene graph if
+	//!         any transform changed since it was last updated
+	glm::mat4 const& get_world_transform() const;
+
+	//! \brief Render this node and all its descendants, with their cached
+	//!        world matrices, in one linear pass over the scene graph.
+	//!
+	//! @param [in] WVP Matrix transforming from world-space to clip-space
+	void render_hierarchy(glm::mat4 const& WVP) const;
+
+	//! \brief Return the model-space bounds of this node's geometry.
+	//!
+	//! @return the bounds given by the last call to `set_geometry()`;
+	//!         they are invalid if no geometry was set
+	bonobo::bounding_volume const& get_bounds() const;
+
 
 
 private:
+	friend class RenderQueue;
+
+	//! \brief Uniform locations used by `render()`, resolved once per
+	//!        program (and link of that program) the node is drawn with.
+	struct uniform_locations {
+		GLuint program;
+		size_t generation;
+		GLuint object_block;     //!< `GL_INVALID_INDEX` if the program
+		                         //!< has no `Object` uniform block
+		GLint vertex_model_to_world;
+		GLint normal_model_to_world;
+		GLint vertex_world_to_clip;
+		GLint has_textures;
+		GLint has_diffuse_texture;
+		GLint has_opacity_texture;
+		GLint has_binormals;
+		std::vector<GLint> textures; //!< one per entry in `_textures`
+	};
+
+	//! \brief Return the uniform locations for `program`, resolving them
+	//!        from the program's reflection cache the first time the
+	//!        program (or its latest link) is used with this node.
+	//!
+	//! The reference stays valid until the node is drawn with a program
+	//! it was never drawn with before.
+	uniform_locations const& get_uniform_locations(GLuint program) const;
+
+	//! \brief Hand the model-to-world and normal matrices of a draw to
+	//!        the program: through an `Object` block written to the
+	//!        window's `bonobo::StreamBuffer` if the program has one, or
+	//!        through plain uniforms otherwise.
+	static void set_object_uniforms(uniform_locations const& locations, glm::mat4 const& world);
+
+	//! \brief Copy everything but the transform and the hierarchy.
+	void copy_attributes(Node const& other);
+
+	//! \brief Copy the transform of another node, or reset it to the
+	//!        identity if that node was moved from.
+	void copy_transform(Node const& other);
+
+	//! \brief Get the scene-graph entry of this node, creating one with
+	//!        an identity transform if this node was moved from.
+	SceneGraph::node_id get_id();
+
 	// Geometry data
 	GLuint _vao;
+	GLuint _depth_vao;           //!< position-only, or 0
 	GLsizei _vertices_nb;
 	GLsizei _indices_nb;
 	GLenum _drawing_mode;
 	bool _has_indices;
+	GLint _base_vertex;
+	size_t _first_index;
+	bonobo::bounding_volume _bounds;
+	bool _has_binormals;         //!< otherwise rebuilt by the shaders,
+	                             //!< see `bonobo::vertex_format`
 
 	// Program data
 	GLuint _program;
@@ -188,12 +281,11 @@ private:
 
 	// Textures data
 	std::vector<std::tuple<std::string, GLuint, GLenum>> _textures;
+	bool _has_diffuse_texture;
+	bool _has_opacity_texture;
+	mutable std::vector<uniform_locations> _uniform_locations; //!< one per program
 
-	// Transformation data
-	glm::vec3 _scaling;
-	glm::vec3 _rotation; // as (angle around x-axis, angle around y-axis, angle around z-axis)
-	glm::vec3 _translation;
-
-	// Children data
-	std::vector<Node const*> _children;
+	// Transformation and hierarchy data
+	SceneGraph* _graph;
+	SceneGraph::node_id _id;
 };
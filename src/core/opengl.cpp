@@ -122,6 +122,9 @@ opengl_error_callback( GLenum source, GLenum type, GLuint id, GLenum severity
 namespace shader
 {
 
+static std::unordered_map<GLuint, program_reflection> reflections;
+static size_t reflections_generation = 0u;
+
 bool
 source_and_build_shader(GLuint id, std::string const& source)
 {
@@ -202,7 +205,10 @@ reload_program(GLuint id, std::vector<GLuint> const& ids, std::vector<std::strin
 	for (unsigned int i = 0u; i < ids.size(); ++i)
 		source_and_build_shader(ids[i], sources[i]);
 
-	link_program(id);
+	if (link_program(id))
+		reflect_program(id);
+	else
+		reflections.erase(id);
 }
 
 GLuint
@@ -215,13 +221,64 @@ generate_program(std::vector<GLuint> const& shaders_id)
 
 	auto const success = link_program(id);
 	if (success) {
+		reflect_program(id);
 		return id;
 	} else {
+		reflections.erase(id);
 		glDeleteProgram(id);
 		return 0u;
 	}
 }
 
+void
+reflect_program(GLuint id)
+{
+	program_reflection reflection;
+	reflection.program = id;
+	reflection.generation = ++reflections_generation;
+
+	GLint uniforms_nb = 0, max_name_length = 0;
+	glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &uniforms_nb);
+	glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+	std::unique_ptr<GLchar[]> name = std::make_unique<GLchar[]>(static_cast<size_t>(max_name_length) + 1u);
+	for (GLint i = 0; i < uniforms_nb; ++i) {
+		GLsizei name_length = 0;
+		GLint size = 0;
+		GLenum type = GL_NONE;
+		glGetActiveUniform(id, static_cast<GLuint>(i), max_name_length, &name_length, &size, &type, name.get());
+		auto uniform_name = std::string(name.get(), static_cast<size_t>(name_length));
+		GLint const location = glGetUniformLocation(id, uniform_name.c_str());
+		if (location < 0) // uniforms living in a block have no location
+			continue;
+		reflection.uniforms.emplace(uniform_name, location);
+
+		// Arrays are reported as `name[0]`, but are usually queried as `name`.
+		auto const bracket = uniform_name.find('[');
+		if (bracket != std::string::npos)
+			reflection.uniforms.emplace(uniform_name.substr(0u, bracket), location);
+	}
+
+	reflections[id] = std::move(reflection);
+}
+
+program_reflection const*
+get_reflection(GLuint id)
+{
+	auto const it = reflections.find(id);
+	return it != reflections.end() ? &it->second : nullptr;
+}
+
+GLint
+get_uniform_location(GLuint id, std::string const& name)
+{
+	auto const reflection = get_reflection(id);
+	if (reflection == nullptr)
+		return glGetUniformLocation(id, name.c_str());
+
+	auto const it = reflection->uniforms.find(name);
+	return it != reflection->uniforms.end() ? it->second : -1;
+}
+
 } // end of namespace shader
 
 namespace fullscreen
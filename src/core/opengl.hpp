@@ -4,6 +4,7 @@
 #include <GLFW/glfw3.h>
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 
@@ -33,11 +34,21 @@ opengl_error_callback( GLenum source, GLenum type, GLuint id
 namespace shader
 {
 
+struct program_reflection
+{
+	GLuint program;
+	size_t generation;
+	std::unordered_map<std::string, GLint> uniforms;
+};
+
 bool source_and_build_shader(GLuint id, std::string const& source);
 GLuint generate_shader(GLenum type, std::string const& source);
 bool link_program(GLuint id);
 void reload_program(GLuint id, std::vector<GLuint> const& ids, std::vector<std::string> const& sources);
 GLuint generate_program(std::vector<GLuint> const& shaders_id);
+void reflect_program(GLuint id);
+program_reflection const* get_reflection(GLuint id);
+GLint get_uniform_location(GLuint id, std::string const& name);
 
 } // end of namespace shader
 
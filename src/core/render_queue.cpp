@@ -0,0 +1,318 @@
+#include "render_queue.hpp"
+#include "culling.hpp"
+#include "Misc.h"
+#include "stream_buffer.hpp"
+
+#include <GLFW/glfw3.h>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <tuple>
+
+namespace
+{
+	constexpr size_t tracked_texture_units_nb = 32u;
+
+	constexpr unsigned int pass_shift     = 56u;
+	constexpr unsigned int program_shift  = 44u;
+	constexpr unsigned int material_shift = 24u;
+
+	constexpr uint64_t program_mask  = (1ull << 12u) - 1ull;
+	constexpr uint64_t material_mask = (1ull << 20u) - 1ull;
+	constexpr uint64_t depth_mask    = (1ull << 24u) - 1ull;
+
+	// The bit pattern of a positive IEEE-754 float grows with its value,
+	// so its 24 most significant bits can be used as a coarse depth.
+	uint64_t quantise_depth(float depth)
+	{
+		depth = std::max(depth, 0.0f);
+		uint32_t bits = 0u;
+		std::memcpy(&bits, &depth, sizeof(bits));
+		return static_cast<uint64_t>(bits >> 8u) & depth_mask;
+	}
+
+	// glad only loads OpenGL 4.1, so `glMultiDrawElementsIndirect()` is
+	// fetched here, once, when the context is recent enough to provide it.
+	using multi_draw_elements_indirect_proc = void (APIENTRYP)(GLenum mode, GLenum type, void const* indirect, GLsizei drawcount, GLsizei stride);
+
+	multi_draw_elements_indirect_proc
+	get_multi_draw_elements_indirect()
+	{
+		static auto const proc = []() -> multi_draw_elements_indirect_proc {
+			if ((GLVersion.major < 4 || (GLVersion.major == 4 && GLVersion.minor < 3))
+			    && !glfwExtensionSupported("GL_ARB_multi_draw_indirect"))
+				return nullptr;
+			return reinterpret_cast<multi_draw_elements_indirect_proc>(glfwGetProcAddress("glMultiDrawElementsIndirect"));
+		}();
+		return proc;
+	}
+}
+
+RenderQueue::RenderQueue() : _items(), _order(), _programs(), _materials(), _multi_draw(true), _counts(), _offsets(), _base_vertices(), _commands(), _stats()
+{
+}
+
+void
+RenderQueue::clear()
+{
+	_items.clear();
+	_order.clear();
+}
+
+void
+RenderQueue::push(Node const& node, glm::mat4 const& world, uint8_t pass)
+{
+	push(node, world, node._program, node._set_uniforms, pass);
+}
+
+void
+RenderQueue::push(Node const& node, glm::mat4 const& world, GLuint program, std::function<void (GLuint)> const& set_uniforms, uint8_t pass)
+{
+	push(node, world, program, set_uniforms, pass, node._vao, true);
+}
+
+void
+RenderQueue::push_depth_only(Node const& node, glm::mat4 const& world, GLuint program, GLuint alpha_tested_program, std::function<void (GLuint)> const& set_uniforms, uint8_t pass)
+{
+	if (node._has_opacity_texture)
+		push(node, world, alpha_tested_program, set_uniforms, pass, node._vao, true);
+	else
+		push(node, world, program, set_uniforms, pass, node._depth_vao != 0u ? node._depth_vao : node._vao, false);
+}
+
+void
+RenderQueue::push(Node const& node, glm::mat4 const& world, GLuint program, std::function<void (GLuint)> const& set_uniforms, uint8_t pass, GLuint vao, bool textured)
+{
+	if (vao == 0u || program == 0u)
+		return;
+
+	item queued;
+	queued.node = &node;
+	queued.world = world;
+	queued.program = program;
+	queued.set_uniforms = &set_uniforms;
+	queued.vao = vao;
+	queued.textured = textured;
+	queued.material = textured ? get_material_index(node) : 0u;
+	queued.pass = pass;
+	queued.key = (static_cast<uint64_t>(pass) << pass_shift)
+	           | ((static_cast<uint64_t>(get_program_index(program)) & program_mask) << program_shift)
+	           | ((static_cast<uint64_t>(queued.material) & material_mask) << material_shift);
+
+	_items.push_back(queued);
+}
+
+void
+RenderQueue::submit(glm::mat4 const& world_to_clip)
+{
+	submit(world_to_clip, bonobo::Frustum(world_to_clip));
+}
+
+void
+RenderQueue::submit(glm::mat4 const& world_to_clip, bonobo::Frustum const& frustum)
+{
+	_stats = stats();
+	if (_items.empty())
+		return;
+	auto const start_time = GetTimeMilliseconds();
+
+	// Culling and the depth part of the keys depend on the view.
+	_order.clear();
+	for (size_t i = 0u; i < _items.size(); ++i) {
+		auto& queued = _items[i];
+		if (!frustum.intersects(queued.node->_bounds, queued.world)) {
+			++_stats.culled;
+			continue;
+		}
+		auto const origin = world_to_clip * queued.world[3];
+		queued.key = (queued.key & ~depth_mask) | quantise_depth(origin.w);
+		_order.push_back(i);
+	}
+	std::sort(_order.begin(), _order.end(), [this](size_t lhs, size_t rhs){
+		return _items[lhs].key < _items[rhs].key;
+	});
+
+	std::array<std::pair<GLenum, GLuint>, tracked_texture_units_nb> bound_textures;
+	bound_textures.fill(std::make_pair(GL_NONE, 0u));
+	GLuint current_program = 0u;
+	GLuint current_vao = 0u;
+	std::function<void (GLuint)> const* current_set_uniforms = nullptr;
+
+	for (size_t k = 0u; k < _order.size();) {
+		auto const& queued = _items[_order[k]];
+		auto const& node = *queued.node;
+		auto const program = queued.program;
+
+		auto const& locations = node.get_uniform_locations(program);
+
+		if (program != current_program) {
+			glUseProgram(program);
+			++_stats.program_binds;
+			current_program = program;
+			current_set_uniforms = nullptr;
+			glUniformMatrix4fv(locations.vertex_world_to_clip, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+		}
+		if (queued.set_uniforms != current_set_uniforms) {
+			(*queued.set_uniforms)(program);
+			current_set_uniforms = queued.set_uniforms;
+		}
+
+		Node::set_object_uniforms(locations, queued.world);
+
+		if (queued.textured) {
+			glUniform1i(locations.has_textures, !node._textures.empty());
+			for (size_t i = 0u; i < node._textures.size(); ++i) {
+				auto const& texture = node._textures[i];
+				auto const binding = std::make_pair(std::get<2>(texture), std::get<1>(texture));
+				if (i >= tracked_texture_units_nb || bound_textures[i] != binding) {
+					glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+					glBindTexture(binding.first, binding.second);
+					++_stats.texture_binds;
+					if (i < tracked_texture_units_nb)
+						bound_textures[i] = binding;
+				}
+				glUniform1i(locations.textures[i], static_cast<GLint>(i));
+			}
+			glUniform1i(locations.has_diffuse_texture, node._has_diffuse_texture);
+			glUniform1i(locations.has_opacity_texture, node._has_opacity_texture);
+		}
+		glUniform1i(locations.has_binormals, node._has_binormals);
+
+		if (queued.vao != current_vao) {
+			glBindVertexArray(queued.vao);
+			++_stats.vao_binds;
+			current_vao = queued.vao;
+		}
+
+		// The following items sharing all of that state, e.g. meshes of a
+		// static scene uploaded into the same geometry arena, are drawn
+		// along with this one.
+		auto end = k + 1u;
+		while (_multi_draw && end < _order.size() && can_merge(queued, _items[_order[end]]))
+			++end;
+
+		if (end - k > 1u)
+			multi_draw(k, end);
+		else if (node._has_indices)
+			glDrawElementsBaseVertex(node._drawing_mode, node._indices_nb, GL_UNSIGNED_INT,
+			                         reinterpret_cast<GLvoid const*>(node._first_index * sizeof(GLuint)), node._base_vertex);
+		else
+			glDrawArrays(node._drawing_mode, node._base_vertex, node._vertices_nb);
+		++_stats.draws;
+		_stats.meshes += end - k;
+		k = end;
+	}
+
+	glBindVertexArray(0u);
+	glUseProgram(0u);
+	_stats.submit_time = GetTimeMilliseconds() - start_time;
+}
+
+void
+RenderQueue::set_multi_draw(bool enabled)
+{
+	_multi_draw = enabled;
+}
+
+bool
+RenderQueue::can_merge(item const& first, item const& other) const
+{
+	auto const& a = *first.node;
+	auto const& b = *other.node;
+	return a._has_indices && b._has_indices
+	    && first.vao == other.vao
+	    && a._drawing_mode == b._drawing_mode
+	    && first.program == other.program
+	    && first.set_uniforms == other.set_uniforms
+	    && first.world == other.world
+	    && first.textured == other.textured
+	    && (!first.textured || a._textures == b._textures);
+}
+
+void
+RenderQueue::multi_draw(size_t first, size_t end)
+{
+	auto const& node = *_items[_order[first]].node;
+	auto const multi_draw_indirect = get_multi_draw_elements_indirect();
+	auto* const stream = bonobo::StreamBuffer::get_default();
+
+	// With OpenGL 4.3, the draws are read from a buffer object, written to
+	// the stream buffer.
+	if (multi_draw_indirect != nullptr && stream != nullptr) {
+		_commands.clear();
+		for (auto k = first; k < end; ++k) {
+			auto const& other = *_items[_order[k]].node;
+			_commands.push_back({ static_cast<GLuint>(other._indices_nb), 1u, static_cast<GLuint>(other._first_index),
+			                      other._base_vertex, 0u });
+		}
+		auto const commands = stream->write(_commands.data(), _commands.size() * sizeof(draw_elements_command), 4u);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.bo);
+		multi_draw_indirect(node._drawing_mode, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(commands.offset),
+		                    static_cast<GLsizei>(_commands.size()), 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0u);
+		++_stats.multi_draws;
+		return;
+	}
+
+	_counts.clear();
+	_offsets.clear();
+	_base_vertices.clear();
+	for (auto k = first; k < end; ++k) {
+		auto const& other = *_items[_order[k]].node;
+		_counts.push_back(other._indices_nb);
+		_offsets.push_back(reinterpret_cast<GLvoid const*>(other._first_index * sizeof(GLuint)));
+		_base_vertices.push_back(other._base_vertex);
+	}
+	glMultiDrawElementsBaseVertex(node._drawing_mode, _counts.data(), GL_UNSIGNED_INT, _offsets.data(),
+	                              static_cast<GLsizei>(_counts.size()), _base_vertices.data());
+	++_stats.multi_draws;
+}
+
+size_t
+RenderQueue::size() const
+{
+	return _items.size();
+}
+
+RenderQueue::stats const&
+RenderQueue::get_stats() const
+{
+	return _stats;
+}
+
+uint32_t
+RenderQueue::get_program_index(GLuint program)
+{
+	auto const it = _programs.find(program);
+	if (it != _programs.end())
+		return it->second;
+
+	auto const index = static_cast<uint32_t>(_programs.size());
+	_programs.emplace(program, index);
+	return index;
+}
+
+uint32_t
+RenderQueue::get_material_index(Node const& node)
+{
+	// FNV-1a over the bound textures; collisions only affect the sorting.
+	uint64_t hash = 14695981039346656037ull;
+	auto const mix = [&hash](uint64_t value){
+		hash ^= value;
+		hash *= 1099511628211ull;
+	};
+	for (auto const& texture : node._textures) {
+		mix(std::get<1>(texture));
+		mix(std::get<2>(texture));
+	}
+
+	auto const it = _materials.find(hash);
+	if (it != _materials.end())
+		return it->second;
+
+	auto const index = static_cast<uint32_t>(_materials.size());
+	_materials.emplace(hash, index);
+	return index;
+}
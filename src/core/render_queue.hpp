@@ -0,0 +1,189 @@
+#pragma once
+
+#include "culling.hpp"
+#include "node.hpp"
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+//! \brief Collects draw requests for nodes, sorts them to minimise OpenGL
+//!        state changes, and submits them in one go.
+//!
+//! Every item is sorted with a packed 64-bit key; from most to least
+//! significant bits:
+//! * 8 bits for the pass, so that passes are drawn in increasing order;
+//! * 12 bits for the program;
+//! * 20 bits for the material, i.e. the set of textures used;
+//! * 24 bits for the view-space depth, sorting front to back.
+//!
+//! While submitting, items whose bounds lie outside the view frustum are
+//! skipped, and programs, vertex arrays and textures are only bound when
+//! they differ from the ones bound for the previous item. Consecutive
+//! items differing only by their mesh within a vertex array, e.g. those
+//! of a `bonobo::GeometryArena`, are drawn together with a single
+//! `glMultiDrawElementsBaseVertex()`, or `glMultiDrawElementsIndirect()`
+//! on OpenGL 4.3 contexts.
+class RenderQueue
+{
+public:
+	//! \brief Counters gathered during the last call to `submit()`.
+	struct stats {
+		size_t draws;         //!< number of draw calls issued
+		size_t multi_draws;   //!< how many of those drew several meshes
+		size_t meshes;        //!< number of meshes drawn
+		size_t program_binds; //!< number of calls to glUseProgram
+		size_t vao_binds;     //!< number of calls to glBindVertexArray
+		size_t texture_binds; //!< number of calls to glBindTexture
+		size_t culled;        //!< number of items outside the frustum
+		double submit_time;   //!< CPU time spent in `submit()`, in ms
+	};
+
+	//! \brief Default constructor.
+	RenderQueue();
+
+	//! \brief Remove all items from the queue.
+	void clear();
+
+	//! \brief Queue a node using its own program and uniforms setup.
+	//!
+	//! @param [in] node the node to draw; it has to outlive the next call
+	//!             to `submit()`
+	//! @param [in] world Matrix transforming from model-space to
+	//!             world-space
+	//! @param [in] pass pass to which the node belongs
+	void push(Node const& node, glm::mat4 const& world, uint8_t pass = 0u);
+
+	//! \brief Queue a node using a specific shader program.
+	//!
+	//! @param [in] node the node to draw; it has to outlive the next call
+	//!             to `submit()`
+	//! @param [in] world Matrix transforming from model-space to
+	//!             world-space
+	//! @param [in] program OpenGL shader program to use
+	//! @param [in] set_uniforms function that will take as argument an
+	//!             OpenGL shader program, and will setup that program's
+	//!             uniforms; it has to outlive the next call to
+	//!             `submit()`, and is only called once for consecutive
+	//!             items sharing both program and function
+	//! @param [in] pass pass to which the node belongs
+	void push(Node const& node, glm::mat4 const& world, GLuint program,
+	          std::function<void (GLuint)> const& set_uniforms,
+	          uint8_t pass = 0u);
+
+	//! \brief Only the address of `set_uniforms` is kept, so temporaries,
+	//!        such as lambdas converted on the fly, are rejected.
+	void push(Node const& node, glm::mat4 const& world, GLuint program,
+	          std::function<void (GLuint)>&& set_uniforms,
+	          uint8_t pass = 0u) = delete;
+
+	//! \brief Queue a node for a depth-only pass, e.g. a shadow map or a
+	//!        depth pre-pass.
+	//!
+	//! Nodes without an opacity texture are drawn with `program`, from
+	//! their position-only vertex array when they have one, and without
+	//! binding any texture; all of them then share the same material, and
+	//! can be merged in multi-draw calls. Nodes with an opacity texture
+	//! need their texture coordinates and textures for the alpha test, and
+	//! are drawn as usual with `alpha_tested_program`.
+	//!
+	//! @param [in] node the node to draw; it has to outlive the next call
+	//!             to `submit()`
+	//! @param [in] world Matrix transforming from model-space to
+	//!             world-space
+	//! @param [in] program OpenGL shader program only reading positions
+	//! @param [in] alpha_tested_program OpenGL shader program discarding
+	//!             fragments according to `opacity_texture`
+	//! @param [in] set_uniforms see the other overload
+	//! @param [in] pass pass to which the node belongs
+	void push_depth_only(Node const& node, glm::mat4 const& world, GLuint program,
+	                     GLuint alpha_tested_program,
+	                     std::function<void (GLuint)> const& set_uniforms,
+	                     uint8_t pass = 0u);
+	void push_depth_only(Node const& node, glm::mat4 const& world, GLuint program,
+	                     GLuint alpha_tested_program,
+	                     std::function<void (GLuint)>&& set_uniforms,
+	                     uint8_t pass = 0u) = delete;
+
+	//! \brief Cull, sort and draw all queued items.
+	//!
+	//! The queue is left untouched, so it can be submitted again, for
+	//! example with the matrix of another view.
+	//!
+	//! @param [in] world_to_clip Matrix transforming from world-space to
+	//!             clip-space; the culling frustum is extracted from it
+	void submit(glm::mat4 const& world_to_clip);
+
+	//! \brief Cull, sort and draw all queued items, against a frustum
+	//!        that was already extracted, e.g. the one of a camera
+	//!        snapshot.
+	//!
+	//! @param [in] world_to_clip Matrix transforming from world-space to
+	//!             clip-space
+	//! @param [in] frustum frustum of `world_to_clip`
+	void submit(glm::mat4 const& world_to_clip, bonobo::Frustum const& frustum);
+
+	//! \brief Enable or disable drawing consecutive items with a single
+	//!        multi-draw call; enabled by default.
+	void set_multi_draw(bool enabled);
+
+	//! \brief Get the number of queued items.
+	size_t size() const;
+
+	//! \brief Get the counters gathered during the last `submit()`.
+	stats const& get_stats() const;
+
+private:
+	struct item {
+		uint64_t key;
+		Node const* node;
+		glm::mat4 world;
+		GLuint program;
+		std::function<void (GLuint)> const* set_uniforms;
+		GLuint vao;
+		bool textured;       //!< whether the node's textures are bound
+		uint32_t material;
+		uint8_t pass;
+	};
+
+	//! \brief Layout of `glMultiDrawElementsIndirect()` commands.
+	struct draw_elements_command {
+		GLuint count;
+		GLuint instance_count;
+		GLuint first_index;
+		GLint base_vertex;
+		GLuint base_instance;
+	};
+
+	void push(Node const& node, glm::mat4 const& world, GLuint program,
+	          std::function<void (GLuint)> const& set_uniforms,
+	          uint8_t pass, GLuint vao, bool textured);
+	uint32_t get_program_index(GLuint program);
+	uint32_t get_material_index(Node const& node);
+
+	//! \brief Tell whether `other` can be drawn by the same multi-draw
+	//!        call as `first`, without changing any state.
+	bool can_merge(item const& first, item const& other) const;
+
+	//! \brief Draw the items `_order[first]` to `_order[end - 1]`, whose
+	//!        state is already set up, with a single call.
+	void multi_draw(size_t first, size_t end);
+
+	std::vector<item> _items;
+	std::vector<size_t> _order;
+	std::unordered_map<GLuint, uint32_t> _programs;
+	std::unordered_map<uint64_t, uint32_t> _materials;
+	bool _multi_draw;
+
+	// Arguments of the multi-draw calls, kept to reuse their storage
+	std::vector<GLsizei> _counts;
+	std::vector<GLvoid const*> _offsets;
+	std::vector<GLint> _base_vertices;
+	std::vector<draw_elements_command> _commands;
+
+	stats _stats;
+};
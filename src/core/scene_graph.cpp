@@ -0,0 +1,389 @@
+#include "scene_graph.hpp"
+
+#include "core/Log.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+	// Destroyed nodes leave a hole in the arrays, which is only reclaimed
+	// once there are many of them, so that destroying a whole set of nodes
+	// stays linear.
+	constexpr size_t min_destroyed_nb_before_compaction = 1024u;
+
+	template<typename T>
+	void rotate_slots(std::vector<T>& values, u32 first, u32 middle, u32 last)
+	{
+		std::rotate(values.begin() + first, values.begin() + middle, values.begin() + last);
+	}
+
+	template<typename T>
+	void erase_destroyed_slots(std::vector<T>& values, std::vector<SceneGraph::node_id> const& ids)
+	{
+		size_t kept_nb = 0u;
+		for (size_t slot = 0u; slot < values.size(); ++slot) {
+			if (ids[slot] != SceneGraph::invalid_id)
+				values[kept_nb++] = values[slot];
+		}
+		values.resize(kept_nb);
+	}
+}
+
+constexpr SceneGraph::node_id SceneGraph::invalid_id;
+
+SceneGraph::SceneGraph() : _translations(), _rotations(), _scalings(), _locals(), _worlds(), _parents(), _subtree_sizes(), _stamps(), _world_stamps(), _ids(), _owners(), _slots(), _free_ids(), _epoch(0u), _has_dirty_nodes(false), _destroyed_nb(0u), _updated_nb(0u)
+{
+}
+
+SceneGraph&
+SceneGraph::get_default()
+{
+	static SceneGraph graph;
+	return graph;
+}
+
+SceneGraph::node_id
+SceneGraph::create(Node const* owner)
+{
+	node_id id;
+	if (!_free_ids.empty()) {
+		id = _free_ids.back();
+		_free_ids.pop_back();
+	} else {
+		id = static_cast<node_id>(_slots.size());
+		_slots.push_back(invalid_id);
+	}
+
+	auto const slot = static_cast<u32>(_ids.size());
+	_slots[id] = slot;
+	_translations.emplace_back(0.0f);
+	_rotations.emplace_back(0.0f);
+	_scalings.emplace_back(1.0f);
+	_locals.emplace_back(1.0f);
+	_worlds.emplace_back(1.0f);
+	_parents.push_back(invalid_id);
+	_subtree_sizes.push_back(1u);
+	_stamps.push_back(0u);
+	_world_stamps.push_back(0u);
+	_ids.push_back(id);
+	_owners.push_back(owner);
+	mark_dirty(slot);
+
+	return id;
+}
+
+void
+SceneGraph::destroy(node_id id)
+{
+	// Moving a child away brings its next sibling to its slot; the slots
+	// of destroyed children are left in the subtree until compaction.
+	auto const slot = get_slot(id);
+	for (auto child = slot + 1u; child < slot + _subtree_sizes[slot];) {
+		if (_ids[child] == invalid_id)
+			child += _subtree_sizes[child];
+		else
+			set_parent(_ids[child], invalid_id);
+	}
+
+	_ids[slot] = invalid_id;
+	_owners[slot] = nullptr;
+	_slots[id] = invalid_id;
+	_free_ids.push_back(id);
+
+	++_destroyed_nb;
+	if (_destroyed_nb >= min_destroyed_nb_before_compaction && 2u * _destroyed_nb >= _ids.size())
+		compact();
+}
+
+Node const*
+SceneGraph::get_owner(node_id id) const
+{
+	return _owners[get_slot(id)];
+}
+
+void
+SceneGraph::set_owner(node_id id, Node const* owner)
+{
+	_owners[get_slot(id)] = owner;
+}
+
+bool
+SceneGraph::set_parent(node_id id, node_id parent)
+{
+	auto const slot = get_slot(id);
+	auto const size = _subtree_sizes[slot];
+	auto const parent_slot = parent != invalid_id ? get_slot(parent) : invalid_id;
+	if (parent_slot != invalid_id && parent_slot >= slot && parent_slot < slot + size) {
+		LogError("A node can not become a child of itself, or of one of its descendants.");
+		return false;
+	}
+
+	// The sizes and the destination are computed with the subtree still
+	// at its old place; every ancestor of `parent` includes it afterwards.
+	auto const destination = parent_slot != invalid_id ? parent_slot + _subtree_sizes[parent_slot]
+	                                                   : static_cast<u32>(_ids.size());
+	for (auto ancestor = _parents[slot]; ancestor != invalid_id; ancestor = _parents[ancestor])
+		_subtree_sizes[ancestor] -= size;
+	for (auto ancestor = parent_slot; ancestor != invalid_id; ancestor = _parents[ancestor])
+		_subtree_sizes[ancestor] += size;
+
+	move_subtree(slot, destination, parent);
+	mark_dirty(get_slot(id));
+
+	return true;
+}
+
+SceneGraph::node_id
+SceneGraph::get_parent(node_id id) const
+{
+	auto const parent_slot = _parents[get_slot(id)];
+	return parent_slot != invalid_id ? _ids[parent_slot] : invalid_id;
+}
+
+size_t
+SceneGraph::get_children_nb(node_id id) const
+{
+	auto const slot = get_slot(id);
+	size_t children_nb = 0u;
+	for (auto child = slot + 1u; child < slot + _subtree_sizes[slot]; child += _subtree_sizes[child]) {
+		if (_ids[child] != invalid_id)
+			++children_nb;
+	}
+	return children_nb;
+}
+
+SceneGraph::node_id
+SceneGraph::get_child(node_id id, size_t index) const
+{
+	auto const slot = get_slot(id);
+	for (auto child = slot + 1u; child < slot + _subtree_sizes[slot]; child += _subtree_sizes[child]) {
+		if (_ids[child] == invalid_id)
+			continue;
+		if (index == 0u)
+			return _ids[child];
+		--index;
+	}
+	assert(false);
+	return invalid_id;
+}
+
+glm::vec3 const&
+SceneGraph::get_translation(node_id id) const
+{
+	return _translations[get_slot(id)];
+}
+
+glm::vec3 const&
+SceneGraph::get_rotation(node_id id) const
+{
+	return _rotations[get_slot(id)];
+}
+
+glm::vec3 const&
+SceneGraph::get_scaling(node_id id) const
+{
+	return _scalings[get_slot(id)];
+}
+
+glm::vec3&
+SceneGraph::edit_translation(node_id id)
+{
+	auto const slot = get_slot(id);
+	mark_dirty(slot);
+	return _translations[slot];
+}
+
+glm::vec3&
+SceneGraph::edit_rotation(node_id id)
+{
+	auto const slot = get_slot(id);
+	mark_dirty(slot);
+	return _rotations[slot];
+}
+
+glm::vec3&
+SceneGraph::edit_scaling(node_id id)
+{
+	auto const slot = get_slot(id);
+	mark_dirty(slot);
+	return _scalings[slot];
+}
+
+glm::mat4
+SceneGraph::get_local_transform(node_id id) const
+{
+	auto const slot = get_slot(id);
+	return compose(_translations[slot], _rotations[slot], _scalings[slot]);
+}
+
+glm::mat4 const&
+SceneGraph::get_world_transform(node_id id)
+{
+	update();
+	return _worlds[get_slot(id)];
+}
+
+void
+SceneGraph::update()
+{
+	if (!_has_dirty_nodes)
+		return;
+
+	// Modified nodes were stamped with the upcoming epoch, and nodes get a
+	// new world matrix stamped with it when they or their parent changed.
+	// Parents come first, so one pass is enough, and no flag has to be
+	// cleared afterwards.
+	++_epoch;
+	_updated_nb = 0u;
+	auto const slots_nb = static_cast<u32>(_ids.size());
+	for (u32 slot = 0u; slot < slots_nb; ++slot) {
+		auto const parent = _parents[slot];
+		auto const is_modified = _stamps[slot] == _epoch;
+		if (is_modified)
+			_locals[slot] = compose(_translations[slot], _rotations[slot], _scalings[slot]);
+		else if (parent == invalid_id || _world_stamps[parent] != _epoch)
+			continue;
+
+		_worlds[slot] = parent != invalid_id ? _worlds[parent] * _locals[slot] : _locals[slot];
+		_world_stamps[slot] = _epoch;
+		++_updated_nb;
+	}
+	_has_dirty_nodes = false;
+}
+
+size_t
+SceneGraph::get_nodes_nb() const
+{
+	return _ids.size() - _destroyed_nb;
+}
+
+size_t
+SceneGraph::get_updated_nb() const
+{
+	return _updated_nb;
+}
+
+glm::mat4
+SceneGraph::compose(glm::vec3 const& translation, glm::vec3 const& rotation, glm::vec3 const& scaling)
+{
+	// Expanded form of translate(T) * rotate_z * rotate_y * rotate_x *
+	// scale(S), to avoid building and multiplying five 4x4 matrices.
+	auto const cx = std::cos(rotation.x), sx = std::sin(rotation.x);
+	auto const cy = std::cos(rotation.y), sy = std::sin(rotation.y);
+	auto const cz = std::cos(rotation.z), sz = std::sin(rotation.z);
+
+	glm::mat4 transform;
+	transform[0] = glm::vec4(cz * cy, sz * cy, -sy, 0.0f) * scaling.x;
+	transform[1] = glm::vec4(cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx, 0.0f) * scaling.y;
+	transform[2] = glm::vec4(cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx, 0.0f) * scaling.z;
+	transform[3] = glm::vec4(translation, 1.0f);
+	return transform;
+}
+
+u32
+SceneGraph::get_slot(node_id id) const
+{
+	assert(id < _slots.size() && _slots[id] != invalid_id);
+	return _slots[id];
+}
+
+void
+SceneGraph::mark_dirty(u32 slot)
+{
+	_stamps[slot] = _epoch + 1u;
+	_has_dirty_nodes = true;
+}
+
+void
+SceneGraph::move_subtree(u32 first, u32 destination, node_id parent)
+{
+	auto const last = first + _subtree_sizes[first];
+
+	// Attaching a new node to the last parent created, the usual way of
+	// building a hierarchy, does not move anything.
+	if (destination == first || destination == last) {
+		_parents[first] = parent != invalid_id ? get_slot(parent) : invalid_id;
+		return;
+	}
+
+	// Parents are stored as slots, which the rotation invalidates.
+	parents_to_ids();
+	_parents[first] = parent;
+
+	u32 rotation_first, rotation_middle, rotation_last;
+	if (destination <= first) {
+		rotation_first = destination;
+		rotation_middle = first;
+		rotation_last = last;
+	} else {
+		assert(destination >= last);
+		rotation_first = first;
+		rotation_middle = last;
+		rotation_last = destination;
+	}
+	rotate_slots(_translations, rotation_first, rotation_middle, rotation_last);
+	rotate_slots(_rotations, rotation_first, rotation_middle, rotation_last);
+	rotate_slots(_scalings, rotation_first, rotation_middle, rotation_last);
+	rotate_slots(_locals, rotation_first, rotation_middle, rotation_last);
+	rotate_slots(_worlds, rotation_first, rotation_middle, rotation_last);
+	rotate_slots(_parents, rotation_first, rotation_middle, rotation_last);
+	rotate_slots(_subtree_sizes, rotation_first, rotation_middle, rotation_last);
+	rotate_slots(_stamps, rotation_first, rotation_middle, rotation_last);
+	rotate_slots(_world_stamps, rotation_first, rotation_middle, rotation_last);
+	rotate_slots(_ids, rotation_first, rotation_middle, rotation_last);
+	rotate_slots(_owners, rotation_first, rotation_middle, rotation_last);
+
+	ids_to_parents();
+}
+
+void
+SceneGraph::compact()
+{
+	parents_to_ids();
+
+	erase_destroyed_slots(_translations, _ids);
+	erase_destroyed_slots(_rotations, _ids);
+	erase_destroyed_slots(_scalings, _ids);
+	erase_destroyed_slots(_locals, _ids);
+	erase_destroyed_slots(_worlds, _ids);
+	erase_destroyed_slots(_parents, _ids);
+	erase_destroyed_slots(_stamps, _ids);
+	erase_destroyed_slots(_world_stamps, _ids);
+	erase_destroyed_slots(_owners, _ids);
+	erase_destroyed_slots(_ids, _ids);
+	_destroyed_nb = 0u;
+
+	ids_to_parents();
+
+	// Children come after their parent, so accumulating backwards gives
+	// the size of every subtree.
+	_subtree_sizes.assign(_ids.size(), 1u);
+	for (auto slot = static_cast<u32>(_ids.size()); slot-- > 0u;) {
+		if (_parents[slot] != invalid_id)
+			_subtree_sizes[_parents[slot]] += _subtree_sizes[slot];
+	}
+}
+
+void
+SceneGraph::parents_to_ids()
+{
+	for (auto& parent : _parents) {
+		if (parent != invalid_id)
+			parent = _ids[parent];
+	}
+}
+
+void
+SceneGraph::ids_to_parents()
+{
+	for (u32 slot = 0u; slot < _ids.size(); ++slot) {
+		if (_ids[slot] != invalid_id)
+			_slots[_ids[slot]] = slot;
+	}
+	for (auto& parent : _parents) {
+		if (parent != invalid_id)
+			parent = _slots[parent];
+	}
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "Types.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+class Node;
+
+//! \brief Stores the transforms and the hierarchy of nodes as a flat
+//!        structure of arrays.
+//!
+//! Nodes are kept in depth-first order: each node comes before all of its
+//! descendants, which occupy the slots right after it. Local transforms,
+//! parents and world matrices are stored in separate contiguous arrays, so
+//! `update()` recomputes the world matrices in a single linear pass, and
+//! only for the nodes whose transform, or the transform of an ancestor,
+//! changed since the previous update.
+//!
+//! Nodes are referred to by identifiers, which stay valid while the nodes
+//! are moved around the arrays when reparenting.
+class SceneGraph
+{
+public:
+	using node_id = u32;
+
+	//! \brief Identifier of no node, i.e. the parent of root nodes.
+	static constexpr node_id invalid_id = ~0u;
+
+	//! \brief Default constructor.
+	SceneGraph();
+
+	SceneGraph(SceneGraph const&) = delete;
+	SceneGraph& operator=(SceneGraph const&) = delete;
+
+	//! \brief Get the graph used by nodes created without one.
+	static SceneGraph& get_default();
+
+	//! \brief Create a root node, with an identity transform.
+	//!
+	//! @param [in] owner the node returned by `get_owner()`
+	//! @return the identifier of the new node
+	node_id create(Node const* owner);
+
+	//! \brief Destroy a node; its children become root nodes.
+	void destroy(node_id id);
+
+	//! \brief Get the node an identifier was created for.
+	Node const* get_owner(node_id id) const;
+
+	//! \brief Change the node an identifier refers to, e.g. when moving
+	//!        that node.
+	void set_owner(node_id id, Node const* owner);
+
+	//! \brief Attach a node, and all of its descendants, to a new parent;
+	//!        it becomes the last child of that parent.
+	//!
+	//! @param [in] id the node to move
+	//! @param [in] parent the new parent, or `invalid_id` to make `id` a
+	//!             root node
+	//! @return false if `parent` is `id` or one of its descendants, in
+	//!         which case nothing changes
+	bool set_parent(node_id id, node_id parent);
+
+	//! \brief Get the parent of a node, or `invalid_id` for root nodes.
+	node_id get_parent(node_id id) const;
+
+	//! \brief Get the number of children of a node.
+	size_t get_children_nb(node_id id) const;
+
+	//! \brief Get the ith child of a node.
+	//!
+	//! @param [in] id the parent node
+	//! @param [in] index the index of the child to return; it should be
+	//!             strictly less than the number of children
+	node_id get_child(node_id id, size_t index) const;
+
+	glm::vec3 const& get_translation(node_id id) const;
+	glm::vec3 const& get_rotation(node_id id) const;
+	glm::vec3 const& get_scaling(node_id id) const;
+
+	//! \brief Give write access to the translation of a node, and mark its
+	//!        subtree as needing new world matrices.
+	glm::vec3& edit_translation(node_id id);
+
+	//! \brief Give write access to the rotation of a node, given as
+	//!        angles around the x-, y- and z-axis, and mark its subtree as
+	//!        needing new world matrices.
+	glm::vec3& edit_rotation(node_id id);
+
+	//! \brief Give write access to the scaling of a node, and mark its
+	//!        subtree as needing new world matrices.
+	glm::vec3& edit_scaling(node_id id);
+
+	//! \brief Compute the model matrix of a node, relative to its parent.
+	glm::mat4 get_local_transform(node_id id) const;
+
+	//! \brief Get the matrix transforming from the model-space of a node
+	//!        to world-space, updating the world matrices first.
+	glm::mat4 const& get_world_transform(node_id id);
+
+	//! \brief Recompute the world matrices of all modified subtrees.
+	void update();
+
+	//! \brief Get the number of nodes.
+	size_t get_nodes_nb() const;
+
+	//! \brief Get the number of world matrices recomputed by the last
+	//!        call to `update()` which found modified nodes.
+	size_t get_updated_nb() const;
+
+	//! \brief Call a function on a node and all of its descendants, in
+	//!        depth-first order, with their world matrices.
+	//!
+	//! @param [in] root the first node to visit
+	//! @param [in] visitor function taking a `Node const&` and its world
+	//!             matrix, as a `glm::mat4 const&`
+	template<typename F>
+	void visit(node_id root, F const& visitor);
+
+	//! \brief Compose a translation, a rotation given as angles around the
+	//!        x-, y- and z-axis, and a scaling, as `T * Rz * Ry * Rx * S`.
+	static glm::mat4 compose(glm::vec3 const& translation, glm::vec3 const& rotation, glm::vec3 const& scaling);
+
+private:
+	u32 get_slot(node_id id) const;
+	void mark_dirty(u32 slot);
+
+	//! \brief Move the subtree starting at `first` in front of the slot
+	//!        `destination`, and attach it to `parent`.
+	void move_subtree(u32 first, u32 destination, node_id parent);
+
+	//! \brief Remove the slots of destroyed nodes.
+	void compact();
+
+	void parents_to_ids();
+	void ids_to_parents();
+
+	// Per slot, in depth-first order
+	std::vector<glm::vec3> _translations;
+	std::vector<glm::vec3> _rotations;
+	std::vector<glm::vec3> _scalings;
+	std::vector<glm::mat4> _locals;
+	std::vector<glm::mat4> _worlds;
+	std::vector<u32> _parents;        //!< slot of the parent, or invalid_id
+	std::vector<u32> _subtree_sizes;  //!< in slots, including the node
+	std::vector<u32> _stamps;         //!< epoch of the next update after
+	                                  //!< the last change of the node
+	std::vector<u32> _world_stamps;   //!< epoch of the last update which
+	                                  //!< recomputed the world matrix
+	std::vector<node_id> _ids;        //!< invalid_id for destroyed nodes
+	std::vector<Node const*> _owners;
+
+	// Per identifier
+	std::vector<u32> _slots;
+	std::vector<node_id> _free_ids;
+
+	u32 _epoch;                       //!< incremented by each update
+	bool _has_dirty_nodes;
+	size_t _destroyed_nb;             //!< slots waiting for `compact()`
+	size_t _updated_nb;
+};
+
+template<typename F>
+void
+SceneGraph::visit(node_id root, F const& visitor)
+{
+	update();
+	auto const first = get_slot(root);
+	auto const last = first + _subtree_sizes[first];
+	for (auto slot = first; slot < last; ++slot) {
+		if (_owners[slot] != nullptr)
+			visitor(*_owners[slot], _worlds[slot]);
+	}
+}
@@ -0,0 +1,231 @@
+#include "shadow_atlas.hpp"
+
+#include "helpers.hpp"
+#include "Log.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+	bool
+	is_power_of_two(GLsizei value)
+	{
+		return value > 0 && (value & (value - 1)) == 0;
+	}
+
+	// Smallest power of two greater than or equal to `value`.
+	GLsizei
+	ceil_power_of_two(float value)
+	{
+		GLsizei result = 1;
+		while (static_cast<float>(result) < value)
+			result <<= 1;
+		return result;
+	}
+
+	// Inverse of the Morton order: the even bits of `index` give x, the
+	// odd ones y.
+	glm::ivec2
+	morton_decode(u32 index)
+	{
+		glm::ivec2 position(0);
+		for (u32 bit = 0u; bit < 16u; ++bit) {
+			position.x |= static_cast<int>((index >> (2u * bit)) & 1u) << bit;
+			position.y |= static_cast<int>((index >> (2u * bit + 1u)) & 1u) << bit;
+		}
+		return position;
+	}
+}
+
+bonobo::ShadowAtlas::ShadowAtlas(GLsizei size, GLsizei max_resolution, GLsizei min_resolution) : _size(size), _max_resolution(std::min(max_resolution, size)), _min_resolution(min_resolution), _texture(0u), _static_texture(0u), _fbo(0u), _static_fbo(0u), _lights(), _lights_nb(0u), _order(), _stats()
+{
+	assert(is_power_of_two(_size) && is_power_of_two(_max_resolution) && is_power_of_two(_min_resolution));
+	assert(_min_resolution <= _max_resolution);
+
+	auto const side = static_cast<uint32_t>(_size);
+	_texture = bonobo::createTexture(side, side, GL_TEXTURE_2D, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT);
+	_static_texture = bonobo::createTexture(side, side, GL_TEXTURE_2D, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT);
+	_fbo = bonobo::createFBO({}, _texture);
+	_static_fbo = bonobo::createFBO({}, _static_texture);
+}
+
+bonobo::ShadowAtlas::~ShadowAtlas()
+{
+	GLuint const fbos[2] = { _fbo, _static_fbo };
+	glDeleteFramebuffers(2, fbos);
+	GLuint const textures[2] = { _texture, _static_texture };
+	glDeleteTextures(2, textures);
+}
+
+void
+bonobo::ShadowAtlas::begin_frame()
+{
+	_lights_nb = 0u;
+	_stats = stats();
+}
+
+size_t
+bonobo::ShadowAtlas::add_light(glm::mat4 const& view_projection, float importance, bool dynamic_casters_changed)
+{
+	if (_lights_nb == _lights.size()) {
+		_lights.emplace_back();
+		_lights.back().has_cache = false;
+	}
+
+	auto& l = _lights[_lights_nb];
+	l.view_projection = view_projection;
+	l.importance = glm::clamp(importance, 0.0f, 1.0f);
+	l.dynamic_casters_changed = dynamic_casters_changed;
+	return _lights_nb++;
+}
+
+void
+bonobo::ShadowAtlas::allocate()
+{
+	_stats.lights = _lights_nb;
+
+	// Pick the resolutions, then halve the largest ones until they fit.
+	size_t area = 0u;
+	for (size_t i = 0u; i < _lights_nb; ++i) {
+		auto& s = _lights[i].current_slot;
+		s.resolution = glm::clamp(ceil_power_of_two(_lights[i].importance * static_cast<float>(_max_resolution)),
+		                          _min_resolution, _max_resolution);
+		area += static_cast<size_t>(s.resolution) * static_cast<size_t>(s.resolution);
+	}
+	auto const capacity = static_cast<size_t>(_size) * static_cast<size_t>(_size);
+	while (area > capacity) {
+		auto largest = _lights.begin();
+		for (auto it = _lights.begin(); it != _lights.begin() + _lights_nb; ++it)
+			if (it->current_slot.resolution > largest->current_slot.resolution)
+				largest = it;
+		auto& resolution = largest->current_slot.resolution;
+		if (resolution == _min_resolution)
+			break;
+		area -= 3u * static_cast<size_t>(resolution / 2) * static_cast<size_t>(resolution / 2);
+		resolution /= 2;
+	}
+
+	// Pack the slots largest first, in Morton order of cells of the
+	// minimal resolution: each slot then starts at a multiple of its own
+	// area, which is a square aligned on its size.
+	_order.resize(_lights_nb);
+	for (size_t i = 0u; i < _lights_nb; ++i)
+		_order[i] = i;
+	std::stable_sort(_order.begin(), _order.end(), [this](size_t lhs, size_t rhs){
+		return _lights[lhs].current_slot.resolution > _lights[rhs].current_slot.resolution;
+	});
+	auto const cells_per_side = static_cast<u32>(_size / _min_resolution);
+	auto const cells_nb = cells_per_side * cells_per_side;
+	u32 cursor = 0u;
+	for (auto const i : _order) {
+		auto& s = _lights[i].current_slot;
+		auto const side = static_cast<u32>(s.resolution / _min_resolution);
+		if (cursor + side * side > cells_nb) {
+			LogWarning("The shadow atlas is full: light %u gets no shadow map.", static_cast<unsigned int>(i));
+			s.resolution = 0;
+			s.offset = glm::ivec2(0);
+			s.rect = glm::vec4(0.0f);
+			continue;
+		}
+		s.offset = morton_decode(cursor) * _min_resolution;
+		s.rect = glm::vec4(static_cast<float>(s.offset.x), static_cast<float>(s.offset.y),
+		                   static_cast<float>(s.resolution), static_cast<float>(s.resolution)) / static_cast<float>(_size);
+		cursor += side * side;
+	}
+
+	// Only update what changed.
+	for (size_t i = 0u; i < _lights_nb; ++i) {
+		auto& l = _lights[i];
+		auto const& s = l.current_slot;
+		auto const slot_changed = !l.has_cache || l.cached_slot.resolution != s.resolution || l.cached_slot.offset != s.offset;
+		l.static_update = s.resolution > 0 && (slot_changed || l.cached_view_projection != l.view_projection);
+		l.composite = s.resolution > 0 && (l.static_update || l.dynamic_casters_changed);
+
+		l.cached_view_projection = l.view_projection;
+		l.cached_slot = s;
+		l.has_cache = s.resolution > 0;
+
+		_stats.static_renders += l.static_update ? 1u : 0u;
+		_stats.composites += l.composite ? 1u : 0u;
+		_stats.cached += s.resolution > 0 && !l.composite ? 1u : 0u;
+		_stats.texels += static_cast<size_t>(s.resolution) * static_cast<size_t>(s.resolution);
+	}
+}
+
+bool
+bonobo::ShadowAtlas::needs_static_update(size_t light) const
+{
+	assert(light < _lights_nb);
+	return _lights[light].static_update;
+}
+
+bool
+bonobo::ShadowAtlas::needs_composite(size_t light) const
+{
+	assert(light < _lights_nb);
+	return _lights[light].composite;
+}
+
+void
+bonobo::ShadowAtlas::bind_static(size_t light) const
+{
+	auto const& s = get_slot(light);
+	glBindFramebuffer(GL_FRAMEBUFFER, _static_fbo);
+	glViewport(s.offset.x, s.offset.y, s.resolution, s.resolution);
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(s.offset.x, s.offset.y, s.resolution, s.resolution);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glDisable(GL_SCISSOR_TEST);
+}
+
+void
+bonobo::ShadowAtlas::bind_composite(size_t light) const
+{
+	auto const& s = get_slot(light);
+	auto const x1 = s.offset.x + s.resolution;
+	auto const y1 = s.offset.y + s.resolution;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, _static_fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
+	glBlitFramebuffer(s.offset.x, s.offset.y, x1, y1, s.offset.x, s.offset.y, x1, y1, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+	glViewport(s.offset.x, s.offset.y, s.resolution, s.resolution);
+}
+
+bonobo::ShadowAtlas::slot const&
+bonobo::ShadowAtlas::get_slot(size_t light) const
+{
+	assert(light < _lights_nb);
+	return _lights[light].current_slot;
+}
+
+GLuint
+bonobo::ShadowAtlas::get_texture() const
+{
+	return _texture;
+}
+
+GLsizei
+bonobo::ShadowAtlas::get_size() const
+{
+	return _size;
+}
+
+bonobo::ShadowAtlas::stats const&
+bonobo::ShadowAtlas::get_stats() const
+{
+	return _stats;
+}
+
+float
+bonobo::ShadowAtlas::compute_importance(FPSCameraf::Snapshot const& camera, glm::vec3 const& center, float radius)
+{
+	if (!camera.mFrustum.intersects_sphere(center, radius))
+		return 0.0f;
+
+	auto const depth = -(camera.mWorldToView * glm::vec4(center, 1.0f)).z;
+	if (depth <= radius)
+		return 1.0f;
+	return glm::clamp(radius / (depth * std::tan(camera.mFov * 0.5f)), 0.0f, 1.0f);
+}
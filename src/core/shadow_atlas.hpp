@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Types.h"
+
+#include "external/glad/glad.h"
+#include "FPSCamera.h" // As it includes OpenGL headers, import it after glad
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Depth texture shared by the shadow maps of several lights,
+	//!        which are only re-rendered when something they see changed.
+	//!
+	//! Every frame, the lights are added in the same order, each with its
+	//! view-projection and its screen-space importance; `allocate()` then
+	//! gives each light a square slot, whose resolution is a power of two
+	//! growing with the importance, and packs the slots largest first in
+	//! Morton order, which never leaves holes between power-of-two
+	//! squares. If they do not fit, the largest slots are halved.
+	//!
+	//! Casters are split in two layers. The static casters are rendered
+	//! into a second texture of the same size, the static layer, which is
+	//! only updated when the light's view-projection or its slot changed.
+	//! The slot of the atlas is then composited by copying the static
+	//! layer into it and rendering the dynamic casters on top, but only
+	//! when either the static layer or a dynamic caster seen by the light
+	//! changed; otherwise the slot is left as it was.
+	//!
+	//! Shaders sample the atlas through the light's `shadowmap_atlas_rect`,
+	//! see `shaders/common/uniform_blocks.glsl`, and should clamp their
+	//! coordinates to it, as neighbouring slots belong to other lights.
+	class ShadowAtlas
+	{
+	public:
+		//! \brief Location of a light's shadow map within the atlas.
+		struct slot {
+			glm::ivec2 offset;   //!< in texels
+			GLsizei resolution;  //!< width and height, in texels; 0 when
+			                     //!< the light got no slot
+			glm::vec4 rect;      //!< offset then size, in texture coordinates
+		};
+
+		//! \brief Counters of the current frame.
+		struct stats {
+			size_t lights;
+			size_t static_renders; //!< slots whose static layer is re-rendered
+			size_t composites;     //!< slots whose atlas content is rebuilt
+			size_t cached;         //!< slots left untouched
+			size_t texels;         //!< texels covered by the slots
+		};
+
+		//! \brief Create the atlas and its static layer.
+		//!
+		//! @param [in] size width and height of both textures, in texels
+		//! @param [in] max_resolution resolution of the most important
+		//!             lights' slots, a power of two
+		//! @param [in] min_resolution resolution of the least important
+		//!             lights' slots, a power of two
+		ShadowAtlas(GLsizei size, GLsizei max_resolution, GLsizei min_resolution);
+
+		//! \brief Release both textures and their framebuffers.
+		~ShadowAtlas();
+
+		ShadowAtlas(ShadowAtlas const&) = delete;
+		ShadowAtlas& operator=(ShadowAtlas const&) = delete;
+
+		//! \brief Forget the lights of the previous frame; their cached
+		//!        slots are kept.
+		void begin_frame();
+
+		//! \brief Add the next light of the frame.
+		//!
+		//! @param [in] view_projection world-space to clip-space matrix of
+		//!             the light
+		//! @param [in] importance in [0, 1], see `compute_importance()`
+		//! @param [in] dynamic_casters_changed whether a dynamic caster
+		//!             within the light's frustum moved since last frame
+		//! @return the index of the light, to pass to the other methods
+		size_t add_light(glm::mat4 const& view_projection, float importance, bool dynamic_casters_changed);
+
+		//! \brief Give a slot to each light added, and decide which ones
+		//!        need to be updated.
+		void allocate();
+
+		//! \brief Tell whether the static casters of a light have to be
+		//!        rendered again, after `bind_static()`.
+		bool needs_static_update(size_t light) const;
+
+		//! \brief Tell whether the slot of a light has to be composited
+		//!        again, with `bind_composite()`.
+		bool needs_composite(size_t light) const;
+
+		//! \brief Bind the framebuffer of the static layer, restrict the
+		//!        viewport to the light's slot and clear it.
+		void bind_static(size_t light) const;
+
+		//! \brief Copy the static layer of the light's slot into the atlas,
+		//!        then bind the atlas' framebuffer and restrict the
+		//!        viewport to the slot, ready for the dynamic casters.
+		void bind_composite(size_t light) const;
+
+		//! \brief Get the slot of a light.
+		slot const& get_slot(size_t light) const;
+
+		//! \brief Get the depth texture of the atlas.
+		GLuint get_texture() const;
+
+		//! \brief Get the width and height of the atlas, in texels.
+		GLsizei get_size() const;
+
+		//! \brief Get the counters of the current frame.
+		stats const& get_stats() const;
+
+		//! \brief Estimate how much of the screen a light covers.
+		//!
+		//! @param [in] camera snapshot of the camera rendering the frame
+		//! @param [in] center center of a sphere bounding the light's
+		//!             influence, in world-space
+		//! @param [in] radius radius of that sphere
+		//! @return the height of the sphere's projection relative to the
+		//!         screen's, clamped to [0, 1]; 0 if it is not visible
+		static float compute_importance(FPSCameraf::Snapshot const& camera, glm::vec3 const& center, float radius);
+
+	private:
+		struct light {
+			glm::mat4 view_projection;
+			float importance;
+			bool dynamic_casters_changed;
+
+			// What the slot currently holds
+			glm::mat4 cached_view_projection;
+			slot cached_slot;
+			bool has_cache;
+
+			slot current_slot;
+			bool static_update;
+			bool composite;
+		};
+
+		GLsizei _size;
+		GLsizei _max_resolution;
+		GLsizei _min_resolution;
+
+		GLuint _texture, _static_texture;
+		GLuint _fbo, _static_fbo;
+
+		std::vector<light> _lights;
+		size_t _lights_nb;       //!< lights added during the current frame
+		std::vector<size_t> _order;
+
+		stats _stats;
+	};
+}
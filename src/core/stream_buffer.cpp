@@ -0,0 +1,264 @@
+#include "stream_buffer.hpp"
+
+#include "Log.h"
+#include "Misc.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace
+{
+	// glad only loads OpenGL 4.1, so `glBufferStorage()` and the flags of
+	// persistent mappings, from GL_ARB_buffer_storage, are fetched here.
+	using buffer_storage_proc = void (APIENTRYP)(GLenum target, GLsizeiptr size, void const* data, GLbitfield flags);
+	constexpr GLbitfield map_persistent_bit = 0x0040;
+	constexpr GLbitfield map_coherent_bit = 0x0080;
+
+	// Keeps every region start suitably aligned for any binding.
+	constexpr size_t region_alignment = 256u;
+
+	bonobo::StreamBuffer* default_stream = nullptr;
+
+	buffer_storage_proc
+	get_buffer_storage()
+	{
+		if (!glfwExtensionSupported("GL_ARB_buffer_storage"))
+			return nullptr;
+		return reinterpret_cast<buffer_storage_proc>(glfwGetProcAddress("glBufferStorage"));
+	}
+
+	size_t
+	align_up(size_t value, size_t alignment)
+	{
+		return alignment > 1u ? (value + alignment - 1u) / alignment * alignment : value;
+	}
+}
+
+bonobo::StreamBuffer::StreamBuffer(size_t frame_capacity) : _persistent(false), _frame_capacity(align_up(std::max<size_t>(frame_capacity, 1u), region_alignment)), _uniform_alignment(1u), _bo(0u), _mapping(nullptr), _region(0u), _head(0u), _fences(), _orphaned_bo(0u), _orphaned_capacity(_frame_capacity), _orphaned_head(0u), _staging(), _frame_stats(), _last_stats()
+{
+	_fences.fill(nullptr);
+	create_storage();
+
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	_uniform_alignment = static_cast<size_t>(std::max(alignment, 1));
+
+	glGenBuffers(1, &_orphaned_bo);
+	assert(_orphaned_bo != 0u);
+	orphan();
+
+	LogInfo("Streaming through %s buffer regions of %u bytes.", _persistent ? "persistently mapped" : "orphaned",
+	        static_cast<unsigned int>(_frame_capacity));
+}
+
+bonobo::StreamBuffer::~StreamBuffer()
+{
+	if (default_stream == this)
+		default_stream = nullptr;
+
+	destroy_storage();
+	glDeleteBuffers(1, &_orphaned_bo);
+	_orphaned_bo = 0u;
+}
+
+bonobo::StreamBuffer::allocation
+bonobo::StreamBuffer::allocate(size_t size, size_t alignment)
+{
+	++_frame_stats.allocations;
+	if (_persistent) {
+		auto const offset = align_up(_head, alignment);
+		if (offset + size <= _frame_capacity) {
+			_frame_stats.bytes_streamed += offset + size - _head;
+			_head = offset + size;
+			auto const region_start = _region * _frame_capacity;
+			return { _bo, static_cast<GLintptr>(region_start + offset), static_cast<GLsizeiptr>(size),
+			         _mapping + region_start + offset };
+		}
+		++_frame_stats.overflows;
+	}
+	return allocate_orphaned(size, alignment);
+}
+
+void
+bonobo::StreamBuffer::commit(allocation const& a)
+{
+	// Persistent mappings are coherent: there is nothing left to do.
+	if (a.bo != _orphaned_bo || a.size == 0)
+		return;
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, _orphaned_bo);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, a.offset, a.size, a.data);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+}
+
+bonobo::StreamBuffer::allocation
+bonobo::StreamBuffer::write(void const* data, size_t size, size_t alignment)
+{
+	auto const a = allocate(size, alignment);
+	std::memcpy(a.data, data, size);
+	commit(a);
+	return a;
+}
+
+void
+bonobo::StreamBuffer::end_frame()
+{
+	if (_persistent)
+		_fences[_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	auto const demand = _frame_stats.bytes_streamed;
+	_last_stats = _frame_stats;
+	_frame_stats = stats();
+
+	if (demand > _frame_capacity) {
+		_frame_capacity = align_up(demand + demand / 2u, region_alignment);
+		LogInfo("Growing the stream buffer regions to %u bytes.", static_cast<unsigned int>(_frame_capacity));
+		if (_persistent) {
+			destroy_storage();
+			create_storage();
+		} else {
+			_orphaned_capacity = std::max(_orphaned_capacity, _frame_capacity);
+		}
+	}
+
+	if (_persistent) {
+		_region = (_region + 1u) % frames_in_flight;
+		_head = 0u;
+		wait(_fences[_region]);
+	}
+
+	// Only hand the driver new storage if the current one got used.
+	if (_orphaned_head != 0u || _orphaned_capacity != _staging.size())
+		orphan();
+}
+
+bool
+bonobo::StreamBuffer::is_persistent() const
+{
+	return _persistent;
+}
+
+size_t
+bonobo::StreamBuffer::get_uniform_alignment() const
+{
+	return _uniform_alignment;
+}
+
+size_t
+bonobo::StreamBuffer::get_frame_capacity() const
+{
+	return _frame_capacity;
+}
+
+bonobo::StreamBuffer::stats const&
+bonobo::StreamBuffer::get_stats() const
+{
+	return _last_stats;
+}
+
+bonobo::StreamBuffer*
+bonobo::StreamBuffer::get_default()
+{
+	return default_stream;
+}
+
+void
+bonobo::StreamBuffer::set_default(StreamBuffer* stream)
+{
+	default_stream = stream;
+}
+
+void
+bonobo::StreamBuffer::create_storage()
+{
+	_region = 0u;
+	_head = 0u;
+
+	auto const buffer_storage = get_buffer_storage();
+	if (buffer_storage == nullptr)
+		return;
+
+	glGenBuffers(1, &_bo);
+	assert(_bo != 0u);
+	auto const size = static_cast<GLsizeiptr>(_frame_capacity * frames_in_flight);
+	auto const flags = GL_MAP_WRITE_BIT | map_persistent_bit | map_coherent_bit;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, _bo);
+	buffer_storage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+	_mapping = static_cast<u8*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+
+	_persistent = _mapping != nullptr;
+	if (!_persistent) {
+		LogWarning("Failed to map the stream buffer persistently: falling back to orphaning.");
+		glDeleteBuffers(1, &_bo);
+		_bo = 0u;
+	}
+}
+
+void
+bonobo::StreamBuffer::destroy_storage()
+{
+	for (auto& fence : _fences)
+		wait(fence);
+
+	if (_mapping != nullptr) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, _bo);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+		_mapping = nullptr;
+	}
+	glDeleteBuffers(1, &_bo);
+	_bo = 0u;
+}
+
+void
+bonobo::StreamBuffer::wait(GLsync& fence)
+{
+	if (fence == nullptr)
+		return;
+
+	auto status = glClientWaitSync(fence, 0, 0u);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		++_frame_stats.stalls;
+		auto const start = GetTimeMilliseconds();
+		do
+			status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000u); // 1 ms
+		while (status == GL_TIMEOUT_EXPIRED);
+		_frame_stats.stall_time += GetTimeMilliseconds() - start;
+	}
+	if (status == GL_WAIT_FAILED)
+		LogError("Failed to wait on a stream buffer fence.");
+
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+void
+bonobo::StreamBuffer::orphan()
+{
+	_orphaned_head = 0u;
+	_staging.resize(_orphaned_capacity);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, _orphaned_bo);
+	glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(_orphaned_capacity), nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+}
+
+bonobo::StreamBuffer::allocation
+bonobo::StreamBuffer::allocate_orphaned(size_t size, size_t alignment)
+{
+	auto offset = align_up(_orphaned_head, alignment);
+	if (offset + size > _orphaned_capacity) {
+		// The draw calls already issued keep reading the previous storage.
+		if (!_persistent)
+			++_frame_stats.overflows;
+		_orphaned_capacity = std::max(2u * _orphaned_capacity, align_up(size, region_alignment));
+		orphan();
+		offset = 0u;
+	}
+	_frame_stats.bytes_streamed += offset + size - _orphaned_head;
+	_orphaned_head = offset + size;
+	return { _orphaned_bo, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), _staging.data() + offset };
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "Types.h"
+
+#include "external/glad/glad.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Ring allocator for the data streamed to the GPU every frame,
+	//!        e.g. per-draw uniform blocks, instance attributes or the
+	//!        geometry of the user interface.
+	//!
+	//! The buffer object is split in `frames_in_flight` regions, one per
+	//! frame: a frame suballocates from its own region, and `end_frame()`
+	//! places a fence behind it before moving on to the next one, which is
+	//! only written again once the GPU is done with the frame that last
+	//! used it.
+	//!
+	//! When `GL_ARB_buffer_storage` is available, the regions are mapped
+	//! once, persistently and coherently, so that allocations are written
+	//! straight into the buffer object; OpenGL 4.1 has neither that
+	//! extension in core nor persistent mappings, so otherwise the buffer
+	//! object is orphaned at the start of each frame and allocations are
+	//! uploaded with `glBufferSubData()`. That second path is also used by
+	//! the allocations not fitting in their frame's region; the regions are
+	//! then grown at the end of the frame.
+	class StreamBuffer
+	{
+	public:
+		//! \brief Part of the buffer object handed out by `allocate()`.
+		struct allocation {
+			GLuint bo;       //!< buffer object holding the data
+			GLintptr offset; //!< in bytes, from the start of `bo`
+			GLsizeiptr size; //!< in bytes
+			void* data;      //!< where to write the `size` bytes
+		};
+
+		//! \brief Counters gathered over a frame.
+		struct stats {
+			size_t bytes_streamed; //!< including alignment padding
+			size_t allocations;
+			size_t overflows;      //!< allocations not fitting in the region
+			size_t stalls;         //!< fences not signalled when reached
+			double stall_time;     //!< spent waiting on fences, in ms
+		};
+
+		static constexpr size_t frames_in_flight = 3u;
+
+		//! \brief Create the buffer object.
+		//!
+		//! @param [in] frame_capacity size of the region of each frame,
+		//!             in bytes
+		explicit StreamBuffer(size_t frame_capacity);
+
+		//! \brief Wait for the GPU to be done with all regions, and
+		//!        release the buffer object.
+		~StreamBuffer();
+
+		StreamBuffer(StreamBuffer const&) = delete;
+		StreamBuffer& operator=(StreamBuffer const&) = delete;
+
+		//! \brief Reserve space in the region of the current frame.
+		//!
+		//! The content has to be written to `data` and then handed over
+		//! with `commit()`, before the allocation is used by any draw
+		//! call. A persistently mapped allocation stays valid until the
+		//! end of the frame, an orphaned one only until the next call to
+		//! `allocate()`: bind it and draw with it first.
+		//!
+		//! @param [in] size in bytes
+		//! @param [in] alignment of the offset, in bytes; e.g. the value of
+		//!             `GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT` for blocks bound
+		//!             with `glBindBufferRange()`
+		allocation allocate(size_t size, size_t alignment);
+
+		//! \brief Make the content written to an allocation visible to
+		//!        the GPU.
+		void commit(allocation const& a);
+
+		//! \brief Reserve space and copy `size` bytes of `data` into it.
+		allocation write(void const* data, size_t size, size_t alignment);
+
+		//! \brief Fence the region of the current frame, and move on to
+		//!        the next one; `Window::Swap()` calls it.
+		void end_frame();
+
+		//! \brief Tell whether the regions are persistently mapped.
+		bool is_persistent() const;
+
+		//! \brief Get the alignment of uniform blocks bound from the
+		//!        buffer, i.e. `GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT`.
+		size_t get_uniform_alignment() const;
+
+		//! \brief Get the size of the region of each frame, in bytes.
+		size_t get_frame_capacity() const;
+
+		//! \brief Get the counters of the last complete frame.
+		stats const& get_stats() const;
+
+		//! \brief Get the stream buffer of the current window, if any.
+		static StreamBuffer* get_default();
+
+		//! \brief Set the stream buffer returned by `get_default()`.
+		static void set_default(StreamBuffer* stream);
+
+	private:
+		void create_storage();
+		void destroy_storage();
+		void wait(GLsync& fence);
+		void orphan();
+		allocation allocate_orphaned(size_t size, size_t alignment);
+
+		bool _persistent;
+		size_t _frame_capacity;        //!< in bytes
+		size_t _uniform_alignment;     //!< in bytes
+
+		// Ring of persistently mapped regions
+		GLuint _bo;
+		u8* _mapping;
+		size_t _region;                //!< region of the current frame
+		size_t _head;                  //!< in bytes, from the region start
+		std::array<GLsync, frames_in_flight> _fences;
+
+		// Buffer object orphaned every frame
+		GLuint _orphaned_bo;
+		size_t _orphaned_capacity;     //!< in bytes
+		size_t _orphaned_head;         //!< in bytes
+		std::vector<u8> _staging;
+
+		stats _frame_stats;
+		stats _last_stats;
+	};
+}
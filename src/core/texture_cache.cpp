@@ -0,0 +1,343 @@
+#include "texture_cache.hpp"
+
+#include "helpers.hpp"
+#include "texture_loader.hpp"
+#include "core/Log.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+	size_t get_bytes_per_texel(GLint internal_format)
+	{
+		switch (internal_format) {
+		case GL_RED:
+		case GL_R8:
+			return 1u;
+		case GL_RG:
+		case GL_RG8:
+			return 2u;
+		case GL_RGB:
+		case GL_RGB8:
+		case GL_SRGB8:
+			return 3u;
+		case GL_RGBA16F:
+			return 8u;
+		case GL_RGBA32F:
+			return 16u;
+		default:
+			return 4u;
+		}
+	}
+
+	//! \brief Estimate the memory used by a texture, mipmaps included.
+	size_t measure(GLenum target, GLuint texture, bool generate_mipmap, GLint internal_format, u32& width, u32& height)
+	{
+		GLint level_width = 0, level_height = 0, is_compressed = GL_FALSE;
+		auto const level_target = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+		glBindTexture(target, texture);
+		glGetTexLevelParameteriv(level_target, 0, GL_TEXTURE_WIDTH, &level_width);
+		glGetTexLevelParameteriv(level_target, 0, GL_TEXTURE_HEIGHT, &level_height);
+		glGetTexLevelParameteriv(level_target, 0, GL_TEXTURE_COMPRESSED, &is_compressed);
+		width = static_cast<u32>(level_width);
+		height = static_cast<u32>(level_height);
+
+		size_t bytes = 0u;
+		if (is_compressed == GL_TRUE) {
+			// Compressed mip chains are uploaded level by level, so ask for
+			// their actual size.
+			GLint max_level = 0;
+			glGetTexParameteriv(target, GL_TEXTURE_MAX_LEVEL, &max_level);
+			for (GLint level = 0; level <= max_level; ++level) {
+				GLint level_size = 0;
+				glGetTexLevelParameteriv(level_target, level, GL_TEXTURE_WIDTH, &level_width);
+				if (level_width == 0)
+					break;
+				glGetTexLevelParameteriv(level_target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &level_size);
+				bytes += static_cast<size_t>(level_size);
+			}
+		} else {
+			bytes = static_cast<size_t>(width) * static_cast<size_t>(height) * get_bytes_per_texel(internal_format);
+			if (generate_mipmap)
+				bytes += bytes / 3u; // a full mipmap chain adds about a third
+		}
+		glBindTexture(target, 0u);
+
+		if (target == GL_TEXTURE_CUBE_MAP)
+			bytes *= 6u;
+		return bytes;
+	}
+
+	std::string make_key(GLenum target, std::string const& path, bool flip, bool generate_mipmap, GLint internal_format)
+	{
+		return std::to_string(target) + "|" + path
+		     + (flip ? "|flip" : "|noflip")
+		     + (generate_mipmap ? "|mipmap" : "|nomipmap")
+		     + "|" + std::to_string(internal_format);
+	}
+}
+
+bonobo::TextureCache::handle::handle() : _cache(nullptr), _texture(0u)
+{
+}
+
+bonobo::TextureCache::handle::handle(TextureCache* cache, GLuint texture) : _cache(cache), _texture(texture)
+{
+	if (_cache != nullptr && _texture != 0u)
+		_cache->add_reference(_texture);
+}
+
+bonobo::TextureCache::handle::handle(handle const& other) : handle(other._cache, other._texture)
+{
+}
+
+bonobo::TextureCache::handle::handle(handle&& other) : _cache(other._cache), _texture(other._texture)
+{
+	other._cache = nullptr;
+	other._texture = 0u;
+}
+
+bonobo::TextureCache::handle&
+bonobo::TextureCache::handle::operator=(handle const& other)
+{
+	if (this != &other) {
+		handle copy(other);
+		*this = std::move(copy);
+	}
+	return *this;
+}
+
+bonobo::TextureCache::handle&
+bonobo::TextureCache::handle::operator=(handle&& other)
+{
+	if (this != &other) {
+		reset();
+		std::swap(_cache, other._cache);
+		std::swap(_texture, other._texture);
+	}
+	return *this;
+}
+
+bonobo::TextureCache::handle::~handle()
+{
+	reset();
+}
+
+void
+bonobo::TextureCache::handle::reset()
+{
+	if (_cache != nullptr && _texture != 0u)
+		_cache->remove_reference(_texture);
+	_cache = nullptr;
+	_texture = 0u;
+}
+
+bonobo::TextureCache::TextureCache() : _records(), _keys(), _memory_usage(0u), _budget(std::numeric_limits<size_t>::max()), _use_counter(0u)
+{
+}
+
+bonobo::TextureCache::~TextureCache()
+{
+	for (auto& entry : _records) {
+		if (entry.second.info.references != 0u)
+			LogWarning("Texture \"%s\" is deleted while still referenced", entry.second.info.path.c_str());
+		if (entry.second.loader != nullptr)
+			entry.second.loader->forget(entry.second.texture);
+		glDeleteTextures(1, &entry.second.texture);
+	}
+}
+
+bonobo::TextureCache::handle
+bonobo::TextureCache::load_2d(std::string const& filename, bool generate_mipmap, bool flip, GLint internal_format)
+{
+	auto const key = make_key(GL_TEXTURE_2D, filename, flip, generate_mipmap, internal_format);
+	auto cached = acquire(key);
+	if (cached)
+		return cached;
+
+	auto const texture = bonobo::loadTexture2D(filename, generate_mipmap, flip, internal_format);
+	if (texture == 0u)
+		return handle();
+
+	return insert(key, filename, GL_TEXTURE_2D, texture, generate_mipmap, internal_format);
+}
+
+bonobo::TextureCache::handle
+bonobo::TextureCache::request_2d(TextureLoader& loader, std::string const& filename, bool generate_mipmap, glm::vec4 const& placeholder)
+{
+	auto const key = make_key(GL_TEXTURE_2D, filename, true, generate_mipmap, GL_RGBA);
+	auto cached = acquire(key);
+	if (cached)
+		return cached;
+
+	auto const texture = loader.request(filename, generate_mipmap, placeholder);
+	auto result = insert(key, filename, GL_TEXTURE_2D, texture, generate_mipmap, GL_RGBA);
+	auto& entry = _records[key];
+	entry.loader = &loader;
+	entry.is_pending = loader.is_pending(texture);
+	return result;
+}
+
+bonobo::TextureCache::handle
+bonobo::TextureCache::load_cube_map(std::string const& posx, std::string const& negx,
+                                    std::string const& posy, std::string const& negy,
+                                    std::string const& posz, std::string const& negz,
+                                    bool generate_mipmap)
+{
+	auto const path = posx + ";" + negx + ";" + posy + ";" + negy + ";" + posz + ";" + negz;
+	auto const key = make_key(GL_TEXTURE_CUBE_MAP, path, false, generate_mipmap, GL_RGBA);
+	auto cached = acquire(key);
+	if (cached)
+		return cached;
+
+	auto const texture = bonobo::loadTextureCubeMap(posx, negx, posy, negy, posz, negz, generate_mipmap);
+	if (texture == 0u)
+		return handle();
+
+	return insert(key, path, GL_TEXTURE_CUBE_MAP, texture, generate_mipmap, GL_RGBA);
+}
+
+void
+bonobo::TextureCache::update()
+{
+	for (auto& entry : _records) {
+		auto& r = entry.second;
+		if (!r.is_pending || r.loader->is_pending(r.texture))
+			continue;
+
+		r.is_pending = false;
+		_memory_usage -= r.info.bytes;
+		r.info.bytes = measure(r.info.target, r.texture, r.generate_mipmap, r.internal_format, r.info.width, r.info.height);
+		_memory_usage += r.info.bytes;
+	}
+	enforce_budget();
+}
+
+size_t
+bonobo::TextureCache::evict_unused()
+{
+	auto const previous_usage = _memory_usage;
+	for (auto it = _records.begin(); it != _records.end();) {
+		auto const current = it++;
+		if (current->second.info.references == 0u && !current->second.is_pending)
+			erase(current);
+	}
+	return previous_usage - _memory_usage;
+}
+
+void
+bonobo::TextureCache::set_budget(size_t bytes)
+{
+	_budget = bytes;
+	enforce_budget();
+}
+
+size_t
+bonobo::TextureCache::get_memory_usage() const
+{
+	return _memory_usage;
+}
+
+std::vector<bonobo::TextureCache::entry_info>
+bonobo::TextureCache::get_entries() const
+{
+	std::vector<entry_info> entries;
+	entries.reserve(_records.size());
+	for (auto const& entry : _records)
+		entries.push_back(entry.second.info);
+	std::sort(entries.begin(), entries.end(), [](entry_info const& lhs, entry_info const& rhs){
+		return lhs.bytes > rhs.bytes;
+	});
+	return entries;
+}
+
+void
+bonobo::TextureCache::log_report() const
+{
+	for (auto const& entry : get_entries())
+		LogInfo("\t%8.2f KiB  %4ux%-4u  refs: %u  %s", static_cast<double>(entry.bytes) / 1024.0,
+		        entry.width, entry.height, static_cast<unsigned int>(entry.references), entry.path.c_str());
+	LogInfo("Texture cache: %u textures, %.2f MiB", static_cast<unsigned int>(_records.size()),
+	        static_cast<double>(_memory_usage) / (1024.0 * 1024.0));
+}
+
+bonobo::TextureCache::handle
+bonobo::TextureCache::acquire(std::string const& key)
+{
+	auto const it = _records.find(key);
+	if (it == _records.end())
+		return handle();
+
+	it->second.last_use = ++_use_counter;
+	return handle(this, it->second.texture);
+}
+
+bonobo::TextureCache::handle
+bonobo::TextureCache::insert(std::string const& key, std::string const& path, GLenum target, GLuint texture, bool generate_mipmap, GLint internal_format)
+{
+	record entry;
+	entry.info.path = path;
+	entry.info.target = target;
+	entry.info.bytes = measure(target, texture, generate_mipmap, internal_format, entry.info.width, entry.info.height);
+	entry.info.references = 0u;
+	entry.texture = texture;
+	entry.last_use = ++_use_counter;
+	entry.generate_mipmap = generate_mipmap;
+	entry.internal_format = internal_format;
+	entry.loader = nullptr;
+	entry.is_pending = false;
+
+	_records.emplace(key, entry);
+	_keys.emplace(texture, key);
+	_memory_usage += entry.info.bytes;
+
+	auto result = handle(this, texture);
+	enforce_budget();
+	return result;
+}
+
+void
+bonobo::TextureCache::add_reference(GLuint texture)
+{
+	auto const key = _keys.find(texture);
+	if (key == _keys.end())
+		return;
+	++_records[key->second].info.references;
+}
+
+void
+bonobo::TextureCache::remove_reference(GLuint texture)
+{
+	auto const key = _keys.find(texture);
+	if (key == _keys.end())
+		return;
+	auto& entry = _records[key->second];
+	if (entry.info.references > 0u && --entry.info.references == 0u)
+		enforce_budget();
+}
+
+void
+bonobo::TextureCache::enforce_budget()
+{
+	while (_memory_usage > _budget) {
+		auto oldest = _records.end();
+		for (auto it = _records.begin(); it != _records.end(); ++it)
+			if (it->second.info.references == 0u && !it->second.is_pending && (oldest == _records.end() || it->second.last_use < oldest->second.last_use))
+				oldest = it;
+		if (oldest == _records.end())
+			return; // everything left is still referenced
+		erase(oldest);
+	}
+}
+
+void
+bonobo::TextureCache::erase(std::unordered_map<std::string, record>::iterator it)
+{
+	if (it->second.loader != nullptr)
+		it->second.loader->forget(it->second.texture);
+	glDeleteTextures(1, &it->second.texture);
+	_memory_usage -= it->second.info.bytes;
+	_keys.erase(it->second.texture);
+	_records.erase(it);
+}
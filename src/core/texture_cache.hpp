@@ -0,0 +1,169 @@
+#pragma once
+
+#include "Types.h"
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bonobo
+{
+	class TextureLoader;
+
+	//! \brief Cache of OpenGL textures loaded from image files.
+	//!
+	//! Textures are keyed by their path(s), whether they are flipped,
+	//! whether they have mipmaps, and their internal format: loading the
+	//! same image twice with the same settings returns the same texture.
+	//!
+	//! Textures are handed out through reference-counted handles. A
+	//! texture no longer referenced stays in the cache, so it can be
+	//! handed out again for free, until it is evicted: either explicitly
+	//! through `evict_unused()`, or, least recently used first, whenever
+	//! the memory used goes above the budget. Textures requested through
+	//! a `TextureLoader` are never evicted while still waiting for their
+	//! image, and are only accounted for at their full size once `update()`
+	//! sees them uploaded.
+	//!
+	//! All functions have to be called from the thread owning the OpenGL
+	//! context, and handles must not outlive the cache.
+	class TextureCache
+	{
+	public:
+		//! \brief Shared reference to a texture of the cache.
+		class handle
+		{
+		public:
+			handle();
+			handle(handle const& other);
+			handle(handle&& other);
+			handle& operator=(handle const& other);
+			handle& operator=(handle&& other);
+			~handle();
+
+			//! \brief Return the name of the OpenGL texture, or 0 for an
+			//!        empty handle.
+			GLuint get() const { return _texture; }
+
+			//! \brief Return whether the handle refers to a texture.
+			explicit operator bool() const { return _texture != 0u; }
+
+			//! \brief Drop the reference held by this handle.
+			void reset();
+
+		private:
+			friend class TextureCache;
+			handle(TextureCache* cache, GLuint texture);
+
+			TextureCache* _cache;
+			GLuint _texture;
+		};
+
+		//! \brief Description of a cached texture, for reporting.
+		struct entry_info {
+			std::string path;  //!< path(s) of the image(s) used
+			GLenum target;     //!< GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
+			u32 width;         //!< width of the base level
+			u32 height;        //!< height of the base level
+			size_t bytes;      //!< estimated memory used, mipmaps included
+			size_t references; //!< number of live handles
+		};
+
+		TextureCache();
+
+		//! \brief Delete all cached textures, referenced or not.
+		~TextureCache();
+
+		TextureCache(TextureCache const&) = delete;
+		TextureCache& operator=(TextureCache const&) = delete;
+
+		//! \brief Load a PNG image into a 2D-texture, or reuse the cached one.
+		//!
+		//! @param [in] filename of the PNG image, relative to the `textures`
+		//!             folder within the `resources` folder
+		//! @param [in] generate_mipmap whether or not to generate a mipmap
+		//!             hierarchy
+		//! @param [in] flip whether to flip the image vertically
+		//! @param [in] internal_format internal format of the texture
+		//! @return a handle to the texture; it is empty if the image could
+		//!         not be loaded
+		handle load_2d(std::string const& filename, bool generate_mipmap = true,
+		               bool flip = true, GLint internal_format = GL_RGBA);
+
+		//! \brief Request a PNG image from a `TextureLoader`, or reuse the
+		//!        cached texture; see `TextureLoader::request()`.
+		//!
+		//! The texture is keyed as if loaded by `load_2d()` with `flip` set
+		//! and the default internal format. Images of `loader` requested
+		//! through a cache should always be requested through it, as the
+		//! cache deletes them when evicting them.
+		handle request_2d(TextureLoader& loader, std::string const& filename,
+		                  bool generate_mipmap = true,
+		                  glm::vec4 const& placeholder = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+
+		//! \brief Load six PNG images into a cubemap-texture, or reuse the
+		//!        cached one; see `bonobo::loadTextureCubeMap()`.
+		handle load_cube_map(std::string const& posx, std::string const& negx,
+		                     std::string const& posy, std::string const& negy,
+		                     std::string const& posz, std::string const& negz,
+		                     bool generate_mipmap = false);
+
+		//! \brief Account for textures requested through a `TextureLoader`
+		//!        that were uploaded since the last call, evicting textures
+		//!        if they now exceed the budget.
+		//!
+		//! Should be called after `TextureLoader::upload_ready()`.
+		void update();
+
+		//! \brief Delete all textures without any handle left.
+		//!
+		//! @return the number of bytes freed
+		size_t evict_unused();
+
+		//! \brief Set how much memory textures without any handle left may
+		//!        keep using before being evicted.
+		//!
+		//! @param [in] bytes memory budget, for all cached textures
+		void set_budget(size_t bytes);
+
+		//! \brief Return the estimated memory used by all cached textures.
+		size_t get_memory_usage() const;
+
+		//! \brief Return a description of every cached texture.
+		std::vector<entry_info> get_entries() const;
+
+		//! \brief Log the memory used per texture and in total.
+		void log_report() const;
+
+	private:
+		struct record {
+			entry_info info;
+			GLuint texture;
+			u64 last_use;
+			bool generate_mipmap;
+			GLint internal_format;
+			TextureLoader* loader; //!< loading the image, if requested
+			                       //!< through `request_2d()`
+			bool is_pending;       //!< whether `loader` has yet to upload
+			                       //!< the image
+		};
+
+		handle acquire(std::string const& key);
+		handle insert(std::string const& key, std::string const& path, GLenum target, GLuint texture, bool generate_mipmap, GLint internal_format);
+		void add_reference(GLuint texture);
+		void remove_reference(GLuint texture);
+		void enforce_budget();
+		void erase(std::unordered_map<std::string, record>::iterator it);
+
+		std::unordered_map<std::string, record> _records;
+		std::unordered_map<GLuint, std::string> _keys;
+		size_t _memory_usage;
+		size_t _budget;
+		u64 _use_counter;
+	};
+}
@@ -0,0 +1,218 @@
+#include "texture_loader.hpp"
+
+#include "config.hpp"
+#include "core/Log.h"
+#include "core/Profiler.h"
+#include "external/lodepng.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+bonobo::TextureLoader::TextureLoader(size_t threads_nb) : _workers(), _mutex(), _jobs_condition(), _decoded_condition(), _jobs(), _decoded(), _stop(false), _textures(), _failed(), _pending_textures(), _next_serial(0u), _pending_nb(0u)
+{
+	if (threads_nb == 0u) {
+		auto const hardware_threads_nb = static_cast<size_t>(std::thread::hardware_concurrency());
+		threads_nb = std::max<size_t>(hardware_threads_nb, 2u) - 1u;
+	}
+
+	_workers.reserve(threads_nb);
+	for (size_t i = 0u; i < threads_nb; ++i)
+		_workers.emplace_back(&TextureLoader::work, this);
+}
+
+bonobo::TextureLoader::~TextureLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+		_jobs.clear();
+	}
+	_jobs_condition.notify_all();
+	for (auto& worker : _workers)
+		worker.join();
+}
+
+GLuint
+bonobo::TextureLoader::request(std::string const& filename, bool generate_mipmap, glm::vec4 const& placeholder)
+{
+	auto const key = filename + (generate_mipmap ? "|mipmap" : "|nomipmap");
+	auto const it = _textures.find(key);
+	if (it != _textures.end())
+		return it->second;
+
+	GLuint texture = 0u;
+	glGenTextures(1, &texture);
+	assert(texture != 0u);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_FLOAT, glm::value_ptr(placeholder));
+	glBindTexture(GL_TEXTURE_2D, 0u);
+
+	auto const serial = _next_serial++;
+	_textures.emplace(key, texture);
+	_pending_textures[texture] = serial;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.push_back({ texture, serial, config::resources_path("textures/" + filename), generate_mipmap, true });
+		++_pending_nb;
+	}
+	_jobs_condition.notify_one();
+
+	return texture;
+}
+
+size_t
+bonobo::TextureLoader::upload_ready(size_t max_uploads)
+{
+	PROFILE_SCOPE("TextureLoader::upload_ready");
+	size_t uploads_nb = 0u;
+	while (uploads_nb < max_uploads) {
+		decoded_image image;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (_decoded.empty())
+				break;
+			image = std::move(_decoded.front());
+			_decoded.pop_front();
+			--_pending_nb;
+		}
+
+		// The texture was deleted while its image was being decoded, and
+		// its name possibly reused by a newer request.
+		auto const pending = _pending_textures.find(image.texture);
+		if (pending == _pending_textures.end() || pending->second != image.serial)
+			continue;
+
+		if (image.is_compressed) {
+			if (dds::is_supported(image.compressed.block_format)) {
+				dds::upload(image.texture, image.compressed, image.generate_mipmap);
+				_pending_textures.erase(image.texture);
+				++uploads_nb;
+			} else {
+				// Decode the PNG image instead.
+				std::lock_guard<std::mutex> lock(_mutex);
+				_jobs.push_back({ image.texture, image.serial, std::move(image.path), image.generate_mipmap, false });
+				++_pending_nb;
+				_jobs_condition.notify_one();
+			}
+			continue;
+		}
+
+		if (image.pixels.empty()) {
+			LogWarning("Couldn't load or decode image file %s", image.path.c_str());
+			_failed.insert(image.texture);
+			_pending_textures.erase(image.texture);
+			continue;
+		}
+
+		glBindTexture(GL_TEXTURE_2D, image.texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, static_cast<GLsizei>(image.width), static_cast<GLsizei>(image.height), 0, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(image.pixels.data()));
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.generate_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		if (image.generate_mipmap)
+			glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0u);
+		_pending_textures.erase(image.texture);
+		++uploads_nb;
+	}
+
+	return uploads_nb;
+}
+
+void
+bonobo::TextureLoader::wait()
+{
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			if (_pending_nb == 0u)
+				return;
+			_decoded_condition.wait(lock, [this](){ return !_decoded.empty(); });
+		}
+		upload_ready();
+	}
+}
+
+bool
+bonobo::TextureLoader::has_failed(GLuint texture) const
+{
+	return _failed.find(texture) != _failed.end();
+}
+
+size_t
+bonobo::TextureLoader::get_pending_nb() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _pending_nb;
+}
+
+bool
+bonobo::TextureLoader::is_pending(GLuint texture) const
+{
+	return _pending_textures.find(texture) != _pending_textures.end();
+}
+
+void
+bonobo::TextureLoader::forget(GLuint texture)
+{
+	for (auto it = _textures.begin(); it != _textures.end(); ++it) {
+		if (it->second == texture) {
+			_textures.erase(it);
+			break;
+		}
+	}
+	_failed.erase(texture);
+	_pending_textures.erase(texture);
+}
+
+void
+bonobo::TextureLoader::work()
+{
+	PROFILE_THREAD("Texture loader");
+	for (;;) {
+		job current;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_jobs_condition.wait(lock, [this](){ return _stop || !_jobs.empty(); });
+			if (_stop)
+				return;
+			current = std::move(_jobs.front());
+			_jobs.pop_front();
+		}
+
+		PROFILE_SCOPE("Decode texture");
+		decoded_image image;
+		image.texture = current.texture;
+		image.serial = current.serial;
+		image.path = std::move(current.path);
+		image.generate_mipmap = current.generate_mipmap;
+		image.width = 0u;
+		image.height = 0u;
+		image.is_compressed = current.allow_compressed
+		                   && dds::read(dds::get_path(image.path), image.compressed)
+		                   && image.compressed.flipped;
+		if (image.is_compressed) {
+			// Nothing to decode.
+		} else if (lodepng::decode(image.pixels, image.width, image.height, image.path, LCT_RGBA) != 0u) {
+			image.pixels.clear();
+		} else {
+			// Flip in place, as OpenGL expects the first row to be the
+			// bottom one.
+			auto const row_size = static_cast<size_t>(image.width) * 4u;
+			for (u32 y = 0u; y < image.height / 2u; ++y)
+				std::swap_ranges(image.pixels.begin() + y * row_size,
+				                 image.pixels.begin() + (y + 1u) * row_size,
+				                 image.pixels.begin() + (image.height - 1u - y) * row_size);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_decoded.push_back(std::move(image));
+		}
+		_decoded_condition.notify_all();
+	}
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "dds.hpp"
+#include "Types.h"
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Loads PNG images into OpenGL 2D-textures, decoding them on a
+	//!        pool of worker threads.
+	//!
+	//! `request()` immediately returns the name of a texture holding a 1×1
+	//! placeholder; the decoded image replaces it, under the same name,
+	//! during a later call to `upload_ready()` or `wait()`. All OpenGL
+	//! calls are made from the thread calling those functions, which has
+	//! to be the one owning the OpenGL context.
+	//!
+	//! Requesting the same image twice, with the same mipmap setting,
+	//! returns the same texture and decodes it only once. As with
+	//! `bonobo::loadTexture2D()`, block-compressed versions of the images
+	//! are used when available.
+	class TextureLoader
+	{
+	public:
+		//! \brief Start the worker threads.
+		//!
+		//! @param [in] threads_nb number of worker threads; 0 picks one less
+		//!             than the number of hardware threads, and at least one
+		explicit TextureLoader(size_t threads_nb = 0u);
+
+		//! \brief Stop the worker threads; pending requests are dropped,
+		//!        but textures already handed out are not deleted.
+		~TextureLoader();
+
+		TextureLoader(TextureLoader const&) = delete;
+		TextureLoader& operator=(TextureLoader const&) = delete;
+
+		//! \brief Queue the loading of a PNG image.
+		//!
+		//! @param [in] filename of the PNG image, relative to the `textures`
+		//!             folder within the `resources` folder
+		//! @param [in] generate_mipmap whether or not to generate a mipmap
+		//!             hierarchy
+		//! @param [in] placeholder colour of the texture until the image is
+		//!             uploaded
+		//! @return the name of the OpenGL 2D-texture
+		GLuint request(std::string const& filename, bool generate_mipmap = true,
+		               glm::vec4 const& placeholder = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+
+		//! \brief Upload images that finished decoding.
+		//!
+		//! @param [in] max_uploads maximum number of textures to upload,
+		//!             to bound the time spent in this call
+		//! @return the number of textures that were uploaded
+		size_t upload_ready(size_t max_uploads = std::numeric_limits<size_t>::max());
+
+		//! \brief Block until all requested images are uploaded.
+		void wait();
+
+		//! \brief Return whether an image could not be loaded; its texture
+		//!        then keeps the placeholder.
+		bool has_failed(GLuint texture) const;
+
+		//! \brief Return the number of requested images not yet uploaded.
+		size_t get_pending_nb() const;
+
+		//! \brief Return whether a requested texture still holds its
+		//!        placeholder, waiting for its image to be uploaded.
+		bool is_pending(GLuint texture) const;
+
+		//! \brief Forget a texture that is about to be deleted, so that
+		//!        requesting its image again creates a new one; if its image
+		//!        is still being decoded, it is dropped once decoded.
+		//!
+		//! @param [in] texture a texture returned by `request()`
+		void forget(GLuint texture);
+
+	private:
+		struct job {
+			GLuint texture;
+			u64 serial;            //!< of the request, see `_pending_textures`
+			std::string path;
+			bool generate_mipmap;
+			bool allow_compressed; //!< whether to look for a DDS file first
+		};
+		struct decoded_image {
+			GLuint texture;
+			u64 serial;
+			std::string path;
+			bool generate_mipmap;
+			bool is_compressed;     //!< whether `compressed` is used
+			dds::texture compressed;
+			u32 width;
+			u32 height;
+			std::vector<u8> pixels; //!< empty if decoding failed
+		};
+
+		void work();
+
+		std::vector<std::thread> _workers;
+		mutable std::mutex _mutex;
+		std::condition_variable _jobs_condition;
+		std::condition_variable _decoded_condition;
+		std::deque<job> _jobs;
+		std::deque<decoded_image> _decoded;
+		bool _stop;
+
+		std::unordered_map<std::string, GLuint> _textures;
+		std::unordered_set<GLuint> _failed;
+		//! Serial number of the request each pending texture waits for;
+		//! a deleted texture name can be handed out again by OpenGL, so
+		//! images decoded for a forgotten request are told apart by it.
+		std::unordered_map<GLuint, u64> _pending_textures;
+		u64 _next_serial;
+		size_t _pending_nb;
+	};
+}
@@ -0,0 +1,103 @@
+#include "uniform_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+bonobo::frame_uniforms
+bonobo::make_frame_uniforms(FPSCameraf::Snapshot const& camera, glm::ivec2 const& viewport_size, float time, float delta_time)
+{
+	frame_uniforms uniforms{};
+	uniforms.camera_world_to_view = camera.mWorldToView;
+	uniforms.camera_view_to_clip = camera.mViewToClip;
+	uniforms.camera_world_to_clip = camera.mWorldToClip;
+	uniforms.view_projection_inverse = camera.mClipToWorld;
+	uniforms.camera_position = camera.mPosition;
+	uniforms.time = time;
+	uniforms.viewport_size = glm::vec2(viewport_size);
+	uniforms.inv_res = glm::vec2(1.0f) / glm::max(uniforms.viewport_size, glm::vec2(1.0f));
+	uniforms.delta_time = delta_time;
+	uniforms.camera_near = camera.mNear;
+	uniforms.camera_far = camera.mFar;
+	return uniforms;
+}
+
+void
+bonobo::bind_uniform_blocks(GLuint program)
+{
+	struct block {
+		char const* name;
+		uniform_block_bindings binding;
+	};
+	block const blocks[] = {
+		{ "Frame",  uniform_block_bindings::frame  },
+		{ "Pass",   uniform_block_bindings::pass   },
+		{ "Object", uniform_block_bindings::object }
+	};
+	for (auto const& b : blocks) {
+		auto const index = glGetUniformBlockIndex(program, b.name);
+		if (index != GL_INVALID_INDEX)
+			glUniformBlockBinding(program, index, static_cast<GLuint>(b.binding));
+	}
+}
+
+bonobo::UniformBuffer::UniformBuffer(uniform_block_bindings binding, size_t block_size) : _bo(0u), _binding(static_cast<GLuint>(binding)), _block_size(block_size), _stride(block_size), _capacity(0u), _blocks_nb(0u), _staging()
+{
+	glGenBuffers(1, &_bo);
+	assert(_bo != 0u);
+
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment > 1) {
+		auto const a = static_cast<size_t>(alignment);
+		_stride = (block_size + a - 1u) / a * a;
+	}
+}
+
+bonobo::UniformBuffer::~UniformBuffer()
+{
+	glDeleteBuffers(1, &_bo);
+	_bo = 0u;
+}
+
+void
+bonobo::UniformBuffer::upload(void const* blocks, size_t blocks_nb)
+{
+	_blocks_nb = blocks_nb;
+	if (blocks_nb == 0u)
+		return;
+
+	// Blocks bound with an offset have to start on the driver's alignment,
+	// so several blocks are spread out first.
+	auto const* data = static_cast<u8 const*>(blocks);
+	if (blocks_nb > 1u && _stride != _block_size) {
+		_staging.resize(blocks_nb * _stride);
+		for (size_t i = 0u; i < blocks_nb; ++i)
+			std::memcpy(_staging.data() + i * _stride, data + i * _block_size, _block_size);
+		data = _staging.data();
+	}
+	auto const size = (blocks_nb - 1u) * _stride + _block_size;
+
+	// Orphan the previous storage rather than waiting for the draws still
+	// reading it.
+	glBindBuffer(GL_UNIFORM_BUFFER, _bo);
+	_capacity = std::max(_capacity, size);
+	glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(_capacity), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(size), data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+
+	bind(0u);
+}
+
+void
+bonobo::UniformBuffer::bind(size_t index) const
+{
+	assert(index < _blocks_nb);
+	glBindBufferRange(GL_UNIFORM_BUFFER, _binding, _bo, static_cast<GLintptr>(index * _stride),
+	                  static_cast<GLsizeiptr>(_block_size));
+}
+
+size_t
+bonobo::UniformBuffer::get_blocks_nb() const
+{
+	return _blocks_nb;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "Types.h"
+
+#include "external/glad/glad.h"
+#include "FPSCamera.h" // As it includes OpenGL headers, import it after glad
+
+#include <glm/glm.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Formalise mapping between an OpenGL uniform buffer binding
+	//!        point, and the uniform block sourced from it.
+	//!
+	//! The blocks are declared in `shaders/common/uniform_blocks.glsl`,
+	//! and `bind_uniform_blocks()` attaches them to these binding points,
+	//! as OpenGL 4.1 has no `layout(binding = N)` for uniform blocks.
+	enum class uniform_block_bindings : GLuint {
+		frame = 0u, //!< = 0, block `Frame`, see `frame_uniforms`
+		pass,       //!< = 1, block `Pass`, see `pass_uniforms`
+		object      //!< = 2, block `Object`, see `object_uniforms`
+	};
+
+	//! \brief Content of the `Frame` uniform block, updated once per
+	//!        frame; it follows the std140 layout rules.
+	struct frame_uniforms {
+		glm::mat4 camera_world_to_view;
+		glm::mat4 camera_view_to_clip;
+		glm::mat4 camera_world_to_clip;
+		glm::mat4 view_projection_inverse; //!< camera's clip-space to world-space
+		glm::vec3 camera_position;         //!< in world-space
+		float time;                        //!< in seconds
+		glm::vec2 viewport_size;           //!< in pixels
+		glm::vec2 inv_res;                 //!< inverse of `viewport_size`
+		float delta_time;                  //!< in seconds
+		float camera_near;
+		float camera_far;
+		float padding;
+	};
+
+	//! \brief Content of the `Pass` uniform block, updated once per pass,
+	//!        e.g. per shadow map or per light; it follows the std140
+	//!        layout rules.
+	//!
+	//! Shaders including the uniform blocks read `vertex_world_to_clip`
+	//! from this block, rather than from the matrix given to
+	//! `Node::render()`, which is then only used for culling.
+	struct pass_uniforms {
+		glm::mat4 vertex_world_to_clip;    //!< world-space to clip-space, of the pass' view
+		glm::mat4 shadow_view_projection;  //!< world-space to clip-space, of the light
+		glm::vec3 light_position;          //!< in world-space
+		float light_intensity;
+		glm::vec3 light_direction;         //!< in world-space
+		float light_angle_falloff;
+		glm::vec3 light_color;
+		float padding0;
+		glm::vec2 shadowmap_texel_size;
+		glm::vec2 padding1;
+		glm::vec4 shadowmap_atlas_rect;    //!< light's slot in the shadow atlas: offset then size, in texture coordinates
+	};
+
+	//! \brief Content of the `Object` uniform block, written for every
+	//!        draw by `Node::render()` into the frame's `StreamBuffer`; it
+	//!        follows the std140 layout rules.
+	struct object_uniforms {
+		glm::mat4 vertex_model_to_world;
+		glm::mat4 normal_model_to_world;   //!< inverse transpose of `vertex_model_to_world`
+	};
+
+	static_assert(sizeof(frame_uniforms) == 304u && offsetof(frame_uniforms, camera_position) == 256u
+	              && offsetof(frame_uniforms, viewport_size) == 272u && offsetof(frame_uniforms, delta_time) == 288u,
+	              "frame_uniforms no longer matches the std140 layout of the `Frame` block");
+	static_assert(sizeof(pass_uniforms) == 208u && offsetof(pass_uniforms, light_position) == 128u
+	              && offsetof(pass_uniforms, light_color) == 160u && offsetof(pass_uniforms, shadowmap_texel_size) == 176u
+	              && offsetof(pass_uniforms, shadowmap_atlas_rect) == 192u,
+	              "pass_uniforms no longer matches the std140 layout of the `Pass` block");
+	static_assert(sizeof(object_uniforms) == 128u,
+	              "object_uniforms no longer matches the std140 layout of the `Object` block");
+
+	//! \brief Fill the `Frame` uniform block from a camera.
+	//!
+	//! @param [in] camera snapshot of the camera rendering the frame
+	//! @param [in] viewport_size size of the viewport, in pixels
+	//! @param [in] time time elapsed since the start, in seconds
+	//! @param [in] delta_time time elapsed since the previous frame, in
+	//!             seconds
+	frame_uniforms make_frame_uniforms(FPSCameraf::Snapshot const& camera, glm::ivec2 const& viewport_size,
+	                                   float time, float delta_time);
+
+	//! \brief Attach the uniform blocks used by a program to their binding
+	//!        points; `createProgram()` does it for all its programs.
+	void bind_uniform_blocks(GLuint program);
+
+	//! \brief Buffer object holding one or more instances of a uniform
+	//!        block, e.g. one per pass, which are uploaded together and
+	//!        then bound one after the other.
+	class UniformBuffer
+	{
+	public:
+		//! \brief Create the buffer object.
+		//!
+		//! @param [in] binding the binding point the blocks are bound to
+		//! @param [in] block_size size of a block, in bytes
+		UniformBuffer(uniform_block_bindings binding, size_t block_size);
+
+		//! \brief Release the buffer object.
+		~UniformBuffer();
+
+		UniformBuffer(UniformBuffer const&) = delete;
+		UniformBuffer& operator=(UniformBuffer const&) = delete;
+
+		//! \brief Replace the content of the buffer object, and bind the
+		//!        first block.
+		//!
+		//! @param [in] blocks array of `blocks_nb` blocks, tightly packed
+		//! @param [in] blocks_nb number of blocks in `blocks`
+		void upload(void const* blocks, size_t blocks_nb);
+
+		template<typename T>
+		void upload(T const& block);
+
+		template<typename T>
+		void upload(std::vector<T> const& blocks);
+
+		//! \brief Bind one of the uploaded blocks to the binding point.
+		void bind(size_t index) const;
+
+		//! \brief Get the number of blocks of the last upload.
+		size_t get_blocks_nb() const;
+
+	private:
+		GLuint _bo;
+		GLuint _binding;
+		size_t _block_size;
+		size_t _stride;          //!< block size, rounded up to the
+		                         //!< offset alignment of the driver
+		size_t _capacity;        //!< in bytes
+		size_t _blocks_nb;
+		std::vector<u8> _staging;
+	};
+}
+
+template<typename T>
+void
+bonobo::UniformBuffer::upload(T const& block)
+{
+	assert(sizeof(T) == _block_size);
+	upload(&block, 1u);
+}
+
+template<typename T>
+void
+bonobo::UniformBuffer::upload(std::vector<T> const& blocks)
+{
+	assert(sizeof(T) == _block_size);
+	upload(blocks.data(), blocks.size());
+}
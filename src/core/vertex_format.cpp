@@ -0,0 +1,274 @@
+#include "vertex_format.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+#include <cstring>
+
+namespace
+{
+	//! \brief How one attribute is stored, for a single vertex.
+	struct attribute_encoding {
+		GLint components_nb;
+		GLenum type;
+		GLboolean normalized;
+		size_t size;
+	};
+
+	attribute_encoding get_direction_encoding(bonobo::vertex_format::direction_encoding encoding, bool needs_w)
+	{
+		using direction_encoding = bonobo::vertex_format::direction_encoding;
+		switch (encoding) {
+		case direction_encoding::half4:
+			return { 4, GL_HALF_FLOAT, GL_FALSE, 4u * sizeof(u16) };
+		case direction_encoding::snorm10:
+			return { 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(u32) };
+		case direction_encoding::float3:
+		default:
+			return { needs_w ? 4 : 3, GL_FLOAT, GL_FALSE, (needs_w ? 4u : 3u) * sizeof(float) };
+		}
+	}
+
+	attribute_encoding get_texcoords_encoding(bonobo::vertex_format::texcoords_encoding encoding)
+	{
+		using texcoords_encoding = bonobo::vertex_format::texcoords_encoding;
+		switch (encoding) {
+		case texcoords_encoding::float2:
+			return { 2, GL_FLOAT, GL_FALSE, 2u * sizeof(float) };
+		case texcoords_encoding::half2:
+			return { 2, GL_HALF_FLOAT, GL_FALSE, 2u * sizeof(u16) };
+		case texcoords_encoding::float3:
+		default:
+			return { 3, GL_FLOAT, GL_FALSE, 3u * sizeof(float) };
+		}
+	}
+
+	void write_direction(u8* destination, glm::vec3 const& direction, float w,
+	                     bonobo::vertex_format::direction_encoding encoding, attribute_encoding const& layout)
+	{
+		using direction_encoding = bonobo::vertex_format::direction_encoding;
+		switch (encoding) {
+		case direction_encoding::half4:
+		{
+			u16 const values[4] = { glm::packHalf1x16(direction.x), glm::packHalf1x16(direction.y),
+			                        glm::packHalf1x16(direction.z), glm::packHalf1x16(w) };
+			std::memcpy(destination, values, sizeof(values));
+			break;
+		}
+		case direction_encoding::snorm10:
+		{
+			auto const value = glm::packSnorm3x10_1x2(glm::vec4(direction, w));
+			std::memcpy(destination, &value, sizeof(value));
+			break;
+		}
+		case direction_encoding::float3:
+		default:
+		{
+			float const values[4] = { direction.x, direction.y, direction.z, w };
+			std::memcpy(destination, values, layout.size);
+			break;
+		}
+		}
+	}
+
+	void write_texcoords(u8* destination, glm::vec3 const& texcoords,
+	                     bonobo::vertex_format::texcoords_encoding encoding, attribute_encoding const& layout)
+	{
+		if (encoding == bonobo::vertex_format::texcoords_encoding::half2) {
+			u16 const values[2] = { glm::packHalf1x16(texcoords.x), glm::packHalf1x16(texcoords.y) };
+			std::memcpy(destination, values, sizeof(values));
+		} else {
+			std::memcpy(destination, &texcoords, layout.size);
+		}
+	}
+
+	//! \brief Whether binormals are stored, rather than rebuilt from the
+	//!        normals and tangents.
+	bool stores_binormals(bool has_normals, bool has_tangents, bool has_binormals, bonobo::vertex_format const& format)
+	{
+		return has_binormals && (format.store_binormals || !has_normals || !has_tangents);
+	}
+
+	//! \brief Lay out the attributes of `vertices_nb` vertices, leaving
+	//!        `data` empty; `encodings` receives the encoding of each
+	//!        attribute.
+	bonobo::packed_vertices lay_out_vertices(size_t vertices_nb, bool has_normals, bool has_texcoords,
+	                                         bool has_tangents, bool has_binormals,
+	                                         bonobo::vertex_format const& format,
+	                                         std::vector<attribute_encoding>& encodings)
+	{
+		using bonobo::shader_bindings;
+		auto const store_binormals = stores_binormals(has_normals, has_tangents, has_binormals, format);
+		auto const tangents_need_w = has_tangents && !store_binormals;
+
+		// Attributes are listed in the order of `bonobo::shader_bindings`,
+		// along with their per-vertex encoding.
+		bonobo::packed_vertices packed;
+		packed.vertices_nb = vertices_nb;
+		encodings.clear();
+		auto const add_attribute = [&packed,&encodings](shader_bindings binding, attribute_encoding const& encoding){
+			packed.attributes.push_back({ binding, encoding.components_nb, encoding.type, encoding.normalized, 0, 0u });
+			encodings.push_back(encoding);
+		};
+		add_attribute(shader_bindings::vertices, { 3, GL_FLOAT, GL_FALSE, 3u * sizeof(float) });
+		if (has_normals)
+			add_attribute(shader_bindings::normals, get_direction_encoding(format.directions, false));
+		if (has_texcoords)
+			add_attribute(shader_bindings::texcoords, get_texcoords_encoding(format.texcoords));
+		if (has_tangents)
+			add_attribute(shader_bindings::tangents, get_direction_encoding(format.directions, tangents_need_w));
+		if (store_binormals)
+			add_attribute(shader_bindings::binormals, get_direction_encoding(format.directions, false));
+
+		packed.vertex_size = 0u;
+		for (auto const& encoding : encodings)
+			packed.vertex_size += encoding.size;
+
+		// Planar streams are tightly packed one after the other, while
+		// interleaved ones share the vertex size as stride.
+		auto const is_interleaved = format.arrangement == bonobo::vertex_format::layout::interleaved;
+		size_t offset = 0u;
+		for (size_t i = 0u; i < packed.attributes.size(); ++i) {
+			auto& attribute = packed.attributes[i];
+			attribute.offset = offset;
+			attribute.stride = is_interleaved ? static_cast<GLsizei>(packed.vertex_size) : 0;
+			offset += is_interleaved ? encodings[i].size : encodings[i].size * vertices_nb;
+		}
+
+		return packed;
+	}
+
+	char const* get_direction_encoding_name(bonobo::vertex_format::direction_encoding encoding)
+	{
+		using direction_encoding = bonobo::vertex_format::direction_encoding;
+		switch (encoding) {
+		case direction_encoding::float3:     return "float3";
+		case direction_encoding::half4:      return "half4";
+		case direction_encoding::snorm10:    return "snorm10";
+		}
+		return "?";
+	}
+
+	char const* get_texcoords_encoding_name(bonobo::vertex_format::texcoords_encoding encoding)
+	{
+		using texcoords_encoding = bonobo::vertex_format::texcoords_encoding;
+		switch (encoding) {
+		case texcoords_encoding::float3: return "float3";
+		case texcoords_encoding::float2: return "float2";
+		case texcoords_encoding::half2:  return "half2";
+		}
+		return "?";
+	}
+}
+
+bonobo::vertex_format
+bonobo::vertex_format::planar()
+{
+	return vertex_format();
+}
+
+bonobo::vertex_format
+bonobo::vertex_format::compact()
+{
+	vertex_format format;
+	format.arrangement = layout::interleaved;
+	format.directions = direction_encoding::snorm10;
+	format.texcoords = texcoords_encoding::float2;
+	format.store_binormals = false;
+	return format;
+}
+
+std::string
+bonobo::vertex_format::get_name() const
+{
+	return std::string(arrangement == layout::planar ? "planar" : "interleaved")
+	     + ", " + get_direction_encoding_name(directions)
+	     + ", " + get_texcoords_encoding_name(texcoords)
+	     + (store_binormals ? ", binormals" : ", no binormals");
+}
+
+bool
+bonobo::vertex_format::operator==(vertex_format const& other) const
+{
+	return arrangement == other.arrangement
+	    && directions == other.directions
+	    && texcoords == other.texcoords
+	    && store_binormals == other.store_binormals;
+}
+
+bool
+bonobo::vertex_format::operator!=(vertex_format const& other) const
+{
+	return !(*this == other);
+}
+
+bonobo::packed_vertices
+bonobo::get_packed_layout(size_t vertices_nb, bool has_normals, bool has_texcoords, bool has_tangents, bool has_binormals, vertex_format const& format)
+{
+	std::vector<attribute_encoding> encodings;
+	return lay_out_vertices(vertices_nb, has_normals, has_texcoords, has_tangents, has_binormals, format, encodings);
+}
+
+bonobo::packed_vertices
+bonobo::pack_vertices(vertex_streams const& streams, vertex_format const& format)
+{
+	auto const vertices_nb = streams.vertices_nb;
+	auto const tangents_need_w = streams.tangents != nullptr
+	                          && !stores_binormals(streams.normals != nullptr, streams.tangents != nullptr, streams.binormals != nullptr, format);
+
+	std::vector<attribute_encoding> encodings;
+	auto packed = lay_out_vertices(vertices_nb, streams.normals != nullptr, streams.texcoords != nullptr,
+	                               streams.tangents != nullptr, streams.binormals != nullptr, format, encodings);
+	auto const is_interleaved = format.arrangement == vertex_format::layout::interleaved;
+
+	packed.data.resize(packed.vertex_size * vertices_nb);
+	for (size_t i = 0u; i < packed.attributes.size(); ++i) {
+		auto const& attribute = packed.attributes[i];
+		auto const& encoding = encodings[i];
+		auto const element_stride = is_interleaved ? packed.vertex_size : encoding.size;
+		auto destination = packed.data.data() + attribute.offset;
+		for (size_t v = 0u; v < vertices_nb; ++v, destination += element_stride) {
+			switch (attribute.binding) {
+			case shader_bindings::vertices:
+				std::memcpy(destination, &streams.vertices[v], encoding.size);
+				break;
+			case shader_bindings::normals:
+				write_direction(destination, streams.normals[v], 0.0f, format.directions, encoding);
+				break;
+			case shader_bindings::texcoords:
+				write_texcoords(destination, streams.texcoords[v], format.texcoords, encoding);
+				break;
+			case shader_bindings::tangents:
+			{
+				// The handedness of the tangent frame, so that the
+				// binormal can be rebuilt from the normal and tangent.
+				auto handedness = 1.0f;
+				if (tangents_need_w && streams.binormals != nullptr
+				    && glm::dot(glm::cross(streams.normals[v], streams.tangents[v]), streams.binormals[v]) < 0.0f)
+					handedness = -1.0f;
+				write_direction(destination, streams.tangents[v], handedness, format.directions, encoding);
+				break;
+			}
+			case shader_bindings::binormals:
+				write_direction(destination, streams.binormals[v], 0.0f, format.directions, encoding);
+				break;
+			case shader_bindings::instance_transforms:
+			case shader_bindings::instance_materials:
+				// Per-instance data is never part of a mesh.
+				break;
+			}
+		}
+	}
+
+	return packed;
+}
+
+void
+bonobo::set_vertex_attributes(packed_vertices const& vertices, size_t base_offset)
+{
+	for (auto const& attribute : vertices.attributes) {
+		auto const location = static_cast<unsigned int>(attribute.binding);
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, attribute.components_nb, attribute.type, attribute.normalized,
+		                      attribute.stride, reinterpret_cast<GLvoid const*>(base_offset + attribute.offset));
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Types.h"
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Formalise mapping between an OpenGL VAO attribute binding,
+	//!        and the meaning of that attribute.
+	enum class shader_bindings : unsigned int{
+		vertices = 0u, //!< = 0, value of the binding point for vertices
+		normals,       //!< = 1, value of the binding point for normals
+		texcoords,     //!< = 2, value of the binding point for texcoords
+		tangents,      //!< = 3, value of the binding point for tangents
+		binormals,     //!< = 4, value of the binding point for binormals
+		instance_transforms,     //!< = 5 to 8, per-instance model-to-world matrices, one column each
+		instance_materials = 9u  //!< = 9, value of the binding point for per-instance material indices
+	};
+
+	//! \brief Describe how the vertex attributes of a mesh are stored in
+	//!        its buffer object.
+	//!
+	//! Positions are always stored as 3 floats. All encodings are decoded
+	//! by the vertex fetch, so shaders keep declaring `vec3` inputs. When binormals are not stored, the
+	//! sign of the w component of the tangents holds their handedness, and
+	//! shaders rebuild them as `cross(normal, tangent.xyz) * sign(tangent.w)`:
+	//! the magnitude of w depends on the encoding, i.e. snorm10's 2-bit w
+	//! can decode to ±1/3. Nodes tell shaders which case they are in
+	//! through the `has_binormals` uniform.
+	struct vertex_format {
+		//! \brief How attributes are arranged within the buffer object.
+		enum class layout : u32 {
+			planar,     //!< one stream per attribute, one after the other
+			interleaved //!< all attributes of a vertex next to each other
+		};
+
+		//! \brief How normals and tangents are encoded.
+		enum class direction_encoding : u32 {
+			float3,     //!< 3 floats, 12 bytes
+			half4,      //!< 4 half floats, 8 bytes
+			snorm10     //!< normalised GL_INT_2_10_10_10_REV, 4 bytes
+		};
+
+		//! \brief How texture coordinates are encoded.
+		enum class texcoords_encoding : u32 {
+			float3,     //!< 3 floats, 12 bytes
+			float2,     //!< 2 floats, 8 bytes
+			half2       //!< 2 half floats, 4 bytes; for coordinates that
+			            //!< stay within a few repetitions of the texture
+		};
+
+		layout arrangement = layout::planar;
+		direction_encoding directions = direction_encoding::float3;
+		texcoords_encoding texcoords = texcoords_encoding::float3;
+		bool store_binormals = true; //!< otherwise, rebuilt in the shaders
+
+		//! \brief The layout used by default: planar, full-precision
+		//!        streams, as expected by all shaders.
+		static vertex_format planar();
+
+		//! \brief Interleaved, with 10-bit normals and tangents, 2-float
+		//!        texture coordinates and no binormals: 28 bytes per
+		//!        vertex instead of 60.
+		static vertex_format compact();
+
+		//! \brief Return a short description, i.e. "interleaved, snorm10,
+		//!        float2, no binormals".
+		std::string get_name() const;
+
+		bool operator==(vertex_format const& other) const;
+		bool operator!=(vertex_format const& other) const;
+	};
+
+	//! \brief Vertex attributes stored as separate arrays of 3-component
+	//!        floats, as produced by Assimp or the parametric shapes;
+	//!        missing attributes are left to nullptr.
+	struct vertex_streams {
+		size_t vertices_nb = 0u;
+		glm::vec3 const* vertices = nullptr;
+		glm::vec3 const* normals = nullptr;
+		glm::vec3 const* texcoords = nullptr;
+		glm::vec3 const* tangents = nullptr;
+		glm::vec3 const* binormals = nullptr;
+	};
+
+	//! \brief Vertices encoded in a given vertex format, ready to be
+	//!        uploaded into a buffer object.
+	struct packed_vertices {
+		//! \brief Arguments to `glVertexAttribPointer()` for an attribute.
+		struct attribute {
+			shader_bindings binding;
+			GLint components_nb;
+			GLenum type;
+			GLboolean normalized;
+			GLsizei stride;
+			size_t offset; //!< from the start of `data`
+		};
+
+		std::vector<u8> data; //!< empty when returned by `get_packed_layout()`
+		std::vector<attribute> attributes;
+		size_t vertex_size; //!< in bytes, summed over all attributes
+		size_t vertices_nb;
+	};
+
+	//! \brief Return how `pack_vertices()` would lay out vertices, without
+	//!        encoding any of them; for vertices that were packed ahead of
+	//!        time, i.e. read from a mesh cache.
+	//!
+	//! @param [in] vertices_nb the number of vertices
+	//! @param [in] has_normals whether the vertices have normals
+	//! @param [in] has_texcoords whether the vertices have texcoords
+	//! @param [in] has_tangents whether the vertices have tangents
+	//! @param [in] has_binormals whether the vertices have binormals
+	//! @param [in] format how the vertices are encoded
+	packed_vertices get_packed_layout(size_t vertices_nb, bool has_normals,
+	                                  bool has_texcoords, bool has_tangents,
+	                                  bool has_binormals,
+	                                  vertex_format const& format);
+
+	//! \brief Encode vertex streams into a vertex format.
+	//!
+	//! Binormals are always stored when tangents are present but normals
+	//! are not, as they could not be rebuilt.
+	packed_vertices pack_vertices(vertex_streams const& streams, vertex_format const& format);
+
+	//! \brief Enable and set up the attributes of the currently bound VAO,
+	//!        reading from the buffer object bound to GL_ARRAY_BUFFER.
+	//!
+	//! @param [in] vertices vertices previously uploaded
+	//! @param [in] base_offset where in the buffer object the data of
+	//!             `vertices` was uploaded
+	void set_vertex_attributes(packed_vertices const& vertices, size_t base_offset = 0u);
+}
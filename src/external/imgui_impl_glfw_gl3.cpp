@@ -8,6 +8,7 @@
 
 #include <imgui.h>
 #include "imgui_impl_glfw_gl3.h"
+#include <string.h>
 
 // GL3W/GLFW
 #include "glad/glad.h"
@@ -29,6 +30,26 @@ static int          g_ShaderHandle = 0, g_VertHandle = 0, g_FragHandle = 0;
 static int          g_AttribLocationTex = 0, g_AttribLocationProjMtx = 0;
 static int          g_AttribLocationPosition = 0, g_AttribLocationUV = 0, g_AttribLocationColor = 0;
 static unsigned int g_VboHandle = 0, g_VaoHandle = 0, g_ElementsHandle = 0;
+static ImGui_ImplGlfwGL3_StreamWriteFn g_StreamWriter = NULL;
+static void*        g_StreamWriterUserData = NULL;
+static ImVector<char> g_StreamStaging;
+
+void ImGui_ImplGlfwGL3_SetStreamWriter(ImGui_ImplGlfwGL3_StreamWriteFn writer, void* user_data)
+{
+    g_StreamWriter = writer;
+    g_StreamWriterUserData = user_data;
+}
+
+// Point the vertex attributes of the VAO at the vertices starting 'base_offset' bytes into 'vbo'
+static void ImGui_ImplGlfwGL3_SetupVertexAttribs(GLuint vbo, size_t base_offset)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+#define OFFSETOF(TYPE, ELEMENT) ((size_t)&(((TYPE *)0)->ELEMENT))
+    glVertexAttribPointer(g_AttribLocationPosition, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (GLvoid*)(base_offset + OFFSETOF(ImDrawVert, pos)));
+    glVertexAttribPointer(g_AttribLocationUV, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (GLvoid*)(base_offset + OFFSETOF(ImDrawVert, uv)));
+    glVertexAttribPointer(g_AttribLocationColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert), (GLvoid*)(base_offset + OFFSETOF(ImDrawVert, col)));
+#undef OFFSETOF
+}
 
 // This is the main rendering function that you have to implement and provide to ImGui (via setting up 'RenderDrawListsFn' in the ImGuiIO structure)
 // If text or lines are blurry when integrating ImGui in your engine:
@@ -90,12 +111,34 @@ void ImGui_ImplGlfwGL3_RenderDrawLists(ImDrawData* draw_data)
     {
         const ImDrawList* cmd_list = draw_data->CmdLists[n];
         const ImDrawIdx* idx_buffer_offset = 0;
+        const size_t vtx_size = (size_t)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+        const size_t idx_size = (size_t)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+
+        // Vertices and indices are streamed as a single block, the indices following the vertices
+        GLuint stream_bo = 0;
+        size_t stream_offset = 0;
+        if (g_StreamWriter)
+        {
+            g_StreamStaging.resize((int)(vtx_size + idx_size));
+            memcpy(g_StreamStaging.Data, cmd_list->VtxBuffer.Data, vtx_size);
+            memcpy(g_StreamStaging.Data + vtx_size, cmd_list->IdxBuffer.Data, idx_size);
+            stream_bo = g_StreamWriter(g_StreamWriterUserData, g_StreamStaging.Data, vtx_size + idx_size, &stream_offset);
+        }
 
-        glBindBuffer(GL_ARRAY_BUFFER, g_VboHandle);
-        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert), (const GLvoid*)cmd_list->VtxBuffer.Data, GL_STREAM_DRAW);
+        if (stream_bo != 0)
+        {
+            ImGui_ImplGlfwGL3_SetupVertexAttribs(stream_bo, stream_offset);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, stream_bo);
+            idx_buffer_offset = (const ImDrawIdx*)(intptr_t)(stream_offset + vtx_size);
+        }
+        else
+        {
+            ImGui_ImplGlfwGL3_SetupVertexAttribs(g_VboHandle, 0);
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vtx_size, (const GLvoid*)cmd_list->VtxBuffer.Data, GL_STREAM_DRAW);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_ElementsHandle);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx), (const GLvoid*)cmd_list->IdxBuffer.Data, GL_STREAM_DRAW);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_ElementsHandle);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)idx_size, (const GLvoid*)cmd_list->IdxBuffer.Data, GL_STREAM_DRAW);
+        }
 
         for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
         {
@@ -256,16 +299,10 @@ bool ImGui_ImplGlfwGL3_CreateDeviceObjects()
 
     glGenVertexArrays(1, &g_VaoHandle);
     glBindVertexArray(g_VaoHandle);
-    glBindBuffer(GL_ARRAY_BUFFER, g_VboHandle);
     glEnableVertexAttribArray(g_AttribLocationPosition);
     glEnableVertexAttribArray(g_AttribLocationUV);
     glEnableVertexAttribArray(g_AttribLocationColor);
-
-#define OFFSETOF(TYPE, ELEMENT) ((size_t)&(((TYPE *)0)->ELEMENT))
-    glVertexAttribPointer(g_AttribLocationPosition, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (GLvoid*)OFFSETOF(ImDrawVert, pos));
-    glVertexAttribPointer(g_AttribLocationUV, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (GLvoid*)OFFSETOF(ImDrawVert, uv));
-    glVertexAttribPointer(g_AttribLocationColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert), (GLvoid*)OFFSETOF(ImDrawVert, col));
-#undef OFFSETOF
+    ImGui_ImplGlfwGL3_SetupVertexAttribs(g_VboHandle, 0);
 
     ImGui_ImplGlfwGL3_CreateFontsTexture();
 
@@ -6,6 +6,8 @@
 // If you are new to ImGui, see examples/README.txt and documentation at the top of imgui.cpp.
 // https://github.com/ocornut/imgui
 
+#include <stddef.h>
+
 struct GLFWwindow;
 
 IMGUI_API bool        ImGui_ImplGlfwGL3_Init(GLFWwindow* window, bool install_callbacks);
@@ -16,6 +18,12 @@ IMGUI_API void        ImGui_ImplGlfwGL3_NewFrame();
 IMGUI_API void        ImGui_ImplGlfwGL3_InvalidateDeviceObjects();
 IMGUI_API bool        ImGui_ImplGlfwGL3_CreateDeviceObjects();
 
+// Optional: stream the vertices and indices of each draw list through the application's own buffers, rather than re-specifying the binding's
+// buffer objects every frame. The writer copies 'size' bytes from 'data' into a buffer object, sets 'offset' to where it put them and returns
+// that buffer object, or 0 to let the binding upload the draw list itself; the data has to stay there until the draw list has been drawn.
+typedef unsigned int (*ImGui_ImplGlfwGL3_StreamWriteFn)(void* user_data, const void* data, size_t size, size_t* offset);
+IMGUI_API void        ImGui_ImplGlfwGL3_SetStreamWriter(ImGui_ImplGlfwGL3_StreamWriteFn writer, void* user_data);
+
 // GLFW callbacks (installed by default if you enable 'install_callbacks' during initialization)
 // Provided here if you want to chain callbacks.
 // You can also handle inputs yourself and use those as a reference.
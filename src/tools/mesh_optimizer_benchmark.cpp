@@ -0,0 +1,126 @@
+//! \file
+//! \brief Measure, on the CPU, how the `bonobo::mesh_optimizer` stages
+//!        change the vertex cache and vertex fetch efficiency of a scene.
+//!
+//! Usage: mesh_optimizer_benchmark [scene]
+//!
+//! The scene is relative to `res/scenes`, and defaults to Sponza. It is
+//! always imported with Assimp, as the mesh cache holds optimised meshes.
+//! The vertex fetch is modelled as a FIFO cache of 64-byte lines over the
+//! positions, to show the effect of the vertex order.
+
+#include "config.hpp"
+#include "core/Log.h"
+#include "core/Misc.h"
+#include "core/mesh_cache.hpp"
+#include "core/mesh_optimizer.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+	constexpr size_t cache_line_size = 64u;
+	constexpr size_t fetch_cache_lines_nb = 32u;
+
+	struct mesh_copy {
+		std::vector<glm::vec3> vertex_data;
+		std::vector<u32> indices;
+		size_t streams_nb;
+		size_t vertices_nb;
+	};
+
+	//! \brief Count the cache lines loaded to read the positions, with a
+	//!        small FIFO cache in front of memory.
+	size_t simulate_vertex_fetch(std::vector<u32> const& indices)
+	{
+		std::vector<size_t> cache(fetch_cache_lines_nb, ~size_t(0));
+		size_t next_slot = 0u, loads_nb = 0u;
+		for (auto const vertex : indices) {
+			auto const first_byte = static_cast<size_t>(vertex) * sizeof(glm::vec3);
+			for (auto line = first_byte / cache_line_size; line <= (first_byte + sizeof(glm::vec3) - 1u) / cache_line_size; ++line) {
+				auto is_cached = false;
+				for (auto const cached_line : cache)
+					is_cached = is_cached || cached_line == line;
+				if (is_cached)
+					continue;
+				cache[next_slot] = line;
+				next_slot = (next_slot + 1u) % fetch_cache_lines_nb;
+				++loads_nb;
+			}
+		}
+		return loads_nb;
+	}
+
+	void report(char const* name, std::vector<mesh_copy> const& meshes, double time)
+	{
+		bonobo::mesh_optimizer::cache_statistics small_cache, default_cache, large_cache;
+		size_t fetched_lines_nb = 0u;
+		for (auto const& mesh : meshes) {
+			small_cache += bonobo::mesh_optimizer::simulate_vertex_cache(mesh.indices.data(), mesh.indices.size(), mesh.vertices_nb, 8u);
+			default_cache += bonobo::mesh_optimizer::simulate_vertex_cache(mesh.indices.data(), mesh.indices.size(), mesh.vertices_nb);
+			large_cache += bonobo::mesh_optimizer::simulate_vertex_cache(mesh.indices.data(), mesh.indices.size(), mesh.vertices_nb, 32u);
+			fetched_lines_nb += simulate_vertex_fetch(mesh.indices);
+		}
+		std::printf("%-28s %7.3f %7.3f %7.3f %7.3f %12.2f %10.1f\n", name,
+		            small_cache.get_acmr(), default_cache.get_acmr(), large_cache.get_acmr(), default_cache.get_atvr(),
+		            static_cast<double>(fetched_lines_nb * cache_line_size) / (1024.0 * 1024.0), time);
+	}
+
+	std::vector<mesh_copy> run(std::vector<mesh_copy> meshes, u32 stages, double& time)
+	{
+		auto const start_time = GetTimeMilliseconds();
+		for (auto& mesh : meshes) {
+			std::vector<glm::vec3*> streams(mesh.streams_nb);
+			for (size_t i = 0u; i < streams.size(); ++i)
+				streams[i] = mesh.vertex_data.data() + i * mesh.vertices_nb;
+			bonobo::mesh_optimizer::optimize(stages, mesh.indices.data(), mesh.indices.size(), streams.data(), streams.size(), mesh.vertices_nb);
+		}
+		time = GetTimeMilliseconds() - start_time;
+		return meshes;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Log::Init();
+
+	auto const filename = argc > 1 ? std::string(argv[1]) : std::string("../crysponza/sponza.obj");
+	auto const scene_filepath = config::resources_path("scenes/" + filename);
+
+	bonobo::mesh_cache::contents scene;
+	if (!bonobo::mesh_cache::import_scene(scene_filepath, 0u, bonobo::vertex_format::planar(), scene)) {
+		Log::Destroy();
+		return EXIT_FAILURE;
+	}
+
+	std::vector<mesh_copy> meshes;
+	meshes.reserve(scene.meshes.size());
+	for (auto const& mesh : scene.meshes) {
+		if (mesh.indices_nb % 3u != 0u)
+			continue;
+		auto const vertex_data = static_cast<glm::vec3 const*>(mesh.vertex_data);
+		auto const streams_nb = bonobo::mesh_cache::get_streams_nb(mesh.attributes);
+		meshes.push_back({ std::vector<glm::vec3>(vertex_data, vertex_data + streams_nb * mesh.vertices_nb),
+		                   std::vector<u32>(mesh.indices, mesh.indices + mesh.indices_nb),
+		                   streams_nb, mesh.vertices_nb });
+	}
+
+	using namespace bonobo::mesh_optimizer;
+	std::printf("%-28s %7s %7s %7s %7s %12s %10s\n", "stages", "ACMR/8", "ACMR/16", "ACMR/32", "ATVR/16", "fetched MiB", "time (ms)");
+	double time = 0.0;
+	report("none (Assimp order)", meshes, 0.0);
+	auto const cache_optimised = run(meshes, stage::vertex_cache, time);
+	report("vertex cache", cache_optimised, time);
+	auto const overdraw_optimised = run(meshes, stage::vertex_cache | stage::overdraw, time);
+	report("vertex cache, overdraw", overdraw_optimised, time);
+	auto const default_optimised = run(meshes, default_stages, time);
+	report("vertex cache, vertex fetch", default_optimised, time);
+	auto const all_optimised = run(meshes, stage::vertex_cache | stage::overdraw | stage::vertex_fetch, time);
+	report("all", all_optimised, time);
+
+	Log::Destroy();
+	return EXIT_SUCCESS;
+}
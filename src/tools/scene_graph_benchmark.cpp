@@ -0,0 +1,135 @@
+//! \file
+//! \brief Time the update of the world matrices of a solar system, with
+//!        thousands of bodies orbiting a sun, in `SceneGraph` and with the
+//!        stack-based traversal the assignments used to run every frame.
+//!
+//! Usage: scene_graph_benchmark [bodies_nb]
+//!
+//! Each body hangs from its own pivot, rotating around the sun, and every
+//! tenth body has a moon; the share of pivots rotated each frame varies
+//! from none to all of them.
+
+#include "core/Log.h"
+#include "core/Misc.h"
+#include "core/scene_graph.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stack>
+#include <vector>
+
+namespace
+{
+	constexpr int frames_nb = 200;
+
+	// Keeps the compiler from discarding the stack-based traversal.
+	volatile float sink = 0.0f;
+
+	//! \brief Node as stored before `SceneGraph`: a transform, and the
+	//!        children behind pointers.
+	struct pointer_node {
+		glm::vec3 translation;
+		glm::vec3 rotation;
+		glm::vec3 scaling;
+		std::vector<pointer_node const*> children;
+	};
+
+	//! \brief Recompute every world matrix by walking the hierarchy with
+	//!        two stacks, as the scene traversal of assignment 1 did.
+	glm::vec4 traverse(pointer_node const& root)
+	{
+		auto node_stack = std::stack<pointer_node const*>();
+		auto matrix_stack = std::stack<glm::mat4>();
+		node_stack.push(&root);
+		matrix_stack.push(glm::mat4(1.0f));
+		glm::vec4 checksum(0.0f);
+		do {
+			auto const* const node = node_stack.top();
+			node_stack.pop();
+			auto const parent_matrix = matrix_stack.top();
+			matrix_stack.pop();
+
+			auto const world = parent_matrix * SceneGraph::compose(node->translation, node->rotation, node->scaling);
+			checksum += world[3];
+
+			for (auto i = node->children.size(); i-- > 0u;) {
+				node_stack.push(node->children[i]);
+				matrix_stack.push(world);
+			}
+		} while (!node_stack.empty());
+		return checksum;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Log::Init();
+
+	auto const bodies_nb = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 5000;
+
+	// The same hierarchy is built in both representations; the pointer
+	// nodes are allocated one by one, as the assignments' nodes were, and
+	// indexed by identifier, which a new graph hands out in order.
+	SceneGraph graph;
+	std::vector<std::unique_ptr<pointer_node>> pointer_nodes;
+	auto const add_node = [&graph, &pointer_nodes](SceneGraph::node_id parent, glm::vec3 const& translation,
+	                                                glm::vec3 const& rotation, glm::vec3 const& scaling){
+		auto const id = graph.create(nullptr);
+		if (parent != SceneGraph::invalid_id)
+			graph.set_parent(id, parent);
+		graph.edit_translation(id) = translation;
+		graph.edit_rotation(id) = rotation;
+		graph.edit_scaling(id) = scaling;
+
+		pointer_nodes.emplace_back(new pointer_node{ translation, rotation, scaling, {} });
+		if (parent != SceneGraph::invalid_id)
+			pointer_nodes[parent]->children.push_back(pointer_nodes.back().get());
+		return id;
+	};
+
+	auto const sun = add_node(SceneGraph::invalid_id, glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f));
+	std::vector<SceneGraph::node_id> pivots;
+	pivots.reserve(static_cast<size_t>(bodies_nb));
+	for (int i = 0; i < bodies_nb; ++i) {
+		auto const pivot = add_node(sun, glm::vec3(0.0f), glm::vec3(0.0f, static_cast<float>(i), 0.0f), glm::vec3(1.0f));
+		auto const body = add_node(pivot, glm::vec3(2.0f + 0.01f * static_cast<float>(i), 0.0f, 0.0f), glm::vec3(0.0f), glm::vec3(0.1f));
+		if (i % 10 == 0)
+			add_node(body, glm::vec3(1.5f, 0.0f, 0.0f), glm::vec3(0.0f), glm::vec3(1.0f));
+		pivots.push_back(pivot);
+	}
+	graph.update();
+	std::printf("%u nodes\n\n", static_cast<unsigned int>(graph.get_nodes_nb()));
+
+	std::printf("%-16s %16s %18s %16s\n", "moving pivots", "updated nodes", "SceneGraph (us)", "stacks (us)");
+	for (auto const moving_share : { 0.0, 0.01, 0.1, 1.0 }) {
+		auto const step = moving_share > 0.0 ? static_cast<size_t>(1.0 / moving_share) : pivots.size();
+
+		size_t updated_nb = 0u;
+		auto start_time = GetTimeMilliseconds();
+		for (int frame = 0; frame < frames_nb; ++frame) {
+			for (size_t i = 0u; moving_share > 0.0 && i < pivots.size(); i += step) {
+				graph.edit_rotation(pivots[i]).y += 0.01f;
+				pointer_nodes[pivots[i]]->rotation.y += 0.01f;
+			}
+			graph.update();
+			updated_nb = moving_share > 0.0 ? graph.get_updated_nb() : 0u;
+		}
+		auto const graph_time = (GetTimeMilliseconds() - start_time) * 1000.0 / frames_nb;
+
+		glm::vec4 checksum(0.0f);
+		start_time = GetTimeMilliseconds();
+		for (int frame = 0; frame < frames_nb; ++frame)
+			checksum += traverse(*pointer_nodes[sun]);
+		auto const stacks_time = (GetTimeMilliseconds() - start_time) * 1000.0 / frames_nb;
+
+		sink = checksum.x;
+
+		std::printf("%15.0f%% %16u %18.1f %16.1f\n", 100.0 * moving_share, static_cast<unsigned int>(updated_nb),
+		            graph_time, stacks_time);
+	}
+
+	Log::Destroy();
+	return EXIT_SUCCESS;
+}
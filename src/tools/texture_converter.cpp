@@ -0,0 +1,147 @@
+//! \file
+//! \brief Convert PNG images into block-compressed DDS files, written next
+//!        to the images, which `bonobo::loadTexture2D()` then picks up.
+//!
+//! Usage: texture_converter [--format=auto|bc1|bc3|bc5] [--no-mipmaps]
+//!                          [--no-flip] <image.png>...
+//!
+//! Options apply to the images following them. With `auto`, normal maps,
+//! recognised by a file name containing `_normal` or `_ddn`, use BC5;
+//! images with any translucent texel use BC3, the others BC1. Normal maps
+//! named otherwise, e.g. the `_bump` ones of the assignments (a suffix
+//! Sponza uses for height maps), have to be listed after `--format=bc5`,
+//! as the `compress_textures` target does. BC5 only
+//! keeps the red and green channels, so it should only be used for data
+//! the shaders read that way, i.e. normal maps whose z component is
+//! rebuilt from x and y.
+
+#include "core/dds.hpp"
+#include "external/lodepng.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	enum class format_choice { automatic, bc1, bc3, bc5 };
+
+	bool has_translucent_texels(std::vector<unsigned char> const& pixels)
+	{
+		for (size_t i = 3u; i < pixels.size(); i += 4u)
+			if (pixels[i] != 255u)
+				return true;
+		return false;
+	}
+
+	bool is_normal_map(std::string const& path)
+	{
+		auto const separator = path.find_last_of("/\\");
+		auto name = path.substr(separator == std::string::npos ? 0u : separator + 1u);
+		std::transform(name.begin(), name.end(), name.begin(), [](char c){
+			return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		});
+		return name.find("_normal") != std::string::npos || name.find("_ddn") != std::string::npos;
+	}
+
+	char const* get_format_name(bonobo::dds::format block_format)
+	{
+		switch (block_format) {
+		case bonobo::dds::format::bc1: return "BC1";
+		case bonobo::dds::format::bc3: return "BC3";
+		case bonobo::dds::format::bc5: return "BC5";
+		}
+		return "?";
+	}
+
+	void print_usage(char const* program)
+	{
+		std::fprintf(stderr, "Usage: %s [--format=auto|bc1|bc3|bc5] [--no-mipmaps] [--no-flip] <image.png>...\n", program);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	auto choice = format_choice::automatic;
+	auto generate_mipmap = true;
+	auto flip = true;
+	size_t converted_nb = 0u, failed_nb = 0u;
+	size_t input_bytes = 0u, output_bytes = 0u;
+
+	for (int i = 1; i < argc; ++i) {
+		auto const argument = std::string(argv[i]);
+		if (argument == "--help" || argument == "-h") {
+			print_usage(argv[0]);
+			return EXIT_SUCCESS;
+		} else if (argument == "--format=auto") {
+			choice = format_choice::automatic;
+		} else if (argument == "--format=bc1") {
+			choice = format_choice::bc1;
+		} else if (argument == "--format=bc3") {
+			choice = format_choice::bc3;
+		} else if (argument == "--format=bc5") {
+			choice = format_choice::bc5;
+		} else if (argument == "--no-mipmaps") {
+			generate_mipmap = false;
+		} else if (argument == "--no-flip") {
+			flip = false;
+		} else if (argument.compare(0u, 2u, "--") == 0) {
+			std::fprintf(stderr, "Unknown option \"%s\"\n", argument.c_str());
+			print_usage(argv[0]);
+			return EXIT_FAILURE;
+		} else {
+			std::vector<unsigned char> pixels;
+			unsigned int width = 0u, height = 0u;
+			if (lodepng::decode(pixels, width, height, argument, LCT_RGBA) != 0u) {
+				std::fprintf(stderr, "Couldn't load or decode image file %s\n", argument.c_str());
+				++failed_nb;
+				continue;
+			}
+
+			auto block_format = bonobo::dds::format::bc1;
+			switch (choice) {
+			case format_choice::automatic:
+				if (is_normal_map(argument))
+					block_format = bonobo::dds::format::bc5;
+				else
+					block_format = has_translucent_texels(pixels) ? bonobo::dds::format::bc3 : bonobo::dds::format::bc1;
+				break;
+			case format_choice::bc1: block_format = bonobo::dds::format::bc1; break;
+			case format_choice::bc3: block_format = bonobo::dds::format::bc3; break;
+			case format_choice::bc5: block_format = bonobo::dds::format::bc5; break;
+			}
+
+			auto const compressed = bonobo::dds::compress(pixels.data(), width, height, block_format, generate_mipmap, flip);
+			auto const output = bonobo::dds::get_path(argument);
+			if (!bonobo::dds::write(output, compressed)) {
+				std::fprintf(stderr, "Couldn't write %s\n", output.c_str());
+				++failed_nb;
+				continue;
+			}
+
+			size_t compressed_size = 0u;
+			for (auto const& level : compressed.levels)
+				compressed_size += level.data.size();
+			std::printf("%s: %ux%u, %s, %u levels, %.1f KiB\n", output.c_str(), width, height,
+			            get_format_name(block_format), static_cast<unsigned int>(compressed.levels.size()),
+			            static_cast<double>(compressed_size) / 1024.0);
+			input_bytes += pixels.size();
+			output_bytes += compressed_size;
+			++converted_nb;
+		}
+	}
+
+	if (converted_nb == 0u && failed_nb == 0u) {
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::printf("Converted %u images (%u failed): %.1f MiB of RGBA8 base levels into %.1f MiB of compressed mip chains\n",
+	            static_cast<unsigned int>(converted_nb), static_cast<unsigned int>(failed_nb),
+	            static_cast<double>(input_bytes) / (1024.0 * 1024.0), static_cast<double>(output_bytes) / (1024.0 * 1024.0));
+	return failed_nb == 0u ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,317 @@
+//! \file
+//! \brief Compare how much memory the vertices of a scene use, and how
+//!        much of it a draw of the whole scene touches, when stored in
+//!        different vertex formats.
+//!
+//! Usage: vertex_format_benchmark [scene]
+//!
+//! The scene is relative to `res/scenes`, and defaults to Sponza. The
+//! touched memory counts each distinct 64-byte cache line read by the
+//! vertex fetch once per mesh: it is a lower bound of the bandwidth used
+//! by the vertices, which ignores the post-transform cache.
+
+#include "config.hpp"
+#include "core/Log.h"
+#include "core/Misc.h"
+#include "core/mesh_cache.hpp"
+#include "core/mesh_optimizer.hpp"
+#include "core/vertex_format.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+	constexpr size_t cache_line_size = 64u;
+
+	struct results {
+		size_t bytes;
+		size_t touched_bytes;
+		size_t touched_position_bytes; //!< as for a depth-only pass
+		double packing_time;
+		float max_normal_error; //!< in degrees
+	};
+
+	size_t get_element_size(bonobo::packed_vertices::attribute const& attribute)
+	{
+		switch (attribute.type) {
+		case GL_INT_2_10_10_10_REV: return sizeof(u32);
+		case GL_HALF_FLOAT:         return static_cast<size_t>(attribute.components_nb) * sizeof(u16);
+		case GL_SHORT:              return static_cast<size_t>(attribute.components_nb) * sizeof(i16);
+		default:                    return static_cast<size_t>(attribute.components_nb) * sizeof(float);
+		}
+	}
+
+	float decode_snorm10(u32 value, u32 shift)
+	{
+		auto bits = static_cast<i32>((value >> shift) & 0x3FFu);
+		if (bits >= 512)
+			bits -= 1024;
+		return std::max(static_cast<float>(bits) / 511.0f, -1.0f);
+	}
+
+	float decode_snorm16(i16 value)
+	{
+		return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+	}
+
+	i16 to_snorm16(float value)
+	{
+		return static_cast<i16>(std::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	//! \brief Map a unit vector onto the [-1, 1]² square, by projecting
+	//!        it onto an octahedron and unfolding the lower half.
+	glm::vec2 encode_octahedral(glm::vec3 const& direction)
+	{
+		auto const l1_norm = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+		if (l1_norm == 0.0f)
+			return glm::vec2(0.0f);
+		auto const projected = direction / l1_norm;
+		if (projected.z >= 0.0f)
+			return glm::vec2(projected.x, projected.y);
+		return glm::vec2((1.0f - std::abs(projected.y)) * (projected.x >= 0.0f ? 1.0f : -1.0f),
+		                 (1.0f - std::abs(projected.x)) * (projected.y >= 0.0f ? 1.0f : -1.0f));
+	}
+
+	//! \brief Pack vertices interleaved, with 2-float texture coordinates
+	//!        and octahedral normals and tangents: 2 normalised shorts
+	//!        each, plus 2 more for tangents to keep the handedness in w.
+	//!
+	//! No shader decodes that encoding, which is why it is not part of
+	//! `bonobo::vertex_format`; it is only measured here, to see what it
+	//! would save over the formats the vertex fetch decodes.
+	bonobo::packed_vertices pack_octahedral(bonobo::vertex_streams const& streams)
+	{
+		using bonobo::shader_bindings;
+		bonobo::packed_vertices packed;
+		packed.vertices_nb = streams.vertices_nb;
+		packed.vertex_size = 0u;
+		auto const add_attribute = [&packed](shader_bindings binding, GLint components_nb, GLenum type, size_t size){
+			packed.attributes.push_back({ binding, components_nb, type, static_cast<GLboolean>(type == GL_SHORT ? GL_TRUE : GL_FALSE), 0, packed.vertex_size });
+			packed.vertex_size += size;
+		};
+		// As with `bonobo::pack_vertices()`, binormals are only stored if
+		// they cannot be rebuilt from the normals and tangents.
+		auto const store_binormals = streams.binormals != nullptr && (streams.normals == nullptr || streams.tangents == nullptr);
+		add_attribute(shader_bindings::vertices, 3, GL_FLOAT, 3u * sizeof(float));
+		if (streams.normals != nullptr)
+			add_attribute(shader_bindings::normals, 2, GL_SHORT, 2u * sizeof(i16));
+		if (streams.texcoords != nullptr)
+			add_attribute(shader_bindings::texcoords, 2, GL_FLOAT, 2u * sizeof(float));
+		if (streams.tangents != nullptr)
+			add_attribute(shader_bindings::tangents, store_binormals ? 2 : 4, GL_SHORT, (store_binormals ? 2u : 4u) * sizeof(i16));
+		if (store_binormals)
+			add_attribute(shader_bindings::binormals, 2, GL_SHORT, 2u * sizeof(i16));
+		for (auto& attribute : packed.attributes)
+			attribute.stride = static_cast<GLsizei>(packed.vertex_size);
+
+		packed.data.resize(packed.vertex_size * packed.vertices_nb);
+		auto const write_direction = [](u8* destination, glm::vec3 const& direction, GLint components_nb, float w){
+			auto const encoded = encode_octahedral(direction);
+			i16 const values[4] = { to_snorm16(encoded.x), to_snorm16(encoded.y), 0, to_snorm16(w) };
+			std::memcpy(destination, values, static_cast<size_t>(components_nb) * sizeof(i16));
+		};
+		for (size_t v = 0u; v < packed.vertices_nb; ++v) {
+			auto* const vertex = packed.data.data() + v * packed.vertex_size;
+			for (auto const& attribute : packed.attributes) {
+				auto* const destination = vertex + attribute.offset;
+				switch (attribute.binding) {
+				case shader_bindings::vertices:
+					std::memcpy(destination, &streams.vertices[v], 3u * sizeof(float));
+					break;
+				case shader_bindings::normals:
+					write_direction(destination, streams.normals[v], attribute.components_nb, 0.0f);
+					break;
+				case shader_bindings::texcoords:
+					std::memcpy(destination, &streams.texcoords[v], 2u * sizeof(float));
+					break;
+				case shader_bindings::tangents:
+				{
+					auto handedness = 1.0f;
+					if (!store_binormals && streams.binormals != nullptr
+					    && glm::dot(glm::cross(streams.normals[v], streams.tangents[v]), streams.binormals[v]) < 0.0f)
+						handedness = -1.0f;
+					write_direction(destination, streams.tangents[v], attribute.components_nb, handedness);
+					break;
+				}
+				case shader_bindings::binormals:
+					write_direction(destination, streams.binormals[v], attribute.components_nb, 0.0f);
+					break;
+				default:
+					break;
+				}
+			}
+		}
+
+		return packed;
+	}
+
+	//! \brief Decode a normal the way the vertex fetch would, or for
+	//!        octahedral encoding a shader.
+	glm::vec3 decode_normal(u8 const* element, bonobo::packed_vertices::attribute const& attribute)
+	{
+		switch (attribute.type) {
+		case GL_INT_2_10_10_10_REV:
+		{
+			u32 value;
+			std::memcpy(&value, element, sizeof(value));
+			return glm::vec3(decode_snorm10(value, 0u), decode_snorm10(value, 10u), decode_snorm10(value, 20u));
+		}
+		case GL_HALF_FLOAT:
+		{
+			u16 values[3];
+			std::memcpy(values, element, sizeof(values));
+			return glm::vec3(glm::unpackHalf1x16(values[0]), glm::unpackHalf1x16(values[1]), glm::unpackHalf1x16(values[2]));
+		}
+		case GL_SHORT:
+		{
+			i16 values[2];
+			std::memcpy(values, element, sizeof(values));
+			auto const encoded = glm::vec2(decode_snorm16(values[0]), decode_snorm16(values[1]));
+			auto normal = glm::vec3(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+			if (normal.z < 0.0f) {
+				auto const x = normal.x;
+				normal.x = (1.0f - std::abs(normal.y)) * (x >= 0.0f ? 1.0f : -1.0f);
+				normal.y = (1.0f - std::abs(x)) * (normal.y >= 0.0f ? 1.0f : -1.0f);
+			}
+			return normal;
+		}
+		default:
+		{
+			glm::vec3 normal;
+			std::memcpy(&normal, element, sizeof(normal));
+			return normal;
+		}
+		}
+	}
+
+	//! \brief A vertex format to measure, or the octahedral encoding of
+	//!        `pack_octahedral()`.
+	struct candidate {
+		std::string name;
+		bonobo::vertex_format format;
+		bool octahedral;
+	};
+
+	results measure(bonobo::mesh_cache::contents const& scene, candidate const& tested)
+	{
+		results result = { 0u, 0u, 0u, 0.0, 0.0f };
+		std::unordered_set<size_t> touched_lines;
+
+		for (auto const& mesh : scene.meshes) {
+			auto const streams = bonobo::mesh_cache::get_vertex_streams(mesh);
+
+			auto const start_time = GetTimeMilliseconds();
+			auto const packed = tested.octahedral ? pack_octahedral(streams) : bonobo::pack_vertices(streams, tested.format);
+			result.packing_time += GetTimeMilliseconds() - start_time;
+			result.bytes += packed.data.size();
+
+			// Buffer objects are assumed to start on a cache line.
+			touched_lines.clear();
+			for (auto const& attribute : packed.attributes) {
+				auto const element_size = get_element_size(attribute);
+				auto const element_stride = attribute.stride != 0 ? static_cast<size_t>(attribute.stride) : element_size;
+				for (u32 i = 0u; i < mesh.indices_nb; ++i) {
+					auto const first_byte = attribute.offset + mesh.indices[i] * element_stride;
+					for (auto line = first_byte / cache_line_size; line <= (first_byte + element_size - 1u) / cache_line_size; ++line)
+						touched_lines.insert(line);
+				}
+				if (attribute.binding == bonobo::shader_bindings::vertices)
+					result.touched_position_bytes += touched_lines.size() * cache_line_size;
+
+				if (attribute.binding != bonobo::shader_bindings::normals)
+					continue;
+				for (u32 v = 0u; v < mesh.vertices_nb; ++v) {
+					auto const reference = streams.normals[v];
+					auto const reference_length = glm::length(reference);
+					auto const decoded = decode_normal(packed.data.data() + attribute.offset + v * element_stride, attribute);
+					auto const decoded_length = glm::length(decoded);
+					if (reference_length == 0.0f || decoded_length == 0.0f)
+						continue;
+					auto const cosine = glm::clamp(glm::dot(reference, decoded) / (reference_length * decoded_length), -1.0f, 1.0f);
+					result.max_normal_error = std::max(result.max_normal_error, glm::degrees(std::acos(cosine)));
+				}
+			}
+			result.touched_bytes += touched_lines.size() * cache_line_size;
+		}
+
+		return result;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Log::Init();
+
+	auto const filename = argc > 1 ? std::string(argv[1]) : std::string("../crysponza/sponza.obj");
+	auto const scene_filepath = config::resources_path("scenes/" + filename);
+
+	bonobo::mesh_cache::contents scene;
+	if (!bonobo::mesh_cache::load(scene_filepath, bonobo::mesh_optimizer::default_stages, bonobo::vertex_format::planar(), scene)) {
+		Log::Destroy();
+		return EXIT_FAILURE;
+	}
+
+	size_t vertices_nb = 0u, indices_nb = 0u;
+	for (auto const& mesh : scene.meshes) {
+		vertices_nb += mesh.vertices_nb;
+		indices_nb += mesh.indices_nb;
+	}
+	std::printf("%s: %u meshes, %u vertices, %u indices\n\n", filename.c_str(),
+	            static_cast<unsigned int>(scene.meshes.size()), static_cast<unsigned int>(vertices_nb),
+	            static_cast<unsigned int>(indices_nb));
+
+	using vertex_format = bonobo::vertex_format;
+	std::vector<candidate> candidates;
+	auto const add_format = [&candidates](vertex_format const& format){
+		candidates.push_back({ format.get_name(), format, false });
+	};
+	add_format(vertex_format::planar());
+	{
+		auto format = vertex_format::planar();
+		format.arrangement = vertex_format::layout::interleaved;
+		add_format(format);
+		format.texcoords = vertex_format::texcoords_encoding::float2;
+		format.directions = vertex_format::direction_encoding::half4;
+		add_format(format);
+		format.store_binormals = false;
+		add_format(format);
+		candidates.push_back({ "interleaved, octahedral, float2, no binormals", format, true });
+	}
+	add_format(vertex_format::compact());
+	{
+		auto format = vertex_format::compact();
+		format.texcoords = vertex_format::texcoords_encoding::half2;
+		add_format(format);
+	}
+
+	std::printf("%-46s %8s %10s %8s %12s %12s %10s %10s\n", "format", "B/vertex", "MiB", "ratio", "touched MiB", "depth-only", "pack (ms)", "max error");
+	double reference_bytes = 0.0;
+	for (auto const& tested : candidates) {
+		auto const result = measure(scene, tested);
+		if (reference_bytes == 0.0)
+			reference_bytes = static_cast<double>(result.bytes);
+		std::printf("%-46s %8.1f %10.2f %7.0f%% %12.2f %12.2f %10.2f %9.3f°\n", tested.name.c_str(),
+		            static_cast<double>(result.bytes) / static_cast<double>(std::max<size_t>(vertices_nb, 1u)),
+		            static_cast<double>(result.bytes) / (1024.0 * 1024.0),
+		            100.0 * static_cast<double>(result.bytes) / reference_bytes,
+		            static_cast<double>(result.touched_bytes) / (1024.0 * 1024.0),
+		            static_cast<double>(result.touched_position_bytes) / (1024.0 * 1024.0),
+		            result.packing_time, static_cast<double>(result.max_normal_error));
+	}
+	std::printf("\n\"touched MiB\" is read by the vertex fetch for each draw of the whole scene with all attributes, as in the\n"
+	            "G-buffer pass; \"depth-only\" when only reading positions, as in the shadow-map pass, which interleaving\n"
+	            "penalises.\n");
+
+	Log::Destroy();
+	return EXIT_SUCCESS;
+}